@@ -0,0 +1,128 @@
+#include "BenchHarness.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdlib>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+BenchHarness::BenchHarness(int warmup, int repetitions)
+    : m_warmup(std::max(0, warmup)), m_repetitions(std::max(1, repetitions))
+{
+}
+
+const BenchResult& BenchHarness::run(const std::string& name, int size, double items,
+    const std::function<void()>& fn, const std::function<void()>& setup) {
+    for (int i = 0; i < m_warmup; ++i) {
+        if (setup) setup();
+        fn();
+    }
+
+    std::vector<double> samples;
+    samples.reserve(m_repetitions);
+    for (int i = 0; i < m_repetitions; ++i) {
+        if (setup) setup();
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.name = name;
+    result.size = size;
+    result.repetitions = m_repetitions;
+    result.medianMs = samples[samples.size() / 2];
+    result.p95Ms = samples[std::min(samples.size() - 1, (size_t)(samples.size() * 0.95))];
+    result.minMs = samples.front();
+    double sum = 0.0;
+    for (double s : samples) sum += s;
+    result.meanMs = sum / samples.size();
+    result.itemsPerSecond = result.medianMs > 0.0 ? items / (result.medianMs / 1000.0) : 0.0;
+
+    std::printf("%-28s %6d  median %10.3f ms  p95 %10.3f ms  %10.2f M/s\n",
+        name.c_str(), size, result.medianMs, result.p95Ms, result.itemsPerSecond / 1e6);
+    std::fflush(stdout);
+
+    m_results.push_back(result);
+    return m_results.back();
+}
+
+void BenchHarness::addHash(const std::string& name, uint64_t value) {
+    m_hashes.push_back({ name, value });
+    std::printf("hash %-40s %016" PRIx64 "\n", name.c_str(), value);
+}
+
+void BenchHarness::fail(const std::string& message) {
+    m_failures.push_back(message);
+    std::printf("FAILED: %s\n", message.c_str());
+}
+
+bool BenchHarness::ok() const {
+    return m_failures.empty();
+}
+
+bool BenchHarness::compareHashes(const std::string& baselinePath) {
+    std::ifstream in(baselinePath);
+    if (!in) {
+        fail("cannot read baseline " + baselinePath);
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    const std::string text = buffer.str();
+
+    // Only our own writeJson output is expected here: "name": "hexvalue"
+    bool match = true;
+    int compared = 0;
+    for (const BenchHash& hash : m_hashes) {
+        std::string key = "\"" + hash.name + "\": \"";
+        size_t pos = text.find(key);
+        if (pos == std::string::npos) continue;
+
+        uint64_t expected = std::strtoull(text.c_str() + pos + key.size(), nullptr, 16);
+        ++compared;
+        if (expected != hash.value) {
+            char message[256];
+            std::snprintf(message, sizeof(message), "hash %s changed: baseline %016" PRIx64 ", now %016" PRIx64,
+                hash.name.c_str(), expected, hash.value);
+            fail(message);
+            match = false;
+        }
+    }
+
+    std::printf("compared %d hash(es) against %s: %s\n", compared, baselinePath.c_str(), match ? "identical" : "DIFFERENT");
+    return match;
+}
+
+bool BenchHarness::writeJson(const std::string& path) const {
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    std::fprintf(file, "{\n  \"warmup\": %d,\n  \"repetitions\": %d,\n  \"results\": [\n", m_warmup, m_repetitions);
+    for (size_t i = 0; i < m_results.size(); ++i) {
+        const BenchResult& r = m_results[i];
+        std::fprintf(file,
+            "    { \"name\": \"%s\", \"size\": %d, \"repetitions\": %d, \"median_ms\": %.6f, "
+            "\"p95_ms\": %.6f, \"min_ms\": %.6f, \"mean_ms\": %.6f, \"items_per_second\": %.1f }%s\n",
+            r.name.c_str(), r.size, r.repetitions, r.medianMs, r.p95Ms, r.minMs, r.meanMs, r.itemsPerSecond,
+            i + 1 < m_results.size() ? "," : "");
+    }
+
+    std::fprintf(file, "  ],\n  \"hashes\": {\n");
+    for (size_t i = 0; i < m_hashes.size(); ++i) {
+        std::fprintf(file, "    \"%s\": \"%016" PRIx64 "\"%s\n", m_hashes[i].name.c_str(), m_hashes[i].value,
+            i + 1 < m_hashes.size() ? "," : "");
+    }
+
+    std::fprintf(file, "  },\n  \"failures\": %zu\n}\n", m_failures.size());
+    return std::fclose(file) == 0;
+}
+
+const std::vector<BenchResult>& BenchHarness::getResults() const {
+    return m_results;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "util/Hash.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Timing statistics for one benchmark case
+struct BenchResult {
+    std::string name;
+    int size = 0;            // map edge length (0 if not size-dependent)
+    int repetitions = 0;
+    double medianMs = 0.0;
+    double p95Ms = 0.0;
+    double minMs = 0.0;
+    double meanMs = 0.0;
+    double itemsPerSecond = 0.0; // items / median time
+};
+
+// Output fingerprint recorded alongside the timings
+struct BenchHash {
+    std::string name;
+    uint64_t value = 0;
+};
+
+// Small self-contained benchmark harness: warmup runs, timed repetitions,
+// median/p95 statistics, determinism hashes and JSON output.
+class BenchHarness {
+public:
+    BenchHarness(int warmup, int repetitions);
+
+    // Times fn. setup (optional) runs before every call, untimed.
+    // items is the work per call (tiles, points...) for the throughput column.
+    const BenchResult& run(const std::string& name, int size, double items,
+        const std::function<void()>& fn,
+        const std::function<void()>& setup = nullptr);
+
+    void addHash(const std::string& name, uint64_t value);
+
+    // Marks the run as failed (shown in the summary, non-zero exit)
+    void fail(const std::string& message);
+    bool ok() const;
+
+    // Compares recorded hashes against a previous JSON report.
+    // Hashes missing from either side are ignored.
+    bool compareHashes(const std::string& baselinePath);
+
+    bool writeJson(const std::string& path) const;
+
+    const std::vector<BenchResult>& getResults() const;
+
+private:
+    int m_warmup;
+    int m_repetitions;
+    std::vector<BenchResult> m_results;
+    std::vector<BenchHash> m_hashes;
+    std::vector<std::string> m_failures;
+};
@@ -0,0 +1,1448 @@
+// terrainGen_bench: micro and macro benchmarks for the generation stages.
+//
+//   terrainGen_bench [--sizes 256,1024,4096] [--reps 5] [--warmup 1]
+//                    [--threads N] [--json out.json] [--baseline old.json]
+//
+// Every case runs on a fixed seed. Output hashes are recorded per size and
+// must not depend on the thread count; pass --baseline with the JSON of a
+// previous run to prove an optimisation left the output unchanged.
+
+#include "BenchHarness.h"
+
+#include "noise/NoiseBackend.h"
+#include "noise/OpenSimplex2.h"
+#include "noise/PerlinNoise.h"
+#include "noise/ValueNoise.h"
+#include "pipeline/GenerationWorker.h"
+#include "pipeline/TerrainPipeline.h"
+#include "render/Hillshade.h"
+#include "render/Renderer.h"
+#include "render/TilePyramid.h"
+#include "roads/AntColony.h"
+#include "shard/ShardedGenerator.h"
+#include "terrain/BiomeClassifier.h"
+#include "terrain/ErosionSimulator.h"
+#include "terrain/FlowAccumulation.h"
+#include "terrain/RiverGenerator.h"
+#include "terrain/TerrainGenerator.h"
+#include "terrain/TerrainRecipe.h"
+#include "util/Profiler.h"
+#include "util/Random.h"
+#include "util/ThreadPool.h"
+#include "world/ChunkedWorld.h"
+#include "world/CompactWorld.h"
+#include "world/WorldArchive.h"
+#include "world/WorldPyramid.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Every heap allocation in the process is counted, so the bench can check
+// that steady-state regeneration does not allocate
+static std::atomic<uint64_t> g_heapAllocations{ 0 };
+
+void* operator new(size_t size) {
+    ++g_heapAllocations;
+    if (void* memory = std::malloc(size > 0 ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+// Over-aligned: the pointer malloc returned sits just before the block
+void* operator new(size_t size, std::align_val_t alignment) {
+    ++g_heapAllocations;
+    const size_t align = (size_t)alignment;
+    void* raw = std::malloc(size + align + sizeof(void*));
+    if (!raw) throw std::bad_alloc();
+    uintptr_t block = ((uintptr_t)raw + sizeof(void*) + align - 1) & ~(uintptr_t)(align - 1);
+    reinterpret_cast<void**>(block)[-1] = raw;
+    return reinterpret_cast<void*>(block);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    if (memory) std::free(static_cast<void**>(memory)[-1]);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept {
+    if (memory) std::free(static_cast<void**>(memory)[-1]);
+}
+
+namespace {
+
+const unsigned int SEED = 1337;
+const float NOISE_TOLERANCE = 1e-5f;
+
+struct Options {
+    std::vector<int> sizes = { 256, 1024, 4096 };
+    int repetitions = 5;
+    int warmup = 1;
+    int threads = 0;
+    std::string jsonPath = "bench_results.json";
+    std::string baselinePath;
+    std::string executable; // for shard worker processes
+};
+
+void printUsage() {
+    std::printf(
+        "usage: terrainGen_bench [options]\n"
+        "  --sizes A,B,...    map edge lengths (default 256,1024,4096; up to 8192)\n"
+        "  --reps N           timed repetitions per case (default 5)\n"
+        "  --warmup N         untimed warmup runs per case (default 1)\n"
+        "  --threads N        threads for parallel stages, 0 = all (default 0)\n"
+        "  --json PATH        report path (default bench_results.json)\n"
+        "  --baseline PATH    fail if output hashes differ from this report\n");
+}
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* next = (i + 1 < argc) ? argv[i + 1] : nullptr;
+        if (!next) return false;
+
+        if (arg == "--sizes") {
+            options.sizes.clear();
+            std::stringstream list(next);
+            std::string item;
+            while (std::getline(list, item, ',')) {
+                int size = std::atoi(item.c_str());
+                if (size <= 0) return false;
+                options.sizes.push_back(size);
+            }
+        }
+        else if (arg == "--reps") options.repetitions = std::atoi(next);
+        else if (arg == "--warmup") options.warmup = std::atoi(next);
+        else if (arg == "--threads") options.threads = std::atoi(next);
+        else if (arg == "--json") options.jsonPath = next;
+        else if (arg == "--baseline") options.baselinePath = next;
+        else return false;
+        ++i;
+    }
+    return !options.sizes.empty();
+}
+
+const char* simdName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::Scalar: return "scalar";
+    case SimdLevel::SSE41:  return "sse41";
+    case SimdLevel::AVX2:   return "avx2";
+    }
+    return "?";
+}
+
+uint64_t hashTerrain(const World& world) {
+    uint64_t h = fnv1a(world.heightPlane().data(), world.heightPlane().getMemoryUsage());
+    h = fnv1a(world.moisturePlane().data(), world.moisturePlane().getMemoryUsage(), h);
+    h = fnv1a(world.temperaturePlane().data(), world.temperaturePlane().getMemoryUsage(), h);
+    return fnv1a(world.biomePlane().data(), world.biomePlane().getMemoryUsage(), h);
+}
+
+// Every plane of every tile, byte for byte
+uint64_t hashWorld(const World& world) {
+    uint64_t h = hashTerrain(world);
+    h = fnv1a(world.riverPlane().data(), world.riverPlane().getMemoryUsage(), h);
+    h = fnv1a(world.lakePlane().data(), world.lakePlane().getMemoryUsage(), h);
+    h = fnv1a(world.roadPlane().data(), world.roadPlane().getMemoryUsage(), h);
+    return fnv1a(world.settlementPlane().data(), world.settlementPlane().getMemoryUsage(), h);
+}
+
+// Keeps the optimiser from dropping otherwise unused results
+volatile float g_sink;
+
+// One noise backend; Perlin keeps the unsuffixed case names
+template <typename Backend>
+void benchNoise(BenchHarness& bench, int size, noise::NoiseBackend kind) {
+    const std::string name = noise::noiseBackendName(kind);
+    const std::string suffix = kind == noise::NoiseBackend::Perlin ? "" : "_" + name;
+    Backend backend(SEED);
+    const double points = (double)size * size;
+    const float step = 5.0f / size;
+
+    bench.run(name + "_noise", size, points, [&] {
+        float sum = 0.0f;
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                sum += backend.noise((float)x * step, (float)y * step);
+            }
+        }
+        g_sink = sum;
+    });
+
+    std::vector<float> reference((size_t)size * size);
+    bench.run("fractal_noise" + suffix, size, points, [&] {
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                reference[(size_t)y * size + x] = noise::fractalNoise(backend, (float)x * step, (float)y * step, 4, 2.0f, 0.5f);
+            }
+        }
+    });
+
+    std::vector<float> batched((size_t)size * size);
+    const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2 };
+    for (SimdLevel level : levels) {
+        if (level > PerlinNoise::bestSimdLevel()) break;
+
+        // Backends without kernels for this level would only time the scalar path again
+        float probe[8];
+        if (level != SimdLevel::Scalar && backend.fractalRowSimd(level, 0.0f, 0, 1, step, 8, 2, 2.0f, 0.5f, probe) == 0) continue;
+
+        const std::string caseName = std::string("fractal_noise_row_") + simdName(level) + suffix;
+        bench.run(caseName, size, points, [&] {
+            for (int y = 0; y < size; ++y) {
+                noise::fractalNoiseRow(backend, (float)y * step, 0, step, size, 4, 2.0f, 0.5f, &batched[(size_t)y * size], level);
+            }
+        });
+
+        float maxError = 0.0f;
+        for (size_t i = 0; i < batched.size(); ++i) {
+            maxError = std::max(maxError, std::fabs(batched[i] - reference[i]));
+        }
+        if (maxError > NOISE_TOLERANCE) {
+            bench.fail(caseName + " differs from fractalNoise by " + std::to_string(maxError));
+        }
+    }
+}
+
+void benchNoise(BenchHarness& bench, int size) {
+    benchNoise<PerlinNoise>(bench, size, noise::NoiseBackend::Perlin);
+    benchNoise<OpenSimplex2Noise>(bench, size, noise::NoiseBackend::OpenSimplex2);
+    benchNoise<ValueNoise>(bench, size, noise::NoiseBackend::Value);
+}
+
+// Every backend must stay within its bound with a mean near 0 and a spread
+// that neither collapses nor saturates
+template <typename Backend>
+void checkNoiseRange(BenchHarness& bench, noise::NoiseBackend kind, float bound) {
+    const std::string name = noise::noiseBackendName(kind);
+    const Backend backend(SEED);
+    const int size = 512;
+    const float step = 0.173f; // not a multiple of the lattice spacing
+
+    double sum = 0.0;
+    double sumSquares = 0.0;
+    float low = 0.0f;
+    float high = 0.0f;
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            const float n = backend.noise((float)x * step - 40.0f, (float)y * step - 40.0f);
+            sum += n;
+            sumSquares += (double)n * n;
+            low = std::min(low, n);
+            high = std::max(high, n);
+        }
+    }
+
+    const double count = (double)size * size;
+    const double mean = sum / count;
+    const double deviation = std::sqrt(std::max(0.0, sumSquares / count - mean * mean));
+    std::printf("%s noise: range [%.3f, %.3f], mean %.4f, std %.3f\n", name.c_str(), low, high, mean, deviation);
+
+    if (low < -bound || high > bound) bench.fail(name + " noise left [-" + std::to_string(bound) + ", " + std::to_string(bound) + "]");
+    if (std::fabs(mean) > 0.05) bench.fail(name + " noise mean " + std::to_string(mean) + " is not near 0");
+    if (deviation < 0.1 || deviation > 0.6) bench.fail(name + " noise std " + std::to_string(deviation) + " is out of range");
+    if (high - low < 1.0f) bench.fail(name + " noise covers too little of [-1, 1]");
+}
+
+void checkNoiseBackends(BenchHarness& bench) {
+    // Perlin's (1, 2) gradients reach about 1.5 near the cell centre
+    checkNoiseRange<PerlinNoise>(bench, noise::NoiseBackend::Perlin, 1.6f);
+    checkNoiseRange<OpenSimplex2Noise>(bench, noise::NoiseBackend::OpenSimplex2, 1.0f);
+    checkNoiseRange<ValueNoise>(bench, noise::NoiseBackend::Value, 1.0f);
+
+    // The default constructor is seed 1, not an empty table
+    const PerlinNoise unseeded;
+    const PerlinNoise seeded(1);
+    for (int i = 0; i < 64; ++i) {
+        const float x = i * 0.37f;
+        const float y = i * 0.61f;
+        if (unseeded.noise(x, y) != seeded.noise(x, y)) {
+            bench.fail("PerlinNoise() differs from PerlinNoise(1)");
+            break;
+        }
+    }
+
+    // A single octave counts as the minimum rather than dividing by zero
+    float row[16];
+    seeded.fractalNoiseRow(0.3f, 0, 0.11f, 16, 1, 2.0f, 0.5f, row);
+    for (int i = 0; i < 16; ++i) {
+        if (!std::isfinite(row[i]) || row[i] != seeded.fractalNoise(i * 0.11f, 0.3f, 1, 2.0f, 0.5f)) {
+            bench.fail("fractal noise with one octave is not the MIN_OCTAVES sum");
+            break;
+        }
+    }
+}
+
+// Philox4x32-10 known-answer vector; a mismatch means seeds no longer
+// reproduce the worlds they made before
+void checkRandom(BenchHarness& bench) {
+    const uint32_t expected[4] = { 0xd16cfe09u, 0x94fdccebu, 0x5001e420u, 0x24126ea1u };
+    uint32_t out[4];
+    CounterRng(0xa4093822u, RandomStream(0x299f31d0u)).block(0x243f6a88u, 0x85a308d3u, 0x13198a2eu, 0x03707344u, out);
+    if (std::memcmp(out, expected, sizeof(out)) != 0) {
+        bench.fail("CounterRng does not match the Philox4x32-10 reference");
+    }
+}
+
+// Every instrumented stage must show up once the profiler is on, with its
+// pool threads' busy time, and nothing may be recorded while it is off
+void checkProfiler(BenchHarness& bench, const Options& options) {
+    if (!Profiler::isCompiledIn()) {
+        std::printf("profiler compiled out\n");
+        return;
+    }
+
+    const int size = 256;
+    World world(size, size);
+    TerrainGenerator generator(SEED);
+    generator.setThreadCount(options.threads);
+    RiverGenerator rivers(world, SEED);
+    rivers.setThreadCount(options.threads);
+    std::vector<unsigned char> pixels;
+    auto generate = [&] {
+        generator.generate(world);
+        generator.classifyBiomes(world, BiomeRules());
+        rivers.calculateFlowDirections();
+        rivers.generateRivers();
+        rivers.generateLakes();
+        buildPixelBuffer(world, pixels);
+    };
+
+    Profiler::reset();
+    Profiler::setEnabled(true);
+    generate();
+    Profiler::setEnabled(false);
+    generate();
+
+    const std::vector<ProfileStage> stages = Profiler::getStages();
+    for (const char* name : { "terrain_noise", "classify_biomes", "flow_directions", "fill_depressions",
+        "simulate_flow", "generate_lakes", "pixel_build" }) {
+        auto stage = std::find_if(stages.begin(), stages.end(), [&](const ProfileStage& s) { return s.name == name; });
+        if (stage == stages.end() || stage->calls != 1 || stage->totalMs <= 0.0) {
+            bench.fail(std::string("profiler did not record stage ") + name + " exactly once");
+        }
+        else if (std::string(name) == "terrain_noise" && generator.getThreadCount() > 1 &&
+            stage->threadBusyMs.size() != (size_t)generator.getThreadCount()) {
+            bench.fail("profiler did not record the busy time of every terrain_noise thread");
+        }
+    }
+    std::printf("profiler recorded %zu stage(s), %zu event(s)\n", stages.size(), Profiler::getEventCount());
+    Profiler::reset();
+}
+
+// The compiled table must agree with the rules on both sides of every
+// threshold and at random points, on every SIMD path
+void checkBiomeRules(BenchHarness& bench, const std::string& name, const BiomeRuleSet& rules,
+    const BiomeRules* builtin) {
+    std::vector<float> values = { 0.0f, 1.0f, -1.0f, 2.0f };
+    for (const BiomeRule& rule : rules.getRules()) {
+        for (const BiomeCondition& c : rule.conditions) {
+            values.push_back(c.value);
+            values.push_back(std::nextafter(c.value, -1e30f));
+            values.push_back(std::nextafter(c.value, 1e30f));
+        }
+    }
+
+    std::vector<float> heights, moistures, temperatures;
+    for (float h : values) {
+        for (float m : values) {
+            for (float t : values) {
+                heights.push_back(h);
+                moistures.push_back(m);
+                temperatures.push_back(t);
+            }
+        }
+    }
+    CounterRng rng(SEED, RandomStream(99));
+    for (uint32_t i = 0; i < 100000; ++i) {
+        heights.push_back(rng.uniform(i, 0));
+        moistures.push_back(rng.uniform(i, 1));
+        temperatures.push_back(rng.uniform(i, 2));
+    }
+
+    const size_t count = heights.size();
+    std::vector<Biome> expected(count);
+    for (size_t i = 0; i < count; ++i) {
+        expected[i] = rules.classify(heights[i], moistures[i], temperatures[i]);
+        if (builtin && expected[i] != TerrainGenerator::determineBiome(heights[i], moistures[i], temperatures[i], *builtin)) {
+            bench.fail("biome rules " + name + " differ from determineBiome");
+            return;
+        }
+    }
+
+    const BiomeClassifier classifier(rules);
+    std::vector<Biome> out(count);
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41, SimdLevel::AVX2 }) {
+        classifier.classify(heights.data(), moistures.data(), temperatures.data(), out.data(), count, level);
+        if (out != expected) {
+            bench.fail("biome table " + name + " differs from its rules (SIMD level " + std::to_string((int)level) + ")");
+        }
+    }
+}
+
+void checkBiomeClassifier(BenchHarness& bench) {
+    const BiomeRules defaults;
+    checkBiomeRules(bench, "default", BiomeRuleSet::fromRules(defaults), &defaults);
+
+    BiomeRules tuned;
+    tuned.oceanLevel = 0.3f;
+    tuned.mountainLevel = 0.5f;
+    tuned.snowLevel = 0.5f;
+    tuned.desertMoisture = 0.6f;
+    checkBiomeRules(bench, "tuned", BiomeRuleSet::fromRules(tuned), &tuned);
+
+    // Text form, with every comparison and a biome the built-in rules lack
+    BiomeRuleSet custom;
+    std::string error;
+    const char* text =
+        "# comment line\n"
+        "Ocean    height <= 0.4\n"
+        "Swamp    moisture >= 0.7  temperature > 0.5   # trailing comment\n"
+        "Mountain height > 0.75\n"
+        "Desert   moisture < 0.2\n"
+        "Plains\n";
+    if (!custom.parse(text, &error)) {
+        bench.fail("biome rule text does not parse: " + error);
+        return;
+    }
+    checkBiomeRules(bench, "custom", custom, nullptr);
+
+    BiomeRuleSet roundTrip;
+    if (!roundTrip.parse(BiomeRuleSet::fromRules(defaults).toText(), &error)) {
+        bench.fail("printed biome rules do not parse: " + error);
+    }
+    else {
+        checkBiomeRules(bench, "printed", roundTrip, &defaults);
+    }
+
+    if (custom.parse("Lava height > 0.9\n") || custom.parse("Ocean height ~ 0.4\n") || custom.parse("Ocean height <\n")) {
+        bench.fail("invalid biome rule text parsed");
+    }
+}
+
+void benchSize(BenchHarness& bench, const Options& options, int size) {
+    const double tiles = (double)size * size;
+
+    benchNoise(bench, size);
+
+    // ----------- TERRAIN -----------
+
+    World world(size, size);
+    TerrainGenerator generator(SEED);
+    generator.setThreadCount(options.threads);
+    bench.run("terrain_generate", size, tiles, [&] { generator.generate(world); });
+
+    const uint64_t terrainHash = hashTerrain(world);
+    bench.addHash("terrain_" + std::to_string(size), terrainHash);
+
+    // Output must not depend on the thread count or tiling
+    {
+        World check(size, size);
+        TerrainGenerator serial(SEED);
+        serial.setThreadCount(1);
+        serial.setTileSize(48);
+        serial.generate(check);
+        if (hashTerrain(check) != terrainHash) {
+            bench.fail("terrain_" + std::to_string(size) + " differs between 1 and " + std::to_string(generator.getThreadCount()) + " threads");
+        }
+    }
+
+    // Coarse to fine: the 1/16 preview alone, then the whole pyramid, which
+    // must end in exactly the generate() map
+    {
+        WorldPyramid pyramid(size, size, WorldPyramid::levelsFor(size, size, 5));
+        const int coarsest = pyramid.getLevelCount() - 1;
+        bench.run("terrain_preview", size, tiles, [&] {
+            generator.generateLevel(pyramid.level(coarsest), coarsest, size, size);
+        });
+        bench.run("terrain_progressive", size, tiles, [&] { generator.generateProgressive(pyramid); });
+        if (hashTerrain(pyramid.level(0)) != terrainHash) {
+            bench.fail("terrain_progressive level 0 differs from generate");
+        }
+
+        // Every level holds point samples of the full map
+        for (int level = 1; level < pyramid.getLevelCount(); ++level) {
+            const World& coarse = pyramid.level(level);
+            bool same = true;
+            for (int y = 0; y < coarse.getHeight() && same; ++y) {
+                for (int x = 0; x < coarse.getWidth() && same; ++x) {
+                    same = coarse.heightPlane().at(x, y) == world.heightPlane().at(x << level, y << level) &&
+                        coarse.biomePlane().at(x, y) == world.biomePlane().at(x << level, y << level);
+                }
+            }
+            if (!same) bench.fail("terrain_progressive level " + std::to_string(level) + " is not a sample of the full map");
+        }
+    }
+
+    // A chunk cache a few chunks big must evict while sweeping the map,
+    // stay within its budget, and regenerate evicted chunks exactly
+    {
+        const int chunkSize = 64;
+        const size_t budget = 3 * World(chunkSize, chunkSize).getMemoryUsage();
+        ChunkedWorld chunked(chunkSize, budget, generator.chunkGenerator(size, size));
+        const int chunks = (size + chunkSize - 1) / chunkSize;
+        bench.run("chunked_sweep", size, tiles, [&] {
+            for (int cy = 0; cy < chunks; ++cy) {
+                for (int cx = 0; cx < chunks; ++cx) chunked.getChunk(cx, cy);
+            }
+        }, [&] { chunked.clear(); });
+        std::printf("  %llu chunk(s) evicted, %zu resident, %.1f of %.1f MB\n",
+            (unsigned long long)chunked.getEvictedChunks(), chunked.getResidentChunks(),
+            chunked.getMemoryUsage() / 1e6, budget / 1e6);
+        if (chunked.getEvictedChunks() == 0 || chunked.getMemoryUsage() > budget) {
+            bench.fail("chunked_sweep did not keep its cache within " + std::to_string(budget) + " bytes");
+        }
+
+        // Chunk (0, 0) went first, so this regenerates it; it must hold the
+        // generate() map packed like any CompactWorld
+        const uint64_t generated = chunked.getGeneratedChunks();
+        std::shared_ptr<CompactWorld> first = chunked.getChunk(0, 0);
+        const int extent = std::min(chunkSize, size);
+        World corner(extent, extent);
+        corner.copyRegion(world, 0, 0, 0, 0, extent, extent);
+        CompactWorld packed(extent, extent);
+        packed.encode(corner);
+        bool same = chunked.getGeneratedChunks() == generated + 1;
+        for (int y = 0; y < extent && same; ++y) {
+            same = std::memcmp(first->heightPlane().row(y), packed.heightPlane().row(y), extent * sizeof(uint16_t)) == 0 &&
+                std::memcmp(first->moisturePlane().row(y), packed.moisturePlane().row(y), extent) == 0 &&
+                std::memcmp(first->temperaturePlane().row(y), packed.temperaturePlane().row(y), extent) == 0 &&
+                std::memcmp(first->flagsPlane().row(y), packed.flagsPlane().row(y), extent) == 0;
+        }
+        if (!same) bench.fail("chunked_sweep regenerated chunk differs from generate");
+    }
+
+    // The cheaper and the nicer backends through the same recipe
+    for (noise::NoiseBackend backend : { noise::NoiseBackend::OpenSimplex2, noise::NoiseBackend::Value }) {
+        const std::string name = noise::noiseBackendName(backend);
+        World other(size, size);
+        TerrainGenerator backendGenerator(SEED);
+        backendGenerator.setThreadCount(options.threads);
+        backendGenerator.setNoiseBackend(backend);
+        bench.run("terrain_generate_" + name, size, tiles, [&] { backendGenerator.generate(other); });
+        bench.addHash("terrain_" + name + "_" + std::to_string(size), hashTerrain(other));
+
+        bool inRange = true;
+        for (size_t i = 0, n = other.heightPlane().size(); i < n; ++i) {
+            const float h = other.heightPlane()[i];
+            inRange &= h >= 0.0f && h <= 1.0f;
+        }
+        if (!inRange) bench.fail("terrain_generate_" + name + " left a height outside [0, 1]");
+
+        World serial(size, size);
+        backendGenerator.setThreadCount(1);
+        backendGenerator.generate(serial);
+        if (hashTerrain(serial) != hashTerrain(other)) {
+            bench.fail("terrain_" + name + "_" + std::to_string(size) + " differs between 1 and " + std::to_string(options.threads) + " threads");
+        }
+    }
+
+    // Every built-in recipe keeps its fields in [0, 1] and its own determinism
+    for (const std::string& name : TerrainRecipe::names()) {
+        if (name == "continent") continue; // terrain_generate above
+        TerrainRecipe recipe;
+        TerrainRecipe::byName(name, recipe);
+        World other(size, size);
+        TerrainGenerator recipeGenerator(SEED);
+        recipeGenerator.setThreadCount(options.threads);
+        recipeGenerator.setRecipe(recipe);
+        bench.run("terrain_recipe_" + name, size, tiles, [&] { recipeGenerator.generate(other); });
+        bench.addHash("recipe_" + name + "_" + std::to_string(size), hashTerrain(other));
+
+        bool inRange = true;
+        for (size_t i = 0, n = other.heightPlane().size(); i < n; ++i) {
+            const float h = other.heightPlane()[i];
+            const float m = other.moisturePlane()[i];
+            const float t = other.temperaturePlane()[i];
+            inRange &= h >= 0.0f && h <= 1.0f && m >= 0.0f && m <= 1.0f && t >= 0.0f && t <= 1.0f;
+        }
+        if (!inRange) bench.fail("terrain_recipe_" + name + " left a field outside [0, 1]");
+    }
+
+    Plane<Biome> biomes(size, size);
+    bench.run("determine_biome", size, tiles, [&] {
+        const float* h = world.heightPlane().data();
+        const float* m = world.moisturePlane().data();
+        const float* t = world.temperaturePlane().data();
+        Biome* out = biomes.data();
+        for (size_t i = 0, n = biomes.size(); i < n; ++i) {
+            out[i] = TerrainGenerator::determineBiome(h[i], m[i], t[i]);
+        }
+    });
+
+    {
+        const BiomeClassifier classifier;
+        Plane<Biome> table(size, size);
+        bench.run("classify_biomes", size, tiles, [&] {
+            classifier.classify(world.heightPlane().data(), world.moisturePlane().data(),
+                world.temperaturePlane().data(), table.data(), table.size());
+        });
+        if (std::memcmp(table.data(), biomes.data(), biomes.size()) != 0 ||
+            std::memcmp(table.data(), world.biomePlane().data(), biomes.size()) != 0) {
+            bench.fail("classify_biomes_" + std::to_string(size) + " differs from determineBiome");
+        }
+    }
+
+    std::vector<unsigned char> pixels;
+    bench.run("pixel_buffer", size, tiles, [&] { buildPixelBuffer(world, pixels); });
+    bench.addHash("pixels_" + std::to_string(size), fnv1a(pixels.data(), pixels.size()));
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41 }) {
+        std::vector<unsigned char> check;
+        buildPixelBuffer(world, check, level);
+        if (check != pixels) {
+            bench.fail("pixel_buffer_" + std::to_string(size) + " differs on SIMD level " + std::to_string((int)level));
+        }
+    }
+
+    // ----------- HYDROLOGY -----------
+
+    {
+        RiverGenerator rivers(world);
+        bench.run("flow_directions", size, tiles, [&] { rivers.calculateFlowDirections(); });
+        const std::vector<int>& flow = rivers.getFlowDirections();
+        bench.addHash("flow_" + std::to_string(size), fnv1a(flow.data(), flow.size() * sizeof(int)));
+    }
+
+    {
+        RiverGenerator rivers(world);
+        rivers.setThreadCount(options.threads);
+        bench.run("fill_depressions", size, tiles, [&] { rivers.fillDepressions(); });
+        const std::vector<float>& filled = rivers.getFilledHeights();
+        const std::vector<int>& basins = rivers.getBasinIds();
+        uint64_t fillHash = fnv1a(filled.data(), filled.size() * sizeof(float));
+        bench.addHash("filled_" + std::to_string(size), fnv1a(basins.data(), basins.size() * sizeof(int), fillHash));
+
+        // After filling, water can only stop in the ocean or at the map edge
+        const std::vector<int>& flow = rivers.getFlowDirections();
+        const Biome* biome = world.biomePlane().data();
+        for (int y = 1; y < size - 1; ++y) {
+            int idx = y * size + 1;
+            for (int x = 1; x < size - 1; ++x, ++idx) {
+                if (flow[idx] < 0 && biome[idx] != Biome::Ocean) {
+                    bench.fail("fill_depressions left a sink at " + std::to_string(x) + "," + std::to_string(y));
+                    y = size;
+                    break;
+                }
+            }
+        }
+        std::printf("  %zu basins filled\n", rivers.getBasins().size());
+    }
+
+    {
+        RiverGenerator rivers(world);
+        rivers.setThreadCount(options.threads);
+        rivers.calculateFlowDirections();
+        bench.run("accumulate_flow", size, tiles, [&] { rivers.accumulateFlow(); });
+        const std::vector<float>& accumulation = rivers.getAccumulation();
+        bench.addHash("accumulation_" + std::to_string(size), fnv1a(accumulation.data(), accumulation.size() * sizeof(float)));
+
+        // Band decomposition must agree with a single sequential pass
+        const std::vector<int>& flow = rivers.getFlowDirections();
+        const int dx[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+        const int dy[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+        std::vector<float> rain(accumulation.size(), 1.0f);
+        std::vector<float> banded(accumulation.size());
+        std::vector<float> single(accumulation.size());
+        accumulateFlow(flow.data(), dx, dy, rain.data(), banded.data(), size, size, nullptr, 7);
+        accumulateFlow(flow.data(), dx, dy, rain.data(), single.data(), size, size, nullptr, size);
+        for (size_t i = 0; i < single.size(); ++i) {
+            if (std::fabs(banded[i] - single[i]) > 1e-4f * single[i]) {
+                bench.fail("accumulate_flow bands disagree with a single pass at tile " + std::to_string(i));
+                break;
+            }
+        }
+
+        RiverGenerator serial(world);
+        serial.setThreadCount(1);
+        serial.calculateFlowDirections();
+        serial.accumulateFlow();
+        if (serial.getAccumulation() != accumulation) {
+            bench.fail("accumulate_flow differs between 1 and " + std::to_string(options.threads) + " threads");
+        }
+    }
+
+    std::unique_ptr<RiverGenerator> rivers;
+    auto resetWater = [&] {
+        world.riverPlane().fill(0.0f);
+        world.lakePlane().fill(false);
+        rivers.reset(new RiverGenerator(world, SEED));
+        rivers->setThreadCount(options.threads);
+    };
+
+    bench.run("generate_rivers", size, tiles, [&] { rivers->generateRivers(); }, resetWater);
+    {
+        // River sources come from the seed alone, not the clock or thread count
+        const size_t count = (size_t)size * size;
+        std::vector<float> riverStrength(world.riverPlane().data(), world.riverPlane().data() + count);
+        bench.addHash("rivers_" + std::to_string(size), fnv1a(riverStrength.data(), count * sizeof(float)));
+
+        world.riverPlane().fill(0.0f);
+        RiverGenerator serial(world, SEED);
+        serial.setThreadCount(1);
+        serial.generateRivers();
+        if (std::memcmp(world.riverPlane().data(), riverStrength.data(), count * sizeof(float)) != 0) {
+            bench.fail("generate_rivers differs between 1 and " + std::to_string(options.threads) + " threads");
+        }
+    }
+
+    bench.run("generate_catchment_rivers", size, tiles, [&] { rivers->generateCatchmentRivers(); }, resetWater);
+
+    bench.run("generate_lakes", size, tiles, [&] { rivers->generateLakes(); }, [&] {
+        resetWater();
+        rivers->generateRivers();
+    });
+
+    // ----------- ROADS -----------
+
+    {
+        AntColony colony(world, SEED);
+        colony.setThreadCount(options.threads);
+        const int placed = colony.placeSettlements(16);
+        AntColonySettings roadSettings;
+        bench.run("ant_colony", size, tiles, [&] { colony.buildRoads(roadSettings); });
+
+        double iterationMs = 0.0;
+        for (const AntIterationStats& stats : colony.getIterationStats()) iterationMs += stats.milliseconds;
+        std::printf("  %d settlement(s), %d/%d link(s) connected, setup %.2f ms, %.3f ms/iteration\n",
+            placed, colony.getConnectedLinkCount(), colony.getLinkCount(), colony.getSetupMilliseconds(),
+            iterationMs / std::max<size_t>(colony.getIterationStats().size(), 1));
+
+        const size_t count = (size_t)size * size;
+        const uint64_t settlementHash = fnv1a(world.settlementPlane().data(), count * sizeof(int));
+        bench.addHash("roads_" + std::to_string(size), fnv1a(world.roadPlane().data(), count, settlementHash));
+
+        // Only meaningful when the colony above ran on more than one thread
+        if (options.threads != 1) {
+            std::vector<bool> roads(world.roadPlane().data(), world.roadPlane().data() + count);
+            AntColony serial(world, SEED);
+            serial.setThreadCount(1);
+            serial.buildRoads(roadSettings);
+            if (!std::equal(roads.begin(), roads.end(), world.roadPlane().data())) {
+                bench.fail("ant_colony differs between 1 and " + std::to_string(options.threads) + " threads");
+            }
+        }
+        if (placed < 2 || colony.getConnectedLinkCount() != colony.getLinkCount()) {
+            bench.fail("ant_colony_" + std::to_string(size) + " left settlements unconnected");
+        }
+    }
+
+    // ----------- EROSION -----------
+
+    {
+        World eroded(world);
+        ErosionSimulator erosion(eroded, SEED);
+        erosion.setThreadCount(options.threads);
+        const ErosionSettings erosionSettings;
+        auto resetHeights = [&] { eroded.heightPlane() = world.heightPlane(); };
+
+        size_t droplets = 0;
+        const BenchResult& hydraulic = bench.run("erosion_hydraulic", size,
+            tiles * erosionSettings.dropletsPerTile, [&] { droplets = erosion.erodeHydraulic(erosionSettings); }, resetHeights);
+        std::printf("  %zu droplet(s), %.2f M droplets/s\n", droplets, hydraulic.itemsPerSecond / 1e6);
+
+        // Thermal passes move height between neighbours and never create or lose any
+        double before = 0.0;
+        double after = 0.0;
+        bench.run("erosion_thermal", size, tiles * erosionSettings.thermalIterations,
+            [&] { erosion.erodeThermal(erosionSettings); }, [&] {
+                resetHeights();
+                erosion.erodeHydraulic(erosionSettings);
+                before = 0.0;
+                for (size_t i = 0; i < eroded.heightPlane().size(); ++i) before += eroded.heightPlane()[i];
+            });
+        for (size_t i = 0; i < eroded.heightPlane().size(); ++i) after += eroded.heightPlane()[i];
+        if (std::abs(after - before) > 1e-5 * before) {
+            bench.fail("erosion_thermal changed the total height from " + std::to_string(before) + " to " + std::to_string(after));
+        }
+
+        const size_t count = (size_t)size * size;
+        double change = 0.0;
+        bool finite = true;
+        for (size_t i = 0; i < count; ++i) {
+            change += std::abs(eroded.heightPlane()[i] - world.heightPlane()[i]);
+            finite &= std::isfinite(eroded.heightPlane()[i]);
+        }
+        std::printf("  mean height change %.5f\n", change / count);
+        if (!finite || change == 0.0) bench.fail("erosion_" + std::to_string(size) + " left the heights unchanged or not finite");
+
+        const uint64_t erosionHash = fnv1a(eroded.heightPlane().data(), count * sizeof(float));
+        bench.addHash("erosion_" + std::to_string(size), erosionHash);
+
+        ErosionSimulator serial(eroded, SEED);
+        serial.setThreadCount(1);
+        resetHeights();
+        serial.erode(erosionSettings);
+        if (fnv1a(eroded.heightPlane().data(), count * sizeof(float)) != erosionHash) {
+            bench.fail("erosion differs between 1 and " + std::to_string(erosion.getThreadCount()) + " threads");
+        }
+    }
+
+    // ----------- PIPELINE -----------
+
+    PipelineSettings settings;
+    settings.seed = SEED;
+    settings.width = size;
+    settings.height = size;
+
+    std::unique_ptr<TerrainPipeline> pipeline;
+    int stagesRun = 0;
+    auto expectStages = [&](const char* name, int expected) {
+        if (stagesRun != expected) {
+            bench.fail(std::string(name) + " ran " + std::to_string(stagesRun) + " stage(s), expected " + std::to_string(expected));
+        }
+    };
+
+    bench.run("pipeline_full", size, tiles, [&] { stagesRun = pipeline->update(); }, [&] {
+        pipeline.reset(new TerrainPipeline(settings));
+        pipeline->setThreadCount(options.threads);
+    });
+    expectStages("pipeline_full", pipeline->getGraph().getStageCount());
+    if (hashTerrain(pipeline->getWorld()) != terrainHash) {
+        bench.fail("pipeline terrain differs from TerrainGenerator");
+    }
+
+    // The noise backend is part of the terrain key: switching reruns every
+    // stage and gives the generator's map for that backend
+    {
+        settings.noise = noise::NoiseBackend::Value;
+        pipeline->setSettings(settings);
+        stagesRun = pipeline->update();
+        expectStages("pipeline_noise_change", pipeline->getGraph().getStageCount());
+
+        World valueWorld(size, size);
+        TerrainGenerator valueGenerator(SEED);
+        valueGenerator.setThreadCount(options.threads);
+        valueGenerator.setNoiseBackend(noise::NoiseBackend::Value);
+        valueGenerator.generate(valueWorld);
+        if (hashTerrain(pipeline->getWorld()) != hashTerrain(valueWorld)) {
+            bench.fail("pipeline value noise terrain differs from TerrainGenerator");
+        }
+
+        settings.noise = noise::NoiseBackend::Perlin;
+        pipeline->setSettings(settings);
+        pipeline->update();
+        if (hashTerrain(pipeline->getWorld()) != terrainHash) {
+            bench.fail("pipeline terrain not restored after switching back to Perlin");
+        }
+    }
+
+    // Every repetition moves the setting to the other of two values, so
+    // each one sees a change whatever the number of repetitions
+    auto toggle = [&](float& value, float a, float b) {
+        value = value == a ? b : a;
+        pipeline->setSettings(settings);
+    };
+
+    // Puts one setting back afterwards, so later cases and checks start
+    // from the defaults
+    auto restore = [&](float& value, float original) {
+        value = original;
+        pipeline->setSettings(settings);
+        pipeline->update();
+    };
+
+    const float oceanLevel = settings.biomeRules.oceanLevel;
+    bench.run("pipeline_biome_change", size, tiles, [&] { stagesRun = pipeline->update(); }, [&] {
+        toggle(settings.biomeRules.oceanLevel, 0.40f, 0.42f);
+    });
+    expectStages("pipeline_biome_change", 7);
+    restore(settings.biomeRules.oceanLevel, oceanLevel);
+
+    const float riverThreshold = settings.riverThreshold;
+    bench.run("pipeline_river_change", size, tiles, [&] { stagesRun = pipeline->update(); }, [&] {
+        toggle(settings.riverThreshold, 0.001f, 0.002f);
+    });
+    expectStages("pipeline_river_change", 5);
+    restore(settings.riverThreshold, riverThreshold);
+
+    bench.run("pipeline_unchanged", size, tiles, [&] { stagesRun = pipeline->update(); });
+    expectStages("pipeline_unchanged", 0);
+
+    // Erosion re-runs from the kept noise heights, so every setting gives
+    // the same map as eroding fresh terrain, and turning it off restores them
+    settings.erosionEnabled = true;
+    pipeline->setSettings(settings);
+    pipeline->update();
+    const float droplets = settings.erosion.dropletsPerTile;
+    bench.run("pipeline_erosion_change", size, tiles, [&] { stagesRun = pipeline->update(); }, [&] {
+        toggle(settings.erosion.dropletsPerTile, 0.1f, droplets);
+    });
+    expectStages("pipeline_erosion_change", 8);
+    {
+        World eroded(world);
+        ErosionSimulator direct(eroded, SEED);
+        direct.setThreadCount(options.threads);
+        direct.erode(settings.erosion);
+        if (std::memcmp(pipeline->getWorld().heightPlane().data(), eroded.heightPlane().data(),
+                eroded.heightPlane().getMemoryUsage()) != 0) {
+            bench.fail("pipeline erosion differs from ErosionSimulator");
+        }
+
+        settings.erosionEnabled = false;
+        pipeline->setSettings(settings);
+        pipeline->update();
+        if (hashTerrain(pipeline->getWorld()) != terrainHash) {
+            bench.fail("pipeline terrain not restored with erosion turned off");
+        }
+        // Batch regeneration below runs with the default erosion
+        settings.erosionEnabled = true;
+        settings.erosion = ErosionSettings();
+        pipeline->setSettings(settings);
+    }
+
+    {
+        // A run cancelled during terrain leaves only terrain dirty. Going
+        // back to the settings before it reruns terrain with unchanged keys,
+        // and everything below must follow or it keeps eroding and
+        // classifying a map that terrain has since overwritten.
+        PipelineSettings first = settings;
+        first.biomeRules.oceanLevel = 0.35f;
+        first.biomeRules.mountainLevel = 0.6f;
+        PipelineSettings second = first;
+        second.seed = SEED + 100;
+
+        TerrainPipeline direct(first);
+        direct.setThreadCount(options.threads);
+        direct.update();
+
+        std::atomic<bool> cancel{ false };
+        TerrainPipeline reverted(first);
+        reverted.setThreadCount(options.threads);
+        reverted.setCancelFlag(&cancel);
+        bench.run("pipeline_cancel_revert", size, tiles, [&] { stagesRun = reverted.update(); }, [&] {
+            reverted.setSettings(second);
+            reverted.setPreviewCallback([&](int, const World&, const std::vector<unsigned char>&) { cancel = true; });
+            reverted.update();
+            if (!reverted.getGraph().isDirty("terrain")) bench.fail("pipeline_cancel_revert was not cancelled during terrain");
+            reverted.setPreviewCallback(nullptr);
+            cancel = false;
+            reverted.setSettings(first);
+        });
+        expectStages("pipeline_cancel_revert", reverted.getGraph().getStageCount());
+        if (hashWorld(reverted.getWorld()) != hashWorld(direct.getWorld()) || reverted.getPixels() != direct.getPixels()) {
+            bench.fail("pipeline_cancel_revert differs from an uncancelled run");
+        }
+    }
+
+    {
+        // Batch regeneration cycles through a few seeds. One pass over them
+        // grows the scratch to fit; after that no seed may allocate.
+        const unsigned int seeds[] = { SEED, SEED + 1, SEED + 2, SEED + 3 };
+        int nextSeed = 0;
+        auto reseed = [&] {
+            settings.seed = seeds[nextSeed++ % 4];
+            pipeline->setSettings(settings);
+        };
+        for (int i = 0; i < 4; ++i) {
+            reseed();
+            pipeline->update();
+        }
+
+        uint64_t allocations = 0;
+        bench.run("pipeline_regenerate", size, tiles, [&] {
+            uint64_t before = g_heapAllocations.load();
+            stagesRun = pipeline->update();
+            allocations += g_heapAllocations.load() - before;
+        }, reseed);
+        expectStages("pipeline_regenerate", pipeline->getGraph().getStageCount());
+        std::printf("  %llu heap allocation(s) in steady state, %.1f MB scratch\n",
+            (unsigned long long)allocations, pipeline->getScratchMemoryUsage() / (1024.0 * 1024.0));
+        if (allocations != 0) {
+            bench.fail("pipeline_regenerate made " + std::to_string(allocations) + " heap allocation(s)");
+        }
+        settings.seed = SEED;
+    }
+
+    // ----------- BACKGROUND WORKER -----------
+
+    // A burst of requests must converge on the last one and cost about one
+    // pipeline_full: stale jobs are cancelled instead of finishing
+    GenerationWorker worker(options.threads);
+    GenerationResult result;
+    PipelineSettings last = settings;
+    unsigned int burstSeed = SEED;
+    bench.run("worker_request_burst", size, tiles, [&] {
+        for (int i = 0; i < 4; ++i) {
+            last.seed = ++burstSeed;
+            worker.request(last);
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        worker.waitIdle();
+    });
+
+    // Pixels and map of a result against a direct pipeline run of the same
+    // settings; the map travels with the pixels in compact form
+    auto checkResult = [&](const std::string& name, const PipelineSettings& expectedSettings, bool printSize) {
+        TerrainPipeline direct(expectedSettings);
+        direct.setThreadCount(options.threads);
+        direct.update();
+        if (result.pixels != direct.getPixels()) {
+            bench.fail(name + " result differs from a direct pipeline run");
+        }
+
+        CompactWorld packed(size, size);
+        packed.encode(direct.getWorld());
+        const size_t count = (size_t)size * size;
+        if (result.world.getWidth() != size || result.world.getHeight() != size ||
+            std::memcmp(result.world.heightPlane().data(), packed.heightPlane().data(), count * sizeof(uint16_t)) != 0 ||
+            std::memcmp(result.world.flagsPlane().data(), packed.flagsPlane().data(), count) != 0 ||
+            std::memcmp(result.world.riverPlane().data(), packed.riverPlane().data(), count) != 0) {
+            bench.fail(name + " compact world differs from a direct pipeline run");
+        }
+        if (printSize) {
+            std::printf("  result map %.1f MB compact, %.1f MB as a World\n",
+                result.world.getMemoryUsage() / 1e6, direct.getWorld().getMemoryUsage() / 1e6);
+        }
+    };
+
+    if (!worker.takeResult(result) || result.settings.seed != last.seed) {
+        bench.fail("worker_request_burst did not deliver the last request");
+    }
+    else {
+        checkResult("worker_request_burst", last, true);
+    }
+    std::printf("  %d stale job(s) cancelled\n", worker.getCancelledCount());
+
+    {
+        // Dragging a slider away and back: the job for the new value is
+        // cancelled during terrain and the earlier settings come back. The
+        // result must match them, eroded and classified by the custom rules.
+        PipelineSettings first = settings;
+        first.erosionEnabled = true;
+        first.biomeRules.oceanLevel = 0.35f;
+        first.biomeRules.mountainLevel = 0.6f;
+        PipelineSettings second = first;
+        second.seed = SEED + 100;
+
+        worker.request(first);
+        worker.waitIdle();
+
+        // Terrain publishes its coarse previews as it goes, so a preview of
+        // the second job means terrain is still running; the rest of it
+        // takes far longer than the request below. Retried in the rare case
+        // the job got past terrain anyway.
+        bool cancelledInTerrain = false;
+        for (int attempt = 0; attempt < 4 && !cancelledInTerrain; ++attempt) {
+            const int cancelledBefore = worker.getCancelledCount();
+            const uint64_t secondId = worker.request(second);
+            while (!(worker.takeResult(result) && result.requestId == secondId && result.level > 0)) {
+                std::this_thread::yield();
+            }
+            worker.request(first);
+            worker.waitIdle();
+            cancelledInTerrain = worker.getCancelledCount() > cancelledBefore;
+        }
+        if (!cancelledInTerrain) bench.fail("worker_cancel_revert could not cancel a job during terrain");
+
+        if (!worker.takeResult(result) || result.settings.seed != first.seed || result.level != 0) {
+            bench.fail("worker_cancel_revert did not deliver the reverted request");
+        }
+        else {
+            checkResult("worker_cancel_revert", first, false);
+        }
+    }
+
+    // ----------- WORLD ARCHIVE -----------
+
+    // Full world with water plus some infrastructure so every plane is covered
+    World full = pipeline->getWorld();
+    for (int y = 0; y < size; ++y) {
+        full.roadPlane().row(y)[(y * 7) % size] = true;
+        if (y % 37 == 0) full.settlementPlane().row(y)[(y * 13) % size] = y / 37;
+    }
+    const uint64_t fullHash = hashWorld(full);
+    const double fullBytes = (double)full.getMemoryUsage();
+
+    // ----------- COMPACT WORLD -----------
+
+    {
+        ThreadPool pool(options.threads);
+        CompactWorld packed(size, size);
+        bench.run("compact_encode", size, tiles, [&] { packed.encode(full, &pool); });
+        std::printf("  %.1f MB packed, %.1fx smaller than the %.1f MB World\n",
+            packed.getMemoryUsage() / 1e6, fullBytes / packed.getMemoryUsage(), fullBytes / 1e6);
+
+        World unpacked(size, size);
+        bench.run("compact_decode", size, tiles, [&] { packed.decode(unpacked, &pool); });
+
+        // Quantization error stays within half a step; everything else is exact
+        auto maxError = [&](const Plane<float>& a, const Plane<float>& b) {
+            float error = 0.0f;
+            for (size_t i = 0; i < a.size(); ++i) error = std::max(error, std::fabs(a[i] - std::clamp(b[i], 0.0f, 1.0f)));
+            return error;
+        };
+        const float heightError = maxError(unpacked.heightPlane(), full.heightPlane());
+        const float unitError = std::max({ maxError(unpacked.moisturePlane(), full.moisturePlane()),
+            maxError(unpacked.temperaturePlane(), full.temperaturePlane()), maxError(unpacked.riverPlane(), full.riverPlane()) });
+        if (heightError > 0.5f / 65535.0f + 1e-7f || unitError > 0.5f / 255.0f + 1e-6f) {
+            bench.fail("compact_world error too large: height " + std::to_string(heightError) + ", 8-bit " + std::to_string(unitError));
+        }
+        const size_t count = (size_t)size * size;
+        if (!std::equal(full.biomePlane().data(), full.biomePlane().data() + count, unpacked.biomePlane().data()) ||
+            !std::equal(full.lakePlane().data(), full.lakePlane().data() + count, unpacked.lakePlane().data()) ||
+            !std::equal(full.roadPlane().data(), full.roadPlane().data() + count, unpacked.roadPlane().data()) ||
+            !std::equal(full.settlementPlane().data(), full.settlementPlane().data() + count, unpacked.settlementPlane().data())) {
+            bench.fail("compact_world round trip changed biomes, water or infrastructure");
+        }
+
+        // Per-tile proxies read and write like TileRef
+        const int x = size / 3, y = size / 2;
+        Tile tile = full.at(x, y);
+        tile.settlementId = 12345;
+        tile.hasRoad = !tile.hasRoad;
+        packed.at(x, y) = tile;
+        const Tile back = packed.at(x, y);
+        if (back.biome != tile.biome || back.hasRoad != tile.hasRoad || back.isLake != tile.isLake ||
+            back.settlementId != 12345 || std::fabs(back.height - tile.height) > 0.5f / 65535.0f + 1e-7f) {
+            bench.fail("compact_world tile proxy does not round-trip");
+        }
+        packed.at(x, y).settlementId = -1;
+        if (packed.settlements().get((uint32_t)(y * size + x)) != -1) bench.fail("compact_world kept a removed settlement");
+
+        // Every SIMD level packs and shades the same bytes
+        for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41 }) {
+            CompactWorld check(size, size);
+            check.encode(full, nullptr, level);
+            if (std::memcmp(check.heightPlane().data(), packed.heightPlane().data(), count * sizeof(uint16_t)) != 0 ||
+                std::memcmp(check.moisturePlane().data(), packed.moisturePlane().data(), count) != 0 ||
+                std::memcmp(check.riverPlane().data(), packed.riverPlane().data(), count) != 0) {
+                bench.fail("compact_encode differs on SIMD level " + std::to_string((int)level));
+            }
+        }
+
+        std::vector<unsigned char> compactPixels;
+        bench.run("compact_pixel_buffer", size, tiles, [&] { buildPixelBuffer(packed, compactPixels); });
+        for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41 }) {
+            std::vector<unsigned char> check;
+            buildPixelBuffer(packed, check, level);
+            if (check != compactPixels) {
+                bench.fail("compact_pixel_buffer differs on SIMD level " + std::to_string((int)level));
+            }
+        }
+    }
+
+    const std::string archivePath = (std::filesystem::temp_directory_path() /
+        ("terrainGen_bench_" + std::to_string(size) + ".tgw")).string();
+
+    bench.run("archive_save", size, tiles, [&] {
+        if (!saveWorldArchive(archivePath, full, 256, options.threads)) bench.fail("archive_save could not write " + archivePath);
+    });
+
+    WorldArchive archive;
+    bench.run("archive_open", size, tiles, [&] { archive.open(archivePath); }, [&] { archive.close(); });
+    if (!archive.isOpen()) {
+        bench.fail("archive_open could not open " + archivePath);
+        return;
+    }
+    std::printf("  %.1f MB on disk, %.1f%% of the %.1f MB in memory\n",
+        archive.getFileSize() / 1e6, 100.0 * archive.getFileSize() / fullBytes, fullBytes / 1e6);
+
+    World loaded(size, size);
+    bench.run("archive_read_world", size, tiles, [&] {
+        if (!archive.readWorld(loaded, options.threads)) bench.fail("archive_read_world failed");
+    });
+    if (hashWorld(loaded) != fullHash) bench.fail("archive round trip changed the world");
+
+    World chunk(archive.getChunkSize(), archive.getChunkSize());
+    const int middle = archive.getChunksX() / 2;
+    bench.run("archive_read_chunk", size, (double)chunk.getWidth() * chunk.getHeight(), [&] {
+        archive.readChunk(middle, middle, chunk);
+    });
+
+    // Lazy loading through a ChunkedWorld whose chunks straddle archive
+    // chunks; it keeps them compact, so heights come back quantized
+    {
+        ChunkedWorld lazy(100, 64u << 20, archive.chunkSource());
+        for (int y = 0; y < size; y += 7) {
+            for (int x = 0; x < size; x += 5) {
+                Tile a = lazy.getTile(x, y);
+                Tile b = full.at(x, y);
+                using Unit16 = compact::UnitRef<uint16_t>;
+                if (a.height != Unit16::decode(Unit16::encode(b.height)) || a.biome != b.biome ||
+                    a.isLake != b.isLake || a.hasRoad != b.hasRoad || a.settlementId != b.settlementId) {
+                    bench.fail("archive chunkSource differs at " + std::to_string(x) + "," + std::to_string(y));
+                    y = size;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Streaming save straight from the generator, never holding the world
+    bench.run("archive_save_streamed", size, tiles, [&] {
+        saveWorldArchive(archivePath, size, size, 256, generator.chunkGenerator(size, size), options.threads);
+    });
+    archive.open(archivePath);
+    archive.readWorld(loaded, options.threads);
+    if (hashTerrain(loaded) != terrainHash) bench.fail("archive_save_streamed terrain differs from generate");
+
+    // A damaged chunk must be reported, not decoded
+    archive.close();
+    {
+        std::fstream file(archivePath, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(-16, std::ios::end);
+        file.put('\x5A');
+    }
+    archive.open(archivePath);
+    if (archive.readChunk(archive.getChunksX() - 1, archive.getChunksY() - 1, chunk)) {
+        bench.fail("archive_read_chunk accepted a corrupt chunk");
+    }
+    archive.close();
+    std::filesystem::remove(archivePath);
+}
+
+// Sharded generation must match one process bit for bit, with workers on
+// threads and in child processes alike
+void benchSharded(BenchHarness& bench, const Options& options, int size) {
+    std::printf("sharded %dx%d\n", size, size);
+    const double tiles = (double)size * size;
+
+    ShardSettings settings;
+    settings.width = size;
+    settings.height = size;
+    settings.seed = SEED;
+    settings.shardRows = FLOW_BAND_ROWS;
+    settings.threadsPerShard = options.threads;
+
+    World reference(size, size);
+    TerrainGenerator generator(SEED);
+    generator.setThreadCount(options.threads);
+    generator.generate(reference);
+    RiverGenerator rivers(reference, SEED);
+    rivers.setThreadCount(options.threads);
+    rivers.calculateFlowDirections();
+    rivers.accumulateFlow(settings.moistureInfluence);
+    rivers.applyRiverStrength(settings.riverThreshold);
+    const uint64_t referenceHash = hashWorld(reference);
+
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() /
+        ("terrainGen_bench_shards_" + std::to_string(size));
+    const std::string outPath = (directory / "world.tgw").string();
+    World loaded(size, size);
+    auto check = [&](const char* name, ShardLauncher& launcher) {
+        ShardedGenerator sharded(settings, launcher);
+        sharded.setThreadCount(options.threads);
+        if (!sharded.generate(directory.string(), outPath)) {
+            bench.fail(std::string(name) + ": " + sharded.getError());
+            return;
+        }
+        WorldArchive archive;
+        if (!archive.open(outPath) || !archive.readWorld(loaded, options.threads)) {
+            bench.fail(std::string(name) + " could not read back " + outPath);
+            return;
+        }
+        if (hashWorld(loaded) != referenceHash) bench.fail(std::string(name) + " differs from a single process");
+    };
+
+    InProcessLauncher threads(options.threads);
+    bench.run("shard_generate", size, tiles, [&] { check("shard_generate", threads); });
+    bench.addHash("sharded_" + std::to_string(size), hashWorld(loaded));
+    std::printf("  %d shard(s) of %d rows\n", ShardedGenerator(settings, threads).getShardCount(), settings.shardRows);
+
+    ProcessLauncher processes({ { options.executable } });
+    check("shard_generate_processes", processes);
+    std::filesystem::remove_all(directory);
+}
+
+// Tile pyramid export: every base tile must equal the full-map pixel
+// buffer, every level must be present, and the result must not depend on
+// the thread count
+void benchTilePyramid(BenchHarness& bench, const Options& options, int size) {
+    std::printf("tile pyramid %dx%d\n", size, size);
+    const double tiles = (double)size * size;
+
+    World world(size, size);
+    TerrainGenerator generator(SEED);
+    generator.setThreadCount(1); // the exporter parallelises across chunks
+    generator.generate(world);
+    std::vector<unsigned char> pixels;
+    buildPixelBuffer(world, pixels);
+    const ChunkGenerator source = generator.chunkGenerator(size, size);
+
+    TilePyramidExporter exporter(options.threads);
+    const std::filesystem::path directory = std::filesystem::temp_directory_path() /
+        ("terrainGen_bench_tiles_" + std::to_string(size));
+    bench.run("tile_pyramid", size, tiles, [&] {
+        if (!exporter.write(directory.string(), size, size, source)) bench.fail("tile_pyramid could not write " + directory.string());
+    });
+    const TilePyramidStats stats = exporter.getStats();
+    std::printf("  %d level(s), %llu tile(s), %.1f MB/s exported, %.1f MB/s PNG encoding per thread, "
+        "%.1f MB of PNG (%.0f%% of raw), %.1f MB buffers, %.1f MB peak RSS\n",
+        stats.levels, (unsigned long long)stats.tiles, stats.megabytesPerSecond(), stats.encodeMegabytesPerSecond(),
+        stats.fileBytes / 1e6, stats.compressionRatio() * 100.0, stats.bufferBytes / 1e6, stats.peakResidentBytes / 1e6);
+    std::filesystem::remove_all(directory);
+
+    // Order-independent hash of every tile
+    auto exportHash = [&](int threads, int width, int height, const ChunkGenerator& from, int tileSize) {
+        std::atomic<uint64_t> hash{ 0 };
+        std::atomic<uint64_t> count{ 0 };
+        TilePyramidExporter check(threads);
+        check.setTileSize(tileSize);
+        const int maxZoom = TilePyramidExporter::levelsFor(width, height, tileSize) - 1;
+        const size_t rowBytes = (size_t)tileSize * 3;
+        check.write(width, height, from, [&](int z, int x, int y, const uint8_t* rgb) {
+            if (z == maxZoom && width == size && height == size) {
+                for (int row = 0; row < tileSize && y * tileSize + row < size; ++row) {
+                    const size_t inside = (size_t)std::min(tileSize, size - x * tileSize) * 3;
+                    if (std::memcmp(rgb + row * rowBytes,
+                            pixels.data() + ((size_t)(y * tileSize + row) * size + x * tileSize) * 3, inside) != 0) {
+                        bench.fail("tile_pyramid base tile " + std::to_string(x) + "/" + std::to_string(y) + " differs from the pixel buffer");
+                        break;
+                    }
+                }
+            }
+            const int key[3] = { z, x, y };
+            hash += fnv1a(rgb, rowBytes * tileSize, fnv1a(key, sizeof(key)));
+            ++count;
+            return true;
+        });
+
+        uint64_t expected = 0;
+        for (int z = 0; z <= maxZoom; ++z) {
+            const int level = maxZoom - z;
+            const uint64_t across = (WorldPyramid::levelExtent(width, level) + tileSize - 1) / tileSize;
+            const uint64_t down = (WorldPyramid::levelExtent(height, level) + tileSize - 1) / tileSize;
+            expected += across * down;
+        }
+        if (count != expected || check.getStats().tiles != expected) {
+            bench.fail("tile_pyramid wrote " + std::to_string(count.load()) + " tile(s), expected " + std::to_string(expected));
+        }
+        return hash.load();
+    };
+
+    const uint64_t tileHash = exportHash(options.threads, size, size, source, 256);
+    bench.addHash("tiles_" + std::to_string(size), tileHash);
+    if (exportHash(1, size, size, source, 256) != tileHash) bench.fail("tile_pyramid differs between thread counts");
+
+    // A ragged map with small tiles takes the map-edge paths on every level
+    const int width = size * 3 / 4 + 5;
+    const int height = size / 2 + 3;
+    const ChunkGenerator ragged = [&](World& chunk, int originX, int originY) {
+        const int w = std::max(0, std::min(chunk.getWidth(), width - originX));
+        const int h = std::max(0, std::min(chunk.getHeight(), height - originY));
+        chunk.copyRegion(world, originX, originY, 0, 0, w, h);
+    };
+    if (exportHash(options.threads, width, height, ragged, 32) != exportHash(1, width, height, ragged, 32)) {
+        bench.fail("tile_pyramid on a ragged map differs between thread counts");
+    }
+}
+
+// Hillshaded relief: every SIMD level and thread count must give the same
+// bytes, and in the pipeline moving the sun must only re-run the pixels
+void benchHillshade(BenchHarness& bench, const Options& options, int size) {
+    std::printf("hillshade %dx%d\n", size, size);
+    const double tiles = (double)size * size;
+
+    PipelineSettings settings;
+    settings.seed = SEED;
+    settings.width = size;
+    settings.height = size;
+    settings.hillshadeEnabled = true;
+    TerrainPipeline pipeline(settings);
+    pipeline.setThreadCount(options.threads);
+    pipeline.update();
+    const World& world = pipeline.getWorld();
+
+    HillshadeRenderer renderer(options.threads);
+    HillshadeSettings relief;
+    bench.run("hillshade_prepare", size, tiles, [&] { renderer.prepare(world, relief); });
+
+    // Each repetition moves the sun to the other of two azimuths
+    const float azimuth = relief.sunAzimuth;
+    auto moveSun = [&](HillshadeSettings& sun) {
+        sun.sunAzimuth = sun.sunAzimuth == azimuth ? 300.0f : azimuth;
+    };
+
+    std::vector<unsigned char> pixels;
+    bench.run("hillshade_relight", size, tiles, [&] { renderer.relight(relief, pixels); }, [&] { moveSun(relief); });
+    relief.sunAzimuth = azimuth;
+    renderer.relight(relief, pixels);
+    bench.addHash("relief_" + std::to_string(size), fnv1a(pixels.data(), pixels.size()));
+    std::printf("  %.1f MB of normals and albedo\n", renderer.getMemoryUsage() / 1e6);
+
+    if (pixels != pipeline.getPixels()) {
+        bench.fail("hillshade_" + std::to_string(size) + " differs from the pipeline pixels");
+    }
+    for (SimdLevel level : { SimdLevel::Scalar, SimdLevel::SSE41 }) {
+        std::vector<unsigned char> check;
+        renderer.relight(relief, check, level);
+        if (check != pixels) {
+            bench.fail("hillshade_" + std::to_string(size) + " differs on SIMD level " + std::to_string((int)level));
+        }
+    }
+    {
+        HillshadeRenderer serial(1);
+        std::vector<unsigned char> check;
+        serial.render(world, relief, check);
+        if (check != pixels) bench.fail("hillshade_" + std::to_string(size) + " differs between thread counts");
+    }
+
+    int stagesRun = 0;
+    bench.run("pipeline_relight", size, tiles, [&] { stagesRun = pipeline.update(); }, [&] {
+        moveSun(settings.hillshade);
+        pipeline.setSettings(settings);
+    });
+    if (stagesRun != 1) {
+        bench.fail("pipeline_relight ran " + std::to_string(stagesRun) + " stage(s), expected 1");
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int workerExit;
+    if (handleShardWorker(argc, argv, workerExit)) return workerExit;
+
+    Options options;
+    options.executable = currentExecutable(argv[0]);
+    if (!parseArgs(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    std::printf("terrainGen_bench: %d thread(s), SIMD %s, %d warmup + %d reps\n",
+        options.threads > 0 ? options.threads : ThreadPool::hardwareThreads(),
+        simdName(PerlinNoise::bestSimdLevel()), options.warmup, options.repetitions);
+
+    BenchHarness bench(options.warmup, options.repetitions);
+    checkRandom(bench);
+    checkNoiseBackends(bench);
+    checkBiomeClassifier(bench);
+    checkProfiler(bench, options);
+    for (int size : options.sizes) {
+        benchSize(bench, options, size);
+        benchSharded(bench, options, size);
+        benchTilePyramid(bench, options, size);
+        benchHillshade(bench, options, size);
+    }
+
+    if (!options.baselinePath.empty()) {
+        bench.compareHashes(options.baselinePath);
+    }
+
+    if (!bench.writeJson(options.jsonPath)) {
+        std::fprintf(stderr, "Cannot write %s\n", options.jsonPath.c_str());
+        return 1;
+    }
+    std::printf("wrote %s\n", options.jsonPath.c_str());
+    return bench.ok() ? 0 : 1;
+}
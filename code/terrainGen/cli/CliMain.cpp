@@ -0,0 +1,529 @@
+// Headless batch generator: no window, no GL context.
+//
+//   terrainGenCli --seed 42 --seeds 100-115 --size 2048x2048 --out maps
+//
+// Every seed writes <out>/seed_<N>_{biome,height,rivers}.png and
+// <out>/seed_<N>_{height,rivers}.f32, plus <out>/seed_<N>.tgw with
+// --archive and a z/x/y PNG tile pyramid in <out>/seed_<N>_tiles with
+// --tiles. --relief adds <out>/seed_<N>_relief.png, the biome colours
+// hillshaded by a sun set with --sun. --biome-rules classifies with a rule
+// file instead of the built-in rules (--print-biome-rules prints those as
+// a starting point).
+// --roads N places N settlements and joins them with ant-colony roads,
+// written to <out>/seed_<N>_roads.png with per-iteration timing.
+// --recipe picks a built-in terrain recipe (continent, archipelago),
+// --noise the noise backend (perlin, simplex, value).
+// --erosion D erodes the heights with D droplets per tile (plus --thermal
+// passes of thermal erosion) before biomes, rivers and roads.
+// --profile F / --trace F write per-stage timings as JSON and a Chrome
+// trace (needs a build with TERRAINGEN_PROFILE).
+// --shard-rows N generates each map as row strips of N rows in worker
+// processes (--shard-jobs at a time, started with --shard-command, default
+// this executable) and stitches them into <out>/seed_<N>.tgw with
+// catchment rivers; see shard/ShardedGenerator.h.
+// Several seeds are generated concurrently, one per thread; a single seed
+// uses all threads itself.
+
+#include "render/Hillshade.h"
+#include "render/Renderer.h"
+#include "render/TilePyramid.h"
+#include "roads/AntColony.h"
+#include "shard/ShardedGenerator.h"
+#include "terrain/ErosionSimulator.h"
+#include "terrain/RiverGenerator.h"
+#include "terrain/TerrainGenerator.h"
+#include "terrain/TerrainRecipe.h"
+#include "util/ImageWriter.h"
+#include "util/Profiler.h"
+#include "util/ThreadPool.h"
+#include "world/WorldArchive.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::vector<unsigned int> seeds;
+    int width = 1024;
+    int height = 1024;
+    std::string outDir = ".";
+    int threads = 0;
+    int riverSources = 50;
+    TerrainRecipe recipe;
+    std::string recipeName = "continent";
+    noise::NoiseBackend noiseBackend = noise::NoiseBackend::Perlin;
+    bool erode = false;
+    ErosionSettings erosion;
+    bool writePngs = true;
+    bool writeRaw = true;
+    bool writeArchive = false;
+    bool writeTiles = false;
+    bool writeRelief = false;
+    HillshadeSettings relief;
+    std::string biomeRulesPath;
+    int settlements = 0;
+    AntColonySettings roads;
+    bool verbose = false;
+    bool printBiomeRules = false;
+    std::string profilePath;
+    std::string tracePath;
+    int shardRows = 0; // 0 = one process
+    int shardJobs = 0;
+    std::vector<std::vector<std::string>> shardCommands;
+    bool keepShards = false;
+    std::string executable;
+};
+
+void printUsage() {
+    std::printf(
+        "usage: terrainGenCli [options]\n"
+        "  --seed N          generate seed N (repeatable)\n"
+        "  --seeds A-B       generate seeds A through B\n"
+        "  --size WxH        map size in tiles (default 1024x1024)\n"
+        "  --out DIR         output directory (default .)\n"
+        "  --threads N       worker threads, 0 = all cores (default 0)\n"
+        "  --rivers N        river sources per map (default 50)\n"
+        "  --recipe NAME     terrain recipe: continent (default) or archipelago\n"
+        "  --noise NAME      noise backend: perlin (default), simplex or value\n"
+        "  --erosion D       erode with D droplets per tile (e.g. 0.25) before rivers\n"
+        "  --thermal N       thermal erosion passes with --erosion (default 8)\n"
+        "  --no-png          skip PNG output\n"
+        "  --no-raw          skip raw float32 output\n"
+        "  --archive         write a .tgw world archive\n"
+        "  --tiles           write a z/x/y PNG tile pyramid (slippy map)\n"
+        "  --relief          write a hillshaded relief PNG\n"
+        "  --sun AZ,EL       sun azimuth and elevation in degrees (default 315,45)\n"
+        "  --biome-rules F   classify biomes with the rule file F\n"
+        "  --print-biome-rules  print the built-in biome rules and exit\n"
+        "  --roads N         place N settlements and build roads between them\n"
+        "  --road-iterations N  ant colony iterations (default 40)\n"
+        "  --ants N          ants per iteration (default 64)\n"
+        "  --verbose         print the timing of every road iteration\n"
+        "  --profile F       write per-stage timings to the JSON file F\n"
+        "  --trace F         write a Chrome trace (chrome://tracing) to F\n"
+        "  --shard-rows N    generate in worker processes, N rows per shard;\n"
+        "                    writes only the .tgw archive, with catchment rivers\n"
+        "  --shard-jobs N    worker processes at once, 0 = one per core (default 0)\n"
+        "  --shard-command C start workers with command C, split on spaces\n"
+        "                    (repeatable, round robin; default this executable)\n"
+        "  --keep-shards     keep the shard files next to the archive\n");
+}
+
+bool parseUnsigned(const char* text, unsigned int& value) {
+    char* end = nullptr;
+    unsigned long v = std::strtoul(text, &end, 10);
+    if (end == text || *end != '\0') return false;
+    value = (unsigned int)v;
+    return true;
+}
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        const char* next = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+        if (arg == "--seed" && next) {
+            unsigned int seed;
+            if (!parseUnsigned(next, seed)) return false;
+            options.seeds.push_back(seed);
+            ++i;
+        }
+        else if (arg == "--seeds" && next) {
+            unsigned int first, last;
+            if (std::sscanf(next, "%u-%u", &first, &last) != 2 || last < first) return false;
+            for (unsigned int s = first; s <= last; ++s) {
+                options.seeds.push_back(s);
+                if (s == last) break; // avoid wrap-around at UINT_MAX
+            }
+            ++i;
+        }
+        else if (arg == "--size" && next) {
+            if (std::sscanf(next, "%dx%d", &options.width, &options.height) != 2) return false;
+            if (options.width <= 0 || options.height <= 0) return false;
+            ++i;
+        }
+        else if (arg == "--out" && next) {
+            options.outDir = next;
+            ++i;
+        }
+        else if (arg == "--threads" && next) {
+            options.threads = std::atoi(next);
+            ++i;
+        }
+        else if (arg == "--rivers" && next) {
+            options.riverSources = std::atoi(next);
+            ++i;
+        }
+        else if (arg == "--recipe" && next) {
+            if (!TerrainRecipe::byName(next, options.recipe)) {
+                std::fprintf(stderr, "Unknown recipe %s\n", next);
+                return false;
+            }
+            options.recipeName = next;
+            ++i;
+        }
+        else if (arg == "--noise" && next) {
+            if (!noise::parseNoiseBackend(next, options.noiseBackend)) {
+                std::fprintf(stderr, "Unknown noise backend %s\n", next);
+                return false;
+            }
+            ++i;
+        }
+        else if (arg == "--erosion" && next) {
+            options.erosion.dropletsPerTile = (float)std::atof(next);
+            options.erode = true;
+            ++i;
+        }
+        else if (arg == "--thermal" && next) {
+            options.erosion.thermalIterations = std::atoi(next);
+            ++i;
+        }
+        else if (arg == "--no-png") {
+            options.writePngs = false;
+        }
+        else if (arg == "--no-raw") {
+            options.writeRaw = false;
+        }
+        else if (arg == "--archive") {
+            options.writeArchive = true;
+        }
+        else if (arg == "--tiles") {
+            options.writeTiles = true;
+        }
+        else if (arg == "--relief") {
+            options.writeRelief = true;
+        }
+        else if (arg == "--sun" && next) {
+            if (std::sscanf(next, "%f,%f", &options.relief.sunAzimuth, &options.relief.sunElevation) != 2) return false;
+            ++i;
+        }
+        else if (arg == "--biome-rules" && next) {
+            options.biomeRulesPath = next;
+            ++i;
+        }
+        else if (arg == "--print-biome-rules") {
+            options.printBiomeRules = true;
+        }
+        else if (arg == "--roads" && next) {
+            options.settlements = std::atoi(next);
+            ++i;
+        }
+        else if (arg == "--road-iterations" && next) {
+            options.roads.iterations = std::atoi(next);
+            ++i;
+        }
+        else if (arg == "--ants" && next) {
+            options.roads.colonySize = std::atoi(next);
+            ++i;
+        }
+        else if (arg == "--verbose") {
+            options.verbose = true;
+        }
+        else if (arg == "--profile" && next) {
+            options.profilePath = next;
+            ++i;
+        }
+        else if (arg == "--trace" && next) {
+            options.tracePath = next;
+            ++i;
+        }
+        else if (arg == "--shard-rows" && next) {
+            options.shardRows = std::atoi(next);
+            if (options.shardRows <= 0) return false;
+            ++i;
+        }
+        else if (arg == "--shard-jobs" && next) {
+            options.shardJobs = std::atoi(next);
+            ++i;
+        }
+        else if (arg == "--shard-command" && next) {
+            std::vector<std::string> command;
+            std::stringstream words(next);
+            std::string word;
+            while (words >> word) command.push_back(word);
+            if (command.empty()) return false;
+            options.shardCommands.push_back(command);
+            ++i;
+        }
+        else if (arg == "--keep-shards") {
+            options.keepShards = true;
+        }
+        else {
+            return false;
+        }
+    }
+    if (options.shardRows > 0 && (options.erode || options.settlements > 0 || !options.biomeRulesPath.empty())) {
+        std::fprintf(stderr, "--shard-rows cannot be combined with --erosion, --roads or --biome-rules\n");
+        return false;
+    }
+    return !options.seeds.empty() || options.printBiomeRules;
+}
+
+// <prefix>_tiles/z/x/y.png from any chunk source, in constant memory
+bool writeTiles(const std::string& prefix, int width, int height, const ChunkGenerator& source, int threads) {
+    TilePyramidExporter exporter(threads);
+    const bool ok = exporter.write(prefix + "_tiles", width, height, source);
+    const TilePyramidStats& stats = exporter.getStats();
+    std::printf("%s_tiles: %d level(s), %llu tile(s), %.1f MB (%.0f%% of raw) in %.2fs, %.1f MB/s, "
+        "PNG encoding %.1f MB/s per thread, %.1f MB peak RSS\n",
+        prefix.c_str(), stats.levels, (unsigned long long)stats.tiles, stats.fileBytes / 1e6,
+        stats.compressionRatio() * 100.0, stats.seconds, stats.megabytesPerSecond(),
+        stats.encodeMegabytesPerSecond(), stats.peakResidentBytes / 1e6);
+    return ok;
+}
+
+bool writeOutputs(const Options& options, const World& world, const std::string& prefix, int threads) {
+    const int width = world.getWidth();
+    const int height = world.getHeight();
+    const size_t tiles = (size_t)width * height;
+    bool ok = true;
+
+    if (options.writePngs) {
+        std::vector<unsigned char> pixels;
+        buildPixelBuffer(world, pixels);
+        ok &= writePng(prefix + "_biome.png", width, height, 3, pixels.data());
+
+        std::vector<uint16_t> heights(tiles);
+        const float* h = world.heightPlane().data();
+        for (size_t i = 0; i < tiles; ++i) {
+            heights[i] = (uint16_t)(h[i] * 65535.0f + 0.5f);
+        }
+        ok &= writePng16(prefix + "_height.png", width, height, heights.data());
+
+        // Rivers in proportion to strength, lakes at full intensity
+        std::vector<uint8_t> water(tiles);
+        const float* rivers = world.riverPlane().data();
+        const bool* lakes = world.lakePlane().data();
+        for (size_t i = 0; i < tiles; ++i) {
+            water[i] = lakes[i] ? 255 : (uint8_t)(rivers[i] * 255.0f + 0.5f);
+        }
+        ok &= writePng(prefix + "_rivers.png", width, height, 1, water.data());
+
+        if (options.settlements > 0) {
+            // Settlements at full intensity, roads dimmer
+            std::vector<uint8_t> roads(tiles);
+            const bool* road = world.roadPlane().data();
+            const int* settlement = world.settlementPlane().data();
+            for (size_t i = 0; i < tiles; ++i) {
+                roads[i] = settlement[i] >= 0 ? 255 : road[i] ? 160 : 0;
+            }
+            ok &= writePng(prefix + "_roads.png", width, height, 1, roads.data());
+        }
+    }
+
+    if (options.writeRelief) {
+        std::vector<unsigned char> pixels;
+        HillshadeRenderer relief(threads);
+        relief.render(world, options.relief, pixels);
+        ok &= writePng(prefix + "_relief.png", width, height, 3, pixels.data());
+    }
+
+    if (options.writeRaw) {
+        ok &= writeRawFloats(prefix + "_height.f32", world.heightPlane().data(), tiles);
+        ok &= writeRawFloats(prefix + "_rivers.f32", world.riverPlane().data(), tiles);
+    }
+
+    if (options.writeArchive) {
+        ok &= saveWorldArchive(prefix + ".tgw", world, 256, threads);
+    }
+
+    if (options.writeTiles) {
+        ok &= writeTiles(prefix, width, height, [&](World& chunk, int originX, int originY) {
+            const int w = std::max(0, std::min(chunk.getWidth(), width - originX));
+            const int h = std::max(0, std::min(chunk.getHeight(), height - originY));
+            chunk.copyRegion(world, originX, originY, 0, 0, w, h);
+        }, threads);
+    }
+    return ok;
+}
+
+// biomes: custom rules, or nullptr for the built-in ones
+bool generateSeed(const Options& options, unsigned int seed, int threads, const BiomeClassifier* biomes) {
+    auto start = std::chrono::steady_clock::now();
+
+    World world(options.width, options.height);
+    TerrainGenerator generator(seed);
+    generator.setThreadCount(threads);
+    generator.setRecipe(options.recipe);
+    generator.setNoiseBackend(options.noiseBackend);
+    generator.generate(world);
+
+    // Generation classified the raw noise heights; erosion moves them
+    if (options.erode) {
+        ErosionSimulator erosion(world, seed);
+        erosion.setThreadCount(threads);
+        erosion.erode(options.erosion);
+        if (!biomes) generator.classifyBiomes(world, BiomeRules());
+    }
+    if (biomes) generator.classifyBiomes(world, *biomes);
+
+    RiverGenerator rivers(world, seed);
+    rivers.setThreadCount(threads);
+    rivers.generateRivers(options.riverSources);
+    rivers.generateLakes();
+
+    std::string roadSummary;
+    if (options.settlements > 0) {
+        AntColony colony(world, seed);
+        colony.setThreadCount(threads);
+        const int placed = colony.placeSettlements(options.settlements);
+        colony.buildRoads(options.roads, [&](const AntIterationStats& stats) {
+            if (options.verbose) {
+                std::printf("seed %u: road iteration %d: %.2f ms, %d ant(s) arrived, %d road(s), cost %.1f\n",
+                    seed, stats.iteration, stats.milliseconds, stats.arrived, stats.connected, stats.bestCost);
+            }
+        });
+
+        double iterationMs = 0.0;
+        for (const AntIterationStats& stats : colony.getIterationStats()) iterationMs += stats.milliseconds;
+        char text[160];
+        std::snprintf(text, sizeof(text), ", %d settlement(s), %d/%d road(s), roads %.2f ms setup + %.2f ms/iteration",
+            placed, colony.getConnectedLinkCount(), colony.getLinkCount(), colony.getSetupMilliseconds(),
+            iterationMs / std::max<size_t>(colony.getIterationStats().size(), 1));
+        roadSummary = text;
+    }
+
+    std::string prefix = (std::filesystem::path(options.outDir) / ("seed_" + std::to_string(seed))).string();
+    bool ok;
+    {
+        TG_PROFILE_SCOPE("write_outputs", (double)options.width * options.height);
+        ok = writeOutputs(options, world, prefix, threads);
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("seed %u: %dx%d in %.2fs%s%s\n", seed, options.width, options.height, seconds,
+        roadSummary.c_str(), ok ? "" : " (failed to write output)");
+    return ok;
+}
+
+// One map through worker processes, stitched into <out>/seed_<N>.tgw
+bool generateSharded(const Options& options, unsigned int seed) {
+    auto start = std::chrono::steady_clock::now();
+
+    ShardSettings settings;
+    settings.width = options.width;
+    settings.height = options.height;
+    settings.seed = seed;
+    settings.recipe = options.recipeName;
+    settings.noise = options.noiseBackend;
+    settings.shardRows = options.shardRows;
+    settings.threadsPerShard = options.shardJobs == 1 ? options.threads : 1;
+
+    std::vector<std::vector<std::string>> commands = options.shardCommands;
+    if (commands.empty()) commands.push_back({ options.executable });
+    ProcessLauncher launcher(commands, options.shardJobs);
+
+    const std::string prefix = (std::filesystem::path(options.outDir) / ("seed_" + std::to_string(seed))).string();
+    ShardedGenerator generator(settings, launcher);
+    generator.setThreadCount(options.threads);
+    bool ok = generator.generate(prefix + "_shards", prefix + ".tgw", options.keepShards);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("seed %u: %dx%d in %d shard(s) of %d rows in %.2fs%s%s\n", seed, options.width, options.height,
+        generator.getShardCount(), generator.getShardRows(), seconds, ok ? "" : ": ", generator.getError().c_str());
+
+    // Tiles straight from the archive, never holding the map
+    if (ok && options.writeTiles) {
+        WorldArchive archive;
+        ok = archive.open(prefix + ".tgw") &&
+            writeTiles(prefix, options.width, options.height, archive.chunkSource(), options.threads);
+    }
+    return ok;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    int workerExit;
+    if (handleShardWorker(argc, argv, workerExit)) return workerExit;
+
+    Options options;
+    options.executable = currentExecutable(argv[0]);
+    if (!parseArgs(argc, argv, options)) {
+        printUsage();
+        return 1;
+    }
+
+    if (options.printBiomeRules) {
+        std::fputs(BiomeRuleSet::fromRules(BiomeRules()).toText().c_str(), stdout);
+        return 0;
+    }
+
+    // Compiled once, then only read by every seed
+    std::unique_ptr<BiomeClassifier> biomes;
+    if (!options.biomeRulesPath.empty()) {
+        BiomeRuleSet rules;
+        std::string message;
+        if (!rules.load(options.biomeRulesPath, &message)) {
+            std::fprintf(stderr, "Cannot load biome rules %s: %s\n", options.biomeRulesPath.c_str(), message.c_str());
+            return 1;
+        }
+        biomes.reset(new BiomeClassifier(rules));
+    }
+
+    std::error_code error;
+    std::filesystem::create_directories(options.outDir, error);
+    if (error) {
+        std::fprintf(stderr, "Cannot create output directory %s: %s\n", options.outDir.c_str(), error.message().c_str());
+        return 1;
+    }
+
+    const bool profiling = !options.profilePath.empty() || !options.tracePath.empty();
+    if (profiling && !Profiler::isCompiledIn()) {
+        std::fprintf(stderr, "--profile and --trace need a build with TERRAINGEN_PROFILE\n");
+        return 1;
+    }
+    Profiler::setEnabled(profiling);
+
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<int> failures{ 0 };
+
+    if (options.shardRows > 0) {
+        // Workers parallelise across processes; seeds go one at a time
+        for (unsigned int seed : options.seeds) {
+            if (!generateSharded(options, seed)) ++failures;
+        }
+    }
+    else if (options.seeds.size() == 1) {
+        // One map: parallelise inside the generator
+        if (!generateSeed(options, options.seeds[0], options.threads, biomes.get())) ++failures;
+    }
+    else {
+        // Many maps: one seed per task; generators nested in a pool job run
+        // on the task's thread, so cores are not oversubscribed
+        ThreadPool pool(options.threads);
+        pool.parallelFor((int)options.seeds.size(), [&](int i) {
+            if (!generateSeed(options, options.seeds[i], 1, biomes.get())) ++failures;
+        });
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::printf("%zu map(s) in %.2fs\n", options.seeds.size(), seconds);
+
+    if (profiling) {
+        for (const ProfileStage& stage : Profiler::getStages()) {
+            std::printf("  %-18s %4d call(s) %10.2f ms %10.2f Mtiles/s %8llu alloc(s) %8.1f MB peak\n",
+                stage.name.c_str(), stage.calls, stage.totalMs, stage.tilesPerSecond() / 1e6,
+                (unsigned long long)stage.allocations, stage.peakBytes / 1e6);
+        }
+        if (!options.profilePath.empty() && !Profiler::writeJson(options.profilePath)) {
+            std::fprintf(stderr, "Cannot write %s\n", options.profilePath.c_str());
+            ++failures;
+        }
+        if (!options.tracePath.empty() && !Profiler::writeChromeTrace(options.tracePath)) {
+            std::fprintf(stderr, "Cannot write %s\n", options.tracePath.c_str());
+            ++failures;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -1,188 +1,258 @@
 #include <ew/external/opengl/include/glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <imgui.h>
+#include <imgui_impl_glfw.h>
+#include <imgui_impl_opengl3.h>
 #include <iostream>
-#include "world/world.h"
-#include "world/tile.h"
-#include "noise/PerlinNoise.h"
+#include <string>
+#include "pipeline/GenerationWorker.h"
+#include "terrain/BiomeClassifier.h"
+#include "util/Profiler.h"
 #include <glm/glm.hpp>
-#include <cstdlib>
-#include <ctime>
 #include <cmath>
+#include <cstdio>
+#include <random>
 
-// Map size
+// Initial map size
 const int MAP_WIDTH = 256;
 const int MAP_HEIGHT = 256;
 
-// Error callback for GLFW
-void glfwErrorCallback(int error, const char* description) {
-    std::cerr << "GLFW Error: " << description << std::endl;
-}
+// Map sizes offered in the tuning panel
+const int MAP_SIZES[] = { 256, 512, 1024, 2048, 4096, 8192 };
 
-// Clamp function for C++11/14 compatibility
-float clamp(float x, float min, float max) {
-    if (x < min) return min;
-    if (x > max) return max;
-    return x;
-}
+// Noise backends offered in the tuning panel, best looking first; value
+// noise previews large maps several times faster
+const noise::NoiseBackend NOISE_BACKENDS[] = { noise::NoiseBackend::Perlin, noise::NoiseBackend::OpenSimplex2, noise::NoiseBackend::Value };
 
-// Smooth interpolation function
-float smoothstep(float edge0, float edge1, float x) {
-    x = clamp((x - edge0) / (edge1 - edge0), 0.0f, 1.0f);
-    return x * x * (3.0f - 2.0f * x);
+// Fresh world seed from the OS; everything random inside a world derives
+// from its seed, so this is the only non-reproducible number
+unsigned int randomSeed() {
+    return std::random_device{}();
 }
 
-// ---------------- BIOME DECISION ----------------
+// Error callback for GLFW
+void glfwErrorCallback(int error, const char* description) {
+    std::cerr << "GLFW Error: " << description << std::endl;
+}
 
-Biome determineBiome(float height, float moisture, float temperature) {
-    // Bigger oceans - raised threshold
-    if (height < 0.42f)
-        return Biome::Ocean;
+// Live tuning panel; returns true if any setting changed this frame
+bool drawTuningPanel(PipelineSettings& settings, const GenerationResult& shown, bool busy) {
+    bool changed = false;
 
-    // Narrow beach zone
-    if (height < 0.47f)
-        return Biome::Beach;
+    ImGui::Begin("Generation");
 
-    // More mountains - lowered threshold
-    if (height > 0.68f) {
-        // Snow caps on very tall mountains in cold areas
-        if (height > 0.78f && temperature < 0.4f)
-            return Biome::Tundra;
-        return Biome::Mountain;
+    int seed = (int)settings.seed;
+    if (ImGui::InputInt("Seed", &seed)) {
+        settings.seed = (unsigned int)seed;
+        changed = true;
     }
-
-    // Cold regions (polar/high latitude)
-    if (temperature < 0.25f) {
-        if (moisture > 0.4f)
-            return Biome::Tundra;
-        return Biome::Tundra; // Cold deserts still look tundra-ish
+    if (ImGui::Button("Random seed")) {
+        settings.seed = randomSeed();
+        changed = true;
     }
 
-    // Temperate cold
-    if (temperature < 0.45f) {
-        if (moisture > 0.55f)
-            return Biome::Forest; // Boreal/Taiga forest
-        return Biome::Plains;
+    std::string sizeLabel = std::to_string(settings.width) + "x" + std::to_string(settings.height);
+    if (ImGui::BeginCombo("Size", sizeLabel.c_str())) {
+        for (int size : MAP_SIZES) {
+            std::string label = std::to_string(size) + "x" + std::to_string(size);
+            if (ImGui::Selectable(label.c_str(), settings.width == size && settings.height == size)) {
+                settings.width = size;
+                settings.height = size;
+                changed = true;
+            }
+        }
+        ImGui::EndCombo();
     }
-
-    // Temperate
-    if (temperature < 0.65f) {
-        if (moisture > 0.6f)
-            return Biome::Forest; // Temperate forest
-        if (moisture > 0.35f)
-            return Biome::Plains; // Grasslands
-        return Biome::Plains; // Dry plains
+    if (ImGui::BeginCombo("Noise", noise::noiseBackendName(settings.noise))) {
+        for (noise::NoiseBackend backend : NOISE_BACKENDS) {
+            if (ImGui::Selectable(noise::noiseBackendName(backend), settings.noise == backend)) {
+                settings.noise = backend;
+                changed = true;
+            }
+        }
+        ImGui::EndCombo();
     }
 
-    // Hot regions
-    if (moisture < 0.25f)
-        return Biome::Desert; // Hot desert
+    ImGui::Separator();
+    ImGui::Text("Biomes");
+    BiomeRules& rules = settings.biomeRules;
+    changed |= ImGui::SliderFloat("Ocean level", &rules.oceanLevel, 0.0f, 1.0f);
+    changed |= ImGui::SliderFloat("Beach level", &rules.beachLevel, 0.0f, 1.0f);
+    changed |= ImGui::SliderFloat("Mountain level", &rules.mountainLevel, 0.0f, 1.0f);
+    changed |= ImGui::SliderFloat("Snow level", &rules.snowLevel, 0.0f, 1.0f);
+    changed |= ImGui::SliderFloat("Polar temperature", &rules.polarTemperature, 0.0f, 1.0f);
+    changed |= ImGui::SliderFloat("Desert moisture", &rules.desertMoisture, 0.0f, 1.0f);
+
+    ImGui::Separator();
+    ImGui::Text("Water");
+    changed |= ImGui::SliderFloat("River threshold", &settings.riverThreshold, 0.0001f, 0.05f, "%.4f", ImGuiSliderFlags_Logarithmic);
+    changed |= ImGui::SliderFloat("Moisture influence", &settings.moistureInfluence, 0.0f, 1.0f);
+    changed |= ImGui::SliderFloat("Lake threshold", &settings.lakeThreshold, 0.0001f, 0.05f, "%.4f", ImGuiSliderFlags_Logarithmic);
+
+    ImGui::Separator();
+    ImGui::Text("Erosion");
+    ErosionSettings& erosion = settings.erosion;
+    changed |= ImGui::Checkbox("Erode", &settings.erosionEnabled);
+    changed |= ImGui::SliderFloat("Droplets per tile", &erosion.dropletsPerTile, 0.0f, 2.0f);
+    changed |= ImGui::SliderFloat("Erode speed", &erosion.erodeSpeed, 0.0f, 1.0f);
+    changed |= ImGui::SliderFloat("Deposit speed", &erosion.depositSpeed, 0.0f, 1.0f);
+    changed |= ImGui::SliderInt("Thermal passes", &erosion.thermalIterations, 0, 64);
+    changed |= ImGui::SliderFloat("Talus", &erosion.talus, 0.0f, 0.1f);
+
+    // Moving the sun only re-lights the prepared map, so it follows the
+    // sliders interactively even on large maps
+    ImGui::Separator();
+    ImGui::Text("Relief");
+    HillshadeSettings& relief = settings.hillshade;
+    changed |= ImGui::Checkbox("Hillshade", &settings.hillshadeEnabled);
+    changed |= ImGui::SliderFloat("Sun azimuth", &relief.sunAzimuth, 0.0f, 360.0f);
+    changed |= ImGui::SliderFloat("Sun elevation", &relief.sunElevation, 0.0f, 90.0f);
+    changed |= ImGui::SliderFloat("Ambient", &relief.ambient, 0.0f, 1.0f);
+    changed |= ImGui::SliderFloat("Relief scale", &relief.reliefScale, 1.0f, 256.0f, "%.0f", ImGuiSliderFlags_Logarithmic);
+    changed |= ImGui::Checkbox("Ambient occlusion", &relief.ambientOcclusion);
+
+    ImGui::Separator();
+    ImGui::Text("%s", busy ? "Generating..." : "Up to date");
+    if (shown.level > 0) {
+        ImGui::Text("Shown: %dx%d preview (1/%d) after %.1f ms", shown.width, shown.height, 1 << shown.level, shown.totalMs);
+    }
+    else {
+        ImGui::Text("Shown: %dx%d in %.1f ms", shown.width, shown.height, shown.totalMs);
+    }
+    for (const StageStats& stage : shown.stages) {
+        ImGui::Text("  %-8s %9.1f ms  (%d runs)", stage.name.c_str(), stage.lastMs, stage.runs);
+    }
+    ImGui::Text("%.0f FPS", ImGui::GetIO().Framerate);
 
-    if (moisture < 0.45f)
-        return Biome::Plains; // Savanna/dry grassland
+    bool profiling = Profiler::isEnabled();
+    if (ImGui::Checkbox("Profiler", &profiling)) {
+        Profiler::setEnabled(profiling);
+    }
 
-    return Biome::Forest; // Tropical/subtropical forest
+    ImGui::End();
+    return changed;
 }
 
-// ---------------- BIOME COLORS ----------------
-
-void biomeToColor(Biome biome, unsigned char& r, unsigned char& g, unsigned char& b) {
-    switch (biome) {
-    case Biome::Ocean:    r = 25;  g = 60;  b = 140; break;  // Deeper blue
-    case Biome::Beach:    r = 220; g = 205; b = 150; break;  // Sandy
-    case Biome::Plains:   r = 100; g = 165; b = 80;  break;  // Grassland green
-    case Biome::Forest:   r = 30;  g = 105; b = 50;  break;  // Deep forest green
-    case Biome::Desert:   r = 210; g = 180; b = 100; break;  // Sandy brown
-    case Biome::Tundra:   r = 210; g = 225; b = 230; break;  // Icy white-blue
-    case Biome::Mountain: r = 110; g = 100; b = 90;  break;  // Rocky gray-brown
+// Per-stage timings recorded while the profiler is on
+void drawProfilerOverlay() {
+    static std::string status;
+
+    ImGui::Begin("Profiler");
+    if (!Profiler::isCompiledIn()) {
+        ImGui::Text("Compiled out; rebuild with TERRAINGEN_PROFILE=ON");
+        ImGui::End();
+        return;
     }
-}
 
-int main() {
-    std::srand(std::time(0));
-    World world(MAP_WIDTH, MAP_HEIGHT);
-
-    PerlinNoise heightNoise(rand());
-    PerlinNoise moistureNoise(rand());
-    PerlinNoise temperatureNoise(rand());
-
-    // ----------- GENERATE NOISE MAPS -----------
-
-    for (int y = 0; y < MAP_HEIGHT; ++y) {
-        for (int x = 0; x < MAP_WIDTH; ++x) {
-            float nx = (float)x / MAP_WIDTH;
-            float ny = (float)y / MAP_HEIGHT;
-
-            // Height: Multiple octaves for natural looking terrain
-            // Large scale landmass shape
-            float continents = heightNoise.fractalNoise(nx * 2.2f, ny * 2.2f, 3, 2.0f, 0.5f);
-            // Medium scale features (hills, valleys)
-            float mediumDetail = heightNoise.fractalNoise(nx * 5.0f, ny * 5.0f, 4, 2.0f, 0.5f);
-            // Fine detail
-            float fineDetail = heightNoise.fractalNoise(nx * 12.0f, ny * 12.0f, 3, 2.0f, 0.4f);
-
-            // Blend the scales with appropriate weights
-            float height = continents * 0.55f + mediumDetail * 0.3f + fineDetail * 0.15f;
-
-            // Apply island mask for single continent with natural coastlines
-            float centerX = nx - 0.5f;
-            float centerY = ny - 0.5f;
-            float distFromCenter = std::sqrt(centerX * centerX + centerY * centerY);
-            float islandMask = 1.0f - smoothstep(0.25f, 0.48f, distFromCenter);
-            height = height * (0.3f + 0.7f * islandMask); // Stronger island effect for single continent
-
-            height = (height + 1.0f) / 2.0f;
-            height = clamp(height, 0.0f, 1.0f);
-
-            // Moisture: affected by distance from water
-            float baseMoisture = moistureNoise.fractalNoise(nx * 3.5f, ny * 3.5f, 4, 2.1f, 0.5f);
-            baseMoisture = (baseMoisture + 1.0f) / 2.0f;
-
-            // Increase moisture near water
-            if (height < 0.45f) {
-                baseMoisture = std::min(1.0f, baseMoisture + 0.3f);
+    if (ImGui::Button("Reset")) {
+        Profiler::reset();
+        status.clear();
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Save JSON")) {
+        status = Profiler::writeJson("terrainGen_profile.json") ? "Saved terrainGen_profile.json" : "Cannot write terrainGen_profile.json";
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Save trace")) {
+        status = Profiler::writeChromeTrace("terrainGen_trace.json") ? "Saved terrainGen_trace.json" : "Cannot write terrainGen_trace.json";
+    }
+    if (!status.empty()) ImGui::Text("%s", status.c_str());
+    ImGui::Text("Peak RSS %.1f MB, %zu event(s)", Profiler::getPeakResidentBytes() / 1e6, Profiler::getEventCount());
+
+    const int flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingFixedFit;
+    if (ImGui::BeginTable("stages", 7, flags)) {
+        ImGui::TableSetupColumn("Stage");
+        ImGui::TableSetupColumn("Calls");
+        ImGui::TableSetupColumn("Last ms");
+        ImGui::TableSetupColumn("Mean ms");
+        ImGui::TableSetupColumn("Mtiles/s");
+        ImGui::TableSetupColumn("Allocs/call");
+        ImGui::TableSetupColumn("Peak MB");
+        ImGui::TableHeadersRow();
+
+        for (const ProfileStage& stage : Profiler::getStages()) {
+            ImGui::TableNextRow();
+            ImGui::TableNextColumn();
+            ImGui::Text("%s", stage.name.c_str());
+            ImGui::TableNextColumn();
+            ImGui::Text("%d", stage.calls);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", stage.lastMs);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.2f", stage.calls > 0 ? stage.totalMs / stage.calls : 0.0);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", stage.tilesPerSecond() / 1e6);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", stage.calls > 0 ? (double)stage.allocations / stage.calls : 0.0);
+            ImGui::TableNextColumn();
+            ImGui::Text("%.1f", stage.peakBytes / 1e6);
+
+            // Share of the stage's wall time each pool thread spent working
+            if (!stage.threadBusyMs.empty() && stage.totalMs > 0.0) {
+                std::string busy = "  threads busy:";
+                char value[16];
+                for (double ms : stage.threadBusyMs) {
+                    std::snprintf(value, sizeof(value), " %.0f%%", 100.0 * ms / stage.totalMs);
+                    busy += value;
+                }
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                ImGui::Text("%s", busy.c_str());
             }
-
-            float moisture = clamp(baseMoisture, 0.0f, 1.0f);
-
-            // Temperature: More localized variation for continent-scale
-            // No strong latitude gradient - just regional variation
-            float tempNoise = temperatureNoise.fractalNoise(nx * 2.8f, ny * 2.8f, 4, 2.0f, 0.5f);
-            tempNoise = (tempNoise + 1.0f) / 2.0f;
-
-            // Temperature decreases with elevation (mountains are cooler)
-            float elevationCooling = smoothstep(0.5f, 0.85f, height) * 0.35f;
-
-            // Combine: mostly noise-driven with elevation effect
-            float temperature = tempNoise * 0.85f + 0.15f - elevationCooling;
-            temperature = clamp(temperature, 0.0f, 1.0f);
-
-            Tile& t = world.at(x, y);
-            t.height = height;
-            t.moisture = moisture;
-            t.temperature = temperature;
-            t.biome = determineBiome(height, moisture, temperature);
         }
+        ImGui::EndTable();
     }
+    ImGui::End();
+}
 
-    // ----------- BUILD PIXEL BUFFER -----------
+// The tile under the mouse, read from the shown map
+void drawTileTooltip(GLFWwindow* window, const GenerationResult& shown) {
+    const CompactWorld& world = shown.world;
+    if (world.getWidth() == 0 || ImGui::GetIO().WantCaptureMouse) return;
+
+    // The map fills the viewport, which is in framebuffer pixels from the
+    // bottom left; texture row 0 is at the bottom
+    double cursorX, cursorY;
+    int windowWidth, windowHeight, framebufferWidth, framebufferHeight;
+    GLint viewport[4];
+    glfwGetCursorPos(window, &cursorX, &cursorY);
+    glfwGetWindowSize(window, &windowWidth, &windowHeight);
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    if (windowWidth <= 0 || windowHeight <= 0 || viewport[2] <= 0 || viewport[3] <= 0) return;
+
+    const double pixelX = cursorX * framebufferWidth / windowWidth - viewport[0];
+    const double pixelY = framebufferHeight - cursorY * framebufferHeight / windowHeight - viewport[1];
+    const int x = (int)std::floor(pixelX / viewport[2] * world.getWidth());
+    const int y = (int)std::floor(pixelY / viewport[3] * world.getHeight());
+    if (!world.inBounds(x, y)) return;
+
+    const Tile tile = world.at(x, y);
+    ImGui::BeginTooltip();
+    ImGui::Text("(%d, %d) %s", x << shown.level, y << shown.level, biomeName(tile.biome));
+    ImGui::Text("Height %.3f", tile.height);
+    ImGui::Text("Moisture %.2f, temperature %.2f", tile.moisture, tile.temperature);
+    if (tile.isLake) ImGui::Text("Lake");
+    else if (tile.riverStrength > 0.0f) ImGui::Text("River %.2f", tile.riverStrength);
+    ImGui::EndTooltip();
+}
 
-    std::vector<unsigned char> pixels(MAP_WIDTH * MAP_HEIGHT * 3);
+int main() {
+    PipelineSettings settings;
+    settings.seed = randomSeed();
+    settings.width = MAP_WIDTH;
+    settings.height = MAP_HEIGHT;
+    settings.erosionEnabled = true;
+    settings.hillshadeEnabled = true;
 
-    for (int y = 0; y < MAP_HEIGHT; ++y) {
-        for (int x = 0; x < MAP_WIDTH; ++x) {
-            unsigned char r, g, b;
-            biomeToColor(world.at(x, y).biome, r, g, b);
+    // ----------- GENERATE IN THE BACKGROUND -----------
 
-            // Add subtle height-based shading for more depth
-            float heightShade = world.at(x, y).height;
-            float shadeFactor = 0.7f + 0.3f * heightShade;
+    // The worker regenerates whenever the settings change; the render loop
+    // only picks up finished maps and never waits for one
+    GenerationWorker worker;
+    worker.request(settings);
 
-            int index = (y * MAP_WIDTH + x) * 3;
-            pixels[index + 0] = (unsigned char)(r * shadeFactor);
-            pixels[index + 1] = (unsigned char)(g * shadeFactor);
-            pixels[index + 2] = (unsigned char)(b * shadeFactor);
-        }
-    }
+    GenerationResult shown;
 
     glfwSetErrorCallback(glfwErrorCallback);
 
@@ -212,12 +282,21 @@ int main() {
 
     glViewport(0, 0, 800, 800);
 
-    // Create OpenGL texture
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGui_ImplGlfw_InitForOpenGL(window, true);
+    ImGui_ImplOpenGL3_Init("#version 330");
+
+    // Create OpenGL texture; it stays empty until the first map is done
     GLuint texture;
     glGenTextures(1, &texture);
     glBindTexture(GL_TEXTURE_2D, texture);
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, MAP_WIDTH, MAP_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+    // Rows of RGB8 pixels are not 4-byte aligned for every width
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, MAP_WIDTH, MAP_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    int textureWidth = MAP_WIDTH;
+    int textureHeight = MAP_HEIGHT;
 
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -309,18 +388,50 @@ int main() {
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
 
-        glClear(GL_COLOR_BUFFER_BIT);
-
+        // Swap in a finished map; the texture is only touched when one arrives
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, texture);
+        if (worker.takeResult(shown)) {
+            TG_PROFILE_SCOPE("pixel_upload", (double)shown.width * shown.height);
+            if (shown.width != textureWidth || shown.height != textureHeight) {
+                textureWidth = shown.width;
+                textureHeight = shown.height;
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, textureWidth, textureHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, shown.pixels.data());
+            }
+            else {
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, textureWidth, textureHeight, GL_RGB, GL_UNSIGNED_BYTE, shown.pixels.data());
+            }
+        }
+
+        ImGui_ImplOpenGL3_NewFrame();
+        ImGui_ImplGlfw_NewFrame();
+        ImGui::NewFrame();
+
+        if (drawTuningPanel(settings, shown, worker.isBusy())) {
+            worker.request(settings);
+        }
+        if (Profiler::isEnabled()) {
+            drawProfilerOverlay();
+        }
+        drawTileTooltip(window, shown);
+
+        glClear(GL_COLOR_BUFFER_BIT);
 
+        glUseProgram(shaderProgram);
         glBindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
 
+        ImGui::Render();
+        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
         glfwSwapBuffers(window);
     }
 
     // Cleanup
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGlfw_Shutdown();
+    ImGui::DestroyContext();
+
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
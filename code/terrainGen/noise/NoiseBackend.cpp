@@ -0,0 +1,22 @@
+#include "NoiseBackend.h"
+
+namespace noise {
+
+const char* noiseBackendName(NoiseBackend backend) {
+    switch (backend) {
+    case NoiseBackend::Perlin: return "perlin";
+    case NoiseBackend::OpenSimplex2: return "simplex";
+    case NoiseBackend::Value: return "value";
+    }
+    return "unknown";
+}
+
+bool parseNoiseBackend(const std::string& name, NoiseBackend& out) {
+    if (name == "perlin") out = NoiseBackend::Perlin;
+    else if (name == "simplex") out = NoiseBackend::OpenSimplex2;
+    else if (name == "value") out = NoiseBackend::Value;
+    else return false;
+    return true;
+}
+
+} // namespace noise
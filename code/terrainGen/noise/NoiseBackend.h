@@ -0,0 +1,81 @@
+#pragma once
+
+#include "PerlinNoise.h"
+#include <algorithm>
+#include <string>
+
+// Noise backends are plain classes picked at compile time: the fractal
+// loops below, the noise graphs and TerrainGenerator are templates over
+// them, so switching backend costs nothing per sample. A backend provides
+//
+//     void setSeed(unsigned int seed);
+//     float noise(float x, float y) const;         // centred on 0
+//     int fractalRowSimd(SimdLevel level, float y, int x0, int xStride,
+//         float xStep, int count, int octaves, float lacunarity,
+//         float persistence, float* out) const;    // whole vectors only,
+//                                                  // 0 if it has no kernels
+//
+// and its SIMD kernels must match fractalNoise() below bit for bit.
+//
+// Backends, from best looking to cheapest:
+//   PerlinNoise        classic gradient noise, the default
+//   OpenSimplex2Noise  fewer axis-aligned artifacts, scalar only, slowest
+//   ValueNoise         hashed lattice values, blockier but the fastest
+
+namespace noise {
+
+enum class NoiseBackend {
+    Perlin,
+    OpenSimplex2,
+    Value
+};
+
+const char* noiseBackendName(NoiseBackend backend);
+
+// "perlin", "simplex" or "value"; false if the name is unknown
+bool parseNoiseBackend(const std::string& name, NoiseBackend& out);
+
+// The octave loops sum octaves - 1 layers, as the original generator did,
+// so at least two octaves are needed for a non-empty sum; fewer are raised
+// to this
+const int MIN_OCTAVES = 2;
+
+// Fractal noise (multiple octaves), divided by the total amplitude so it
+// keeps the range of backend.noise()
+template <typename Backend>
+float fractalNoise(const Backend& backend, float x, float y, int octaves, float lacunarity, float persistence) {
+    octaves = std::max(octaves, MIN_OCTAVES);
+    float total = 0.0f;
+    float frequency = 1.0f;
+    float amplitude = 1.0f;
+    float maxAmplitude = 0.0f;
+
+    for (int i = 1; i < octaves; i++) {
+        total += backend.noise(x * frequency, y * frequency) * amplitude;
+        maxAmplitude += amplitude;
+
+        amplitude *= persistence;
+        frequency *= lacunarity;
+    }
+
+    // Normalize to [-1,1]
+    return total / maxAmplitude;
+}
+
+// Batched fractal noise along one row:
+// out[i] = fractalNoise(backend, (x0 + i * xStride) * xStep, y, ...) for i in [0, count)
+// level is clamped to what the CPU supports.
+template <typename Backend>
+void fractalNoiseRow(const Backend& backend, float y, int x0, float xStep, int count, int octaves,
+    float lacunarity, float persistence, float* out, SimdLevel level, int xStride = 1) {
+    level = std::min(level, PerlinNoise::bestSimdLevel());
+    octaves = std::max(octaves, MIN_OCTAVES);
+    const int done = backend.fractalRowSimd(level, y, x0, xStride, xStep, count, octaves, lacunarity, persistence, out);
+
+    // Scalar tail (or the whole row on the scalar path)
+    for (int i = done; i < count; ++i) {
+        out[i] = fractalNoise(backend, (float)(x0 + i * xStride) * xStep, y, octaves, lacunarity, persistence);
+    }
+}
+
+} // namespace noise
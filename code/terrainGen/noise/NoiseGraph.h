@@ -0,0 +1,349 @@
+#pragma once
+
+#include "NoiseBackend.h"
+#include <algorithm>
+#include <cmath>
+#include <type_traits>
+
+// Composable noise graphs, evaluated a row of tiles at a time.
+//
+// A graph is an expression built from nodes and plain floats:
+//
+//     using namespace noise;
+//     auto land = scale(2.2f, fbm(NoiseLayer::Height, 3, 2.0f, 0.5f)) * 0.7f
+//               + scale(8.0f, fbm(NoiseLayer::Height, 4, 2.0f, 0.5f)) * 0.3f;
+//     auto height = clamp(remap(land * radialMask(0.25f, 0.48f), -1.0f, 1.0f, 0.0f, 1.0f), 0.0f, 1.0f);
+//
+// Every node is its own type, so the whole expression is one type and the
+// compiler sees all of it at once. Evaluating a row first fills one buffer
+// per fbm node with the batched (SIMD) noise, then runs the rest of the
+// graph as a single inlined loop over the row: no virtual calls and no
+// buffers between nodes. The noise backend (see NoiseBackend.h) comes in
+// through the RowContext type, so the same graph compiles once per
+// backend. TerrainRecipe turns three graphs (height, moisture,
+// temperature) into such row kernels.
+//
+// Nodes:
+//   fbm(layer, octaves, lacunarity, persistence)  fractal noise in [-1, 1];
+//                              octaves below noise::MIN_OCTAVES (2) count as 2
+//   scale(factor, graph)       samples graph at factor times the frequency
+//   radialMask(inner, outer)   1 inside inner, falling smoothly to 0 at outer
+//                              (distances from the map centre, map = 1 across)
+//   height()                   the tile's finished height (moisture and
+//                              temperature graphs only)
+//   a + b, a - b, a * b        with graphs or floats on either side
+//   blend(a, b, t)             a + (b - a) * t
+//   remap(graph, inMin, inMax, outMin, outMax)
+//   clamp(graph, min, max), min(a, b), max(a, b)
+//   smoothstep(edge0, edge1, graph)
+//   apply(a, b, fn)            fn(a, b) for anything else, e.g. a threshold
+//
+// Arithmetic runs in the order written, so a graph that spells out an
+// existing formula reproduces it bit for bit.
+
+namespace noise {
+
+// Longest row one evaluation handles
+const int MAX_ROW = 256;
+
+// Noise generators fbm nodes can sample
+enum class NoiseLayer {
+    Height,
+    Moisture,
+    Temperature,
+    Count
+};
+
+// Tiles i in [0, count) of a row: world tile (worldX + i * worldStride, worldY)
+// of a worldWidth x worldHeight map
+template <typename Backend>
+struct RowContext {
+    const Backend* const* layers; // indexed by NoiseLayer
+    int worldX;
+    int worldStride;
+    int worldY;
+    int worldWidth;
+    int worldHeight;
+    int count;
+    float frequency; // product of the enclosing scale nodes, 1 at the root
+};
+
+// Base of every node; marks the types the operators below accept
+struct Node {};
+
+template <typename T>
+using IsNode = std::is_base_of<Node, T>;
+
+// Per-tile arithmetic of the nodes below
+namespace ops {
+
+struct Add { float operator()(float a, float b) const { return a + b; } };
+struct Sub { float operator()(float a, float b) const { return a - b; } };
+struct Mul { float operator()(float a, float b) const { return a * b; } };
+struct Min { float operator()(float a, float b) const { return std::min(a, b); } };
+struct Max { float operator()(float a, float b) const { return std::max(a, b); } };
+
+struct Remap {
+    float inMin, inMax, outMin, outMax;
+    float operator()(float x) const { return outMin + (x - inMin) / (inMax - inMin) * (outMax - outMin); }
+};
+
+struct Clamp {
+    float low, high;
+    float operator()(float x) const {
+        if (x < low) return low;
+        if (x > high) return high;
+        return x;
+    }
+};
+
+struct Smoothstep {
+    float edge0, edge1;
+    float operator()(float x) const {
+        x = Clamp{ 0.0f, 1.0f }((x - edge0) / (edge1 - edge0));
+        return x * x * (3.0f - 2.0f * x);
+    }
+};
+
+} // namespace ops
+
+// ---------------- LEAVES ----------------
+
+struct Constant : Node {
+    struct State {};
+
+    float value;
+
+    explicit Constant(float value) : value(value) {}
+
+    template <typename Row>
+    void prepare(const Row&, State&) const {}
+    template <typename Row>
+    float at(const State&, const Row&, int, float) const { return value; }
+};
+
+struct Fbm : Node {
+    struct State {
+        float row[MAX_ROW];
+    };
+
+    NoiseLayer layer;
+    int octaves;
+    float lacunarity;
+    float persistence;
+
+    Fbm(NoiseLayer layer, int octaves, float lacunarity, float persistence)
+        : layer(layer), octaves(octaves), lacunarity(lacunarity), persistence(persistence) {}
+
+    template <typename Row>
+    void prepare(const Row& row, State& state) const {
+        const float ny = (float)row.worldY / row.worldHeight;
+        const float invWidth = 1.0f / row.worldWidth;
+        fractalNoiseRow(*row.layers[(int)layer], ny * row.frequency, row.worldX, row.frequency * invWidth,
+            row.count, octaves, lacunarity, persistence, state.row, PerlinNoise::bestSimdLevel(), row.worldStride);
+    }
+
+    template <typename Row>
+    float at(const State& state, const Row&, int i, float) const { return state.row[i]; }
+};
+
+struct RadialMask : Node {
+    struct State {};
+
+    float inner;
+    float outer;
+
+    RadialMask(float inner, float outer) : inner(inner), outer(outer) {}
+
+    template <typename Row>
+    void prepare(const Row&, State&) const {}
+
+    template <typename Row>
+    float at(const State&, const Row& row, int i, float) const {
+        const float nx = (float)(row.worldX + i * row.worldStride) / row.worldWidth;
+        const float ny = (float)row.worldY / row.worldHeight;
+        const float centerX = nx - 0.5f;
+        const float centerY = ny - 0.5f;
+        const float distance = std::sqrt(centerX * centerX + centerY * centerY);
+        return 1.0f - ops::Smoothstep{ inner, outer }(distance);
+    }
+};
+
+struct HeightInput : Node {
+    struct State {};
+
+    template <typename Row>
+    void prepare(const Row&, State&) const {}
+    template <typename Row>
+    float at(const State&, const Row&, int, float height) const { return height; }
+};
+
+// ---------------- COMBINATORS ----------------
+
+template <typename A>
+struct Scale : Node {
+    using State = typename A::State;
+
+    float factor;
+    A a;
+
+    Scale(float factor, const A& a) : factor(factor), a(a) {}
+
+    template <typename Row>
+    void prepare(const Row& row, State& state) const {
+        Row scaled = row;
+        scaled.frequency *= factor;
+        a.prepare(scaled, state);
+    }
+
+    template <typename Row>
+    float at(const State& state, const Row& row, int i, float height) const {
+        return a.at(state, row, i, height);
+    }
+};
+
+// Two inputs combined per tile by op
+template <typename A, typename B, typename Op>
+struct Binary : Node {
+    struct State {
+        typename A::State a;
+        typename B::State b;
+    };
+
+    A a;
+    B b;
+    Op op;
+
+    Binary(const A& a, const B& b, const Op& op = Op()) : a(a), b(b), op(op) {}
+
+    template <typename Row>
+    void prepare(const Row& row, State& state) const {
+        a.prepare(row, state.a);
+        b.prepare(row, state.b);
+    }
+
+    template <typename Row>
+    float at(const State& state, const Row& row, int i, float height) const {
+        return op(a.at(state.a, row, i, height), b.at(state.b, row, i, height));
+    }
+};
+
+// One input mapped per tile by Op
+template <typename A, typename Op>
+struct Unary : Node {
+    using State = typename A::State;
+
+    A a;
+    Op op;
+
+    Unary(const A& a, const Op& op) : a(a), op(op) {}
+
+    template <typename Row>
+    void prepare(const Row& row, State& state) const { a.prepare(row, state); }
+
+    template <typename Row>
+    float at(const State& state, const Row& row, int i, float height) const {
+        return op(a.at(state, row, i, height));
+    }
+};
+
+// ---------------- BUILDERS ----------------
+
+// Floats become constants, nodes stay as they are
+inline Constant toNode(float value) { return Constant(value); }
+
+template <typename A, typename = typename std::enable_if<IsNode<A>::value>::type>
+const A& toNode(const A& node) { return node; }
+
+template <typename T>
+using NodeOf = typename std::decay<decltype(toNode(std::declval<T>()))>::type;
+
+// At least one side must be a node, so plain float arithmetic is untouched
+template <typename A, typename B>
+using EnableGraph = typename std::enable_if<IsNode<A>::value || IsNode<B>::value>::type;
+
+inline Fbm fbm(NoiseLayer layer, int octaves, float lacunarity, float persistence) {
+    return Fbm(layer, octaves, lacunarity, persistence);
+}
+
+inline RadialMask radialMask(float inner, float outer) { return RadialMask(inner, outer); }
+
+inline HeightInput height() { return HeightInput(); }
+
+template <typename A>
+Scale<A> scale(float factor, const A& graph) { return Scale<A>(factor, graph); }
+
+template <typename A, typename B, typename = EnableGraph<A, B>>
+Binary<NodeOf<A>, NodeOf<B>, ops::Add> operator+(const A& a, const B& b) {
+    return { toNode(a), toNode(b) };
+}
+
+template <typename A, typename B, typename = EnableGraph<A, B>>
+Binary<NodeOf<A>, NodeOf<B>, ops::Sub> operator-(const A& a, const B& b) {
+    return { toNode(a), toNode(b) };
+}
+
+template <typename A, typename B, typename = EnableGraph<A, B>>
+Binary<NodeOf<A>, NodeOf<B>, ops::Mul> operator*(const A& a, const B& b) {
+    return { toNode(a), toNode(b) };
+}
+
+template <typename A, typename B, typename = EnableGraph<A, B>>
+Binary<NodeOf<A>, NodeOf<B>, ops::Min> min(const A& a, const B& b) {
+    return { toNode(a), toNode(b) };
+}
+
+template <typename A, typename B, typename = EnableGraph<A, B>>
+Binary<NodeOf<A>, NodeOf<B>, ops::Max> max(const A& a, const B& b) {
+    return { toNode(a), toNode(b) };
+}
+
+template <typename A, typename B, typename T>
+auto blend(const A& a, const B& b, const T& t) -> decltype(a + (b - a) * t) {
+    return a + (b - a) * t;
+}
+
+template <typename A>
+Unary<A, ops::Remap> remap(const A& graph, float inMin, float inMax, float outMin, float outMax) {
+    return { graph, ops::Remap{ inMin, inMax, outMin, outMax } };
+}
+
+template <typename A>
+Unary<A, ops::Clamp> clamp(const A& graph, float low, float high) {
+    return { graph, ops::Clamp{ low, high } };
+}
+
+template <typename A>
+Unary<A, ops::Smoothstep> smoothstep(float edge0, float edge1, const A& graph) {
+    return { graph, ops::Smoothstep{ edge0, edge1 } };
+}
+
+template <typename A, typename B, typename Fn>
+Binary<NodeOf<A>, NodeOf<B>, Fn> apply(const A& a, const B& b, const Fn& fn) {
+    return { toNode(a), toNode(b), fn };
+}
+
+// ---------------- EVALUATION ----------------
+
+// Fills height, moisture and temperature for one row of count <= MAX_ROW
+// tiles. The moisture and temperature graphs see the finished height
+// through height().
+template <typename H, typename M, typename T, typename Backend>
+void evaluateRow(const H& heightGraph, const M& moistureGraph, const T& temperatureGraph,
+    const RowContext<Backend>& row, float* heights, float* moistures, float* temperatures) {
+    typename H::State heightState;
+    typename M::State moistureState;
+    typename T::State temperatureState;
+    heightGraph.prepare(row, heightState);
+    moistureGraph.prepare(row, moistureState);
+    temperatureGraph.prepare(row, temperatureState);
+
+    for (int i = 0; i < row.count; ++i) {
+        const float h = heightGraph.at(heightState, row, i, 0.0f);
+        heights[i] = h;
+        moistures[i] = moistureGraph.at(moistureState, row, i, h);
+        temperatures[i] = temperatureGraph.at(temperatureState, row, i, h);
+    }
+}
+
+} // namespace noise
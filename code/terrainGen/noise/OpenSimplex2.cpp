@@ -0,0 +1,142 @@
+#include "OpenSimplex2.h"
+#include "util/Random.h"
+#include <array>
+#include <cmath>
+
+namespace {
+
+const uint64_t PRIME_X = 0x5205402B9270C86Full;
+const uint64_t PRIME_Y = 0x598CD327003817B5ull;
+const uint64_t HASH_MULTIPLIER = 0x53A3F72DEECCA1D5ull;
+
+const double SKEW = 0.366025403784439;         // (sqrt(3) - 1) / 2
+const double UNSKEW = -0.21132486540518713;    // (1 / sqrt(3) - 1) / 2
+const double NORMALIZER = 0.01001634121365712;
+const float RSQUARED = 0.5f;
+
+const int GRADIENT_BITS = 7; // 128 gradients
+
+// 24 unit directions, pre-divided by the normalizer and repeated to fill
+// the 128-entry table
+std::array<float, 2 << GRADIENT_BITS> makeGradients() {
+    static const double directions[] = {
+         0.38268343236509,   0.923879532511287,
+         0.923879532511287,  0.38268343236509,
+         0.923879532511287, -0.38268343236509,
+         0.38268343236509,  -0.923879532511287,
+        -0.38268343236509,  -0.923879532511287,
+        -0.923879532511287, -0.38268343236509,
+        -0.923879532511287,  0.38268343236509,
+        -0.38268343236509,   0.923879532511287,
+         0.130526192220052,  0.99144486137381,
+         0.608761429008721,  0.793353340291235,
+         0.793353340291235,  0.608761429008721,
+         0.99144486137381,   0.130526192220051,
+         0.99144486137381,  -0.130526192220051,
+         0.793353340291235, -0.60876142900872,
+         0.608761429008721, -0.793353340291235,
+         0.130526192220052, -0.99144486137381,
+        -0.130526192220052, -0.99144486137381,
+        -0.608761429008721, -0.793353340291235,
+        -0.793353340291235, -0.608761429008721,
+        -0.99144486137381,  -0.130526192220052,
+        -0.99144486137381,   0.130526192220051,
+        -0.793353340291235,  0.608761429008721,
+        -0.608761429008721,  0.793353340291235,
+        -0.130526192220052,  0.99144486137381,
+    };
+    const int count = (int)(sizeof(directions) / sizeof(directions[0]));
+
+    std::array<float, 2 << GRADIENT_BITS> table;
+    for (int i = 0; i < (int)table.size(); ++i) {
+        table[i] = (float)(directions[i % count] / NORMALIZER);
+    }
+    return table;
+}
+
+const std::array<float, 2 << GRADIENT_BITS> GRADIENTS = makeGradients();
+
+int fastFloor(double x) {
+    int xi = (int)x;
+    return x < xi ? xi - 1 : xi;
+}
+
+} // namespace
+
+OpenSimplex2Noise::OpenSimplex2Noise()
+    : OpenSimplex2Noise(1)
+{
+}
+
+OpenSimplex2Noise::OpenSimplex2Noise(unsigned int seed) {
+    setSeed(seed);
+}
+
+void OpenSimplex2Noise::setSeed(unsigned int seed) {
+    // Same stream as the Perlin table, so every backend follows the world seed
+    CounterRng rng(seed, RandomStream::NoisePermutation);
+    m_seed = ((uint64_t)rng.bits(0) << 32) | rng.bits(1);
+}
+
+float OpenSimplex2Noise::noise(float x, float y) const {
+    // Skew onto the triangular lattice
+    const double s = SKEW * ((double)x + (double)y);
+    const double xs = x + s;
+    const double ys = y + s;
+
+    const int xsb = fastFloor(xs);
+    const int ysb = fastFloor(ys);
+    const float xi = (float)(xs - xsb);
+    const float yi = (float)(ys - ysb);
+    const uint64_t xsbp = (uint64_t)(int64_t)xsb * PRIME_X;
+    const uint64_t ysbp = (uint64_t)(int64_t)ysb * PRIME_Y;
+
+    // Unskew to the offset from the base vertex
+    const float t = (xi + yi) * (float)UNSKEW;
+    const float dx0 = xi + t;
+    const float dy0 = yi + t;
+
+    // Base vertex
+    float value = 0.0f;
+    const float a0 = RSQUARED - dx0 * dx0 - dy0 * dy0;
+    if (a0 > 0) {
+        value = (a0 * a0) * (a0 * a0) * grad(xsbp, ysbp, dx0, dy0);
+    }
+
+    // Opposite vertex (1, 1); its falloff follows from a0 and t
+    const float a1 = (float)(2 * (1 + 2 * UNSKEW) * (1 / UNSKEW + 2)) * t
+        + ((float)(-2 * (1 + 2 * UNSKEW) * (1 + 2 * UNSKEW)) + a0);
+    if (a1 > 0) {
+        const float dx1 = dx0 - (float)(1 + 2 * UNSKEW);
+        const float dy1 = dy0 - (float)(1 + 2 * UNSKEW);
+        value += (a1 * a1) * (a1 * a1) * grad(xsbp + PRIME_X, ysbp + PRIME_Y, dx1, dy1);
+    }
+
+    // Third vertex, (0, 1) or (1, 0) depending on the triangle
+    if (dy0 > dx0) {
+        const float dx2 = dx0 - (float)UNSKEW;
+        const float dy2 = dy0 - (float)(UNSKEW + 1);
+        const float a2 = RSQUARED - dx2 * dx2 - dy2 * dy2;
+        if (a2 > 0) {
+            value += (a2 * a2) * (a2 * a2) * grad(xsbp, ysbp + PRIME_Y, dx2, dy2);
+        }
+    }
+    else {
+        const float dx2 = dx0 - (float)(UNSKEW + 1);
+        const float dy2 = dy0 - (float)UNSKEW;
+        const float a2 = RSQUARED - dx2 * dx2 - dy2 * dy2;
+        if (a2 > 0) {
+            value += (a2 * a2) * (a2 * a2) * grad(xsbp + PRIME_X, ysbp, dx2, dy2);
+        }
+    }
+
+    return value;
+}
+
+float OpenSimplex2Noise::grad(uint64_t xsvp, uint64_t ysvp, float dx, float dy) const {
+    uint64_t hash = m_seed ^ xsvp ^ ysvp;
+    hash *= HASH_MULTIPLIER;
+    hash ^= hash >> (64 - GRADIENT_BITS + 1);
+    const int gi = (int)hash & (((1 << GRADIENT_BITS) - 1) << 1);
+    return GRADIENTS[gi] * dx + GRADIENTS[gi | 1] * dy;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "PerlinNoise.h"
+#include <cstdint>
+
+// 2D OpenSimplex2 noise (the "fast" variant of K.jpg's OpenSimplex2):
+// gradients on a skewed triangular lattice, so it lacks the axis-aligned
+// ridges of Perlin noise. It has no SIMD kernels, which makes it the
+// slowest backend (see NoiseBackend.h). Output lies in about [-1, 1].
+class OpenSimplex2Noise {
+public:
+    OpenSimplex2Noise(); // seed 1
+    OpenSimplex2Noise(unsigned int seed);
+
+    void setSeed(unsigned int seed);
+
+    // Core noise function
+    float noise(float x, float y) const;
+
+    // Backend hook; scalar only, so always 0
+    int fractalRowSimd(SimdLevel, float, int, int, float, int, int, float, float, float*) const { return 0; }
+
+private:
+    uint64_t m_seed;
+
+    float grad(uint64_t xsvp, uint64_t ysvp, float dx, float dy) const;
+};
@@ -1,28 +1,35 @@
 #include "PerlinNoise.h"
+#include "NoiseBackend.h"
+#include "PerlinNoiseSimd.h"
+#include "util/Random.h"
 #include <cmath>
 #include <algorithm>
-#include <random>
 #include <numeric>
 
 // Constructors
 
-PerlinNoise::PerlinNoise() {
-    // Default seed
-    PerlinNoise(1);
+PerlinNoise::PerlinNoise()
+    : PerlinNoise(1)
+{
 }
 
 PerlinNoise::PerlinNoise(unsigned int seed) {
-    p.resize(256);
+    setSeed(seed);
+}
 
+void PerlinNoise::setSeed(unsigned int seed) {
     // Fill with values 0..255
-    std::iota(p.begin(), p.end(), 0);
+    std::iota(p.begin(), p.begin() + 256, 0);
 
-    // Shuffle with seed
-    std::default_random_engine engine(seed);
-    std::shuffle(p.begin(), p.end(), engine);
+    // Fisher-Yates shuffle; std::shuffle and the std engines differ
+    // between standard libraries, the counter-based RNG does not
+    CounterRng rng(seed, RandomStream::NoisePermutation);
+    for (int i = 255; i > 0; --i) {
+        std::swap(p[i], p[rng.below(i + 1, i)]);
+    }
 
     // Duplicate the table
-    p.insert(p.end(), p.begin(), p.end());
+    std::copy(p.begin(), p.begin() + 256, p.begin() + 256);
 }
 
 // Core Noise
@@ -59,21 +66,38 @@ float PerlinNoise::noise(float x, float y) const {
 // Fractal / Octave Noise
 
 float PerlinNoise::fractalNoise(float x, float y, int octaves, float lacunarity, float persistence) const {
-    float total = 0.0f;
-    float frequency = 1.0f;
-    float amplitude = 1.0f;
-    float maxAmplitude = 0.0f;
+    return noise::fractalNoise(*this, x, y, octaves, lacunarity, persistence);
+}
 
-    for (int i = 1; i < octaves; i++) {
-        total += noise(x * frequency, y * frequency) * amplitude;
-        maxAmplitude += amplitude;
+// Batched Fractal Noise
+
+void PerlinNoise::fractalNoiseRow(float y, int x0, float xStep, int count, int octaves,
+    float lacunarity, float persistence, float* out, int xStride) const {
+    noise::fractalNoiseRow(*this, y, x0, xStep, count, octaves, lacunarity, persistence, out, bestSimdLevel(), xStride);
+}
 
-        amplitude *= persistence;
-        frequency *= lacunarity;
+void PerlinNoise::fractalNoiseRow(float y, int x0, float xStep, int count, int octaves,
+    float lacunarity, float persistence, float* out, SimdLevel level, int xStride) const {
+    noise::fractalNoiseRow(*this, y, x0, xStep, count, octaves, lacunarity, persistence, out, level, xStride);
+}
+
+int PerlinNoise::fractalRowSimd(SimdLevel level, float y, int x0, int xStride, float xStep, int count,
+    int octaves, float lacunarity, float persistence, float* out) const {
+    if (level == SimdLevel::AVX2) {
+        return PerlinSimd::fractalRowAvx2(p.data(), y, x0, xStride, xStep, count, octaves, lacunarity, persistence, out);
     }
+    if (level == SimdLevel::SSE41) {
+        return PerlinSimd::fractalRowSse41(p.data(), y, x0, xStride, xStep, count, octaves, lacunarity, persistence, out);
+    }
+    return 0;
+}
 
-    // Normalize to [-1,1]
-    return total / maxAmplitude;
+SimdLevel PerlinNoise::bestSimdLevel() {
+    static const SimdLevel level =
+        PerlinSimd::cpuHasAvx2() ? SimdLevel::AVX2 :
+        PerlinSimd::cpuHasSse41() ? SimdLevel::SSE41 :
+        SimdLevel::Scalar;
+    return level;
 }
 
 
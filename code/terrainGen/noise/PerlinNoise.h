@@ -1,20 +1,30 @@
 #pragma once
 
-#include <vector>
-#include <random>
-#include <numeric>
-#include <algorithm>
+#include <array>
+#include <cstdint>
 
+// Instruction set used by the batched noise kernels
+enum class SimdLevel {
+    Scalar,
+    SSE41,  // 4 points per instruction
+    AVX2    // 8 points per instruction
+};
+
+// Classic 2D Perlin gradient noise over a 256-entry permutation table, the
+// default noise backend (see NoiseBackend.h)
 class PerlinNoise {
 public:
     // Constructors
-    PerlinNoise();
+    PerlinNoise(); // seed 1
     PerlinNoise(unsigned int seed);
 
+    // Rebuilds the permutation table in place
+    void setSeed(unsigned int seed);
+
     // Core noise function
     float noise(float x, float y) const;
 
-    // Fractal noise (multiple octaves)
+    // Fractal noise (multiple octaves, at least noise::MIN_OCTAVES)
     float fractalNoise(
         float x,
         float y,
@@ -23,8 +33,48 @@ public:
         float persistence
     ) const;
 
+    // Batched fractal noise along one row:
+    // out[i] = fractalNoise((x0 + i * xStride) * xStep, y, ...) for i in [0, count)
+    // Uses the best SIMD path the CPU supports.
+    void fractalNoiseRow(
+        float y,
+        int x0,
+        float xStep,
+        int count,
+        int octaves,
+        float lacunarity,
+        float persistence,
+        float* out,
+        int xStride = 1
+    ) const;
+
+    // Same as above on an explicit path (clamped to what the CPU supports)
+    void fractalNoiseRow(
+        float y,
+        int x0,
+        float xStep,
+        int count,
+        int octaves,
+        float lacunarity,
+        float persistence,
+        float* out,
+        SimdLevel level,
+        int xStride = 1
+    ) const;
+
+    // Backend hook: whole vectors of fractalNoiseRow on level; returns how
+    // many points were written
+    int fractalRowSimd(SimdLevel level, float y, int x0, int xStride, float xStep, int count,
+        int octaves, float lacunarity, float persistence, float* out) const;
+
+    // Best SIMD level available on this CPU (detected once)
+    static SimdLevel bestSimdLevel();
+
 private:
-    std::vector<int> p; // permutation table
+    // Permutation table, twice over, plus 3 bytes of slack: the AVX2 kernel
+    // gathers 4 bytes from any of the first 512 entries
+    static const int PERMUTATION_SLACK = 3;
+    std::array<uint8_t, 512 + PERMUTATION_SLACK> p{};
 
     // Helper functions
     static float fade(float t);
@@ -0,0 +1,259 @@
+#include "PerlinNoiseSimd.h"
+#include <cmath>
+
+#ifdef TG_NOISE_X86
+
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// The kernels below mirror PerlinNoise::noise/fractalNoise operation for
+// operation (no FMA, same evaluation order) so they match the scalar path.
+
+namespace {
+
+// Scalar part shared by every lane of a row: y is constant across the batch
+struct RowY {
+    int Y;
+    float yf;
+    float v;
+};
+
+RowY makeRowY(float y) {
+    float fy = std::floor(y);
+    RowY r;
+    r.Y = (int)fy & 255;
+    r.yf = y - fy;
+    r.v = r.yf * r.yf * r.yf * (r.yf * (r.yf * 6 - 15) + 10);
+    return r;
+}
+
+// ---------------- SSE4.1 ----------------
+
+TG_TARGET_SSE41 inline __m128 fade4(__m128 t) {
+    __m128 t3 = _mm_mul_ps(_mm_mul_ps(t, t), t);
+    __m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+    return _mm_mul_ps(t3, inner);
+}
+
+TG_TARGET_SSE41 inline __m128 lerp4(__m128 a, __m128 b, __m128 t) {
+    return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+TG_TARGET_SSE41 inline __m128 grad4(__m128i hash, __m128 x, __m128 y) {
+    const __m128 signBit = _mm_set1_ps(-0.0f);
+    __m128i h = _mm_and_si128(hash, _mm_set1_epi32(7));
+    __m128 lowHalf = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4)));
+    __m128 u = _mm_blendv_ps(y, x, lowHalf);
+    __m128 v = _mm_blendv_ps(x, y, lowHalf);
+    v = _mm_mul_ps(v, _mm_set1_ps(2.0f));
+
+    __m128 flipU = _mm_castsi128_ps(_mm_slli_epi32(h, 31));
+    __m128 flipV = _mm_castsi128_ps(_mm_slli_epi32(_mm_srli_epi32(h, 1), 31));
+    u = _mm_xor_ps(u, _mm_and_ps(flipU, signBit));
+    v = _mm_xor_ps(v, _mm_and_ps(flipV, signBit));
+    return _mm_add_ps(u, v);
+}
+
+TG_TARGET_SSE41 inline __m128i lookup4(const uint8_t* perm, __m128i idx) {
+    alignas(16) int i[4];
+    _mm_store_si128((__m128i*)i, idx);
+    return _mm_setr_epi32(perm[i[0]], perm[i[1]], perm[i[2]], perm[i[3]]);
+}
+
+TG_TARGET_SSE41 inline __m128 noise4(const uint8_t* perm, __m128 x, const RowY& row) {
+    __m128 fx = _mm_floor_ps(x);
+    __m128i X = _mm_and_si128(_mm_cvttps_epi32(fx), _mm_set1_epi32(255));
+    __m128 xf = _mm_sub_ps(x, fx);
+    __m128 u = fade4(xf);
+
+    __m128i Y = _mm_set1_epi32(row.Y);
+    __m128i one = _mm_set1_epi32(1);
+    __m128i pX = _mm_add_epi32(lookup4(perm, X), Y);
+    __m128i pX1 = _mm_add_epi32(lookup4(perm, _mm_add_epi32(X, one)), Y);
+
+    __m128i aa = lookup4(perm, pX);
+    __m128i ab = lookup4(perm, _mm_add_epi32(pX, one));
+    __m128i ba = lookup4(perm, pX1);
+    __m128i bb = lookup4(perm, _mm_add_epi32(pX1, one));
+
+    __m128 xf1 = _mm_sub_ps(xf, _mm_set1_ps(1.0f));
+    __m128 yf = _mm_set1_ps(row.yf);
+    __m128 yf1 = _mm_set1_ps(row.yf - 1);
+
+    return lerp4(
+        lerp4(grad4(aa, xf, yf), grad4(ba, xf1, yf), u),
+        lerp4(grad4(ab, xf, yf1), grad4(bb, xf1, yf1), u),
+        _mm_set1_ps(row.v)
+    );
+}
+
+// ---------------- AVX2 ----------------
+
+TG_TARGET_AVX2 inline __m256 fade8(__m256 t) {
+    __m256 t3 = _mm256_mul_ps(_mm256_mul_ps(t, t), t);
+    __m256 inner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f));
+    return _mm256_mul_ps(t3, inner);
+}
+
+TG_TARGET_AVX2 inline __m256 lerp8(__m256 a, __m256 b, __m256 t) {
+    return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+TG_TARGET_AVX2 inline __m256 grad8(__m256i hash, __m256 x, __m256 y) {
+    const __m256 signBit = _mm256_set1_ps(-0.0f);
+    __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(7));
+    __m256 lowHalf = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+    __m256 u = _mm256_blendv_ps(y, x, lowHalf);
+    __m256 v = _mm256_blendv_ps(x, y, lowHalf);
+    v = _mm256_mul_ps(v, _mm256_set1_ps(2.0f));
+
+    __m256 flipU = _mm256_castsi256_ps(_mm256_slli_epi32(h, 31));
+    __m256 flipV = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(h, 1), 31));
+    u = _mm256_xor_ps(u, _mm256_and_ps(flipU, signBit));
+    v = _mm256_xor_ps(v, _mm256_and_ps(flipV, signBit));
+    return _mm256_add_ps(u, v);
+}
+
+// 4-byte gathers at byte offsets, low byte kept; the table is padded so
+// the last entry can be read this way
+TG_TARGET_AVX2 inline __m256i lookup8(const uint8_t* perm, __m256i idx) {
+    return _mm256_and_si256(_mm256_i32gather_epi32((const int*)perm, idx, 1), _mm256_set1_epi32(0xFF));
+}
+
+TG_TARGET_AVX2 inline __m256 noise8(const uint8_t* perm, __m256 x, const RowY& row) {
+    __m256 fx = _mm256_floor_ps(x);
+    __m256i X = _mm256_and_si256(_mm256_cvttps_epi32(fx), _mm256_set1_epi32(255));
+    __m256 xf = _mm256_sub_ps(x, fx);
+    __m256 u = fade8(xf);
+
+    __m256i Y = _mm256_set1_epi32(row.Y);
+    __m256i one = _mm256_set1_epi32(1);
+    __m256i pX = _mm256_add_epi32(lookup8(perm, X), Y);
+    __m256i pX1 = _mm256_add_epi32(lookup8(perm, _mm256_add_epi32(X, one)), Y);
+
+    __m256i aa = lookup8(perm, pX);
+    __m256i ab = lookup8(perm, _mm256_add_epi32(pX, one));
+    __m256i ba = lookup8(perm, pX1);
+    __m256i bb = lookup8(perm, _mm256_add_epi32(pX1, one));
+
+    __m256 xf1 = _mm256_sub_ps(xf, _mm256_set1_ps(1.0f));
+    __m256 yf = _mm256_set1_ps(row.yf);
+    __m256 yf1 = _mm256_set1_ps(row.yf - 1);
+
+    return lerp8(
+        lerp8(grad8(aa, xf, yf), grad8(ba, xf1, yf), u),
+        lerp8(grad8(ab, xf, yf1), grad8(bb, xf1, yf1), u),
+        _mm256_set1_ps(row.v)
+    );
+}
+
+} // namespace
+
+namespace PerlinSimd {
+
+bool cpuHasSse41() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 19)) != 0;
+#else
+    return __builtin_cpu_supports("sse4.1");
+#endif
+}
+
+bool cpuHasAvx2() {
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    // AVX state must be enabled by the OS (OSXSAVE + XCR0 bits)
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+TG_TARGET_SSE41 int fractalRowSse41(const uint8_t* perm, float y, int x0, int xStride, float xStep, int count,
+    int octaves, float lacunarity, float persistence, float* out) {
+    const int batches = count / 4;
+    const __m128i lane = _mm_setr_epi32(0, xStride, 2 * xStride, 3 * xStride);
+    const __m128 step = _mm_set1_ps(xStep);
+
+    for (int b = 0; b < batches; ++b) {
+        __m128 x = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x0 + b * 4 * xStride), lane)), step);
+
+        __m128 total = _mm_setzero_ps();
+        float frequency = 1.0f;
+        float amplitude = 1.0f;
+        float maxAmplitude = 0.0f;
+
+        for (int i = 1; i < octaves; i++) {
+            RowY row = makeRowY(y * frequency);
+            __m128 n = noise4(perm, _mm_mul_ps(x, _mm_set1_ps(frequency)), row);
+            total = _mm_add_ps(total, _mm_mul_ps(n, _mm_set1_ps(amplitude)));
+            maxAmplitude += amplitude;
+
+            amplitude *= persistence;
+            frequency *= lacunarity;
+        }
+
+        _mm_storeu_ps(out + b * 4, _mm_div_ps(total, _mm_set1_ps(maxAmplitude)));
+    }
+
+    return batches * 4;
+}
+
+TG_TARGET_AVX2 int fractalRowAvx2(const uint8_t* perm, float y, int x0, int xStride, float xStep, int count,
+    int octaves, float lacunarity, float persistence, float* out) {
+    const int batches = count / 8;
+    const __m256i lane = _mm256_setr_epi32(0, xStride, 2 * xStride, 3 * xStride,
+        4 * xStride, 5 * xStride, 6 * xStride, 7 * xStride);
+    const __m256 step = _mm256_set1_ps(xStep);
+
+    for (int b = 0; b < batches; ++b) {
+        __m256 x = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x0 + b * 8 * xStride), lane)), step);
+
+        __m256 total = _mm256_setzero_ps();
+        float frequency = 1.0f;
+        float amplitude = 1.0f;
+        float maxAmplitude = 0.0f;
+
+        for (int i = 1; i < octaves; i++) {
+            RowY row = makeRowY(y * frequency);
+            __m256 n = noise8(perm, _mm256_mul_ps(x, _mm256_set1_ps(frequency)), row);
+            total = _mm256_add_ps(total, _mm256_mul_ps(n, _mm256_set1_ps(amplitude)));
+            maxAmplitude += amplitude;
+
+            amplitude *= persistence;
+            frequency *= lacunarity;
+        }
+
+        _mm256_storeu_ps(out + b * 8, _mm256_div_ps(total, _mm256_set1_ps(maxAmplitude)));
+    }
+
+    return batches * 8;
+}
+
+} // namespace PerlinSimd
+
+#else // !TG_NOISE_X86
+
+// Non-x86 targets only have the scalar path
+namespace PerlinSimd {
+    bool cpuHasSse41() { return false; }
+    bool cpuHasAvx2() { return false; }
+
+    int fractalRowSse41(const uint8_t*, float, int, int, float, int, int, float, float, float*) { return 0; }
+    int fractalRowAvx2(const uint8_t*, float, int, int, float, int, int, float, float, float*) { return 0; }
+}
+
+#endif
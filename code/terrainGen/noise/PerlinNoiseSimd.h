@@ -0,0 +1,32 @@
+#pragma once
+
+// SIMD kernels behind PerlinNoise::fractalNoiseRow.
+// Each kernel processes whole vectors only and returns how many points it
+// wrote; the caller finishes the tail with the scalar path.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TG_NOISE_X86 1
+#endif
+
+// GCC/Clang need per-function target attributes to emit SSE4.1/AVX2 code
+// without raising the baseline of the whole build. MSVC always allows it.
+#if defined(__GNUC__) || defined(__clang__)
+#define TG_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TG_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TG_TARGET_SSE41
+#define TG_TARGET_AVX2
+#endif
+
+#include <cstdint>
+
+namespace PerlinSimd {
+    bool cpuHasSse41();
+    bool cpuHasAvx2();
+
+    int fractalRowSse41(const uint8_t* perm, float y, int x0, int xStride, float xStep, int count,
+        int octaves, float lacunarity, float persistence, float* out);
+
+    int fractalRowAvx2(const uint8_t* perm, float y, int x0, int xStride, float xStep, int count,
+        int octaves, float lacunarity, float persistence, float* out);
+}
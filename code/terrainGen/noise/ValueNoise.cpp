@@ -0,0 +1,54 @@
+#include "ValueNoise.h"
+#include "ValueNoiseSimd.h"
+#include "util/Random.h"
+#include <cmath>
+
+ValueNoise::ValueNoise()
+    : ValueNoise(1)
+{
+}
+
+ValueNoise::ValueNoise(unsigned int seed) {
+    setSeed(seed);
+}
+
+void ValueNoise::setSeed(unsigned int seed) {
+    // Same stream as the Perlin table, so both backends follow the world seed
+    m_seed = CounterRng(seed, RandomStream::NoisePermutation).bits(0);
+}
+
+float ValueNoise::noise(float x, float y) const {
+    // Lattice cell and position inside it
+    float fx = std::floor(x);
+    float fy = std::floor(y);
+    uint32_t hx0 = (uint32_t)(int)fx * PRIME_X;
+    uint32_t hx1 = hx0 + PRIME_X;
+    uint32_t hy0 = m_seed ^ ((uint32_t)(int)fy * PRIME_Y);
+    uint32_t hy1 = m_seed ^ ((uint32_t)(int)fy * PRIME_Y + PRIME_Y);
+    float xf = x - fx;
+    float yf = y - fy;
+
+    // Same fade curve as PerlinNoise
+    float u = xf * xf * xf * (xf * (xf * 6 - 15) + 10);
+    float v = yf * yf * yf * (yf * (yf * 6 - 15) + 10);
+
+    float aa = toFloat(mix(hx0 ^ hy0));
+    float ba = toFloat(mix(hx1 ^ hy0));
+    float ab = toFloat(mix(hx0 ^ hy1));
+    float bb = toFloat(mix(hx1 ^ hy1));
+
+    float top = aa + u * (ba - aa);
+    float bottom = ab + u * (bb - ab);
+    return top + v * (bottom - top);
+}
+
+int ValueNoise::fractalRowSimd(SimdLevel level, float y, int x0, int xStride, float xStep, int count,
+    int octaves, float lacunarity, float persistence, float* out) const {
+    if (level == SimdLevel::AVX2) {
+        return ValueSimd::fractalRowAvx2(m_seed, y, x0, xStride, xStep, count, octaves, lacunarity, persistence, out);
+    }
+    if (level == SimdLevel::SSE41) {
+        return ValueSimd::fractalRowSse41(m_seed, y, x0, xStride, xStep, count, octaves, lacunarity, persistence, out);
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "PerlinNoise.h"
+#include <cstdint>
+
+// Value noise: a hashed random value at every lattice point, blended with
+// the same quintic fade as PerlinNoise. No table and no gradients, so it is
+// the cheapest backend (see NoiseBackend.h); the price is a blockier,
+// more grid-aligned look. Output lies in [-1, 1).
+class ValueNoise {
+public:
+    ValueNoise(); // seed 1
+    ValueNoise(unsigned int seed);
+
+    void setSeed(unsigned int seed);
+
+    // Core noise function
+    float noise(float x, float y) const;
+
+    // Backend hook: whole vectors of fractal noise on level; returns how
+    // many points were written
+    int fractalRowSimd(SimdLevel level, float y, int x0, int xStride, float xStep, int count,
+        int octaves, float lacunarity, float persistence, float* out) const;
+
+    // Lattice hashing, shared with the SIMD kernels. A lattice point's
+    // value is toFloat(mix(seed ^ X * PRIME_X ^ Y * PRIME_Y)).
+    static constexpr uint32_t PRIME_X = 0x27D4EB2Du;
+    static constexpr uint32_t PRIME_Y = 0x165667B1u;
+    static constexpr uint32_t MIX_1 = 0x7FEB352Du;
+    static constexpr uint32_t MIX_2 = 0x846CA68Bu;
+
+    static uint32_t mix(uint32_t h) {
+        h ^= h >> 16;
+        h *= MIX_1;
+        h ^= h >> 15;
+        h *= MIX_2;
+        h ^= h >> 16;
+        return h;
+    }
+
+    // Signed 32-bit hash to [-1, 1)
+    static float toFloat(uint32_t h) { return (float)(int32_t)h * (1.0f / 2147483648.0f); }
+
+private:
+    uint32_t m_seed;
+};
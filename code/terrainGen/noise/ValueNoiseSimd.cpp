@@ -0,0 +1,175 @@
+#include "ValueNoiseSimd.h"
+#include "ValueNoise.h"
+#include <cmath>
+
+#ifdef TG_NOISE_X86
+
+#include <immintrin.h>
+
+// The kernels below mirror ValueNoise::noise and noise::fractalNoise
+// operation for operation (no FMA, same evaluation order) so they match
+// the scalar path.
+
+namespace {
+
+// Scalar part shared by every lane of a row: y is constant across the batch
+struct RowY {
+    uint32_t hy0;
+    uint32_t hy1;
+    float v;
+};
+
+RowY makeRowY(uint32_t seed, float y) {
+    float fy = std::floor(y);
+    RowY r;
+    r.hy0 = seed ^ ((uint32_t)(int)fy * ValueNoise::PRIME_Y);
+    r.hy1 = seed ^ ((uint32_t)(int)fy * ValueNoise::PRIME_Y + ValueNoise::PRIME_Y);
+    float yf = y - fy;
+    r.v = yf * yf * yf * (yf * (yf * 6 - 15) + 10);
+    return r;
+}
+
+// ---------------- SSE4.1 ----------------
+
+TG_TARGET_SSE41 inline __m128 value4(__m128i h) {
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+    h = _mm_mullo_epi32(h, _mm_set1_epi32((int)ValueNoise::MIX_1));
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+    h = _mm_mullo_epi32(h, _mm_set1_epi32((int)ValueNoise::MIX_2));
+    h = _mm_xor_si128(h, _mm_srli_epi32(h, 16));
+    return _mm_mul_ps(_mm_cvtepi32_ps(h), _mm_set1_ps(1.0f / 2147483648.0f));
+}
+
+TG_TARGET_SSE41 inline __m128 lerp4(__m128 a, __m128 b, __m128 t) {
+    return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+TG_TARGET_SSE41 inline __m128 noise4(__m128 x, const RowY& row) {
+    __m128 fx = _mm_floor_ps(x);
+    __m128i hx0 = _mm_mullo_epi32(_mm_cvttps_epi32(fx), _mm_set1_epi32((int)ValueNoise::PRIME_X));
+    __m128i hx1 = _mm_add_epi32(hx0, _mm_set1_epi32((int)ValueNoise::PRIME_X));
+    __m128 xf = _mm_sub_ps(x, fx);
+
+    __m128 t3 = _mm_mul_ps(_mm_mul_ps(xf, xf), xf);
+    __m128 u = _mm_mul_ps(t3, _mm_add_ps(_mm_mul_ps(xf, _mm_sub_ps(_mm_mul_ps(xf, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f)));
+
+    __m128i hy0 = _mm_set1_epi32((int)row.hy0);
+    __m128i hy1 = _mm_set1_epi32((int)row.hy1);
+    __m128 aa = value4(_mm_xor_si128(hx0, hy0));
+    __m128 ba = value4(_mm_xor_si128(hx1, hy0));
+    __m128 ab = value4(_mm_xor_si128(hx0, hy1));
+    __m128 bb = value4(_mm_xor_si128(hx1, hy1));
+
+    return lerp4(lerp4(aa, ba, u), lerp4(ab, bb, u), _mm_set1_ps(row.v));
+}
+
+// ---------------- AVX2 ----------------
+
+TG_TARGET_AVX2 inline __m256 value8(__m256i h) {
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32((int)ValueNoise::MIX_1));
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32((int)ValueNoise::MIX_2));
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 16));
+    return _mm256_mul_ps(_mm256_cvtepi32_ps(h), _mm256_set1_ps(1.0f / 2147483648.0f));
+}
+
+TG_TARGET_AVX2 inline __m256 lerp8(__m256 a, __m256 b, __m256 t) {
+    return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+
+TG_TARGET_AVX2 inline __m256 noise8(__m256 x, const RowY& row) {
+    __m256 fx = _mm256_floor_ps(x);
+    __m256i hx0 = _mm256_mullo_epi32(_mm256_cvttps_epi32(fx), _mm256_set1_epi32((int)ValueNoise::PRIME_X));
+    __m256i hx1 = _mm256_add_epi32(hx0, _mm256_set1_epi32((int)ValueNoise::PRIME_X));
+    __m256 xf = _mm256_sub_ps(x, fx);
+
+    __m256 t3 = _mm256_mul_ps(_mm256_mul_ps(xf, xf), xf);
+    __m256 u = _mm256_mul_ps(t3, _mm256_add_ps(_mm256_mul_ps(xf, _mm256_sub_ps(_mm256_mul_ps(xf, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f)));
+
+    __m256i hy0 = _mm256_set1_epi32((int)row.hy0);
+    __m256i hy1 = _mm256_set1_epi32((int)row.hy1);
+    __m256 aa = value8(_mm256_xor_si256(hx0, hy0));
+    __m256 ba = value8(_mm256_xor_si256(hx1, hy0));
+    __m256 ab = value8(_mm256_xor_si256(hx0, hy1));
+    __m256 bb = value8(_mm256_xor_si256(hx1, hy1));
+
+    return lerp8(lerp8(aa, ba, u), lerp8(ab, bb, u), _mm256_set1_ps(row.v));
+}
+
+} // namespace
+
+namespace ValueSimd {
+
+TG_TARGET_SSE41 int fractalRowSse41(uint32_t seed, float y, int x0, int xStride, float xStep, int count,
+    int octaves, float lacunarity, float persistence, float* out) {
+    const int batches = count / 4;
+    const __m128i lane = _mm_setr_epi32(0, xStride, 2 * xStride, 3 * xStride);
+    const __m128 step = _mm_set1_ps(xStep);
+
+    for (int b = 0; b < batches; ++b) {
+        __m128 x = _mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x0 + b * 4 * xStride), lane)), step);
+
+        __m128 total = _mm_setzero_ps();
+        float frequency = 1.0f;
+        float amplitude = 1.0f;
+        float maxAmplitude = 0.0f;
+
+        for (int i = 1; i < octaves; i++) {
+            RowY row = makeRowY(seed, y * frequency);
+            __m128 n = noise4(_mm_mul_ps(x, _mm_set1_ps(frequency)), row);
+            total = _mm_add_ps(total, _mm_mul_ps(n, _mm_set1_ps(amplitude)));
+            maxAmplitude += amplitude;
+
+            amplitude *= persistence;
+            frequency *= lacunarity;
+        }
+
+        _mm_storeu_ps(out + b * 4, _mm_div_ps(total, _mm_set1_ps(maxAmplitude)));
+    }
+
+    return batches * 4;
+}
+
+TG_TARGET_AVX2 int fractalRowAvx2(uint32_t seed, float y, int x0, int xStride, float xStep, int count,
+    int octaves, float lacunarity, float persistence, float* out) {
+    const int batches = count / 8;
+    const __m256i lane = _mm256_setr_epi32(0, xStride, 2 * xStride, 3 * xStride,
+        4 * xStride, 5 * xStride, 6 * xStride, 7 * xStride);
+    const __m256 step = _mm256_set1_ps(xStep);
+
+    for (int b = 0; b < batches; ++b) {
+        __m256 x = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x0 + b * 8 * xStride), lane)), step);
+
+        __m256 total = _mm256_setzero_ps();
+        float frequency = 1.0f;
+        float amplitude = 1.0f;
+        float maxAmplitude = 0.0f;
+
+        for (int i = 1; i < octaves; i++) {
+            RowY row = makeRowY(seed, y * frequency);
+            __m256 n = noise8(_mm256_mul_ps(x, _mm256_set1_ps(frequency)), row);
+            total = _mm256_add_ps(total, _mm256_mul_ps(n, _mm256_set1_ps(amplitude)));
+            maxAmplitude += amplitude;
+
+            amplitude *= persistence;
+            frequency *= lacunarity;
+        }
+
+        _mm256_storeu_ps(out + b * 8, _mm256_div_ps(total, _mm256_set1_ps(maxAmplitude)));
+    }
+
+    return batches * 8;
+}
+
+} // namespace ValueSimd
+
+#else // !TG_NOISE_X86
+
+// Non-x86 targets only have the scalar path
+namespace ValueSimd {
+    int fractalRowSse41(uint32_t, float, int, int, float, int, int, float, float, float*) { return 0; }
+    int fractalRowAvx2(uint32_t, float, int, int, float, int, int, float, float, float*) { return 0; }
+}
+
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "PerlinNoiseSimd.h"
+#include <cstdint>
+
+// SIMD kernels behind ValueNoise::fractalRowSimd. Same contract as
+// PerlinSimd: whole vectors only, returns how many points were written.
+namespace ValueSimd {
+    int fractalRowSse41(uint32_t seed, float y, int x0, int xStride, float xStep, int count,
+        int octaves, float lacunarity, float persistence, float* out);
+
+    int fractalRowAvx2(uint32_t seed, float y, int x0, int xStride, float xStep, int count,
+        int octaves, float lacunarity, float persistence, float* out);
+}
@@ -0,0 +1,121 @@
+#include "GenerationWorker.h"
+
+#include "util/ThreadPool.h"
+
+#include <algorithm>
+#include <chrono>
+
+GenerationWorker::GenerationWorker(int threadCount) {
+    if (threadCount <= 0) threadCount = std::max(1, ThreadPool::hardwareThreads() - 1);
+    m_pipeline.setThreadCount(threadCount);
+    m_pipeline.setCancelFlag(&m_cancel);
+    m_pipeline.setPreviewCallback([this](int level, const World& world, const std::vector<unsigned char>& pixels) {
+        // A stale job's previews would replace a newer map
+        if (!m_cancel.load()) publish(level, world, pixels);
+    });
+    m_thread = std::thread(&GenerationWorker::workerLoop, this);
+}
+
+GenerationWorker::~GenerationWorker() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        m_cancel = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+}
+
+uint64_t GenerationWorker::request(const PipelineSettings& settings) {
+    uint64_t id;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        id = ++m_nextId;
+        m_pendingSettings = settings;
+        m_pendingId = id;
+
+        // Whatever is running now is stale
+        if (m_running) m_cancel = true;
+    }
+    m_wake.notify_one();
+    return id;
+}
+
+bool GenerationWorker::takeResult(GenerationResult& result) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_hasReady) return false;
+
+    std::swap(result, m_ready);
+    m_hasReady = false;
+    return true;
+}
+
+bool GenerationWorker::isBusy() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_running || m_pendingId != 0;
+}
+
+void GenerationWorker::waitIdle() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return !m_running && m_pendingId == 0; });
+}
+
+int GenerationWorker::getCancelledCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_cancelled;
+}
+
+void GenerationWorker::workerLoop() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        m_wake.wait(lock, [this] { return m_stop || m_pendingId != 0; });
+        if (m_stop) return;
+
+        // Taking the request and clearing the flag under the lock means a
+        // newer request can only cancel this job, never one it replaced
+        const uint64_t id = m_pendingId;
+        const PipelineSettings settings = m_pendingSettings;
+        m_pendingId = 0;
+        m_running = true;
+        m_cancel = false;
+        lock.unlock();
+
+        m_jobId = id;
+        m_jobSettings = settings;
+        m_jobStart = std::chrono::steady_clock::now();
+        m_pipeline.setSettings(settings);
+        m_pipeline.update();
+        const bool cancelled = m_cancel.load();
+        if (!cancelled) {
+            publish(0, m_pipeline.getWorld(), m_pipeline.getPixels());
+        }
+
+        lock.lock();
+        m_running = false;
+        if (cancelled) ++m_cancelled;
+        if (m_pendingId == 0) m_idle.notify_all();
+    }
+}
+
+void GenerationWorker::publish(int level, const World& world, const std::vector<unsigned char>& pixels) {
+    const StageGraph& graph = m_pipeline.getGraph();
+    m_back.requestId = m_jobId;
+    m_back.settings = m_jobSettings;
+    m_back.level = level;
+    m_back.width = world.getWidth();
+    m_back.height = world.getHeight();
+    m_back.pixels.assign(pixels.begin(), pixels.end());
+    if (m_back.world.getWidth() != world.getWidth() || m_back.world.getHeight() != world.getHeight()) {
+        m_back.world = CompactWorld(world.getWidth(), world.getHeight());
+    }
+    m_back.world.encode(world);
+    m_back.stages.clear();
+    for (int i = 0; i < graph.getStageCount(); ++i) {
+        m_back.stages.push_back(graph.getStats(i));
+    }
+    m_back.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_jobStart).count();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::swap(m_back, m_ready);
+    m_hasReady = true;
+}
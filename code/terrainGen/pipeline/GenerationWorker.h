@@ -0,0 +1,101 @@
+#pragma once
+
+#include "TerrainPipeline.h"
+#include "world/CompactWorld.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One finished map handed from the worker to its owner
+struct GenerationResult {
+    uint64_t requestId = 0;
+    PipelineSettings settings;
+    int level = 0; // pyramid level; above 0 for a coarse preview
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> pixels; // RGB8, see buildPixelBuffer
+    CompactWorld world;                // the map itself, quantized
+    std::vector<StageStats> stages;    // what ran for this result and how long
+    double totalMs = 0.0;
+};
+
+// Runs a TerrainPipeline on a background thread.
+//
+// request() queues new settings and returns immediately. Only the latest
+// request is kept, and a job that is still running when a newer request
+// arrives is cancelled, so the worker always converges on the last
+// settings. Since the pipeline caches per stage, a request that only
+// changes e.g. river settings re-runs only the water stages.
+//
+// While the terrain of a new map is generated, coarse previews (1/16 of
+// the map per axis first) are published as they complete; the full map
+// follows with level 0.
+//
+// Each result carries the map in a CompactWorld, so the owner can inspect
+// tiles at 6 bytes each instead of keeping a float World per buffer.
+//
+// Finished maps are published through a double buffer: the worker fills
+// its back buffer without holding any lock, then swaps it with the ready
+// slot. takeResult() swaps the ready slot into the caller's buffer, so the
+// buffers are recycled and the owner never waits for generation.
+class GenerationWorker {
+public:
+    // threadCount includes the worker thread; 0 = all hardware threads but
+    // one, leaving a core for the thread that owns the worker (e.g. a UI)
+    explicit GenerationWorker(int threadCount = 0);
+    ~GenerationWorker();
+
+    GenerationWorker(const GenerationWorker&) = delete;
+    GenerationWorker& operator=(const GenerationWorker&) = delete;
+
+    // Queues a generation and cancels any stale one; returns its request id
+    uint64_t request(const PipelineSettings& settings);
+
+    // If a map newer than the last one taken is ready, swaps it into result
+    // and returns true. Never blocks on generation.
+    bool takeResult(GenerationResult& result);
+
+    // True while a request is queued or running
+    bool isBusy() const;
+
+    // Blocks until every queued request has finished or been cancelled
+    void waitIdle();
+
+    // Jobs abandoned because a newer request arrived
+    int getCancelledCount() const;
+
+private:
+    TerrainPipeline m_pipeline; // only touched by the worker thread
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_idle;
+
+    PipelineSettings m_pendingSettings;
+    uint64_t m_pendingId = 0;   // 0 = nothing queued
+    uint64_t m_nextId = 0;
+    bool m_running = false;
+    bool m_stop = false;
+    std::atomic<bool> m_cancel{ false };
+    int m_cancelled = 0;
+
+    // The running job, only touched by the worker thread
+    uint64_t m_jobId = 0;
+    PipelineSettings m_jobSettings;
+    std::chrono::steady_clock::time_point m_jobStart;
+
+    GenerationResult m_back;  // written by the worker without the lock
+    GenerationResult m_ready; // guarded by m_mutex
+    bool m_hasReady = false;
+
+    std::thread m_thread;
+
+    void workerLoop();
+
+    // Fills the back buffer from the pipeline and swaps it into the ready slot
+    void publish(int level, const World& world, const std::vector<unsigned char>& pixels);
+};
@@ -0,0 +1,116 @@
+#include "StageGraph.h"
+
+#include "util/Hash.h"
+#include "util/Profiler.h"
+
+#include <chrono>
+
+int StageGraph::addStage(const std::string& name, const std::vector<std::string>& inputs, ParamsFn params, RunFn run) {
+    if (findStage(name) >= 0) return -1;
+
+    Stage stage;
+    stage.stats.name = name;
+    stage.params = std::move(params);
+    stage.run = std::move(run);
+    for (const std::string& input : inputs) {
+        int index = findStage(input);
+        if (index < 0) return -1;
+        stage.inputs.push_back(index);
+    }
+
+    m_stages.push_back(std::move(stage));
+    return (int)m_stages.size() - 1;
+}
+
+void StageGraph::computeKeys(std::vector<uint64_t>& keys) const {
+    // Inputs come first, so their keys are final when a stage needs them
+    keys.resize(m_stages.size());
+    for (size_t i = 0; i < m_stages.size(); ++i) {
+        const Stage& stage = m_stages[i];
+        uint64_t params = stage.params ? stage.params() : 0;
+        uint64_t key = hashValue(hashValue(FNV_OFFSET_BASIS, params), stage.generation);
+        for (int input : stage.inputs) {
+            key = hashValue(key, keys[input]);
+        }
+        keys[i] = key;
+    }
+}
+
+int StageGraph::update(const std::function<bool()>& cancelled) {
+    // Keys only depend on parameters, never on stage output, so they can
+    // all be computed before anything runs
+    computeKeys(m_keys);
+    const std::vector<uint64_t>& keys = m_keys;
+
+    int ran = 0;
+    for (size_t i = 0; i < m_stages.size(); ++i) {
+        Stage& stage = m_stages[i];
+        if (stage.valid && keys[i] == stage.stats.key) continue;
+        if (cancelled && cancelled()) break;
+
+        TG_PROFILE_SCOPE(stage.stats.name.c_str(), 0.0);
+        auto start = std::chrono::steady_clock::now();
+        stage.valid = false;
+        invalidateDependents(i);
+        if (stage.run) stage.run();
+        if (cancelled && cancelled()) break;
+        stage.stats.lastMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        stage.stats.runs++;
+        stage.stats.key = keys[i];
+        stage.valid = true;
+        ++ran;
+    }
+    return ran;
+}
+
+void StageGraph::invalidateDependents(size_t stage) {
+    // Dependents come later; one with an invalid input depends on stage or
+    // will be reached through an input that reruns anyway
+    for (size_t i = stage + 1; i < m_stages.size(); ++i) {
+        for (int input : m_stages[i].inputs) {
+            if (!m_stages[input].valid) {
+                m_stages[i].valid = false;
+                break;
+            }
+        }
+    }
+}
+
+void StageGraph::invalidate(const std::string& name) {
+    int index = findStage(name);
+    if (index < 0) return;
+
+    // A new generation changes the key, which carries downstream
+    m_stages[index].generation++;
+    m_stages[index].valid = false;
+}
+
+void StageGraph::invalidateAll() {
+    for (Stage& stage : m_stages) {
+        stage.generation++;
+        stage.valid = false;
+    }
+}
+
+bool StageGraph::isDirty(const std::string& name) const {
+    int index = findStage(name);
+    if (index < 0) return false;
+    std::vector<uint64_t> keys;
+    computeKeys(keys);
+    return !m_stages[index].valid || keys[index] != m_stages[index].stats.key;
+}
+
+int StageGraph::findStage(const std::string& name) const {
+    for (size_t i = 0; i < m_stages.size(); ++i) {
+        if (m_stages[i].stats.name == name) return (int)i;
+    }
+    return -1;
+}
+
+int StageGraph::getStageCount() const {
+    return (int)m_stages.size();
+}
+
+const StageStats& StageGraph::getStats(int stage) const {
+    return m_stages[stage].stats;
+}
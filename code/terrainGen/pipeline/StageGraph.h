@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Per-stage bookkeeping, for UIs and benchmarks
+struct StageStats {
+    std::string name;
+    int runs = 0;        // times the stage actually ran
+    double lastMs = 0.0; // duration of the last run
+    uint64_t key = 0;    // cache key of the current output
+};
+
+// A DAG of named generation stages with cached outputs.
+//
+// Every stage has a parameter hash and a list of input stages. Its cache
+// key combines the parameter hash with the keys of its inputs, so a change
+// anywhere upstream changes the key of everything below it. update() runs
+// the stages in order and skips every stage whose key matches its last run;
+// the stage's output (whatever its run function wrote) is still valid then.
+// A stage that runs also invalidates everything downstream, since stages
+// may modify their inputs' output in place: a rerun caused by a cancelled
+// run, with unchanged keys, still has to carry down the graph.
+//
+// Stages must be added after their inputs, so insertion order is a valid
+// run order and the graph cannot contain cycles.
+class StageGraph {
+public:
+    using ParamsFn = std::function<uint64_t()>;
+    using RunFn = std::function<void()>;
+
+    // Returns the stage index, or -1 if the name is taken or an input is unknown
+    int addStage(const std::string& name, const std::vector<std::string>& inputs, ParamsFn params, RunFn run);
+
+    // Runs every stage whose parameters or inputs changed; returns how many ran.
+    // cancelled (optional) is polled before and after every stage; a stage
+    // that finishes after cancellation is treated as incomplete and stays
+    // dirty, and the remaining stages are skipped.
+    int update(const std::function<bool()>& cancelled = nullptr);
+
+    // Forces a stage and everything downstream to run on the next update
+    void invalidate(const std::string& name);
+    void invalidateAll();
+
+    // True if the stage would run on the next update
+    bool isDirty(const std::string& name) const;
+
+    int findStage(const std::string& name) const;
+    int getStageCount() const;
+    const StageStats& getStats(int stage) const;
+
+private:
+    struct Stage {
+        StageStats stats;
+        std::vector<int> inputs;
+        ParamsFn params;
+        RunFn run;
+        uint64_t generation = 0; // bumped by invalidate
+        bool valid = false;
+    };
+
+    std::vector<Stage> m_stages;
+    std::vector<uint64_t> m_keys; // reused by update so it does not allocate
+
+    // Marks every stage that transitively reads stage as invalid
+    void invalidateDependents(size_t stage);
+
+    // Keys of all stages as the next update would compute them
+    void computeKeys(std::vector<uint64_t>& keys) const;
+};
@@ -0,0 +1,246 @@
+#include "TerrainPipeline.h"
+
+#include "render/Renderer.h"
+#include "util/Hash.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Levels kept per map: the coarsest is 1/16 of the map per axis
+const int PYRAMID_LEVELS = 5;
+
+// Coarse levels smaller than this are not worth previewing
+const int MIN_LEVEL_EXTENT = 16;
+
+WorldPyramid* createPyramid(int width, int height) {
+    return new WorldPyramid(width, height, WorldPyramid::levelsFor(width, height, PYRAMID_LEVELS, MIN_LEVEL_EXTENT));
+}
+
+} // namespace
+
+TerrainPipeline::TerrainPipeline(const PipelineSettings& settings)
+    : m_settings(settings),
+    m_pyramid(createPyramid(settings.width, settings.height))
+{
+    m_graph.addStage("terrain", {}, [this] {
+        uint64_t h = hashValue(FNV_OFFSET_BASIS, m_settings.seed);
+        h = hashValue(h, m_settings.width);
+        h = hashValue(h, m_settings.height);
+        return hashValue(h, m_settings.noise);
+    }, [this] { runTerrain(); });
+
+    m_graph.addStage("erosion", { "terrain" }, [this] {
+        uint64_t h = hashValue(FNV_OFFSET_BASIS, m_settings.erosionEnabled);
+        return hashValue(h, m_settings.erosion);
+    }, [this] { runErosion(); });
+
+    m_graph.addStage("biomes", { "erosion" }, [this] {
+        return hashValue(FNV_OFFSET_BASIS, m_settings.biomeRules);
+    }, [this] {
+        m_generator->classifyBiomes(world(), m_settings.biomeRules);
+    });
+
+    m_graph.addStage("flow", { "biomes" }, nullptr, [this] {
+        m_rivers->fillDepressions();
+    });
+
+    m_graph.addStage("rivers", { "flow" }, [this] {
+        uint64_t h = hashValue(FNV_OFFSET_BASIS, m_settings.riverThreshold);
+        return hashValue(h, m_settings.moistureInfluence);
+    }, [this] {
+        world().riverPlane().fill(0.0f);
+        m_rivers->accumulateFlow(m_settings.moistureInfluence);
+        m_rivers->applyRiverStrength(m_settings.riverThreshold);
+    });
+
+    m_graph.addStage("lakes", { "rivers" }, [this] {
+        return hashValue(FNV_OFFSET_BASIS, m_settings.lakeThreshold);
+    }, [this] {
+        world().lakePlane().fill(false);
+        m_rivers->generateLakes(m_settings.lakeThreshold);
+    });
+
+    m_graph.addStage("lod", { "lakes" }, nullptr, [this] {
+        m_pyramid->downsample();
+    });
+
+    m_graph.addStage("relief", { "lakes" }, [this] {
+        const HillshadeSettings& relief = m_settings.hillshade;
+        uint64_t h = hashValue(FNV_OFFSET_BASIS, m_settings.hillshadeEnabled);
+        if (!m_settings.hillshadeEnabled) return h;
+        h = hashValue(h, relief.reliefScale);
+        h = hashValue(h, relief.ambientOcclusion);
+        h = hashValue(h, relief.occlusionRadius);
+        h = hashValue(h, relief.occlusionStrength);
+        h = hashValue(h, relief.rivers);
+        return hashValue(h, relief.lakes);
+    }, [this] { runRelief(); });
+
+    m_graph.addStage("pixels", { "biomes", "relief" }, [this] {
+        const HillshadeSettings& relief = m_settings.hillshade;
+        uint64_t h = hashValue(FNV_OFFSET_BASIS, m_settings.hillshadeEnabled);
+        if (!m_settings.hillshadeEnabled) return h;
+        h = hashValue(h, relief.sunAzimuth);
+        h = hashValue(h, relief.sunElevation);
+        h = hashValue(h, relief.ambient);
+        return hashValue(h, relief.diffuse);
+    }, [this] {
+        if (m_hillshade) {
+            m_hillshade->relight(m_settings.hillshade, m_pixels);
+        }
+        else {
+            buildPixelBuffer(world(), m_pixels);
+        }
+    });
+}
+
+void TerrainPipeline::runTerrain() {
+    if (m_pyramid->getWidth() != m_settings.width || m_pyramid->getHeight() != m_settings.height) {
+        m_rivers.reset();
+        m_erosion.reset();
+        m_pyramid.reset(createPyramid(m_settings.width, m_settings.height));
+    }
+
+    m_context.prepare(m_settings.width, m_settings.height);
+    m_noiseHeightsValid = false;
+
+    // Generators are reseeded rather than rebuilt, so regenerating at the
+    // same size reuses all of their memory and threads
+    if (!m_generator) {
+        m_generator.reset(new TerrainGenerator(m_settings.seed));
+        m_generator->setThreadCount(m_threadCount);
+        m_generator->setCancelFlag(m_cancel);
+    }
+    else {
+        m_generator->setSeed(m_settings.seed);
+    }
+    m_generator->setNoiseBackend(m_settings.noise);
+
+    // Coarse to fine, so a preview can be shown long before the full map
+    m_generator->generateProgressive(*m_pyramid, [this](int level) {
+        if (level == 0 || !m_preview) return;
+
+        World& coarse = m_pyramid->level(level);
+        m_generator->classifyBiomes(coarse, m_settings.biomeRules);
+        buildPixelBuffer(coarse, m_previewPixels);
+        m_preview(level, coarse, m_previewPixels);
+    });
+
+    // The flow stage reads the new terrain through the same World
+    if (!m_rivers) {
+        m_rivers.reset(new RiverGenerator(world(), m_settings.seed));
+        m_rivers->setThreadCount(m_threadCount);
+        m_rivers->setCancelFlag(m_cancel);
+        m_rivers->setContext(&m_context);
+    }
+    else {
+        m_rivers->setSeed(m_settings.seed);
+    }
+}
+
+void TerrainPipeline::runErosion() {
+    // Erosion works in place, so the noise heights are kept the first time
+    // it runs and restored before every later run. While erosion is off the
+    // heights are left alone.
+    Plane<float>& heights = world().heightPlane();
+    if (m_noiseHeightsValid) {
+        std::copy(m_noiseHeights.data(), m_noiseHeights.data() + heights.size(), heights.data());
+    }
+    if (!m_settings.erosionEnabled) return;
+
+    if (!m_noiseHeightsValid) {
+        if (m_noiseHeights.getWidth() != heights.getWidth() || m_noiseHeights.getHeight() != heights.getHeight()) {
+            m_noiseHeights = Plane<float>(heights.getWidth(), heights.getHeight());
+        }
+        std::copy(heights.data(), heights.data() + heights.size(), m_noiseHeights.data());
+        m_noiseHeightsValid = true;
+    }
+
+    if (!m_erosion) {
+        m_erosion.reset(new ErosionSimulator(world(), m_settings.seed));
+        m_erosion->setThreadCount(m_threadCount);
+        m_erosion->setCancelFlag(m_cancel);
+    }
+    else {
+        m_erosion->setSeed(m_settings.seed);
+    }
+    m_erosion->erode(m_settings.erosion);
+}
+
+void TerrainPipeline::runRelief() {
+    // The normals and albedo take 8 bytes per tile, so they are only kept
+    // while relief shading is on
+    if (!m_settings.hillshadeEnabled) {
+        m_hillshade.reset();
+        return;
+    }
+    if (!m_hillshade) {
+        m_hillshade.reset(new HillshadeRenderer(m_threadCount));
+    }
+    m_hillshade->prepare(world(), m_settings.hillshade);
+}
+
+void TerrainPipeline::setSettings(const PipelineSettings& settings) {
+    m_settings = settings;
+}
+
+const PipelineSettings& TerrainPipeline::getSettings() const {
+    return m_settings;
+}
+
+void TerrainPipeline::setThreadCount(int threadCount) {
+    m_threadCount = threadCount;
+    if (m_generator) m_generator->setThreadCount(threadCount);
+    if (m_rivers) m_rivers->setThreadCount(threadCount);
+    if (m_erosion) m_erosion->setThreadCount(threadCount);
+    if (m_hillshade) m_hillshade->setThreadCount(threadCount);
+}
+
+void TerrainPipeline::setCancelFlag(const std::atomic<bool>* cancel) {
+    m_cancel = cancel;
+    if (m_generator) m_generator->setCancelFlag(cancel);
+    if (m_rivers) m_rivers->setCancelFlag(cancel);
+    if (m_erosion) m_erosion->setCancelFlag(cancel);
+}
+
+int TerrainPipeline::update() {
+    if (!m_cancel) return m_graph.update();
+    return m_graph.update([this] { return m_cancel->load(std::memory_order_relaxed); });
+}
+
+void TerrainPipeline::setPreviewCallback(PreviewFn preview) {
+    m_preview = std::move(preview);
+}
+
+World& TerrainPipeline::world() {
+    return m_pyramid->level(0);
+}
+
+const World& TerrainPipeline::getWorld() const {
+    return m_pyramid->level(0);
+}
+
+const WorldPyramid& TerrainPipeline::getPyramid() const {
+    return *m_pyramid;
+}
+
+const std::vector<unsigned char>& TerrainPipeline::getPixels() const {
+    return m_pixels;
+}
+
+size_t TerrainPipeline::getScratchMemoryUsage() const {
+    size_t bytes = m_context.getMemoryUsage() + m_noiseHeights.getMemoryUsage();
+    if (m_erosion) bytes += m_erosion->getMemoryUsage();
+    if (m_hillshade) bytes += m_hillshade->getMemoryUsage();
+    return bytes;
+}
+
+StageGraph& TerrainPipeline::getGraph() {
+    return m_graph;
+}
+
+const StageGraph& TerrainPipeline::getGraph() const {
+    return m_graph;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "StageGraph.h"
+#include "noise/NoiseBackend.h"
+#include "render/Hillshade.h"
+#include "terrain/BiomeRules.h"
+#include "terrain/ErosionSimulator.h"
+#include "terrain/GenerationContext.h"
+#include "terrain/RiverGenerator.h"
+#include "terrain/TerrainGenerator.h"
+#include "world/World.h"
+#include "world/WorldPyramid.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Everything that shapes a generated map
+struct PipelineSettings {
+    unsigned int seed = 1337;
+    int width = 256;
+    int height = 256;
+    noise::NoiseBackend noise = noise::NoiseBackend::Perlin; // Value trades quality for speed, e.g. while tuning
+
+    bool erosionEnabled = false; // Off keeps the raw noise heights
+    ErosionSettings erosion;
+
+    BiomeRules biomeRules;
+
+    float riverThreshold = 0.002f;   // Share of the map's rainfall needed to form a river
+    float moistureInfluence = 0.5f;  // How much moisture scales rainfall
+    float lakeThreshold = 0.001f;    // Share of the map's rainfall a basin needs to hold a lake
+
+    bool hillshadeEnabled = false;   // Off keeps the flat height-tinted colours
+    HillshadeSettings hillshade;
+};
+
+// The full generation sequence as a stage graph:
+//
+//   terrain -> erosion -> biomes -> flow -> rivers -> lakes -> lod
+//                                |                          \-> relief
+//                                \-> pixels <---------------------/
+//
+// terrain:  height, moisture and temperature noise (seed, size, noise),
+//           coarse pyramid levels first
+// erosion:  hydraulic and thermal erosion of the heights (erosionEnabled,
+//           erosion); previews of coarse levels show the uneroded noise
+// biomes:   biome classification (biomeRules)
+// flow:     depression filling and flow directions
+// rivers:   catchment accumulation and river strength (riverThreshold, moistureInfluence)
+// lakes:    basin lakes (lakeThreshold)
+// lod:      coarser pyramid levels refreshed from the full map
+// relief:   hillshade normals, occlusion and albedo (hillshadeEnabled and
+//           the surface part of hillshade)
+// pixels:   RGB preview, lit by the sun settings of hillshade when enabled
+//
+// update() only re-runs the stages downstream of a changed setting, so
+// tuning biome or water settings never touches the noise and moving the
+// sun only re-runs pixels. Stage scratch comes from one GenerationContext
+// and the generators are reseeded in place, so regenerating at the same
+// size stops allocating once the scratch has grown to what the stages need.
+class TerrainPipeline {
+public:
+    // A coarse pyramid level, biomes already classified with the current
+    // rules, and its RGB preview
+    using PreviewFn = std::function<void(int level, const World& world, const std::vector<unsigned char>& pixels)>;
+
+    explicit TerrainPipeline(const PipelineSettings& settings = PipelineSettings());
+
+    void setSettings(const PipelineSettings& settings);
+    const PipelineSettings& getSettings() const;
+
+    // Threads for the parallel stages; 0 = all. Does not invalidate anything.
+    void setThreadCount(int threadCount);
+
+    // While *cancel is set, update() abandons the running stage as soon as
+    // possible and leaves it dirty. nullptr (default) disables the check.
+    void setCancelFlag(const std::atomic<bool>* cancel);
+
+    // Brings every output up to date; returns the number of stages that ran
+    int update();
+
+    // Called from update() each time the terrain stage finishes a coarse
+    // level, coarsest first. nullptr (default) skips the previews.
+    void setPreviewCallback(PreviewFn preview);
+
+    const World& getWorld() const;
+
+    // The map and its coarser levels, level 0 being getWorld()
+    const WorldPyramid& getPyramid() const;
+    const std::vector<unsigned char>& getPixels() const;
+
+    // Bytes of stage scratch kept between updates
+    size_t getScratchMemoryUsage() const;
+
+    StageGraph& getGraph();
+    const StageGraph& getGraph() const;
+
+private:
+    PipelineSettings m_settings;
+    int m_threadCount = 0;
+    const std::atomic<bool>* m_cancel = nullptr;
+
+    GenerationContext m_context;
+    std::unique_ptr<WorldPyramid> m_pyramid;
+    std::unique_ptr<TerrainGenerator> m_generator;
+    std::unique_ptr<RiverGenerator> m_rivers;
+    std::unique_ptr<ErosionSimulator> m_erosion;
+    std::unique_ptr<HillshadeRenderer> m_hillshade; // only while hillshadeEnabled
+    Plane<float> m_noiseHeights; // heights before erosion, so erosion can re-run from them
+    bool m_noiseHeightsValid = false;
+    std::vector<unsigned char> m_pixels;
+
+    PreviewFn m_preview;
+    std::vector<unsigned char> m_previewPixels;
+
+    StageGraph m_graph;
+
+    World& world();
+    void runTerrain();
+    void runErosion();
+    void runRelief();
+};
@@ -0,0 +1,219 @@
+#include "Hillshade.h"
+
+#include "HillshadeSimd.h"
+#include "Renderer.h"
+#include "util/Profiler.h"
+#include "world/Stencil.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Rows per relight job: a few hundred KB of input at 8192 tiles per row
+const int RELIGHT_BAND_ROWS = 16;
+
+const float NORMAL_SCALE = 127.0f;
+const float OCCLUSION_UNIT = 1.0f / 255.0f;
+const float PI = 3.14159265358979f;
+
+const unsigned char LAKE_COLOR[3] = { 45, 95, 165 };
+const unsigned char RIVER_COLOR[3] = { 60, 120, 200 };
+
+// Flat, fully open: water and anything without neighbours
+const uint32_t FLAT_NORMAL = (uint32_t)127 << 16 | (uint32_t)255 << 24;
+
+uint32_t packColor(float r, float g, float b) {
+    return (uint32_t)r | (uint32_t)g << 8 | (uint32_t)b << 16;
+}
+
+int roundToInt(float value) {
+    return (int)(value < 0.0f ? value - 0.5f : value + 0.5f);
+}
+
+uint8_t toSignedByte(float value) {
+    return (uint8_t)(int8_t)roundToInt(value * NORMAL_SCALE);
+}
+
+} // namespace
+
+HillshadeRenderer::HillshadeRenderer(int threadCount)
+    : m_pool(new ThreadPool(threadCount))
+{
+}
+
+void HillshadeRenderer::setThreadCount(int threadCount) {
+    if (threadCount <= 0) threadCount = ThreadPool::hardwareThreads();
+    if (threadCount == m_pool->getThreadCount()) return;
+    m_pool.reset(new ThreadPool(threadCount));
+}
+
+void HillshadeRenderer::prepare(const World& world, const HillshadeSettings& settings) {
+    const int width = world.getWidth();
+    const int height = world.getHeight();
+    TG_PROFILE_SCOPE("hillshade_prepare", (double)width * height);
+
+    if (m_normals.getWidth() != width || m_normals.getHeight() != height) {
+        m_normals = Plane<uint32_t>(width, height);
+        m_albedo = Plane<uint32_t>(width, height);
+    }
+
+    const float* heights = world.heightPlane().data();
+    const Biome* biomes = world.biomePlane().data();
+    const float* rivers = world.riverPlane().data();
+    const bool* lakes = world.lakePlane().data();
+    uint32_t* normals = m_normals.data();
+    uint32_t* albedo = m_albedo.data();
+
+    // Height differences in tiles, so slopes keep their look at every map size
+    const float zScale = settings.reliefScale * std::max(width, height) / 256.0f;
+    const int radius = settings.ambientOcclusion ? std::max(1, settings.occlusionRadius) : 0;
+
+    // Horizon samples at 1, 2, 4, ... tiles, and per direction the factor
+    // turning a height difference at each sample into a slope
+    std::vector<int> sampleSteps;
+    for (int s = 1; s <= radius && s <= std::max(width, height); s *= 2) sampleSteps.push_back(s);
+    const int samples = (int)sampleSteps.size();
+    std::vector<float> sampleSlope(8 * samples);
+    for (int dir = 0; dir < 8; ++dir) {
+        const float step = (dir & 1) ? 1.41421356f : 1.0f;
+        for (int k = 0; k < samples; ++k) sampleSlope[dir * samples + k] = zScale / (sampleSteps[k] * step);
+    }
+
+    forEachStencil(width, height, m_pool.get(), [&](const auto& cell) {
+        const int i = cell.idx;
+        const float h0 = heights[i];
+        const bool ocean = biomes[i] == Biome::Ocean;
+        const bool lake = settings.lakes && lakes[i];
+
+        unsigned char r, g, b;
+        biomeToColor(biomes[i], r, g, b);
+        if (ocean) {
+            // Flat water keeps the height tint so the depth still shows
+            const float depthShade = 0.7f + 0.3f * h0;
+            albedo[i] = packColor(r * depthShade, g * depthShade, b * depthShade);
+        }
+        else if (lake) {
+            albedo[i] = packColor(LAKE_COLOR[0], LAKE_COLOR[1], LAKE_COLOR[2]);
+        }
+        else if (settings.rivers && rivers[i] > 0.0f) {
+            const float a = std::min(1.0f, 0.4f + 0.6f * rivers[i]);
+            albedo[i] = packColor(r + (RIVER_COLOR[0] - r) * a, g + (RIVER_COLOR[1] - g) * a, b + (RIVER_COLOR[2] - b) * a);
+        }
+        else {
+            albedo[i] = packColor(r, g, b);
+        }
+
+        if (ocean || lake) {
+            normals[i] = FLAT_NORMAL;
+            return;
+        }
+
+        // Horn's gradient; missing neighbours at the map edge count as level
+        float n[8];
+        for (int dir = 0; dir < 8; ++dir) {
+            n[dir] = cell.has(dir) ? heights[cell.neighbour(dir)] : h0;
+        }
+        const float gx = ((n[1] + 2.0f * n[2] + n[3]) - (n[7] + 2.0f * n[6] + n[5])) * (zScale / 8.0f);
+        const float gy = ((n[5] + 2.0f * n[4] + n[3]) - (n[7] + 2.0f * n[0] + n[1])) * (zScale / 8.0f);
+        const float inverseLength = 1.0f / std::sqrt(gx * gx + gy * gy + 1.0f);
+
+        // Horizon-based occlusion: in each direction the steepest rise
+        // within the radius, as the sine of its elevation
+        float occlusion = 0.0f;
+        for (int dir = 0; dir < 8 && samples > 0; ++dir) {
+            const float* slope = &sampleSlope[dir * samples];
+            float steepest = 0.0f;
+            for (int k = 0; k < samples; ++k) {
+                const int x = cell.x + stencil::DX[dir] * sampleSteps[k];
+                const int y = cell.y + stencil::DY[dir] * sampleSteps[k];
+                if (x < 0 || y < 0 || x >= width || y >= height) break;
+                steepest = std::max(steepest, (heights[(size_t)y * width + x] - h0) * slope[k]);
+            }
+            if (steepest > 0.0f) occlusion += steepest / std::sqrt(1.0f + steepest * steepest);
+        }
+        const float open = std::max(0.0f, 1.0f - settings.occlusionStrength * occlusion / 8.0f);
+
+        normals[i] = toSignedByte(-gx * inverseLength)
+            | (uint32_t)toSignedByte(-gy * inverseLength) << 8
+            | (uint32_t)roundToInt(inverseLength * NORMAL_SCALE) << 16
+            | (uint32_t)roundToInt(open * 255.0f) << 24;
+    });
+}
+
+void HillshadeRenderer::relight(const HillshadeSettings& settings, std::vector<unsigned char>& pixels) const {
+    relight(settings, pixels, PerlinNoise::bestSimdLevel());
+}
+
+void HillshadeRenderer::relight(const HillshadeSettings& settings, std::vector<unsigned char>& pixels, SimdLevel level) const {
+    const int width = m_normals.getWidth();
+    const int height = m_normals.getHeight();
+    TG_PROFILE_SCOPE("hillshade_relight", (double)width * height);
+    pixels.resize(m_normals.size() * 3);
+    level = std::min(level, PerlinNoise::bestSimdLevel());
+
+    // Sun direction with y down the map, prescaled to the normal bytes
+    const float azimuth = settings.sunAzimuth * (PI / 180.0f);
+    const float elevation = settings.sunElevation * (PI / 180.0f);
+    HillshadeSimd::Light light;
+    light.x = std::sin(azimuth) * std::cos(elevation) / NORMAL_SCALE;
+    light.y = -std::cos(azimuth) * std::cos(elevation) / NORMAL_SCALE;
+    light.z = std::sin(elevation) / NORMAL_SCALE;
+    light.ambient = settings.ambient;
+    light.diffuse = settings.diffuse;
+
+    const uint32_t* normals = m_normals.data();
+    const uint32_t* albedo = m_albedo.data();
+    unsigned char* out = pixels.data();
+
+    const int bands = (height + RELIGHT_BAND_ROWS - 1) / RELIGHT_BAND_ROWS;
+    m_pool->parallelFor(bands, [&](int band) {
+        const size_t begin = (size_t)band * RELIGHT_BAND_ROWS * width;
+        const size_t end = (size_t)std::min(height, (band + 1) * RELIGHT_BAND_ROWS) * width;
+        const size_t count = end - begin;
+
+        size_t done = 0;
+        if (level == SimdLevel::AVX2) {
+            done = HillshadeSimd::relightAvx2(normals + begin, albedo + begin, light, out + begin * 3, count);
+        }
+        else if (level == SimdLevel::SSE41) {
+            done = HillshadeSimd::relightSse41(normals + begin, albedo + begin, light, out + begin * 3, count);
+        }
+
+        for (size_t tile = begin + done; tile < end; ++tile) {
+            const uint32_t n = normals[tile];
+            const float nx = (float)(int8_t)(n & 0xFF);
+            const float ny = (float)(int8_t)(n >> 8 & 0xFF);
+            const float nz = (float)(n >> 16 & 0xFF);
+            const float open = (float)(n >> 24);
+
+            float d = nx * light.x + ny * light.y;
+            d = d + nz * light.z;
+            d = std::max(d, 0.0f);
+            const float lit = (light.ambient + light.diffuse * d) * (open * OCCLUSION_UNIT);
+
+            const uint32_t rgb = albedo[tile];
+            unsigned char* pixel = out + tile * 3;
+            pixel[0] = (unsigned char)std::min((float)(rgb & 0xFF) * lit, 255.0f);
+            pixel[1] = (unsigned char)std::min((float)(rgb >> 8 & 0xFF) * lit, 255.0f);
+            pixel[2] = (unsigned char)std::min((float)(rgb >> 16 & 0xFF) * lit, 255.0f);
+        }
+    });
+}
+
+void HillshadeRenderer::render(const World& world, const HillshadeSettings& settings, std::vector<unsigned char>& pixels) {
+    prepare(world, settings);
+    relight(settings, pixels);
+}
+
+int HillshadeRenderer::getWidth() const {
+    return m_normals.getWidth();
+}
+
+int HillshadeRenderer::getHeight() const {
+    return m_normals.getHeight();
+}
+
+size_t HillshadeRenderer::getMemoryUsage() const {
+    return m_normals.getMemoryUsage() + m_albedo.getMemoryUsage();
+}
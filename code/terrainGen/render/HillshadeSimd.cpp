@@ -0,0 +1,123 @@
+#include "HillshadeSimd.h"
+#include "noise/PerlinNoiseSimd.h"
+#include <cstring>
+
+#ifdef TG_NOISE_X86
+
+#include <immintrin.h>
+
+// Same operations in the same order as the scalar loop in
+// HillshadeRenderer::relight (no FMA), so the pixels match it byte for byte.
+
+namespace {
+
+const float OCCLUSION_UNIT = 1.0f / 255.0f;
+
+// Lit 0RGB dwords for 4 packed normals and albedos
+TG_TARGET_SSE41 inline __m128i light4(__m128i normal, __m128i albedo, const HillshadeSimd::Light& light) {
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    __m128 nx = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(normal, 24), 24));
+    __m128 ny = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(normal, 16), 24));
+    __m128 nz = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(normal, 16), byteMask));
+    __m128 occlusion = _mm_cvtepi32_ps(_mm_srli_epi32(normal, 24));
+
+    __m128 d = _mm_add_ps(_mm_mul_ps(nx, _mm_set1_ps(light.x)), _mm_mul_ps(ny, _mm_set1_ps(light.y)));
+    d = _mm_add_ps(d, _mm_mul_ps(nz, _mm_set1_ps(light.z)));
+    d = _mm_max_ps(d, _mm_setzero_ps());
+    __m128 lit = _mm_add_ps(_mm_set1_ps(light.ambient), _mm_mul_ps(_mm_set1_ps(light.diffuse), d));
+    lit = _mm_mul_ps(lit, _mm_mul_ps(occlusion, _mm_set1_ps(OCCLUSION_UNIT)));
+
+    const __m128 maxByte = _mm_set1_ps(255.0f);
+    __m128 r = _mm_cvtepi32_ps(_mm_and_si128(albedo, byteMask));
+    __m128 g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(albedo, 8), byteMask));
+    __m128 b = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(albedo, 16), byteMask));
+    __m128i ri = _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(r, lit), maxByte));
+    __m128i gi = _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(g, lit), maxByte));
+    __m128i bi = _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(b, lit), maxByte));
+    return _mm_or_si128(ri, _mm_or_si128(_mm_slli_epi32(gi, 8), _mm_slli_epi32(bi, 16)));
+}
+
+TG_TARGET_AVX2 inline __m256i light8(__m256i normal, __m256i albedo, const HillshadeSimd::Light& light) {
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+    __m256 nx = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(normal, 24), 24));
+    __m256 ny = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(normal, 16), 24));
+    __m256 nz = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(normal, 16), byteMask));
+    __m256 occlusion = _mm256_cvtepi32_ps(_mm256_srli_epi32(normal, 24));
+
+    __m256 d = _mm256_add_ps(_mm256_mul_ps(nx, _mm256_set1_ps(light.x)), _mm256_mul_ps(ny, _mm256_set1_ps(light.y)));
+    d = _mm256_add_ps(d, _mm256_mul_ps(nz, _mm256_set1_ps(light.z)));
+    d = _mm256_max_ps(d, _mm256_setzero_ps());
+    __m256 lit = _mm256_add_ps(_mm256_set1_ps(light.ambient), _mm256_mul_ps(_mm256_set1_ps(light.diffuse), d));
+    lit = _mm256_mul_ps(lit, _mm256_mul_ps(occlusion, _mm256_set1_ps(OCCLUSION_UNIT)));
+
+    const __m256 maxByte = _mm256_set1_ps(255.0f);
+    __m256 r = _mm256_cvtepi32_ps(_mm256_and_si256(albedo, byteMask));
+    __m256 g = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(albedo, 8), byteMask));
+    __m256 b = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(albedo, 16), byteMask));
+    __m256i ri = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_mul_ps(r, lit), maxByte));
+    __m256i gi = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_mul_ps(g, lit), maxByte));
+    __m256i bi = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_mul_ps(b, lit), maxByte));
+    return _mm256_or_si256(ri, _mm256_or_si256(_mm256_slli_epi32(gi, 8), _mm256_slli_epi32(bi, 16)));
+}
+
+// 0RGB dwords -> 12 packed RGB bytes at the bottom of the register
+TG_TARGET_SSE41 inline __m128i packRgb(__m128i rgb) {
+    const __m128i order = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    return _mm_shuffle_epi8(rgb, order);
+}
+
+TG_TARGET_SSE41 inline void store12(unsigned char* out, __m128i packed) {
+    _mm_storel_epi64((__m128i*)out, packed);
+    int last = _mm_extract_epi32(packed, 2);
+    std::memcpy(out + 8, &last, 4);
+}
+
+} // namespace
+
+namespace HillshadeSimd {
+
+TG_TARGET_SSE41 size_t relightSse41(const uint32_t* normals, const uint32_t* albedo, const Light& light,
+    unsigned char* out, size_t count) {
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i normal = _mm_loadu_si128((const __m128i*)(normals + i));
+        __m128i colour = _mm_loadu_si128((const __m128i*)(albedo + i));
+        store12(out + i * 3, packRgb(light4(normal, colour, light)));
+    }
+    return i;
+}
+
+TG_TARGET_AVX2 size_t relightAvx2(const uint32_t* normals, const uint32_t* albedo, const Light& light,
+    unsigned char* out, size_t count) {
+    const __m256i order = _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i normal = _mm256_loadu_si256((const __m256i*)(normals + i));
+        __m256i colour = _mm256_loadu_si256((const __m256i*)(albedo + i));
+        __m256i packed = _mm256_shuffle_epi8(light8(normal, colour, light), order);
+
+        // Two runs of 12 bytes, one per 128-bit lane; the low lane's 4 spare
+        // bytes are overwritten by the high lane's store
+        unsigned char* dst = out + i * 3;
+        _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(packed));
+        __m128i high = _mm256_extracti128_si256(packed, 1);
+        _mm_storel_epi64((__m128i*)(dst + 12), high);
+        int last = _mm_extract_epi32(high, 2);
+        std::memcpy(dst + 20, &last, 4);
+    }
+    return i;
+}
+
+} // namespace HillshadeSimd
+
+#else
+
+namespace HillshadeSimd {
+    size_t relightSse41(const uint32_t*, const uint32_t*, const Light&, unsigned char*, size_t) { return 0; }
+    size_t relightAvx2(const uint32_t*, const uint32_t*, const Light&, unsigned char*, size_t) { return 0; }
+}
+
+#endif
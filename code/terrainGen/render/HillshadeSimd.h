@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// SIMD kernels behind HillshadeRenderer::relight.
+// Each kernel processes whole vectors only and returns how many tiles it
+// wrote; the caller finishes the tail with the scalar path.
+
+namespace HillshadeSimd {
+    // Sun direction prescaled by 1 / 127 (the normal scale) and the light
+    // terms, as HillshadeRenderer::relight sets them up
+    struct Light {
+        float x, y, z;
+        float ambient;
+        float diffuse;
+    };
+
+    // normals[i] = nx | ny << 8 | nz << 16 | occlusion << 24 (signed bytes),
+    // albedo[i] = r | g << 8 | b << 16.
+    // out[3i..3i+2] = min(albedo * light, 255), truncated, where
+    // light = (ambient + diffuse * max(n.L, 0)) * occlusion / 255.
+    size_t relightSse41(const uint32_t* normals, const uint32_t* albedo, const Light& light,
+        unsigned char* out, size_t count);
+
+    size_t relightAvx2(const uint32_t* normals, const uint32_t* albedo, const Light& light,
+        unsigned char* out, size_t count);
+}
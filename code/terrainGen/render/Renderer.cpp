@@ -0,0 +1,134 @@
+#include "Renderer.h"
+#include "RendererSimd.h"
+#include "util/Profiler.h"
+#include "world/CompactWorld.h"
+#include <algorithm>
+
+// ---------------- BIOME COLORS ----------------
+
+namespace {
+
+const unsigned char BIOME_COLORS[][3] = {
+    { 25,  60,  140 },  // Ocean: deeper blue
+    { 220, 205, 150 },  // Beach: sandy
+    { 100, 165, 80  },  // Plains: grassland green
+    { 30,  105, 50  },  // Forest: deep forest green
+    { 210, 180, 100 },  // Desert: sandy brown
+    { 210, 225, 230 },  // Tundra: icy white-blue
+    { 110, 100, 90  },  // Mountain: rocky gray-brown
+    { 70,  90,  60  },  // Swamp: murky olive
+};
+const int BIOME_COLOR_COUNT = sizeof(BIOME_COLORS) / sizeof(BIOME_COLORS[0]);
+
+// r | g << 8 | b << 16 for every byte value, so kernels can index it with
+// any Biome byte; values past the last biome are black
+struct Palette {
+    uint32_t rgb[256] = {};
+
+    Palette() {
+        for (int i = 0; i < BIOME_COLOR_COUNT; ++i) {
+            rgb[i] = BIOME_COLORS[i][0] | BIOME_COLORS[i][1] << 8 | BIOME_COLORS[i][2] << 16;
+        }
+    }
+};
+
+const Palette& palette() {
+    static const Palette table;
+    return table;
+}
+
+// The same colours indexed by a CompactWorld flags byte, which carries the
+// lake and road bits above the biome
+struct FlagsPalette {
+    uint32_t rgb[256] = {};
+
+    FlagsPalette() {
+        for (int i = 0; i < 256; ++i) rgb[i] = palette().rgb[i & CompactWorld::BIOME_MASK];
+    }
+};
+
+const FlagsPalette& flagsPalette() {
+    static const FlagsPalette table;
+    return table;
+}
+
+} // namespace
+
+void biomeToColor(Biome biome, unsigned char& r, unsigned char& g, unsigned char& b) {
+    uint32_t rgb = palette().rgb[(uint8_t)biome];
+    r = (unsigned char)(rgb & 0xFF);
+    g = (unsigned char)(rgb >> 8 & 0xFF);
+    b = (unsigned char)(rgb >> 16 & 0xFF);
+}
+
+// ----------- BUILD PIXEL BUFFER -----------
+
+void buildPixelBuffer(const World& world, std::vector<unsigned char>& pixels) {
+    buildPixelBuffer(world, pixels, PerlinNoise::bestSimdLevel());
+}
+
+void buildPixelBuffer(const World& world, std::vector<unsigned char>& pixels, SimdLevel level) {
+    const size_t count = (size_t)world.getWidth() * world.getHeight();
+    TG_PROFILE_SCOPE("pixel_build", (double)count);
+    pixels.resize(count * 3);
+    level = std::min(level, PerlinNoise::bestSimdLevel());
+
+    const Biome* biomes = world.biomePlane().data();
+    const float* heights = world.heightPlane().data();
+    const uint32_t* colors = palette().rgb;
+
+    size_t done = 0;
+    if (level == SimdLevel::AVX2) {
+        done = RenderSimd::shadeAvx2(colors, biomes, heights, pixels.data(), count);
+    }
+    else if (level == SimdLevel::SSE41) {
+        done = RenderSimd::shadeSse41(colors, biomes, heights, pixels.data(), count);
+    }
+
+    for (size_t tile = done; tile < count; ++tile) {
+        unsigned char r, g, b;
+        biomeToColor(biomes[tile], r, g, b);
+
+        // Add subtle height-based shading for more depth
+        float heightShade = heights[tile];
+        float shadeFactor = 0.7f + 0.3f * heightShade;
+
+        size_t index = tile * 3;
+        pixels[index + 0] = (unsigned char)(r * shadeFactor);
+        pixels[index + 1] = (unsigned char)(g * shadeFactor);
+        pixels[index + 2] = (unsigned char)(b * shadeFactor);
+    }
+}
+
+void buildPixelBuffer(const CompactWorld& world, std::vector<unsigned char>& pixels) {
+    buildPixelBuffer(world, pixels, PerlinNoise::bestSimdLevel());
+}
+
+void buildPixelBuffer(const CompactWorld& world, std::vector<unsigned char>& pixels, SimdLevel level) {
+    const size_t count = (size_t)world.getWidth() * world.getHeight();
+    TG_PROFILE_SCOPE("pixel_build", (double)count);
+    pixels.resize(count * 3);
+    level = std::min(level, PerlinNoise::bestSimdLevel());
+
+    const uint8_t* flags = world.flagsPlane().data();
+    const uint16_t* heights = world.heightPlane().data();
+    const uint32_t* colors = flagsPalette().rgb;
+
+    size_t done = 0;
+    if (level == SimdLevel::AVX2) {
+        done = RenderSimd::shadeQuantizedAvx2(colors, flags, heights, pixels.data(), count);
+    }
+    else if (level == SimdLevel::SSE41) {
+        done = RenderSimd::shadeQuantizedSse41(colors, flags, heights, pixels.data(), count);
+    }
+
+    for (size_t tile = done; tile < count; ++tile) {
+        const uint32_t rgb = colors[flags[tile]];
+        const float shadeFactor = 0.7f + 0.3f * compact::UnitRef<uint16_t>::decode(heights[tile]);
+
+        size_t index = tile * 3;
+        pixels[index + 0] = (unsigned char)((rgb & 0xFF) * shadeFactor);
+        pixels[index + 1] = (unsigned char)((rgb >> 8 & 0xFF) * shadeFactor);
+        pixels[index + 2] = (unsigned char)((rgb >> 16 & 0xFF) * shadeFactor);
+    }
+}
@@ -1 +1,26 @@
 #pragma once
+
+#include "noise/PerlinNoise.h"
+#include "world/World.h"
+#include <vector>
+
+class CompactWorld;
+
+// CPU-side map colouring, shared by the viewer and the headless tools.
+// Nothing here touches OpenGL.
+
+// Base colour of a biome
+void biomeToColor(Biome biome, unsigned char& r, unsigned char& g, unsigned char& b);
+
+// Biome colours with height shading, RGB8, row-major from tile (0, 0)
+void buildPixelBuffer(const World& world, std::vector<unsigned char>& pixels);
+
+// Same on an explicit SIMD path (clamped to what the CPU supports); every
+// path produces the same bytes
+void buildPixelBuffer(const World& world, std::vector<unsigned char>& pixels, SimdLevel level);
+
+// Same colouring straight from quantized storage, without unpacking; reads
+// 3 bytes per tile instead of 5. Heights are quantized, so a pixel may be
+// one step darker than from the World the storage was packed from.
+void buildPixelBuffer(const CompactWorld& world, std::vector<unsigned char>& pixels);
+void buildPixelBuffer(const CompactWorld& world, std::vector<unsigned char>& pixels, SimdLevel level);
@@ -0,0 +1,144 @@
+#include "RendererSimd.h"
+#include "noise/PerlinNoiseSimd.h"
+#include <cstring>
+
+#ifdef TG_NOISE_X86
+
+#include <immintrin.h>
+
+// Same operations as the scalar loop in buildPixelBuffer (no FMA), so the
+// pixels match it byte for byte.
+
+namespace {
+
+TG_TARGET_SSE41 inline __m128i shade4(__m128i rgb, __m128 factor) {
+    const __m128i byteMask = _mm_set1_epi32(0xFF);
+    __m128 r = _mm_cvtepi32_ps(_mm_and_si128(rgb, byteMask));
+    __m128 g = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(rgb, 8), byteMask));
+    __m128 b = _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(rgb, 16), byteMask));
+    __m128i ri = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(r, factor)), byteMask);
+    __m128i gi = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(g, factor)), byteMask);
+    __m128i bi = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(b, factor)), byteMask);
+    return _mm_or_si128(ri, _mm_or_si128(_mm_slli_epi32(gi, 8), _mm_slli_epi32(bi, 16)));
+}
+
+// 0RGB dwords -> 12 packed RGB bytes at the bottom of the register
+TG_TARGET_SSE41 inline __m128i packRgb(__m128i rgb) {
+    const __m128i order = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    return _mm_shuffle_epi8(rgb, order);
+}
+
+TG_TARGET_SSE41 inline void store12(unsigned char* out, __m128i packed) {
+    _mm_storel_epi64((__m128i*)out, packed);
+    int last = _mm_extract_epi32(packed, 2);
+    std::memcpy(out + 8, &last, 4);
+}
+
+TG_TARGET_AVX2 inline void shade8(__m256i rgb, __m256 factor, unsigned char* dst) {
+    const __m256i byteMask = _mm256_set1_epi32(0xFF);
+    const __m256i order = _mm256_setr_epi8(
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+        0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+    __m256 r = _mm256_cvtepi32_ps(_mm256_and_si256(rgb, byteMask));
+    __m256 g = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(rgb, 8), byteMask));
+    __m256 b = _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(rgb, 16), byteMask));
+    __m256i ri = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_mul_ps(r, factor)), byteMask);
+    __m256i gi = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_mul_ps(g, factor)), byteMask);
+    __m256i bi = _mm256_and_si256(_mm256_cvttps_epi32(_mm256_mul_ps(b, factor)), byteMask);
+    __m256i shaded = _mm256_or_si256(ri, _mm256_or_si256(_mm256_slli_epi32(gi, 8), _mm256_slli_epi32(bi, 16)));
+    __m256i packed = _mm256_shuffle_epi8(shaded, order);
+
+    // Two runs of 12 bytes, one per 128-bit lane; the low lane's 4 spare
+    // bytes are overwritten by the high lane's store
+    _mm_storeu_si128((__m128i*)dst, _mm256_castsi256_si128(packed));
+    __m128i high = _mm256_extracti128_si256(packed, 1);
+    _mm_storel_epi64((__m128i*)(dst + 12), high);
+    int last = _mm_extract_epi32(high, 2);
+    std::memcpy(dst + 20, &last, 4);
+}
+
+} // namespace
+
+namespace RenderSimd {
+
+TG_TARGET_SSE41 size_t shadeSse41(const uint32_t* palette, const Biome* biomes, const float* heights,
+    unsigned char* out, size_t count) {
+    const __m128 base = _mm_set1_ps(0.7f);
+    const __m128 scale = _mm_set1_ps(0.3f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i rgb = _mm_setr_epi32(
+            (int)palette[(uint8_t)biomes[i + 0]], (int)palette[(uint8_t)biomes[i + 1]],
+            (int)palette[(uint8_t)biomes[i + 2]], (int)palette[(uint8_t)biomes[i + 3]]);
+        __m128 factor = _mm_add_ps(base, _mm_mul_ps(scale, _mm_loadu_ps(heights + i)));
+        store12(out + i * 3, packRgb(shade4(rgb, factor)));
+    }
+    return i;
+}
+
+TG_TARGET_AVX2 size_t shadeAvx2(const uint32_t* palette, const Biome* biomes, const float* heights,
+    unsigned char* out, size_t count) {
+    const __m256 base = _mm256_set1_ps(0.7f);
+    const __m256 scale = _mm256_set1_ps(0.3f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(biomes + i)));
+        __m256i rgb = _mm256_i32gather_epi32((const int*)palette, index, 4);
+        __m256 factor = _mm256_add_ps(base, _mm256_mul_ps(scale, _mm256_loadu_ps(heights + i)));
+        shade8(rgb, factor, out + i * 3);
+    }
+    return i;
+}
+
+TG_TARGET_SSE41 size_t shadeQuantizedSse41(const uint32_t* palette, const uint8_t* flags, const uint16_t* heights,
+    unsigned char* out, size_t count) {
+    const __m128 base = _mm_set1_ps(0.7f);
+    const __m128 scale = _mm_set1_ps(0.3f);
+    const __m128 unit = _mm_set1_ps(1.0f / 65535.0f);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i rgb = _mm_setr_epi32(
+            (int)palette[flags[i + 0]], (int)palette[flags[i + 1]],
+            (int)palette[flags[i + 2]], (int)palette[flags[i + 3]]);
+        __m128i h = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i*)(heights + i)));
+        __m128 height = _mm_mul_ps(_mm_cvtepi32_ps(h), unit);
+        __m128 factor = _mm_add_ps(base, _mm_mul_ps(scale, height));
+        store12(out + i * 3, packRgb(shade4(rgb, factor)));
+    }
+    return i;
+}
+
+TG_TARGET_AVX2 size_t shadeQuantizedAvx2(const uint32_t* palette, const uint8_t* flags, const uint16_t* heights,
+    unsigned char* out, size_t count) {
+    const __m256 base = _mm256_set1_ps(0.7f);
+    const __m256 scale = _mm256_set1_ps(0.3f);
+    const __m256 unit = _mm256_set1_ps(1.0f / 65535.0f);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(flags + i)));
+        __m256i rgb = _mm256_i32gather_epi32((const int*)palette, index, 4);
+        __m256i h = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)(heights + i)));
+        __m256 height = _mm256_mul_ps(_mm256_cvtepi32_ps(h), unit);
+        __m256 factor = _mm256_add_ps(base, _mm256_mul_ps(scale, height));
+        shade8(rgb, factor, out + i * 3);
+    }
+    return i;
+}
+
+} // namespace RenderSimd
+
+#else
+
+namespace RenderSimd {
+    size_t shadeSse41(const uint32_t*, const Biome*, const float*, unsigned char*, size_t) { return 0; }
+    size_t shadeAvx2(const uint32_t*, const Biome*, const float*, unsigned char*, size_t) { return 0; }
+    size_t shadeQuantizedSse41(const uint32_t*, const uint8_t*, const uint16_t*, unsigned char*, size_t) { return 0; }
+    size_t shadeQuantizedAvx2(const uint32_t*, const uint8_t*, const uint16_t*, unsigned char*, size_t) { return 0; }
+}
+
+#endif
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "world/Tile.h"
+#include <cstddef>
+#include <cstdint>
+
+// SIMD kernels behind buildPixelBuffer.
+// Each kernel processes whole vectors only and returns how many tiles it
+// wrote; the caller finishes the tail with the scalar path.
+
+namespace RenderSimd {
+    // palette[biome] = r | g << 8 | b << 16 for every byte value of Biome.
+    // out[3i..3i+2] = colour * (0.7 + 0.3 * heights[i]), truncated.
+    size_t shadeSse41(const uint32_t* palette, const Biome* biomes, const float* heights,
+        unsigned char* out, size_t count);
+
+    size_t shadeAvx2(const uint32_t* palette, const Biome* biomes, const float* heights,
+        unsigned char* out, size_t count);
+
+    // Same from quantized storage: palette[flags[i]], heights[i] / 65535
+    size_t shadeQuantizedSse41(const uint32_t* palette, const uint8_t* flags, const uint16_t* heights,
+        unsigned char* out, size_t count);
+
+    size_t shadeQuantizedAvx2(const uint32_t* palette, const uint8_t* flags, const uint16_t* heights,
+        unsigned char* out, size_t count);
+}
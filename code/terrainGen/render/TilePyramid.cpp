@@ -0,0 +1,244 @@
+#include "TilePyramid.h"
+
+#include "Renderer.h"
+#include "util/ImageWriter.h"
+#include "util/Profiler.h"
+#include "world/WorldPyramid.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+
+TilePyramidExporter::TilePyramidExporter(int threadCount)
+    : m_pool(new ThreadPool(threadCount))
+{
+}
+
+void TilePyramidExporter::setThreadCount(int threadCount) {
+    if (threadCount <= 0) threadCount = ThreadPool::hardwareThreads();
+    if (threadCount == m_pool->getThreadCount()) return;
+    m_pool.reset(new ThreadPool(threadCount));
+}
+
+void TilePyramidExporter::setTileSize(int tileSize) {
+    int size = 2;
+    while (size < tileSize) size *= 2;
+    m_tileSize = size;
+}
+
+int TilePyramidExporter::getTileSize() const {
+    return m_tileSize;
+}
+
+const TilePyramidStats& TilePyramidExporter::getStats() const {
+    return m_stats;
+}
+
+int TilePyramidExporter::levelsFor(int width, int height, int tileSize) {
+    const int64_t size = std::max(width, height);
+    int levels = 1;
+    while ((int64_t)tileSize << (levels - 1) < size) ++levels;
+    return levels;
+}
+
+bool TilePyramidExporter::write(const std::string& directory, int width, int height, const ChunkGenerator& source) {
+    std::atomic<uint64_t> fileBytes{ 0 };
+    std::atomic<int64_t> encodeNs{ 0 };
+    const TileSink files = [&](int z, int x, int y, const uint8_t* rgb) {
+        const std::filesystem::path column = std::filesystem::path(directory) / std::to_string(z) / std::to_string(x);
+        std::error_code error;
+        std::filesystem::create_directories(column, error);
+        if (error) return false;
+
+        const std::string path = (column / (std::to_string(y) + ".png")).string();
+        const auto start = std::chrono::steady_clock::now();
+        if (!writePng(path, m_tileSize, m_tileSize, 3, rgb)) return false;
+        encodeNs += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+        fileBytes += std::filesystem::file_size(path, error);
+        return true;
+    };
+
+    const bool ok = write(width, height, source, files);
+    m_stats.fileBytes = fileBytes;
+    m_stats.encodeSeconds = encodeNs * 1e-9;
+    return ok;
+}
+
+bool TilePyramidExporter::write(int width, int height, const ChunkGenerator& source, const TileSink& sink) {
+    m_stats = TilePyramidStats();
+    if (width <= 0 || height <= 0) return false;
+    TG_PROFILE_SCOPE("tile_pyramid", (double)width * height);
+    const auto start = std::chrono::steady_clock::now();
+
+    m_width = width;
+    m_height = height;
+    m_maxZoom = levelsFor(width, height, m_tileSize) - 1;
+    m_blockZoom = std::max(0, m_maxZoom - BLOCK_LEVELS);
+    m_source = &source;
+    m_sink = &sink;
+    m_failed = false;
+    m_tilesWritten = 0;
+
+    // Level k of a block holds 4^k tiles
+    const size_t tileBytes = (size_t)m_tileSize * m_tileSize * 3;
+    m_blockLevels.resize(m_maxZoom - m_blockZoom + 1);
+    for (size_t k = 0; k < m_blockLevels.size(); ++k) {
+        m_blockLevels[k].assign(tileBytes << (2 * k), 0);
+        m_stats.bufferBytes += m_blockLevels[k].size();
+    }
+    m_upper.assign(m_blockZoom, std::vector<uint8_t>(tileBytes));
+    m_stats.bufferBytes += m_upper.size() * tileBytes;
+
+    renderTile(0, 0, 0);
+
+    m_stats.levels = m_maxZoom + 1;
+    m_stats.tiles = m_tilesWritten;
+    m_stats.pixelBytes = m_stats.tiles * tileBytes;
+    m_stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    m_stats.peakResidentBytes = Profiler::getPeakResidentBytes();
+
+    m_blockLevels = {};
+    m_upper = {};
+    m_source = nullptr;
+    m_sink = nullptr;
+    return !m_failed;
+}
+
+bool TilePyramidExporter::hasTile(int z, int x, int y) const {
+    const int level = m_maxZoom - z;
+    return (int64_t)x * m_tileSize < WorldPyramid::levelExtent(m_width, level) &&
+        (int64_t)y * m_tileSize < WorldPyramid::levelExtent(m_height, level);
+}
+
+void TilePyramidExporter::emit(int z, int x, int y, const uint8_t* rgb) {
+    if (m_failed) return;
+    if ((*m_sink)(z, x, y, rgb)) ++m_tilesWritten;
+    else m_failed = true;
+}
+
+const uint8_t* TilePyramidExporter::renderTile(int z, int x, int y) {
+    if (z == m_blockZoom) return renderBlock(z, x, y);
+
+    // Children one after another, each folded in as soon as it is done
+    uint8_t* out = m_upper[z].data();
+    std::fill(m_upper[z].begin(), m_upper[z].end(), 0);
+    for (int c = 0; c < 4 && !m_failed; ++c) {
+        const int childX = x * 2 + (c & 1);
+        const int childY = y * 2 + (c >> 1);
+        if (!hasTile(z + 1, childX, childY)) continue;
+        downsample(z, childX, childY, renderTile(z + 1, childX, childY), out);
+    }
+    emit(z, x, y, out);
+    return out;
+}
+
+const uint8_t* TilePyramidExporter::renderBlock(int z, int x, int y) {
+    const size_t tileBytes = (size_t)m_tileSize * m_tileSize * 3;
+    const int depth = m_maxZoom - z;
+
+    // Base tiles straight from the source
+    {
+        const int n = 1 << depth;
+        uint8_t* level = m_blockLevels[depth].data();
+        m_pool->parallelFor(n * n, [&](int i) {
+            const int tileX = x * n + i % n;
+            const int tileY = y * n + i / n;
+            if (m_failed || !hasTile(m_maxZoom, tileX, tileY)) return;
+
+            World chunk(m_tileSize, m_tileSize);
+            std::vector<unsigned char> rgb;
+            uint8_t* out = level + i * tileBytes;
+            renderBase(tileX, tileY, chunk, rgb, out);
+            emit(m_maxZoom, tileX, tileY, out);
+        });
+    }
+
+    // Then the block's coarser levels, each tile from its four children
+    for (int k = depth - 1; k >= 0; --k) {
+        const int n = 1 << k;
+        const uint8_t* fine = m_blockLevels[k + 1].data();
+        uint8_t* coarse = m_blockLevels[k].data();
+        m_pool->parallelFor(n * n, [&](int i) {
+            const int ix = i % n;
+            const int iy = i / n;
+            const int tileX = x * n + ix;
+            const int tileY = y * n + iy;
+            if (m_failed || !hasTile(z + k, tileX, tileY)) return;
+
+            uint8_t* out = coarse + i * tileBytes;
+            std::fill(out, out + tileBytes, 0);
+            for (int c = 0; c < 4; ++c) {
+                const int childX = tileX * 2 + (c & 1);
+                const int childY = tileY * 2 + (c >> 1);
+                if (!hasTile(z + k + 1, childX, childY)) continue;
+                const int child = (iy * 2 + (c >> 1)) * (n * 2) + ix * 2 + (c & 1);
+                downsample(z + k, childX, childY, fine + child * tileBytes, out);
+            }
+            emit(z + k, tileX, tileY, out);
+        });
+    }
+    return m_blockLevels[0].data();
+}
+
+void TilePyramidExporter::renderBase(int x, int y, World& chunk, std::vector<unsigned char>& rgb, uint8_t* out) const {
+    const int size = m_tileSize;
+    (*m_source)(chunk, x * size, y * size);
+    buildPixelBuffer(chunk, rgb);
+
+    const size_t rowBytes = (size_t)size * 3;
+    const int w = std::min(size, m_width - x * size);
+    const int h = std::min(size, m_height - y * size);
+    for (int row = 0; row < size; ++row) {
+        uint8_t* dst = out + row * rowBytes;
+        const size_t inside = row < h ? (size_t)w * 3 : 0;
+        std::memcpy(dst, rgb.data() + row * rowBytes, inside);
+        std::memset(dst + inside, 0, rowBytes - inside);
+    }
+}
+
+void TilePyramidExporter::downsample(int z, int childX, int childY, const uint8_t* child, uint8_t* out) const {
+    const int size = m_tileSize;
+    const int half = size / 2;
+    const size_t rowBytes = (size_t)size * 3;
+
+    // Child pixels inside the map
+    const int level = m_maxZoom - (z + 1);
+    const int validW = (int)std::clamp<int64_t>(WorldPyramid::levelExtent(m_width, level) - (int64_t)childX * size, 0, size);
+    const int validH = (int)std::clamp<int64_t>(WorldPyramid::levelExtent(m_height, level) - (int64_t)childY * size, 0, size);
+
+    uint8_t* quadrant = out + (size_t)(childY & 1) * half * rowBytes + (size_t)(childX & 1) * half * 3;
+    for (int oy = 0; oy < half; ++oy) {
+        const uint8_t* r0 = child + (size_t)(oy * 2) * rowBytes;
+        const uint8_t* r1 = r0 + rowBytes;
+        uint8_t* dst = quadrant + oy * rowBytes;
+
+        if (validW == size && oy * 2 + 1 < validH) {
+            // Interior: plain 2x2 box filter
+            for (int ox = 0; ox < half; ++ox) {
+                for (int c = 0; c < 3; ++c) {
+                    const int a = ox * 6 + c;
+                    dst[ox * 3 + c] = (uint8_t)((r0[a] + r0[a + 3] + r1[a] + r1[a + 3] + 2) >> 2);
+                }
+            }
+            continue;
+        }
+
+        // Map edge: average only the children inside it
+        for (int ox = 0; ox < half; ++ox) {
+            int sum[3] = { 0, 0, 0 };
+            int count = 0;
+            for (int dy = 0; dy < 2; ++dy) {
+                for (int dx = 0; dx < 2; ++dx) {
+                    const int px = ox * 2 + dx;
+                    const int py = oy * 2 + dy;
+                    if (px >= validW || py >= validH) continue;
+                    const uint8_t* p = child + py * rowBytes + px * 3;
+                    for (int c = 0; c < 3; ++c) sum[c] += p[c];
+                    ++count;
+                }
+            }
+            for (int c = 0; c < 3; ++c) dst[ox * 3 + c] = count ? (uint8_t)((sum[c] + count / 2) / count) : 0;
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "util/ThreadPool.h"
+#include "world/ChunkedWorld.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Slippy-map tile pyramid (z/x/y.png) of the biome colouring, streamed from
+// a chunk source so no level is ever held whole.
+//
+// The deepest zoom maps one world tile to one pixel; every level up halves
+// the resolution, down to zoom 0, a single tile covering the whole map.
+// Tiles are tileSize x tileSize RGB8 anchored at the top-left corner; pixels
+// past the map edge are black, and tiles wholly past it are not written.
+//
+// The map is walked as a quadtree. Below a fixed block level, 2^BLOCK_LEVELS
+// x 2^BLOCK_LEVELS base tiles are generated, coloured and encoded in
+// parallel, then reduced level by level, again in parallel; above it each
+// tile is the 2x2 average of its children, built as they finish. Memory
+// therefore depends on the tile size and the pyramid depth only, never on
+// the map size: about 17 MB of pixels plus one chunk per thread at 256 px.
+
+struct TilePyramidStats {
+    int levels = 0;              // zoom levels 0 .. levels - 1
+    uint64_t tiles = 0;          // tiles written
+    uint64_t pixelBytes = 0;     // RGB bytes encoded
+    uint64_t fileBytes = 0;      // PNG bytes on disk (write to a directory only)
+    double seconds = 0.0;
+    double encodeSeconds = 0.0;  // PNG filtering and deflate, summed over threads (directory only)
+    size_t bufferBytes = 0;      // pixel buffers held by the exporter
+    size_t peakResidentBytes = 0; // of the whole process, 0 where unsupported
+
+    // Exported pixel data per second, generation and colouring included
+    double megabytesPerSecond() const { return seconds > 0.0 ? pixelBytes / 1e6 / seconds : 0.0; }
+
+    // Pixel data PNG-encoded per second by one thread
+    double encodeMegabytesPerSecond() const { return encodeSeconds > 0.0 ? pixelBytes / 1e6 / encodeSeconds : 0.0; }
+
+    // PNG bytes per pixel byte
+    double compressionRatio() const { return pixelBytes > 0 ? (double)fileBytes / pixelBytes : 0.0; }
+};
+
+// Receives one finished tile (tileSize x tileSize RGB8). Called from
+// several threads at once; false aborts the export.
+using TileSink = std::function<bool(int z, int x, int y, const uint8_t* rgb)>;
+
+class TilePyramidExporter {
+public:
+    static const int BLOCK_LEVELS = 3;
+
+    // 0 = all hardware threads
+    explicit TilePyramidExporter(int threadCount = 0);
+
+    void setThreadCount(int threadCount);
+
+    // Power of two, at least 2 (default 256)
+    void setTileSize(int tileSize);
+    int getTileSize() const;
+
+    // Zoom levels of a width x height map
+    static int levelsFor(int width, int height, int tileSize);
+
+    // Writes directory/z/x/y.png for a width x height map. source fills a
+    // chunk for a world origin (TerrainGenerator::chunkGenerator,
+    // WorldArchive::chunkSource, ...) and is called from several threads.
+    bool write(const std::string& directory, int width, int height, const ChunkGenerator& source);
+
+    // Same, handing every tile to sink instead of a file
+    bool write(int width, int height, const ChunkGenerator& source, const TileSink& sink);
+
+    const TilePyramidStats& getStats() const;
+
+private:
+    int m_tileSize = 256;
+    std::unique_ptr<ThreadPool> m_pool;
+    TilePyramidStats m_stats;
+
+    // Per export
+    int m_width = 0;
+    int m_height = 0;
+    int m_maxZoom = 0;
+    int m_blockZoom = 0;
+    const ChunkGenerator* m_source = nullptr;
+    const TileSink* m_sink = nullptr;
+    std::atomic<bool> m_failed{ false };
+    std::atomic<uint64_t> m_tilesWritten{ 0 };
+
+    // Tiles of the current block, one buffer per level (finest last), and
+    // one tile per zoom above the block level
+    std::vector<std::vector<uint8_t>> m_blockLevels;
+    std::vector<std::vector<uint8_t>> m_upper;
+
+    bool hasTile(int z, int x, int y) const;
+    void emit(int z, int x, int y, const uint8_t* rgb);
+
+    // Renders tile (z, x, y) and everything below it; returns its pixels
+    const uint8_t* renderTile(int z, int x, int y);
+    const uint8_t* renderBlock(int z, int x, int y);
+
+    // Base tile from the source, coloured, past-the-edge pixels black
+    void renderBase(int x, int y, World& chunk, std::vector<unsigned char>& rgb, uint8_t* out) const;
+
+    // Averages child tile (z + 1, childX, childY) into its quadrant of out
+    void downsample(int z, int childX, int childY, const uint8_t* child, uint8_t* out) const;
+};
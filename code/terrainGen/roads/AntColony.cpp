@@ -0,0 +1,582 @@
+#include "AntColony.h"
+#include "AntColonySimd.h"
+#include "noise/PerlinNoise.h"
+#include "util/Profiler.h"
+#include "util/Random.h"
+#include "world/Stencil.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+const float SQRT2 = 1.41421356f;
+
+// Base cost of crossing one tile of each biome; 0 = impassable
+float biomeCost(Biome biome) {
+    switch (biome) {
+    case Biome::Ocean:    return 0.0f;
+    case Biome::Beach:    return 1.5f;
+    case Biome::Plains:   return 1.0f;
+    case Biome::Forest:   return 2.0f;
+    case Biome::Desert:   return 1.5f;
+    case Biome::Tundra:   return 2.5f;
+    case Biome::Mountain: return 5.0f;
+    case Biome::Swamp:    return 4.0f;
+    }
+    return 0.0f;
+}
+
+// Steps of a shortest 8-connected path on an empty grid
+int octileSteps(int from, int to, int width) {
+    return std::max(std::abs(from % width - to % width), std::abs(from / width - to / width));
+}
+
+// Slot of a tile in a visited table of mask + 1 entries
+size_t visitSlot(int cell, size_t mask) {
+    return ((uint32_t)cell * 0x9E3779B1u) & mask;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+AntColony::AntColony(World& world, unsigned int seed)
+    : m_world(world),
+    m_seed(seed),
+    m_pool(new ThreadPool())
+{
+}
+
+void AntColony::setThreadCount(int threadCount) {
+    if (threadCount <= 0) threadCount = ThreadPool::hardwareThreads();
+    if (threadCount == m_pool->getThreadCount()) return;
+    m_pool.reset(new ThreadPool(threadCount));
+}
+
+void AntColony::setSeed(unsigned int seed) {
+    m_seed = seed;
+}
+
+// ---------------- TERRAIN COST ----------------
+
+void AntColony::computeCosts(const AntColonySettings& settings) {
+    const int width = m_world.getWidth();
+    const int height = m_world.getHeight();
+    const size_t tiles = (size_t)width * height;
+    m_cost.resize(tiles);
+    m_desirability.resize(tiles);
+
+    // Whole powers are the common case and much cheaper than pow
+    const int wholePower = (int)settings.costWeight;
+    const bool whole = wholePower == settings.costWeight && wholePower >= 0 && wholePower <= 8;
+
+    forEachStencil(width, height, m_pool.get(), [&](const auto& cell) {
+        const float cost = tileCost(cell, settings);
+        m_cost[cell.idx] = cost;
+        if (cost == 0.0f) {
+            m_desirability[cell.idx] = 0.0f;
+        }
+        else if (whole) {
+            const float inverse = 1.0f / cost;
+            float desirability = 1.0f;
+            for (int i = 0; i < wholePower; ++i) desirability *= inverse;
+            m_desirability[cell.idx] = desirability;
+        }
+        else {
+            m_desirability[cell.idx] = std::pow(1.0f / cost, settings.costWeight);
+        }
+    });
+}
+
+template <typename Cell>
+float AntColony::tileCost(const Cell& cell, const AntColonySettings& settings) const {
+    const float* heights = m_world.heightPlane().data();
+    const float base = m_world.lakePlane()[cell.idx] ? 0.0f : biomeCost(m_world.biomePlane()[cell.idx]);
+    if (base == 0.0f) return 0.0f;
+
+    // Steepest rise or fall to a neighbour
+    float slope = 0.0f;
+    for (int dir = 0; dir < 8; ++dir) {
+        if (!cell.has(dir)) continue;
+        slope = std::max(slope, std::abs(heights[cell.neighbour(dir)] - heights[cell.idx]));
+    }
+
+    const float slopeScale = std::max(m_world.getWidth(), m_world.getHeight()) / 1024.0f;
+    return base + settings.slopeCost * slope * slopeScale + settings.riverCost * m_world.riverPlane()[cell.idx];
+}
+
+// ---------------- SETTLEMENTS ----------------
+
+int AntColony::placeSettlements(int count, int minSpacing) {
+    const int width = m_world.getWidth();
+    const int height = m_world.getHeight();
+    Plane<int>& settlements = m_world.settlementPlane();
+    settlements.fill(-1);
+    if (count <= 0) return 0;
+
+    if (minSpacing <= 0) {
+        minSpacing = (int)(std::sqrt((double)width * height / count) * 0.5);
+    }
+
+    // Random land tiles away from the map edge, cheapest terrain first
+    const CounterRng rng(m_seed, RandomStream::Settlements);
+    const AntColonySettings defaults;
+    const stencil::Offsets offsets(width);
+    const int margin = std::min(8, std::min(width, height) / 4);
+    const int samples = count * 64;
+    std::vector<std::pair<float, int>> candidates;
+    candidates.reserve(samples);
+    for (int i = 0; i < samples; ++i) {
+        int x = margin + (int)rng.below(width - 2 * margin, i, 0);
+        int y = margin + (int)rng.below(height - 2 * margin, i, 1);
+        const StencilCell<true> cell{ x, y, y * width + x, width, height, offsets.value };
+        const float cost = tileCost(cell, defaults);
+        if (cost > 0.0f) candidates.push_back({ cost, cell.idx });
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    std::vector<int> placed;
+    const long long minDistance2 = (long long)minSpacing * minSpacing;
+    for (const auto& candidate : candidates) {
+        const int x = candidate.second % width;
+        const int y = candidate.second / width;
+        bool clear = true;
+        for (int other : placed) {
+            long long dx = x - other % width;
+            long long dy = y - other / width;
+            if (dx * dx + dy * dy < minDistance2) {
+                clear = false;
+                break;
+            }
+        }
+        if (!clear) continue;
+
+        settlements[candidate.second] = (int)placed.size();
+        placed.push_back(candidate.second);
+        if ((int)placed.size() == count) break;
+    }
+    return (int)placed.size();
+}
+
+void AntColony::linkSettlements() {
+    const int width = m_world.getWidth();
+    const Plane<int>& settlements = m_world.settlementPlane();
+
+    // First tile of every settlement id, in id order
+    std::vector<std::pair<int, int>> found;
+    for (size_t i = 0, n = settlements.size(); i < n; ++i) {
+        if (settlements[i] >= 0) found.push_back({ settlements[i], (int)i });
+    }
+    std::sort(found.begin(), found.end());
+    found.erase(std::unique(found.begin(), found.end(),
+        [](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.first == b.first; }), found.end());
+
+    m_links.clear();
+    const size_t count = found.size();
+    if (count < 2) return;
+
+    // Landmass of every settlement: union-find over the runs of passable
+    // tiles in each row, joining runs that touch (diagonals included) in
+    // the row above. One sequential scan instead of a flood fill.
+    const int height = m_world.getHeight();
+    struct Run {
+        int x0, x1; // [x0, x1)
+    };
+    std::vector<Run> runs;
+    std::vector<int> rowStart(height + 1, 0);
+    std::vector<int> runParent;
+    auto root = [&](int run) {
+        while (runParent[run] != run) {
+            runParent[run] = runParent[runParent[run]];
+            run = runParent[run];
+        }
+        return run;
+    };
+
+    for (int y = 0; y < height; ++y) {
+        rowStart[y] = (int)runs.size();
+        const float* cost = m_cost.data() + (size_t)y * width;
+        for (int x = 0; x < width;) {
+            if (cost[x] <= 0.0f) {
+                ++x;
+                continue;
+            }
+            const int x0 = x;
+            while (x < width && cost[x] > 0.0f) ++x;
+            runs.push_back({ x0, x });
+            runParent.push_back((int)runParent.size());
+        }
+
+        if (y == 0) continue;
+        int above = rowStart[y - 1];
+        const int aboveEnd = rowStart[y];
+        for (int run = rowStart[y]; run < (int)runs.size(); ++run) {
+            while (above < aboveEnd && runs[above].x1 < runs[run].x0) ++above;
+            for (int a = above; a < aboveEnd && runs[a].x0 <= runs[run].x1; ++a) {
+                runParent[root(a)] = root(run);
+            }
+        }
+    }
+    rowStart[height] = (int)runs.size();
+
+    std::vector<int> settlementLandmass(count, -1);
+    for (size_t s = 0; s < count; ++s) {
+        const int x = found[s].second % width;
+        const int y = found[s].second / width;
+        for (int run = rowStart[y]; run < rowStart[y + 1]; ++run) {
+            if (runs[run].x0 <= x && x < runs[run].x1) settlementLandmass[s] = root(run);
+        }
+    }
+
+    // Prim's minimum spanning tree on straight-line distance; settlements
+    // on different landmasses are never linked, so this yields one tree
+    // per landmass
+    std::vector<bool> inTree(count, false);
+    std::vector<double> distance(count, 1e300);
+    std::vector<int> parent(count, -1);
+    distance[0] = 0.0;
+    for (size_t round = 0; round < count; ++round) {
+        size_t next = count;
+        for (size_t i = 0; i < count; ++i) {
+            if (!inTree[i] && (next == count || distance[i] < distance[next])) next = i;
+        }
+        inTree[next] = true;
+
+        // Nothing reachable left: start the next landmass's tree
+        if (distance[next] >= 1e300) distance[next] = 0.0;
+
+        if (parent[next] >= 0) {
+            Link link;
+            link.from = found[parent[next]].second;
+            link.to = found[next].second;
+            link.maxSteps = 0; // set by computeGuides
+            link.bestCost = 0.0f;
+            m_links.push_back(link);
+        }
+
+        const int nx = found[next].second % width;
+        const int ny = found[next].second / width;
+        for (size_t i = 0; i < count; ++i) {
+            if (inTree[i] || settlementLandmass[i] != settlementLandmass[next]) continue;
+            double dx = found[i].second % width - nx;
+            double dy = found[i].second / width - ny;
+            double d = dx * dx + dy * dy;
+            if (d < distance[i]) {
+                distance[i] = d;
+                parent[i] = (int)next;
+            }
+        }
+    }
+}
+
+// Coarse grid of cells holding any passable tile; per link, a BFS from the
+// target cell gives every cell its neighbour on a shortest route there
+void AntColony::computeGuides() {
+    const int width = m_world.getWidth();
+    const int height = m_world.getHeight();
+    m_guideScale = std::max(1, std::max(width, height) / 256);
+    m_guideWidth = (width + m_guideScale - 1) / m_guideScale;
+    m_guideHeight = (height + m_guideScale - 1) / m_guideScale;
+    const int cells = m_guideWidth * m_guideHeight;
+
+    // A cell is passable if most of its tiles are, so routes do not squeeze
+    // through gaps the ants cannot follow
+    std::vector<int> passableTiles(cells, 0);
+    for (int y = 0; y < height; ++y) {
+        const float* cost = m_cost.data() + (size_t)y * width;
+        int* row = passableTiles.data() + (size_t)(y / m_guideScale) * m_guideWidth;
+        for (int x = 0; x < width; ++x) {
+            row[x / m_guideScale] += cost[x] > 0.0f;
+        }
+    }
+    std::vector<uint8_t> passable(cells);
+    for (int c = 0; c < cells; ++c) {
+        passable[c] = 2 * passableTiles[c] > m_guideScale * m_guideScale;
+    }
+
+    const int guideWidth = m_guideWidth;
+    const int guideHeight = m_guideHeight;
+    const int scale = m_guideScale;
+    m_pool->parallelFor((int)m_links.size(), [&](int l) {
+        Link& link = m_links[l];
+        std::vector<int> distance(cells, -1);
+        std::vector<int> queue;
+        queue.reserve(cells);
+
+        const int target = (link.to / width / scale) * guideWidth + (link.to % width) / scale;
+        distance[target] = 0;
+        queue.push_back(target);
+        for (size_t head = 0; head < queue.size(); ++head) {
+            const int cx = queue[head] % guideWidth;
+            const int cy = queue[head] / guideWidth;
+            for (int dir = 0; dir < 8; ++dir) {
+                const int nx = cx + stencil::DX[dir];
+                const int ny = cy + stencil::DY[dir];
+                if (nx < 0 || ny < 0 || nx >= guideWidth || ny >= guideHeight) continue;
+                const int next = ny * guideWidth + nx;
+                if (distance[next] < 0 && passable[next]) {
+                    distance[next] = distance[queue[head]] + 1;
+                    queue.push_back(next);
+                }
+            }
+        }
+
+        link.nextHop.assign(cells, -1);
+        for (int cell : queue) {
+            int best = cell;
+            const int cx = cell % guideWidth;
+            const int cy = cell / guideWidth;
+            for (int dir = 0; dir < 8; ++dir) {
+                const int nx = cx + stencil::DX[dir];
+                const int ny = cy + stencil::DY[dir];
+                if (nx < 0 || ny < 0 || nx >= guideWidth || ny >= guideHeight) continue;
+                const int next = ny * guideWidth + nx;
+                if (distance[next] >= 0 && distance[next] < distance[best]) best = next;
+            }
+            link.nextHop[cell] = best;
+        }
+
+        // Room for the guided route plus wandering
+        const int from = (link.from / width / scale) * guideWidth + (link.from % width) / scale;
+        const int route = distance[from] >= 0 ? (distance[from] + 1) * scale : octileSteps(link.from, link.to, width);
+        link.maxSteps = 4 * std::max(route, octileSteps(link.from, link.to, width)) + 256;
+    });
+}
+
+// ---------------- COLONY ----------------
+
+void AntColony::walk(const AntColonySettings& settings, int ant, int iteration, Batch& batch) const {
+    const int width = m_world.getWidth();
+    const int height = m_world.getHeight();
+    const int linkIndex = ant % (int)m_links.size();
+    const Link& link = m_links[linkIndex];
+    const CounterRng rng(m_seed, RandomStream::Roads);
+
+    const float diagonalFactor = std::pow(SQRT2, -settings.costWeight);
+    const bool linearPheromone = settings.pheromoneWeight == 1.0f;
+
+    // New stamp: every entry of the visited table becomes stale
+    const uint32_t stamp = ++batch.stamp;
+    const size_t mask = batch.visited.size() - 1;
+    auto visit = [&](int cell) {
+        size_t slot = visitSlot(cell, mask);
+        while (batch.visited[slot].stamp == stamp) slot = (slot + 1) & mask;
+        batch.visited[slot] = { stamp, cell };
+    };
+    auto visited = [&](int cell) {
+        for (size_t slot = visitSlot(cell, mask); batch.visited[slot].stamp == stamp; slot = (slot + 1) & mask) {
+            if (batch.visited[slot].cell == cell) return true;
+        }
+        return false;
+    };
+
+    const size_t offset = batch.cells.size();
+    batch.cells.push_back(link.from);
+    visit(link.from);
+    int current = link.from;
+    float cost = 0.0f;
+
+    for (int step = 0; step < link.maxSteps && current != link.to; ++step) {
+        const int x = current % width;
+        const int y = current / width;
+
+        // Head for the centre of the next guide cell, or the target itself
+        // once in its cell (or if the guide has no route)
+        int tx = link.to % width;
+        int ty = link.to / width;
+        const int cell = (y / m_guideScale) * m_guideWidth + x / m_guideScale;
+        const int hop = link.nextHop[cell];
+        if (hop >= 0 && hop != cell) {
+            tx = std::min(width - 1, (hop % m_guideWidth) * m_guideScale + m_guideScale / 2);
+            ty = std::min(height - 1, (hop / m_guideWidth) * m_guideScale + m_guideScale / 2);
+        }
+        const int vx = tx - x;
+        const int vy = ty - y;
+        const float invDistance = 1.0f / std::sqrt((float)(vx * vx + vy * vy));
+
+        // Unvisited neighbours, weighted by pheromone, cheapness and how
+        // straight they head that way; other steps stay possible
+        float weights[8];
+        float total = 0.0f;
+        for (int dir = 0; dir < 8; ++dir) {
+            weights[dir] = 0.0f;
+            const int dx = stencil::DX[dir];
+            const int dy = stencil::DY[dir];
+            const int nx = x + dx;
+            const int ny = y + dy;
+            if (nx < 0 || ny < 0 || nx >= width || ny >= height) continue;
+
+            const int next = ny * width + nx;
+            const float desirability = next == link.to ? 1.0f : m_desirability[next];
+            if (desirability == 0.0f || visited(next)) continue;
+
+            const bool diagonal = dx != 0 && dy != 0;
+            const float cosine = (dx * vx + dy * vy) * invDistance * (diagonal ? 1.0f / SQRT2 : 1.0f);
+            const float towards = 0.5f + 0.5f * cosine;
+            float heading = 1.0f;
+            for (int i = 0; i < settings.headingPower; ++i) heading *= towards;
+
+            const float pheromone = linearPheromone ? m_pheromone[next] : std::pow(m_pheromone[next], settings.pheromoneWeight);
+            weights[dir] = pheromone * desirability * heading * (diagonal ? diagonalFactor : 1.0f);
+            total += weights[dir];
+        }
+
+        // Boxed in by water and its own trail
+        if (total <= 0.0f) break;
+
+        float pick = rng.uniform((uint32_t)ant, (uint32_t)step, (uint32_t)iteration) * total;
+        int dir = 0;
+        while (dir < 7 && (pick >= weights[dir] || weights[dir] == 0.0f)) {
+            pick -= weights[dir];
+            ++dir;
+        }
+        // Rounding can run past the last candidate; fall back to it
+        while (weights[dir] == 0.0f) --dir;
+
+        const bool diagonal = stencil::DX[dir] != 0 && stencil::DY[dir] != 0;
+        current = (y + stencil::DY[dir]) * width + x + stencil::DX[dir];
+        cost += (current == link.to ? 1.0f : m_cost[current]) * (diagonal ? SQRT2 : 1.0f);
+        batch.cells.push_back(current);
+        visit(current);
+    }
+
+    if (current != link.to) {
+        batch.cells.resize(offset);
+        return;
+    }
+    batch.walks.push_back({ linkIndex, cost, offset, (int)(batch.cells.size() - offset) });
+}
+
+void AntColony::evaporate(const AntColonySettings& settings) {
+    const size_t chunk = 1 << 16;
+    const size_t tiles = m_pheromone.size();
+    const int chunks = (int)((tiles + chunk - 1) / chunk);
+    const float keep = 1.0f - settings.evaporation;
+    const float floor = settings.minPheromone;
+    const SimdLevel level = PerlinNoise::bestSimdLevel();
+
+    m_pool->parallelFor(chunks, [&](int c) {
+        float* values = m_pheromone.data() + (size_t)c * chunk;
+        const size_t count = std::min(chunk, tiles - (size_t)c * chunk);
+
+        size_t done = 0;
+        if (level == SimdLevel::AVX2) done = AntSimd::evaporateAvx2(values, count, keep, floor);
+        else if (level == SimdLevel::SSE41) done = AntSimd::evaporateSse41(values, count, keep, floor);
+        for (size_t i = done; i < count; ++i) {
+            values[i] = std::max(values[i] * keep, floor);
+        }
+    });
+}
+
+void AntColony::buildRoads(const AntColonySettings& settings,
+    const std::function<void(const AntIterationStats&)>& onIteration) {
+    const auto setupStart = std::chrono::steady_clock::now();
+    const int width = m_world.getWidth();
+    TG_PROFILE_SCOPE("ant_colony", (double)width * m_world.getHeight());
+
+    computeCosts(settings);
+    linkSettlements();
+    computeGuides();
+    m_pheromone.assign(m_cost.size(), 1.0f);
+    m_stats.clear();
+
+    const int colony = std::max(settings.colonySize, 1);
+    const int batches = std::min(colony, m_pool->getThreadCount() * 4);
+    m_batches.resize(batches);
+
+    // Visited tables at most half full on the longest walk
+    size_t tableSize = 64;
+    for (const Link& link : m_links) {
+        while (tableSize < 2 * (size_t)link.maxSteps + 2) tableSize *= 2;
+    }
+    for (Batch& batch : m_batches) {
+        batch.visited.assign(tableSize, Visit{ 0, 0 });
+        batch.stamp = 0;
+    }
+    m_setupMilliseconds = millisecondsSince(setupStart);
+
+    for (int iteration = 0; iteration < settings.iterations && !m_links.empty(); ++iteration) {
+        const auto start = std::chrono::steady_clock::now();
+
+        // Batch b walks ants [b * colony / batches, (b + 1) * colony / batches)
+        m_pool->parallelFor(batches, [&](int b) {
+            Batch& batch = m_batches[b];
+            batch.cells.clear();
+            batch.walks.clear();
+            const int end = (int)((long long)(b + 1) * colony / batches);
+            for (int ant = (int)((long long)b * colony / batches); ant < end; ++ant) {
+                walk(settings, ant, iteration, batch);
+            }
+        });
+
+        evaporate(settings);
+
+        // Merge in batch order, i.e. ant order, whatever thread ran them.
+        // A straight path over the cheapest terrain deposits about 1.
+        int arrived = 0;
+        for (const Batch& batch : m_batches) {
+            for (const Walk& w : batch.walks) {
+                Link& link = m_links[w.link];
+                const float amount = (float)octileSteps(link.from, link.to, width) / w.cost;
+                const int* cells = batch.cells.data() + w.offset;
+                for (int i = 0; i < w.length; ++i) {
+                    m_pheromone[cells[i]] += amount;
+                }
+                if (link.bestCost == 0.0f || w.cost < link.bestCost) {
+                    link.bestCost = w.cost;
+                    link.bestPath.assign(cells, cells + w.length);
+                }
+                ++arrived;
+            }
+        }
+
+        AntIterationStats stats;
+        stats.iteration = iteration;
+        stats.arrived = arrived;
+        stats.connected = 0;
+        stats.bestCost = 0.0f;
+        for (const Link& link : m_links) {
+            stats.connected += link.bestCost > 0.0f;
+            stats.bestCost += link.bestCost;
+        }
+        stats.milliseconds = millisecondsSince(start);
+        m_stats.push_back(stats);
+        if (onIteration) onIteration(stats);
+    }
+
+    Plane<bool>& roads = m_world.roadPlane();
+    roads.fill(false);
+    for (const Link& link : m_links) {
+        for (int cell : link.bestPath) roads[cell] = true;
+    }
+}
+
+const std::vector<AntIterationStats>& AntColony::getIterationStats() const {
+    return m_stats;
+}
+
+double AntColony::getSetupMilliseconds() const {
+    return m_setupMilliseconds;
+}
+
+const std::vector<float>& AntColony::getPheromones() const {
+    return m_pheromone;
+}
+
+const std::vector<float>& AntColony::getCosts() const {
+    return m_cost;
+}
+
+int AntColony::getLinkCount() const {
+    return (int)m_links.size();
+}
+
+int AntColony::getConnectedLinkCount() const {
+    int connected = 0;
+    for (const Link& link : m_links) connected += link.bestCost > 0.0f;
+    return connected;
+}
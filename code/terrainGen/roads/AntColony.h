@@ -1 +1,133 @@
 #pragma once
+
+#include "util/ThreadPool.h"
+#include "world/World.h"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Ant-colony road builder.
+//
+// Settlements on the same landmass are joined along a minimum spanning
+// tree. Every iteration, a colony of ants walks from one end of a link
+// towards the other without revisiting a tile, choosing each step with
+// probability ~ pheromone * (1 / terrain cost) * heading. Ants head along
+// the shortest route around water on a coarse grid (about 256 cells
+// across), so they find their way around lakes and bays.
+// Ants that arrive lay pheromone in proportion to how cheap their path was,
+// and all pheromone evaporates a little, so cheap corridors, and corridors
+// shared by several links, win out. The cheapest path found for each link
+// becomes road.
+//
+// Ants run in batches on a thread pool. Each batch records its deposits in
+// its own buffer; the buffers are merged in batch order once per iteration,
+// so no locks are taken and the roads do not depend on the thread count.
+// Every random choice is keyed by (ant, step, iteration).
+
+struct AntColonySettings {
+    int iterations = 40;        // Rounds of walk, deposit, evaporate
+    int colonySize = 64;        // Ants per round, shared round-robin between links
+    float evaporation = 0.1f;   // Share of pheromone lost per round
+    float minPheromone = 0.01f; // Floor, so no step becomes impossible
+    float pheromoneWeight = 1.0f; // alpha: pheromone ^ alpha
+    float costWeight = 2.0f;      // beta: (1 / cost) ^ beta
+    int headingPower = 4;         // ((1 + cos) / 2) ^ n of the angle to the target
+
+    // Terrain cost per tile is biome cost + slopeCost * slope + riverCost * river
+    float slopeCost = 40.0f;    // per unit of height change per 1/1024 of the map
+    float riverCost = 8.0f;     // bridging a full-strength river
+};
+
+// Timing and progress of one iteration
+struct AntIterationStats {
+    int iteration;
+    double milliseconds;
+    int arrived;         // Ants that reached their target
+    int connected;       // Links with a path so far
+    float bestCost;      // Sum of the cheapest path of every connected link
+};
+
+class AntColony {
+public:
+    // seed keys settlement placement and every ant's choices
+    AntColony(World& world, unsigned int seed = 0);
+
+    // Threads for the ant batches and grid passes; 0 = all hardware threads
+    void setThreadCount(int threadCount);
+    void setSeed(unsigned int seed);
+
+    // Places up to count settlements on cheap land, at least minSpacing tiles
+    // apart (0 = spread evenly for count), replacing any settlements in the
+    // world. Returns how many were placed.
+    int placeSettlements(int count, int minSpacing = 0);
+
+    // Connects the world's settlements with roads, replacing any roads.
+    // onIteration, if given, runs after every iteration.
+    void buildRoads(const AntColonySettings& settings = AntColonySettings(),
+        const std::function<void(const AntIterationStats&)>& onIteration = nullptr);
+
+    // Results of the last buildRoads
+    const std::vector<AntIterationStats>& getIterationStats() const;
+    double getSetupMilliseconds() const;      // Cost grid and links
+    const std::vector<float>& getPheromones() const;
+    const std::vector<float>& getCosts() const; // per tile; 0 = impassable
+    int getLinkCount() const;
+    int getConnectedLinkCount() const;       // Links an ant found a path for
+
+private:
+    struct Link {
+        int from, to;   // tile indices
+        int maxSteps;
+        float bestCost; // 0 until an ant arrives
+        std::vector<int> bestPath;
+        std::vector<int> nextHop; // per guide cell: next cell towards to, -1 = unreachable
+    };
+
+    // One ant's walk inside a batch's deposit buffer
+    struct Walk {
+        int link;
+        float cost;
+        size_t offset; // into Batch::cells
+        int length;
+    };
+
+    // Tiles visited by the current walk, tagged with its stamp so the
+    // table never needs clearing
+    struct Visit {
+        uint32_t stamp;
+        int cell;
+    };
+
+    struct Batch {
+        std::vector<int> cells;
+        std::vector<Walk> walks;
+        std::vector<Visit> visited; // open addressing, power-of-two size
+        uint32_t stamp = 0;
+    };
+
+    World& m_world;
+    unsigned int m_seed;
+    std::unique_ptr<ThreadPool> m_pool;
+
+    std::vector<float> m_cost;         // Terrain cost per tile, 0 = impassable
+    std::vector<float> m_desirability; // (1 / cost) ^ beta per tile
+    std::vector<float> m_pheromone;
+    std::vector<Link> m_links;
+    std::vector<Batch> m_batches;
+    std::vector<AntIterationStats> m_stats;
+    int m_guideScale = 1; // tiles per guide cell edge
+    int m_guideWidth = 0;
+    int m_guideHeight = 0;
+    double m_setupMilliseconds = 0.0;
+
+    void computeCosts(const AntColonySettings& settings);
+
+    // Terrain cost of a stencil cell; 0 = impassable
+    template <typename Cell>
+    float tileCost(const Cell& cell, const AntColonySettings& settings) const;
+    void linkSettlements();
+    void computeGuides();
+    void walk(const AntColonySettings& settings, int ant, int iteration, Batch& batch) const;
+    void evaporate(const AntColonySettings& settings);
+};
@@ -0,0 +1,42 @@
+#include "AntColonySimd.h"
+#include "noise/PerlinNoiseSimd.h"
+
+#ifdef TG_NOISE_X86
+
+#include <immintrin.h>
+
+namespace AntSimd {
+
+TG_TARGET_SSE41 size_t evaporateSse41(float* values, size_t count, float keep, float floor) {
+    const __m128 k = _mm_set1_ps(keep);
+    const __m128 f = _mm_set1_ps(floor);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(values + i, _mm_max_ps(_mm_mul_ps(_mm_loadu_ps(values + i), k), f));
+    }
+    return i;
+}
+
+TG_TARGET_AVX2 size_t evaporateAvx2(float* values, size_t count, float keep, float floor) {
+    const __m256 k = _mm256_set1_ps(keep);
+    const __m256 f = _mm256_set1_ps(floor);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(values + i), k);
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(values + i + 8), k);
+        _mm256_storeu_ps(values + i, _mm256_max_ps(a, f));
+        _mm256_storeu_ps(values + i + 8, _mm256_max_ps(b, f));
+    }
+    return i;
+}
+
+} // namespace AntSimd
+
+#else
+
+namespace AntSimd {
+    size_t evaporateSse41(float*, size_t, float, float) { return 0; }
+    size_t evaporateAvx2(float*, size_t, float, float) { return 0; }
+}
+
+#endif
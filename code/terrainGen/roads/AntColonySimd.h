@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstddef>
+
+// SIMD kernels behind AntColony's evaporation pass.
+// Each kernel processes whole vectors only and returns how many values it
+// wrote; the caller finishes the tail with the scalar path.
+
+namespace AntSimd {
+    // values[i] = max(values[i] * keep, floor)
+    size_t evaporateSse41(float* values, size_t count, float keep, float floor);
+    size_t evaporateAvx2(float* values, size_t count, float keep, float floor);
+}
@@ -0,0 +1,143 @@
+#include "ShardLauncher.h"
+#include "ShardedGenerator.h"
+#include "util/ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <sys/wait.h>
+#include <unistd.h>
+#include <map>
+#endif
+
+#if defined(__linux__)
+#include <climits>
+#endif
+
+namespace {
+
+// argv for one job; the strings must outlive the returned pointers
+std::vector<const char*> workerArgv(const std::vector<std::string>& command, const std::string& jobPath) {
+    std::vector<const char*> argv;
+    for (const std::string& arg : command) argv.push_back(arg.c_str());
+    argv.push_back("--shard-worker");
+    argv.push_back(jobPath.c_str());
+    argv.push_back(nullptr);
+    return argv;
+}
+
+} // namespace
+
+ProcessLauncher::ProcessLauncher(std::vector<std::vector<std::string>> commands, int maxParallel)
+    : m_commands(std::move(commands)),
+    m_maxParallel(maxParallel > 0 ? maxParallel : ThreadPool::hardwareThreads())
+{
+}
+
+#ifdef _WIN32
+
+bool ProcessLauncher::run(const std::vector<std::string>& jobPaths) {
+    if (m_commands.empty()) return jobPaths.empty();
+
+    // Batches of m_maxParallel; _cwait has no "any child" form
+    bool ok = true;
+    for (size_t first = 0; first < jobPaths.size(); first += m_maxParallel) {
+        const size_t last = std::min(jobPaths.size(), first + (size_t)m_maxParallel);
+        std::vector<intptr_t> handles;
+        for (size_t i = first; i < last; ++i) {
+            const std::vector<std::string>& command = m_commands[i % m_commands.size()];
+            std::vector<const char*> argv = workerArgv(command, jobPaths[i]);
+            intptr_t handle = _spawnvp(_P_NOWAIT, argv[0], argv.data());
+            if (handle == -1) {
+                std::fprintf(stderr, "Cannot start %s\n", argv[0]);
+                ok = false;
+                continue;
+            }
+            handles.push_back(handle);
+        }
+        for (intptr_t handle : handles) {
+            int status = 0;
+            ok &= _cwait(&status, handle, 0) != -1 && status == 0;
+        }
+    }
+    return ok;
+}
+
+#else
+
+bool ProcessLauncher::run(const std::vector<std::string>& jobPaths) {
+    if (m_commands.empty()) return jobPaths.empty();
+
+    bool ok = true;
+    std::map<pid_t, size_t> running;
+    size_t next = 0;
+
+    while (next < jobPaths.size() || !running.empty()) {
+        // Top up to the limit
+        while (next < jobPaths.size() && (int)running.size() < m_maxParallel) {
+            const std::vector<std::string>& command = m_commands[next % m_commands.size()];
+            std::vector<const char*> argv = workerArgv(command, jobPaths[next]);
+
+            pid_t pid = fork();
+            if (pid == 0) {
+                execvp(argv[0], const_cast<char* const*>(argv.data()));
+                _exit(127); // exec failed
+            }
+            if (pid < 0) {
+                std::fprintf(stderr, "Cannot start %s\n", argv[0]);
+                ok = false;
+            }
+            else {
+                running[pid] = next;
+            }
+            ++next;
+        }
+        if (running.empty()) continue;
+
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) return false; // no children left to wait for
+        auto it = running.find(pid);
+        if (it == running.end()) continue;
+
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            std::fprintf(stderr, "Shard job %s failed\n", jobPaths[it->second].c_str());
+            ok = false;
+        }
+        running.erase(it);
+    }
+    return ok;
+}
+
+#endif
+
+InProcessLauncher::InProcessLauncher(int maxParallel)
+    : m_maxParallel(maxParallel)
+{
+}
+
+bool InProcessLauncher::run(const std::vector<std::string>& jobPaths) {
+    ThreadPool pool(m_maxParallel);
+    std::atomic<bool> ok{ true };
+    pool.parallelFor((int)jobPaths.size(), [&](int i) {
+        std::string error;
+        if (!runShardJob(jobPaths[i], &error)) {
+            std::fprintf(stderr, "Shard job %s failed: %s\n", jobPaths[i].c_str(), error.c_str());
+            ok = false;
+        }
+    });
+    return ok;
+}
+
+std::string currentExecutable(const char* argv0) {
+#if defined(__linux__)
+    char path[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+    if (length > 0) return std::string(path, (size_t)length);
+#endif
+    return argv0 ? argv0 : "";
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Runs shard worker jobs for ShardedGenerator. A job is the path of a job
+// file (see ShardJob); a launcher only has to get runShardJob(path) called
+// for each one, in this process, in a child process or on another host
+// that sees the same directory.
+class ShardLauncher {
+public:
+    virtual ~ShardLauncher() = default;
+
+    // Runs every job to completion; false if any of them failed
+    virtual bool run(const std::vector<std::string>& jobPaths) = 0;
+};
+
+// One process per job: command + { "--shard-worker", job }. With several
+// commands the jobs are dealt out round robin, so
+//
+//     { { "ssh", "node1", "/opt/terrainGenCli" }, { "ssh", "node2", "/opt/terrainGenCli" } }
+//
+// spreads them over two hosts. At most maxParallel processes run at once
+// (0 = one per hardware thread). POSIX uses fork/exec, Windows _spawnvp.
+class ProcessLauncher : public ShardLauncher {
+public:
+    explicit ProcessLauncher(std::vector<std::vector<std::string>> commands, int maxParallel = 0);
+
+    bool run(const std::vector<std::string>& jobPaths) override;
+
+private:
+    std::vector<std::vector<std::string>> m_commands;
+    int m_maxParallel;
+};
+
+// Runs the jobs on threads of this process, maxParallel at a time
+// (0 = one per hardware thread). For tests, or when one box is enough but
+// the shard files are wanted.
+class InProcessLauncher : public ShardLauncher {
+public:
+    explicit InProcessLauncher(int maxParallel = 0);
+
+    bool run(const std::vector<std::string>& jobPaths) override;
+
+private:
+    int m_maxParallel;
+};
+
+// Path of the running executable, for a ProcessLauncher that starts
+// workers from the same binary; argv0 is the fallback
+std::string currentExecutable(const char* argv0);
@@ -0,0 +1,577 @@
+#include "ShardedGenerator.h"
+
+#include "terrain/FlowAccumulation.h"
+#include "terrain/RiverGenerator.h"
+#include "terrain/TerrainGenerator.h"
+#include "terrain/TerrainRecipe.h"
+#include "util/Compression.h"
+#include "util/MappedFile.h"
+#include "util/Profiler.h"
+#include "util/ThreadPool.h"
+#include "world/Stencil.h"
+#include "world/WorldArchive.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+// Flow file layout:
+//
+//   header  magic "TGFLOW\0\0", version, width, rows, band count
+//   index   one entry per band: file offset, byte size
+//   bands   [uint32 size][lz int8 flow directions]
+//           [uint32 size][lz delta-shuffled local accumulation]
+//           exit count, exits, exit receivers, exit amounts, edgeExitOf
+//
+// All integers are little-endian, floats are stored by their bits.
+
+namespace {
+
+const char MAGIC[8] = { 'T', 'G', 'F', 'L', 'O', 'W', '\0', '\0' };
+const uint32_t FLOW_VERSION = 1;
+const size_t HEADER_SIZE = 24;
+const size_t INDEX_ENTRY_SIZE = 12;
+
+void putLE32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+void putLE64(std::vector<uint8_t>& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+uint32_t getLE32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint64_t getLE64(const uint8_t* p) {
+    return (uint64_t)getLE32(p) | ((uint64_t)getLE32(p + 4) << 32);
+}
+
+uint32_t floatBits(float v) {
+    uint32_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    return bits;
+}
+
+float bitsFloat(uint32_t bits) {
+    float v;
+    std::memcpy(&v, &bits, sizeof(v));
+    return v;
+}
+
+// Bounds-checked cursor over one band record
+struct Reader {
+    const uint8_t* p;
+    const uint8_t* end;
+
+    bool has(size_t bytes) const { return (size_t)(end - p) >= bytes; }
+
+    bool u32(uint32_t& v) {
+        if (!has(4)) return false;
+        v = getLE32(p);
+        p += 4;
+        return true;
+    }
+
+    // A [uint32 size][bytes] block
+    bool block(const uint8_t*& data, size_t& size) {
+        uint32_t n;
+        if (!u32(n) || !has(n)) return false;
+        data = p;
+        size = n;
+        p += n;
+        return true;
+    }
+
+    template <typename T, typename Fn>
+    bool values(std::vector<T>& out, size_t count, const Fn& convert) {
+        if (!has(count * 4)) return false;
+        out.resize(count);
+        for (size_t i = 0; i < count; ++i, p += 4) out[i] = convert(getLE32(p));
+        return true;
+    }
+};
+
+void encodeBand(const int* flowDirection, const float* accumulation, const FlowBandEdges& edges,
+    std::vector<uint8_t>& blob) {
+    const size_t cells = (size_t)edges.width * edges.rows;
+    blob.clear();
+
+    auto putBlock = [&](const uint8_t* data, size_t size) {
+        const size_t sizePos = blob.size();
+        putLE32(blob, 0);
+        lzCompress(data, size, blob);
+        const uint32_t written = (uint32_t)(blob.size() - sizePos - 4);
+        for (int i = 0; i < 4; ++i) blob[sizePos + i] = (uint8_t)(written >> (8 * i));
+    };
+
+    std::vector<uint8_t> bytes(cells);
+    for (size_t i = 0; i < cells; ++i) bytes[i] = (uint8_t)(int8_t)flowDirection[i];
+    putBlock(bytes.data(), cells);
+
+    bytes.resize(cells * 4);
+    shuffleDelta32((const uint8_t*)accumulation, cells, bytes.data());
+    putBlock(bytes.data(), bytes.size());
+
+    putLE32(blob, (uint32_t)edges.exits.size());
+    for (int v : edges.exits) putLE32(blob, (uint32_t)v);
+    for (int v : edges.exitReceivers) putLE32(blob, (uint32_t)v);
+    for (float v : edges.exitAmounts) putLE32(blob, floatBits(v));
+    for (int v : edges.edgeExitOf) putLE32(blob, (uint32_t)v);
+}
+
+int toInt(uint32_t v) { return (int)v; }
+
+// A shard's flow file, mapped
+class FlowFile {
+public:
+    bool open(const std::string& path) {
+        if (!m_file.open(path)) return false;
+        const uint8_t* data = m_file.data();
+        if (m_file.size() < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0) return false;
+        if (getLE32(data + 8) != FLOW_VERSION) return false;
+
+        m_width = (int)getLE32(data + 12);
+        m_rows = (int)getLE32(data + 16);
+        const uint32_t bands = getLE32(data + 20);
+        if (m_file.size() < HEADER_SIZE + (size_t)bands * INDEX_ENTRY_SIZE) return false;
+
+        m_bands.resize(bands);
+        for (uint32_t b = 0; b < bands; ++b) {
+            const uint8_t* entry = data + HEADER_SIZE + b * INDEX_ENTRY_SIZE;
+            m_bands[b].offset = getLE64(entry);
+            m_bands[b].size = getLE32(entry + 8);
+            if (m_bands[b].offset > m_file.size() || m_bands[b].size > m_file.size() - m_bands[b].offset) return false;
+        }
+        return true;
+    }
+
+    int getWidth() const { return m_width; }
+    int getRows() const { return m_rows; }
+    int getBandCount() const { return (int)m_bands.size(); }
+
+    int bandRows(int band) const {
+        return std::min(FLOW_BAND_ROWS, m_rows - band * FLOW_BAND_ROWS);
+    }
+
+    bool readEdges(int band, FlowBandEdges& edges) const {
+        Reader in = reader(band);
+        const uint8_t* skipped;
+        size_t size;
+        uint32_t exitCount;
+        if (!in.block(skipped, size) || !in.block(skipped, size) || !in.u32(exitCount)) return false;
+
+        edges.width = m_width;
+        edges.rows = bandRows(band);
+        return in.values(edges.exits, exitCount, toInt)
+            && in.values(edges.exitReceivers, exitCount, toInt)
+            && in.values(edges.exitAmounts, exitCount, bitsFloat)
+            && in.values(edges.edgeExitOf, (size_t)2 * m_width, toInt);
+    }
+
+    bool readFlow(int band, std::vector<int>& flowDirection, std::vector<float>& accumulation) const {
+        const size_t cells = (size_t)m_width * bandRows(band);
+        Reader in = reader(band);
+        const uint8_t* data;
+        size_t size;
+
+        std::vector<uint8_t> bytes(cells);
+        if (!in.block(data, size) || !lzDecompress(data, size, bytes.data(), cells)) return false;
+        flowDirection.resize(cells);
+        for (size_t i = 0; i < cells; ++i) flowDirection[i] = (int8_t)bytes[i];
+
+        std::vector<uint8_t> filtered(cells * 4);
+        if (!in.block(data, size) || !lzDecompress(data, size, filtered.data(), filtered.size())) return false;
+        accumulation.resize(cells);
+        unshuffleDelta32(filtered.data(), cells, (uint8_t*)accumulation.data());
+        return true;
+    }
+
+private:
+    struct BandEntry {
+        uint64_t offset;
+        uint32_t size;
+    };
+
+    MappedFile m_file;
+    int m_width = 0;
+    int m_rows = 0;
+    std::vector<BandEntry> m_bands;
+
+    Reader reader(int band) const {
+        const uint8_t* begin = m_file.data() + m_bands[band].offset;
+        return Reader{ begin, begin + m_bands[band].size };
+    }
+};
+
+bool writeFlowFile(const std::string& path, int width, int rows, const std::vector<std::vector<uint8_t>>& blobs) {
+    std::vector<uint8_t> header;
+    header.insert(header.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    putLE32(header, FLOW_VERSION);
+    putLE32(header, (uint32_t)width);
+    putLE32(header, (uint32_t)rows);
+    putLE32(header, (uint32_t)blobs.size());
+
+    uint64_t offset = HEADER_SIZE + blobs.size() * INDEX_ENTRY_SIZE;
+    for (const std::vector<uint8_t>& blob : blobs) {
+        putLE64(header, offset);
+        putLE32(header, (uint32_t)blob.size());
+        offset += blob.size();
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    std::fwrite(header.data(), 1, header.size(), file);
+    for (const std::vector<uint8_t>& blob : blobs) std::fwrite(blob.data(), 1, blob.size(), file);
+    bool ok = std::ferror(file) == 0;
+    return std::fclose(file) == 0 && ok;
+}
+
+int roundedShardRows(int rows) {
+    rows = std::max(rows, 1);
+    return (rows + FLOW_BAND_ROWS - 1) / FLOW_BAND_ROWS * FLOW_BAND_ROWS;
+}
+
+bool validSettings(const ShardSettings& settings, std::string* error) {
+    auto fail = [&](const char* message) {
+        if (error) *error = message;
+        return false;
+    };
+    TerrainRecipe recipe;
+    if (settings.width <= 0 || settings.height <= 0) return fail("map size must be positive");
+    if (!TerrainRecipe::byName(settings.recipe, recipe)) return fail("unknown recipe");
+    if (settings.chunkSize <= 0 || FLOW_BAND_ROWS % settings.chunkSize != 0) {
+        return fail("chunk size must divide the flow band height");
+    }
+    return true;
+}
+
+} // namespace
+
+// ----------- JOB FILES -----------
+
+bool ShardJob::save(const std::string& path) const {
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    const ShardSettings& s = settings;
+    std::fprintf(file, "width %d\nheight %d\nseed %u\nrecipe %s\nnoise %s\n",
+        s.width, s.height, s.seed, s.recipe.c_str(), noise::noiseBackendName(s.noise));
+    std::fprintf(file, "river_threshold %.9g\nmoisture_influence %.9g\n", s.riverThreshold, s.moistureInfluence);
+    std::fprintf(file, "shard_rows %d\nthreads %d\nchunk_size %d\nshard %d\ndirectory %s\n",
+        s.shardRows, s.threadsPerShard, s.chunkSize, shard, directory.c_str());
+
+    bool ok = std::ferror(file) == 0;
+    return std::fclose(file) == 0 && ok;
+}
+
+bool ShardJob::load(const std::string& path, std::string* error) {
+    std::ifstream file(path);
+    if (!file) {
+        if (error) *error = "cannot open " + path;
+        return false;
+    }
+
+    ShardSettings& s = settings;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        ++lineNumber;
+        const size_t space = line.find(' ');
+        if (line.empty()) continue;
+
+        const std::string key = line.substr(0, space);
+        const std::string value = space == std::string::npos ? std::string() : line.substr(space + 1);
+        const char* text = value.c_str();
+        bool ok = true;
+
+        if (key == "width") s.width = std::atoi(text);
+        else if (key == "height") s.height = std::atoi(text);
+        else if (key == "seed") s.seed = (unsigned int)std::strtoul(text, nullptr, 10);
+        else if (key == "recipe") s.recipe = value;
+        else if (key == "noise") ok = noise::parseNoiseBackend(value, s.noise);
+        else if (key == "river_threshold") s.riverThreshold = std::strtof(text, nullptr);
+        else if (key == "moisture_influence") s.moistureInfluence = std::strtof(text, nullptr);
+        else if (key == "shard_rows") s.shardRows = std::atoi(text);
+        else if (key == "threads") s.threadsPerShard = std::atoi(text);
+        else if (key == "chunk_size") s.chunkSize = std::atoi(text);
+        else if (key == "shard") shard = std::atoi(text);
+        else if (key == "directory") directory = value;
+        else ok = false;
+
+        if (!ok) {
+            if (error) *error = "line " + std::to_string(lineNumber) + ": bad entry '" + line + "'";
+            return false;
+        }
+    }
+
+    s.shardRows = roundedShardRows(s.shardRows);
+    return validSettings(s, error);
+}
+
+std::string shardJobPath(const std::string& directory, int shard) {
+    return (std::filesystem::path(directory) / ("shard_" + std::to_string(shard) + ".job")).string();
+}
+
+std::string shardArchivePath(const std::string& directory, int shard) {
+    return (std::filesystem::path(directory) / ("shard_" + std::to_string(shard) + ".tgw")).string();
+}
+
+std::string shardFlowPath(const std::string& directory, int shard) {
+    return (std::filesystem::path(directory) / ("shard_" + std::to_string(shard) + ".flow")).string();
+}
+
+// ----------- WORKER -----------
+
+bool runShardJob(const std::string& jobPath, std::string* error) {
+    ShardJob job;
+    if (!job.load(jobPath, error)) return false;
+    const ShardSettings& s = job.settings;
+
+    const int width = s.width;
+    const int firstRow = job.shard * s.shardRows;
+    const int rows = std::min(s.shardRows, s.height - firstRow);
+    if (rows <= 0) {
+        if (error) *error = "shard lies outside the map";
+        return false;
+    }
+    TG_PROFILE_SCOPE("shard_worker", (double)width * rows);
+
+    // One halo row each side, so edge tiles see all their neighbours
+    const int haloTop = firstRow > 0 ? 1 : 0;
+    const int haloBottom = firstRow + rows < s.height ? 1 : 0;
+    World world(width, rows + haloTop + haloBottom);
+
+    TerrainRecipe recipe;
+    TerrainRecipe::byName(s.recipe, recipe);
+    TerrainGenerator generator(s.seed);
+    generator.setThreadCount(s.threadsPerShard);
+    generator.setRecipe(recipe);
+    generator.setNoiseBackend(s.noise);
+    generator.generateRegion(world, 0, firstRow - haloTop, s.width, s.height);
+
+    RiverGenerator rivers(world, s.seed);
+    rivers.setThreadCount(s.threadsPerShard);
+    rivers.calculateFlowDirections();
+    const int* flowDirection = rivers.getFlowDirections().data() + (size_t)haloTop * width;
+
+    // Local pass of every band
+    const size_t cells = (size_t)width * rows;
+    const float* moistures = world.moisturePlane().row(haloTop);
+    const double tileCount = (double)s.width * s.height;
+    std::vector<float> rainfall(cells);
+    std::vector<float> accumulation(cells);
+
+    const int bands = (rows + FLOW_BAND_ROWS - 1) / FLOW_BAND_ROWS;
+    std::vector<std::vector<uint8_t>> blobs(bands);
+    ThreadPool pool(s.threadsPerShard);
+    pool.parallelFor(bands, [&](int band) {
+        const size_t begin = (size_t)band * FLOW_BAND_ROWS * width;
+        const int bandRows = std::min(FLOW_BAND_ROWS, rows - band * FLOW_BAND_ROWS);
+        const size_t end = begin + (size_t)bandRows * width;
+        for (size_t i = begin; i < end; ++i) {
+            rainfall[i] = RiverGenerator::rainfall(moistures[i], s.moistureInfluence, tileCount);
+        }
+
+        FlowBandEdges edges = accumulateFlowBand(flowDirection + begin, stencil::DX, stencil::DY,
+            rainfall.data() + begin, accumulation.data() + begin, width, bandRows);
+        encodeBand(flowDirection + begin, accumulation.data() + begin, edges, blobs[band]);
+    });
+
+    if (!writeFlowFile(shardFlowPath(job.directory, job.shard), width, rows, blobs)) {
+        if (error) *error = "cannot write " + shardFlowPath(job.directory, job.shard);
+        return false;
+    }
+
+    // Tiles without the halo
+    ChunkGenerator inner = [&](World& chunk, int originX, int originY) {
+        const int w = std::min(chunk.getWidth(), width - originX);
+        const int h = std::min(chunk.getHeight(), rows - originY);
+        chunk.copyRegion(world, originX, originY + haloTop, 0, 0, w, h);
+    };
+    if (!saveWorldArchive(shardArchivePath(job.directory, job.shard), width, rows, s.chunkSize, inner,
+        s.threadsPerShard)) {
+        if (error) *error = "cannot write " + shardArchivePath(job.directory, job.shard);
+        return false;
+    }
+    return true;
+}
+
+bool handleShardWorker(int argc, char** argv, int& exitCode) {
+    if (argc != 3 || std::strcmp(argv[1], "--shard-worker") != 0) return false;
+
+    std::string error;
+    exitCode = 0;
+    if (!runShardJob(argv[2], &error)) {
+        std::fprintf(stderr, "Shard job %s failed: %s\n", argv[2], error.c_str());
+        exitCode = 1;
+    }
+    return true;
+}
+
+// ----------- COORDINATOR -----------
+
+ShardedGenerator::ShardedGenerator(const ShardSettings& settings, ShardLauncher& launcher)
+    : m_settings(settings),
+    m_launcher(launcher)
+{
+    m_settings.shardRows = roundedShardRows(m_settings.shardRows);
+}
+
+int ShardedGenerator::getShardCount() const {
+    return (std::max(m_settings.height, 0) + m_settings.shardRows - 1) / m_settings.shardRows;
+}
+
+int ShardedGenerator::getShardRows() const {
+    return m_settings.shardRows;
+}
+
+void ShardedGenerator::setThreadCount(int threadCount) {
+    m_threadCount = threadCount;
+}
+
+const std::string& ShardedGenerator::getError() const {
+    return m_error;
+}
+
+bool ShardedGenerator::fail(const std::string& message) {
+    m_error = message;
+    return false;
+}
+
+bool ShardedGenerator::generate(const std::string& directory, const std::string& outPath, bool keepShards) {
+    const ShardSettings& s = m_settings;
+    m_error.clear();
+    if (!validSettings(s, &m_error)) return false;
+
+    std::error_code fsError;
+    std::filesystem::create_directories(directory, fsError);
+    if (fsError) return fail("cannot create " + directory + ": " + fsError.message());
+
+    // Step 1: every shard generates and runs its local flow pass
+    const int shards = getShardCount();
+    std::vector<std::string> jobPaths;
+    for (int shard = 0; shard < shards; ++shard) {
+        ShardJob job{ s, shard, directory };
+        jobPaths.push_back(shardJobPath(directory, shard));
+        if (!job.save(jobPaths.back())) return fail("cannot write " + jobPaths.back());
+    }
+    if (!m_launcher.run(jobPaths)) return fail("a shard job failed");
+
+    std::vector<std::unique_ptr<FlowFile>> flows(shards);
+    std::vector<std::unique_ptr<WorldArchive>> archives(shards);
+    for (int shard = 0; shard < shards; ++shard) {
+        flows[shard].reset(new FlowFile());
+        archives[shard].reset(new WorldArchive());
+        const int rows = std::min(s.shardRows, s.height - shard * s.shardRows);
+        if (!flows[shard]->open(shardFlowPath(directory, shard)) || flows[shard]->getWidth() != s.width ||
+            flows[shard]->getRows() != rows) {
+            return fail("bad flow file " + shardFlowPath(directory, shard));
+        }
+        if (!archives[shard]->open(shardArchivePath(directory, shard)) || archives[shard]->getWidth() != s.width ||
+            archives[shard]->getHeight() != rows || archives[shard]->getChunkSize() != s.chunkSize) {
+            return fail("bad shard archive " + shardArchivePath(directory, shard));
+        }
+    }
+
+    // Step 2: flow across every band edge, shard boundaries included
+    std::vector<FlowCrossing> crossings;
+    {
+        TG_PROFILE_SCOPE("shard_reconcile", (double)s.width * s.height);
+        std::vector<FlowBandEdges> edges;
+        for (int shard = 0; shard < shards; ++shard) {
+            for (int band = 0; band < flows[shard]->getBandCount(); ++band) {
+                edges.emplace_back();
+                if (!flows[shard]->readEdges(band, edges.back())) {
+                    return fail("bad flow file " + shardFlowPath(directory, shard));
+                }
+            }
+        }
+        crossings = resolveFlowCrossings(edges);
+    }
+
+    // Step 3: stream the final map. Chunks never straddle a band, and
+    // saveWorldArchive finishes a row of chunks before starting the next,
+    // so only the current band's flow is kept.
+    struct BandFlow {
+        int index = -1;
+        bool ok = false;
+        std::vector<int> flowDirection;
+        std::vector<float> accumulation;
+    };
+    std::mutex bandMutex;
+    std::shared_ptr<const BandFlow> current;
+    std::atomic<bool> corrupt{ false };
+    const int bandsPerShard = s.shardRows / FLOW_BAND_ROWS;
+
+    auto loadBand = [&](int index) {
+        std::lock_guard<std::mutex> lock(bandMutex);
+        if (current && current->index == index) return current;
+
+        std::shared_ptr<BandFlow> band(new BandFlow());
+        band->index = index;
+        const FlowFile& flow = *flows[index / bandsPerShard];
+        const int local = index % bandsPerShard;
+        const int rows = flow.bandRows(local);
+        band->ok = flow.readFlow(local, band->flowDirection, band->accumulation);
+        if (band->ok) {
+            addFlowInflow(band->flowDirection.data(), stencil::DX, stencil::DY, band->accumulation.data(),
+                s.width, rows, (int64_t)index * FLOW_BAND_ROWS * s.width, crossings.data(), crossings.size());
+        }
+        current = band;
+        return current;
+    };
+
+    bool written;
+    {
+        TG_PROFILE_SCOPE("shard_stitch", (double)s.width * s.height);
+        ChunkGenerator stitched = [&](World& chunk, int originX, int originY) {
+            const int shard = originY / s.shardRows;
+            const int chunkY = (originY - shard * s.shardRows) / s.chunkSize;
+            std::shared_ptr<const BandFlow> band = loadBand(originY / FLOW_BAND_ROWS);
+            if (!band->ok || !archives[shard]->readChunk(originX / s.chunkSize, chunkY, chunk)) {
+                corrupt = true;
+                return;
+            }
+
+            // Rivers on land from the full accumulation
+            const int w = std::min(chunk.getWidth(), s.width - originX);
+            const int h = std::min(chunk.getHeight(), s.height - originY);
+            const int bandY = originY % FLOW_BAND_ROWS;
+            for (int y = 0; y < h; ++y) {
+                const float* accumulation = band->accumulation.data() + (size_t)(bandY + y) * s.width + originX;
+                const Biome* biomes = chunk.biomePlane().row(y);
+                float* rivers = chunk.riverPlane().row(y);
+                for (int x = 0; x < w; ++x) {
+                    if (biomes[x] != Biome::Ocean && biomes[x] != Biome::Beach && accumulation[x] > s.riverThreshold) {
+                        rivers[x] = RiverGenerator::riverStrength(accumulation[x], s.riverThreshold);
+                    }
+                }
+            }
+        };
+        written = saveWorldArchive(outPath, s.width, s.height, s.chunkSize, stitched, m_threadCount);
+    }
+    current.reset();
+
+    if (!keepShards) {
+        for (int shard = 0; shard < shards; ++shard) {
+            flows[shard].reset();
+            archives[shard].reset();
+            std::filesystem::remove(shardJobPath(directory, shard), fsError);
+            std::filesystem::remove(shardArchivePath(directory, shard), fsError);
+            std::filesystem::remove(shardFlowPath(directory, shard), fsError);
+        }
+        std::filesystem::remove(directory, fsError);
+    }
+
+    if (corrupt) return fail("a shard file failed to read back");
+    if (!written) return fail("cannot write " + outPath);
+    return true;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "ShardLauncher.h"
+#include "noise/NoiseBackend.h"
+#include <string>
+
+// Multi-process generation of maps too large for one machine's memory.
+//
+// The map is cut into shards of full-width row strips. A worker generates
+// its shard plus a one-row halo above and below (enough for the D8 flow
+// directions at the shard edge), runs the local flow accumulation pass on
+// every FLOW_BAND_ROWS band of it and writes two files:
+//
+//     shard_K.tgw   the shard's tiles, a WorldArchive
+//     shard_K.flow  per band: flow directions, local accumulation and the
+//                   band edges (see FlowBandEdges)
+//
+// The coordinator then resolves the flow crossing every band edge, shard
+// boundaries included, and streams the final archive band by band: each
+// band gets its inflow added, rivers are set from the full accumulation and
+// the shard chunks are copied through. Bands line up with those of
+// accumulateFlow, so the result matches single-process generation
+//
+//     TerrainGenerator::generate
+//     RiverGenerator::calculateFlowDirections
+//     RiverGenerator::accumulateFlow(moistureInfluence)
+//     RiverGenerator::applyRiverStrength(riverThreshold)
+//
+// bit for bit. Rivers are catchment rivers without depression filling;
+// lakes, erosion, roads and custom biome rules need the whole map and are
+// not available here.
+//
+// Workers only read their job file and write to the job directory, so with
+// a shared directory they can run on other hosts (see ProcessLauncher).
+// Map indices are 64-bit. The coordinator holds the band edges of the whole
+// map while resolving them (a few hundred MB at 65536 x 65536), then one
+// band of flow data and one row of chunks at a time; a worker holds
+// width x (shardRows + 2) tiles.
+
+struct ShardSettings {
+    int width = 1024;
+    int height = 1024;
+    unsigned int seed = 0;
+    std::string recipe = "continent";          // TerrainRecipe::byName
+    noise::NoiseBackend noise = noise::NoiseBackend::Perlin;
+    float riverThreshold = 0.002f;
+    float moistureInfluence = 0.5f;
+    int shardRows = 1024;                      // rounded up to a multiple of FLOW_BAND_ROWS
+    int threadsPerShard = 0;                   // 0 = all hardware threads
+    int chunkSize = 256;                       // archive chunks; must divide FLOW_BAND_ROWS
+};
+
+// One worker's share of the map, stored as a text file of "key value" lines
+struct ShardJob {
+    ShardSettings settings;
+    int shard = 0;
+    std::string directory;
+
+    bool save(const std::string& path) const;
+    bool load(const std::string& path, std::string* error = nullptr);
+};
+
+// Paths of a shard's files in directory
+std::string shardJobPath(const std::string& directory, int shard);
+std::string shardArchivePath(const std::string& directory, int shard);
+std::string shardFlowPath(const std::string& directory, int shard);
+
+// Worker side: generates the shard described by the job file
+bool runShardJob(const std::string& jobPath, std::string* error = nullptr);
+
+// Call first thing in main(): if the arguments are "--shard-worker JOB",
+// runs the job, sets exitCode and returns true
+bool handleShardWorker(int argc, char** argv, int& exitCode);
+
+class ShardedGenerator {
+public:
+    ShardedGenerator(const ShardSettings& settings, ShardLauncher& launcher);
+
+    int getShardCount() const;
+    int getShardRows() const;
+
+    // Threads for stitching on the coordinator; 0 = all hardware threads
+    void setThreadCount(int threadCount);
+
+    // Runs the shards in directory (created if needed) and writes the
+    // stitched map to outPath. The shard files are deleted afterwards
+    // (and directory, if that leaves it empty) unless keepShards is set.
+    bool generate(const std::string& directory, const std::string& outPath, bool keepShards = false);
+
+    // Why the last generate() failed
+    const std::string& getError() const;
+
+private:
+    ShardSettings m_settings;
+    ShardLauncher& m_launcher;
+    std::string m_error;
+    int m_threadCount = 0;
+
+    bool fail(const std::string& message);
+};
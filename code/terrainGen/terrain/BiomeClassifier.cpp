@@ -0,0 +1,267 @@
+#include "BiomeClassifier.h"
+#include "BiomeClassifierSimd.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace {
+
+const char* const BIOME_NAMES[] = {
+    "Ocean", "Beach", "Plains", "Forest", "Desert", "Tundra", "Mountain", "Swamp"
+};
+const int BIOME_COUNT = sizeof(BIOME_NAMES) / sizeof(BIOME_NAMES[0]);
+
+const char* const AXIS_NAMES[] = { "height", "moisture", "temperature" };
+const char* const COMPARE_NAMES[] = { "<", "<=", ">", ">=" };
+
+BiomeCondition condition(BiomeAxis axis, BiomeCompare op, float value) {
+    return BiomeCondition{ axis, op, value };
+}
+
+// Every comparison as a ">= edge" test: a > c is a >= next float above c,
+// and < / <= are the negations of >= / >
+float edgeOf(const BiomeCondition& c) {
+    if (c.op == BiomeCompare::Greater || c.op == BiomeCompare::LessEqual) {
+        return std::nextafter(c.value, std::numeric_limits<float>::infinity());
+    }
+    return c.value;
+}
+
+} // namespace
+
+const char* biomeName(Biome biome) {
+    int index = (int)biome;
+    return index < BIOME_COUNT ? BIOME_NAMES[index] : "Unknown";
+}
+
+bool parseBiomeName(const std::string& name, Biome& biome) {
+    for (int i = 0; i < BIOME_COUNT; ++i) {
+        if (name == BIOME_NAMES[i]) {
+            biome = (Biome)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---------------- RULE SET ----------------
+
+bool BiomeCondition::holds(float height, float moisture, float temperature) const {
+    const float v = axis == BiomeAxis::Height ? height : axis == BiomeAxis::Moisture ? moisture : temperature;
+    switch (op) {
+    case BiomeCompare::Less:         return v < value;
+    case BiomeCompare::LessEqual:    return v <= value;
+    case BiomeCompare::Greater:      return v > value;
+    case BiomeCompare::GreaterEqual: return v >= value;
+    }
+    return false;
+}
+
+BiomeRuleSet BiomeRuleSet::fromRules(const BiomeRules& r) {
+    const BiomeAxis H = BiomeAxis::Height;
+    const BiomeAxis M = BiomeAxis::Moisture;
+    const BiomeAxis T = BiomeAxis::Temperature;
+    const BiomeCompare LT = BiomeCompare::Less;
+    const BiomeCompare GT = BiomeCompare::Greater;
+
+    // Same order as the branches of TerrainGenerator::determineBiome
+    BiomeRuleSet set;
+    set.addRule({ Biome::Ocean, { condition(H, LT, r.oceanLevel) } });
+    set.addRule({ Biome::Beach, { condition(H, LT, r.beachLevel) } });
+    set.addRule({ Biome::Tundra, { condition(H, GT, r.mountainLevel), condition(H, GT, r.snowLevel), condition(T, LT, r.snowTemperature) } });
+    set.addRule({ Biome::Mountain, { condition(H, GT, r.mountainLevel) } });
+    set.addRule({ Biome::Tundra, { condition(T, LT, r.polarTemperature) } });
+    set.addRule({ Biome::Forest, { condition(T, LT, r.coolTemperature), condition(M, GT, r.borealForestMoisture) } });
+    set.addRule({ Biome::Plains, { condition(T, LT, r.coolTemperature) } });
+    set.addRule({ Biome::Forest, { condition(T, LT, r.temperateTemperature), condition(M, GT, r.temperateForestMoisture) } });
+    set.addRule({ Biome::Plains, { condition(T, LT, r.temperateTemperature) } });
+    set.addRule({ Biome::Desert, { condition(M, LT, r.desertMoisture) } });
+    set.addRule({ Biome::Plains, { condition(M, LT, r.tropicalForestMoisture) } });
+    set.addRule({ Biome::Forest, {} });
+    return set;
+}
+
+bool BiomeRuleSet::parse(const std::string& text, std::string* error) {
+    std::vector<BiomeRule> rules;
+    std::istringstream lines(text);
+    std::string line;
+    int lineNumber = 0;
+
+    auto fail = [&](const std::string& message) {
+        if (error) *error = "line " + std::to_string(lineNumber) + ": " + message;
+        return false;
+    };
+
+    while (std::getline(lines, line)) {
+        ++lineNumber;
+        line = line.substr(0, line.find('#'));
+
+        std::istringstream tokens(line);
+        std::string name;
+        if (!(tokens >> name)) continue;
+
+        BiomeRule rule;
+        if (!parseBiomeName(name, rule.biome)) return fail("unknown biome '" + name + "'");
+
+        std::string axis, op;
+        while (tokens >> axis) {
+            BiomeCondition c;
+            int a = 0;
+            while (a < 3 && axis != AXIS_NAMES[a]) ++a;
+            if (a == 3) return fail("unknown axis '" + axis + "'");
+            c.axis = (BiomeAxis)a;
+
+            if (!(tokens >> op)) return fail("missing comparison after '" + axis + "'");
+            int o = 0;
+            while (o < 4 && op != COMPARE_NAMES[o]) ++o;
+            if (o == 4) return fail("unknown comparison '" + op + "'");
+            c.op = (BiomeCompare)o;
+
+            if (!(tokens >> c.value) || !std::isfinite(c.value)) return fail("missing or invalid value after '" + op + "'");
+            rule.conditions.push_back(c);
+        }
+        rules.push_back(rule);
+    }
+
+    if (rules.empty()) {
+        if (error) *error = "no rules";
+        return false;
+    }
+    m_rules.swap(rules);
+    return true;
+}
+
+bool BiomeRuleSet::load(const std::string& path, std::string* error) {
+    std::ifstream file(path);
+    if (!file) {
+        if (error) *error = "cannot open " + path;
+        return false;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    return parse(text.str(), error);
+}
+
+std::string BiomeRuleSet::toText() const {
+    std::string text;
+    char value[32];
+    for (const BiomeRule& rule : m_rules) {
+        text += biomeName(rule.biome);
+        for (const BiomeCondition& c : rule.conditions) {
+            // Shortest form that reads back as the same float
+            for (int digits = 6; digits <= 9; ++digits) {
+                std::snprintf(value, sizeof(value), "%.*g", digits, c.value);
+                if (std::strtof(value, nullptr) == c.value) break;
+            }
+            text += std::string(" ") + AXIS_NAMES[(int)c.axis] + " " + COMPARE_NAMES[(int)c.op] + " " + value;
+        }
+        text += "\n";
+    }
+    return text;
+}
+
+Biome BiomeRuleSet::classify(float height, float moisture, float temperature) const {
+    for (const BiomeRule& rule : m_rules) {
+        bool match = true;
+        for (const BiomeCondition& c : rule.conditions) {
+            if (!c.holds(height, moisture, temperature)) {
+                match = false;
+                break;
+            }
+        }
+        if (match) return rule.biome;
+    }
+    return Biome::Ocean;
+}
+
+// ---------------- CLASSIFIER ----------------
+
+BiomeClassifier::BiomeClassifier() : BiomeClassifier(BiomeRules()) {}
+
+BiomeClassifier::BiomeClassifier(const BiomeRules& rules) : BiomeClassifier(BiomeRuleSet::fromRules(rules)) {}
+
+BiomeClassifier::BiomeClassifier(const BiomeRuleSet& rules) {
+    setRules(rules);
+}
+
+void BiomeClassifier::setRules(const BiomeRuleSet& rules) {
+    for (std::vector<float>& edges : m_edges) edges.clear();
+    for (const BiomeRule& rule : rules.getRules()) {
+        for (const BiomeCondition& c : rule.conditions) {
+            m_edges[(int)c.axis].push_back(edgeOf(c));
+        }
+    }
+    for (std::vector<float>& edges : m_edges) {
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+    }
+
+    // One value per interval: the interval's lower edge, or just below the
+    // first edge. Every condition is constant across an interval, so the
+    // rules give the same biome for any value in it.
+    std::vector<float> samples[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        const std::vector<float>& edges = m_edges[axis];
+        samples[axis].push_back(edges.empty() ? 0.0f : std::nextafter(edges[0], -std::numeric_limits<float>::infinity()));
+        samples[axis].insert(samples[axis].end(), edges.begin(), edges.end());
+    }
+
+    m_table.clear();
+    m_table.reserve(samples[0].size() * samples[1].size() * samples[2].size());
+    for (float h : samples[0]) {
+        for (float m : samples[1]) {
+            for (float t : samples[2]) {
+                m_table.push_back((int32_t)rules.classify(h, m, t));
+            }
+        }
+    }
+}
+
+int BiomeClassifier::interval(int axis, float value) const {
+    int index = 0;
+    for (float edge : m_edges[axis]) index += value >= edge;
+    return index;
+}
+
+Biome BiomeClassifier::classify(float height, float moisture, float temperature) const {
+    const size_t moistureCells = m_edges[1].size() + 1;
+    const size_t temperatureCells = m_edges[2].size() + 1;
+    const size_t cell = ((size_t)interval(0, height) * moistureCells + interval(1, moisture)) * temperatureCells
+        + interval(2, temperature);
+    return (Biome)m_table[cell];
+}
+
+void BiomeClassifier::classify(const float* heights, const float* moistures, const float* temperatures,
+    Biome* out, size_t count) const {
+    classify(heights, moistures, temperatures, out, count, PerlinNoise::bestSimdLevel());
+}
+
+void BiomeClassifier::classify(const float* heights, const float* moistures, const float* temperatures,
+    Biome* out, size_t count, SimdLevel level) const {
+    level = std::min(level, PerlinNoise::bestSimdLevel());
+
+    BiomeSimd::Table table;
+    for (int axis = 0; axis < 3; ++axis) {
+        table.edges[axis] = m_edges[axis].data();
+        table.edgeCounts[axis] = (int)m_edges[axis].size();
+    }
+    table.cells = m_table.data();
+    table.heightStride = (int)((m_edges[1].size() + 1) * (m_edges[2].size() + 1));
+    table.moistureStride = (int)(m_edges[2].size() + 1);
+
+    size_t done = 0;
+    if (level == SimdLevel::AVX2) {
+        done = BiomeSimd::classifyAvx2(table, heights, moistures, temperatures, out, count);
+    }
+    else if (level == SimdLevel::SSE41) {
+        done = BiomeSimd::classifySse41(table, heights, moistures, temperatures, out, count);
+    }
+
+    for (size_t i = done; i < count; ++i) {
+        out[i] = classify(heights[i], moistures[i], temperatures[i]);
+    }
+}
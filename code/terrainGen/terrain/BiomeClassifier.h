@@ -0,0 +1,101 @@
+#pragma once
+
+#include "BiomeRules.h"
+#include "noise/PerlinNoise.h"
+#include "world/Tile.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Data-driven biome rules and the lookup table they compile to.
+//
+// A BiomeRuleSet is an ordered list of rules; the first rule whose
+// conditions all hold decides the biome. As text, one rule per line:
+//
+//     # biome    conditions (axis op value), all must hold
+//     Ocean      height < 0.42
+//     Tundra     height > 0.78  temperature < 0.4
+//     Swamp      moisture >= 0.8  temperature > 0.5
+//     Forest     # no conditions: always matches
+//
+// Axes are height, moisture and temperature; ops are <, <=, > and >=.
+//
+// BiomeClassifier compiles a rule set into a 3D table indexed by which
+// side of every threshold a tile falls on. Thresholds only change the
+// result where a value crosses them, so the table reproduces the rules
+// exactly, and classifying is three short compare chains and one lookup
+// per tile instead of a branch tree. Not defined for NaN inputs.
+
+enum class BiomeAxis : uint8_t { Height, Moisture, Temperature };
+enum class BiomeCompare : uint8_t { Less, LessEqual, Greater, GreaterEqual };
+
+struct BiomeCondition {
+    BiomeAxis axis;
+    BiomeCompare op;
+    float value;
+
+    bool holds(float height, float moisture, float temperature) const;
+};
+
+struct BiomeRule {
+    Biome biome;
+    std::vector<BiomeCondition> conditions;
+};
+
+class BiomeRuleSet {
+public:
+    // The built-in rules of TerrainGenerator::determineBiome
+    static BiomeRuleSet fromRules(const BiomeRules& rules);
+
+    // Parses the text format above; on failure returns false and describes
+    // the first bad line in error (if given)
+    bool parse(const std::string& text, std::string* error = nullptr);
+    bool load(const std::string& path, std::string* error = nullptr);
+    std::string toText() const;
+
+    // Reference evaluation: first matching rule, Ocean if none matches
+    Biome classify(float height, float moisture, float temperature) const;
+
+    const std::vector<BiomeRule>& getRules() const { return m_rules; }
+    void addRule(const BiomeRule& rule) { m_rules.push_back(rule); }
+
+private:
+    std::vector<BiomeRule> m_rules;
+};
+
+class BiomeClassifier {
+public:
+    // Default: the built-in rules with default thresholds
+    BiomeClassifier();
+    explicit BiomeClassifier(const BiomeRuleSet& rules);
+    explicit BiomeClassifier(const BiomeRules& rules);
+
+    // Recompiles the table
+    void setRules(const BiomeRuleSet& rules);
+
+    Biome classify(float height, float moisture, float temperature) const;
+
+    // out[i] = classify(heights[i], moistures[i], temperatures[i]) for a
+    // whole run of tiles, on the best SIMD path the CPU supports
+    void classify(const float* heights, const float* moistures, const float* temperatures,
+        Biome* out, size_t count) const;
+
+    // Same on an explicit path (clamped to what the CPU supports)
+    void classify(const float* heights, const float* moistures, const float* temperatures,
+        Biome* out, size_t count, SimdLevel level) const;
+
+    // Table cells (intervals per axis multiplied)
+    size_t getTableSize() const { return m_table.size(); }
+
+private:
+    // Tile value v lies in interval sum(v >= edge) of its axis
+    std::vector<float> m_edges[3];
+    std::vector<int32_t> m_table; // biome per (height, moisture, temperature) interval
+
+    int interval(int axis, float value) const;
+};
+
+// Name used in rule files ("Ocean", "Beach", ...)
+const char* biomeName(Biome biome);
+bool parseBiomeName(const std::string& name, Biome& biome);
@@ -0,0 +1,85 @@
+#include "BiomeClassifierSimd.h"
+#include "noise/PerlinNoiseSimd.h"
+
+#ifdef TG_NOISE_X86
+
+#include <immintrin.h>
+
+namespace {
+
+// Each reached edge turns a lane of the mask to all ones (-1), so
+// subtracting the masks counts them
+TG_TARGET_SSE41 inline __m128i interval4(__m128 v, const float* edges, int edgeCount) {
+    __m128i index = _mm_setzero_si128();
+    for (int e = 0; e < edgeCount; ++e) {
+        __m128 reached = _mm_cmpge_ps(v, _mm_set1_ps(edges[e]));
+        index = _mm_sub_epi32(index, _mm_castps_si128(reached));
+    }
+    return index;
+}
+
+TG_TARGET_AVX2 inline __m256i interval8(__m256 v, const float* edges, int edgeCount) {
+    __m256i index = _mm256_setzero_si256();
+    for (int e = 0; e < edgeCount; ++e) {
+        __m256 reached = _mm256_cmp_ps(v, _mm256_set1_ps(edges[e]), _CMP_GE_OQ);
+        index = _mm256_sub_epi32(index, _mm256_castps_si256(reached));
+    }
+    return index;
+}
+
+} // namespace
+
+namespace BiomeSimd {
+
+TG_TARGET_SSE41 size_t classifySse41(const Table& table, const float* heights, const float* moistures,
+    const float* temperatures, Biome* out, size_t count) {
+    const __m128i heightStride = _mm_set1_epi32(table.heightStride);
+    const __m128i moistureStride = _mm_set1_epi32(table.moistureStride);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i h = interval4(_mm_loadu_ps(heights + i), table.edges[0], table.edgeCounts[0]);
+        __m128i m = interval4(_mm_loadu_ps(moistures + i), table.edges[1], table.edgeCounts[1]);
+        __m128i t = interval4(_mm_loadu_ps(temperatures + i), table.edges[2], table.edgeCounts[2]);
+        __m128i cell = _mm_add_epi32(_mm_add_epi32(_mm_mullo_epi32(h, heightStride), _mm_mullo_epi32(m, moistureStride)), t);
+
+        // No gather before AVX2
+        out[i + 0] = (Biome)table.cells[_mm_extract_epi32(cell, 0)];
+        out[i + 1] = (Biome)table.cells[_mm_extract_epi32(cell, 1)];
+        out[i + 2] = (Biome)table.cells[_mm_extract_epi32(cell, 2)];
+        out[i + 3] = (Biome)table.cells[_mm_extract_epi32(cell, 3)];
+    }
+    return i;
+}
+
+TG_TARGET_AVX2 size_t classifyAvx2(const Table& table, const float* heights, const float* moistures,
+    const float* temperatures, Biome* out, size_t count) {
+    const __m256i heightStride = _mm256_set1_epi32(table.heightStride);
+    const __m256i moistureStride = _mm256_set1_epi32(table.moistureStride);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i h = interval8(_mm256_loadu_ps(heights + i), table.edges[0], table.edgeCounts[0]);
+        __m256i m = interval8(_mm256_loadu_ps(moistures + i), table.edges[1], table.edgeCounts[1]);
+        __m256i t = interval8(_mm256_loadu_ps(temperatures + i), table.edges[2], table.edgeCounts[2]);
+        __m256i cell = _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(h, heightStride), _mm256_mullo_epi32(m, moistureStride)), t);
+        __m256i biome = _mm256_i32gather_epi32((const int*)table.cells, cell, 4);
+
+        // 8 x int32 -> 8 bytes (cells are < 256)
+        __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(biome), _mm256_extracti128_si256(biome, 1));
+        __m128i bytes = _mm_packus_epi16(words, words);
+        _mm_storel_epi64((__m128i*)(out + i), bytes);
+    }
+    return i;
+}
+
+} // namespace BiomeSimd
+
+#else
+
+namespace BiomeSimd {
+    size_t classifySse41(const Table&, const float*, const float*, const float*, Biome*, size_t) { return 0; }
+    size_t classifyAvx2(const Table&, const float*, const float*, const float*, Biome*, size_t) { return 0; }
+}
+
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "world/Tile.h"
+#include <cstddef>
+#include <cstdint>
+
+// SIMD kernels behind BiomeClassifier::classify.
+// Each kernel processes whole vectors only and returns how many tiles it
+// wrote; the caller finishes the tail with the scalar path.
+
+namespace BiomeSimd {
+    // A compiled BiomeClassifier: cell = h * heightStride + m * moistureStride + t,
+    // where each index counts the edges of its axis that the value reaches
+    struct Table {
+        const float* edges[3];
+        int edgeCounts[3];
+        const int32_t* cells;
+        int heightStride;
+        int moistureStride;
+    };
+
+    size_t classifySse41(const Table& table, const float* heights, const float* moistures,
+        const float* temperatures, Biome* out, size_t count);
+
+    size_t classifyAvx2(const Table& table, const float* heights, const float* moistures,
+        const float* temperatures, Biome* out, size_t count);
+}
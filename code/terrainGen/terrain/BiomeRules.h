@@ -0,0 +1,18 @@
+#pragma once
+
+// Thresholds used by TerrainGenerator::determineBiome.
+// The defaults are the original hand-tuned values.
+struct BiomeRules {
+    float oceanLevel = 0.42f;              // Bigger oceans - raised threshold
+    float beachLevel = 0.47f;              // Narrow beach zone
+    float mountainLevel = 0.68f;           // More mountains - lowered threshold
+    float snowLevel = 0.78f;               // Snow caps on very tall mountains...
+    float snowTemperature = 0.4f;          // ...in cold areas
+    float polarTemperature = 0.25f;        // Cold regions (polar/high latitude)
+    float coolTemperature = 0.45f;         // Temperate cold
+    float temperateTemperature = 0.65f;    // Temperate, hot above
+    float borealForestMoisture = 0.55f;    // Boreal/Taiga forest
+    float temperateForestMoisture = 0.6f;  // Temperate forest
+    float desertMoisture = 0.25f;          // Hot desert below
+    float tropicalForestMoisture = 0.45f;  // Savanna/dry grassland below
+};
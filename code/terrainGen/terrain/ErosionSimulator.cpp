@@ -0,0 +1,279 @@
+#include "ErosionSimulator.h"
+#include "util/Profiler.h"
+#include "util/Random.h"
+#include "world/Stencil.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+namespace {
+
+// Edge of the blocks droplets are grouped by. A block plus its halo is
+// about 120 tiles square, 56 KB of heights, so a block's droplets run in L2.
+const int BLOCK_SIZE = 64;
+
+const int MAX_BRUSH_RADIUS = 8;
+
+// Droplet counter reserved for the grid shift of each batch
+const uint32_t SHIFT_COUNTER = 0xFFFFFFFFu;
+
+const float SQRT2 = 1.41421356f;
+
+// Height difference beyond the talus, signed; 0 within it
+inline float excessSlope(float difference, float talus) {
+    if (difference > talus) return difference - talus;
+    if (difference < -talus) return difference + talus;
+    return 0.0f;
+}
+
+} // namespace
+
+ErosionSimulator::ErosionSimulator(World& world, unsigned int seed)
+    : m_world(world),
+    m_seed(seed),
+    m_pool(new ThreadPool())
+{
+}
+
+void ErosionSimulator::setThreadCount(int threadCount) {
+    if (threadCount <= 0) threadCount = ThreadPool::hardwareThreads();
+    if (threadCount == m_pool->getThreadCount()) return;
+    m_pool.reset(new ThreadPool(threadCount));
+}
+
+int ErosionSimulator::getThreadCount() const {
+    return m_pool->getThreadCount();
+}
+
+void ErosionSimulator::setSeed(unsigned int seed) {
+    m_seed = seed;
+}
+
+void ErosionSimulator::setCancelFlag(const std::atomic<bool>* cancel) {
+    m_cancel = cancel;
+}
+
+bool ErosionSimulator::cancelled() const {
+    return m_cancel && m_cancel->load(std::memory_order_relaxed);
+}
+
+void ErosionSimulator::erode(const ErosionSettings& settings) {
+    erodeHydraulic(settings);
+    erodeThermal(settings);
+}
+
+size_t ErosionSimulator::getMemoryUsage() const {
+    return m_buffer.getMemoryUsage();
+}
+
+// ---------------- HYDRAULIC ----------------
+
+size_t ErosionSimulator::erodeHydraulic(const ErosionSettings& settings) {
+    const int width = m_world.getWidth();
+    const int height = m_world.getHeight();
+    if (width < 2 || height < 2 || settings.dropletsPerTile <= 0.0f || settings.maxLifetime <= 0) return 0;
+    TG_PROFILE_SCOPE("erosion_hydraulic", (double)width * height);
+
+    // Weight of every tile closer than the radius falls off linearly
+    const int radius = std::max(1, std::min(MAX_BRUSH_RADIUS, settings.brushRadius));
+    Brush brush;
+    float weightSum = 0.0f;
+    for (int dy = -radius + 1; dy < radius; ++dy) {
+        for (int dx = -radius + 1; dx < radius; ++dx) {
+            const float weight = radius - std::sqrt((float)(dx * dx + dy * dy));
+            if (weight <= 0.0f) continue;
+            brush.dx[brush.count] = dx;
+            brush.dy[brush.count] = dy;
+            brush.offset[brush.count] = dy * width + dx;
+            brush.weight[brush.count] = weight;
+            weightSum += weight;
+            brush.count++;
+        }
+    }
+    for (int i = 0; i < brush.count; ++i) brush.weight[i] /= weightSum;
+
+    // Same-coloured blocks are one block apart; neither droplet reaches
+    // further than halo + radius past its block, so their tiles never meet
+    const int halo = BLOCK_SIZE / 2 - radius - 1;
+    const float scale = std::max(width, height) / 256.0f;
+    const int batches = std::max(1, settings.batches);
+    const double density = (double)settings.dropletsPerTile / batches;
+    const CounterRng rng(m_seed, RandomStream::Erosion);
+
+    size_t droplets = 0;
+    for (int batch = 0; batch < batches && !cancelled(); ++batch) {
+        droplets += (size_t)((double)width * height * density);
+
+        const int shiftX = (int)rng.below(BLOCK_SIZE, SHIFT_COUNTER, batch, 0);
+        const int shiftY = (int)rng.below(BLOCK_SIZE, SHIFT_COUNTER, batch, 1);
+        const int blocksX = (width + shiftX + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        const int blocksY = (height + shiftY + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+        for (int colour = 0; colour < 4 && !cancelled(); ++colour) {
+            const int colourX = colour & 1;
+            const int colourY = colour >> 1;
+            const int columns = (blocksX - colourX + 1) / 2;
+            const int rows = (blocksY - colourY + 1) / 2;
+
+            m_pool->parallelFor(columns * rows, [&](int i) {
+                if (cancelled()) return;
+                const int bx = colourX + 2 * (i % columns);
+                const int by = colourY + 2 * (i / columns);
+                const int x0 = std::max(0, bx * BLOCK_SIZE - shiftX);
+                const int y0 = std::max(0, by * BLOCK_SIZE - shiftY);
+                const int x1 = std::min(width, (bx + 1) * BLOCK_SIZE - shiftX);
+                const int y1 = std::min(height, (by + 1) * BLOCK_SIZE - shiftY);
+
+                // Cells keep one tile clear of the right and bottom edge
+                // for the bilinear samples
+                const Bounds bounds{
+                    std::max(0, x0 - halo), std::max(0, y0 - halo),
+                    std::min(width - 1, x1 + halo), std::min(height - 1, y1 + halo) };
+
+                // The batch's droplets are numbered through the blocks in
+                // row-major order, so every droplet keeps its number however
+                // the blocks are scheduled
+                const double before = (double)y0 * width + (double)(y1 - y0) * x0;
+                const double area = (double)(x1 - x0) * (y1 - y0);
+                const uint32_t first = (uint32_t)(before * density);
+                const uint32_t last = (uint32_t)((before + area) * density);
+
+                for (uint32_t droplet = first; droplet < last; ++droplet) {
+                    const float x = x0 + rng.uniform(droplet, batch, 0) * (x1 - x0);
+                    const float y = y0 + rng.uniform(droplet, batch, 1) * (y1 - y0);
+                    if ((int)x >= bounds.x1 || (int)y >= bounds.y1) continue;
+                    runDroplet(settings, brush, bounds, x, y, scale);
+                }
+            });
+        }
+    }
+    return droplets;
+}
+
+void ErosionSimulator::runDroplet(const ErosionSettings& settings, const Brush& brush, const Bounds& bounds,
+    float x, float y, float scale) {
+    const int width = m_world.getWidth();
+    const int height = m_world.getHeight();
+    float* heights = m_world.heightPlane().data();
+    const float inverseScale = 1.0f / scale;
+    const int reach = MAX_BRUSH_RADIUS;
+
+    // Height (in simulation units) and gradient at (x, y) from the four
+    // tiles around it
+    auto sample = [&](float px, float py, float& gradientX, float& gradientY) {
+        const int cx = (int)px;
+        const int cy = (int)py;
+        const float u = px - cx;
+        const float v = py - cy;
+        const float* h = heights + (size_t)cy * width + cx;
+        const float h00 = h[0] * scale;
+        const float h10 = h[1] * scale;
+        const float h01 = h[width] * scale;
+        const float h11 = h[width + 1] * scale;
+        gradientX = (h10 - h00) * (1.0f - v) + (h11 - h01) * v;
+        gradientY = (h01 - h00) * (1.0f - u) + (h11 - h10) * u;
+        return h00 * (1.0f - u) * (1.0f - v) + h10 * u * (1.0f - v) + h01 * (1.0f - u) * v + h11 * u * v;
+    };
+
+    float dirX = 0.0f;
+    float dirY = 0.0f;
+    float speed = 1.0f;
+    float water = 1.0f;
+    float sediment = 0.0f;
+
+    for (int step = 0; step < settings.maxLifetime; ++step) {
+        const int cx = (int)x;
+        const int cy = (int)y;
+        const float u = x - cx;
+        const float v = y - cy;
+
+        float gradientX, gradientY;
+        const float current = sample(x, y, gradientX, gradientY);
+
+        // Downhill, bent by the direction the droplet already had
+        dirX = dirX * settings.inertia - gradientX * (1.0f - settings.inertia);
+        dirY = dirY * settings.inertia - gradientY * (1.0f - settings.inertia);
+        const float length = std::sqrt(dirX * dirX + dirY * dirY);
+        if (length < 1e-12f) break;
+        dirX /= length;
+        dirY /= length;
+        x += dirX;
+        y += dirY;
+        if (x < bounds.x0 || y < bounds.y0 || x >= bounds.x1 || y >= bounds.y1) break;
+
+        float ignoredX, ignoredY;
+        const float deltaHeight = sample(x, y, ignoredX, ignoredY) - current;
+        const float capacity = std::max(-deltaHeight, settings.minSedimentCapacity)
+            * speed * water * settings.sedimentCapacity;
+
+        float* cell = heights + (size_t)cy * width + cx;
+        if (sediment > capacity || deltaHeight > 0.0f) {
+            // Uphill: fill the pit behind up to the new height. Otherwise
+            // drop part of what is over capacity. Both spread over the four
+            // tiles around the old position.
+            const float amount = deltaHeight > 0.0f ? std::min(deltaHeight, sediment)
+                : (sediment - capacity) * settings.depositSpeed;
+            sediment -= amount;
+            const float deposit = amount * inverseScale;
+            cell[0] += deposit * (1.0f - u) * (1.0f - v);
+            cell[1] += deposit * u * (1.0f - v);
+            cell[width] += deposit * (1.0f - u) * v;
+            cell[width + 1] += deposit * u * v;
+        }
+        else {
+            // Never dig deeper than the descent, so no pits are cut
+            const float amount = std::min((capacity - sediment) * settings.erodeSpeed, -deltaHeight);
+            const bool inside = cx >= reach && cy >= reach && cx < width - reach && cy < height - reach;
+            for (int i = 0; i < brush.count; ++i) {
+                if (!inside) {
+                    const int bx = cx + brush.dx[i];
+                    const int by = cy + brush.dy[i];
+                    if (bx < 0 || by < 0 || bx >= width || by >= height) continue;
+                }
+                float& tile = cell[brush.offset[i]];
+                const float removed = std::min(tile * scale, amount * brush.weight[i]);
+                tile -= removed * inverseScale;
+                sediment += removed;
+            }
+        }
+
+        speed = std::sqrt(std::max(0.0f, speed * speed - deltaHeight * settings.gravity));
+        water *= 1.0f - settings.evaporateSpeed;
+    }
+}
+
+// ---------------- THERMAL ----------------
+
+void ErosionSimulator::erodeThermal(const ErosionSettings& settings) {
+    const int width = m_world.getWidth();
+    const int height = m_world.getHeight();
+    if (settings.thermalIterations <= 0 || settings.thermalRate <= 0.0f) return;
+    TG_PROFILE_SCOPE("erosion_thermal", (double)width * height * settings.thermalIterations);
+
+    if (m_buffer.getWidth() != width || m_buffer.getHeight() != height) {
+        m_buffer = Plane<float>(width, height);
+    }
+
+    // Every neighbour pair trades the same amount in opposite directions,
+    // so each pass keeps the total height and only writes its own tile
+    const float scale = std::max(width, height) / 256.0f;
+    const float talus = settings.talus / scale;
+    const float diagonalTalus = talus * SQRT2;
+    const float rate = std::min(settings.thermalRate, 1.0f / 16.0f);
+
+    for (int iteration = 0; iteration < settings.thermalIterations && !cancelled(); ++iteration) {
+        const float* source = m_world.heightPlane().data();
+        float* target = m_buffer.data();
+        forEachStencil(width, height, m_pool.get(), [&](const auto& cell) {
+            const float h = source[cell.idx];
+            float change = 0.0f;
+            for (int dir = 0; dir < 8; ++dir) {
+                if (!cell.has(dir)) continue;
+                change += excessSlope(source[cell.neighbour(dir)] - h, (dir & 1) ? diagonalTalus : talus);
+            }
+            target[cell.idx] = h + rate * change;
+        });
+        std::swap(m_world.heightPlane(), m_buffer);
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "util/ThreadPool.h"
+#include "world/Plane.h"
+#include "world/World.h"
+#include <atomic>
+#include <memory>
+
+// Hydraulic and thermal erosion of the height plane.
+//
+// Hydraulic: water droplets start at random tiles and run downhill, picking
+// up sediment where they speed up and dropping it where they slow down or
+// climb, which carves gullies and valleys and fills basins. Droplets run in
+// batches on a grid of 64-tile blocks. A droplet never leaves a halo around
+// its start block, and the blocks are coloured like a 2x2 checkerboard so
+// blocks of one colour are far enough apart that their droplets cannot
+// touch the same tile. The four colours run one after the other, the
+// blocks of a colour in parallel, each block's droplets in order. Each
+// batch shifts the block grid so droplets are not always cut off at the
+// same lines.
+//
+// Thermal: material slides from every tile to any neighbour lower than the
+// talus slope, in double-buffered stencil passes.
+//
+// Every random choice is keyed by (droplet, batch), so the result only
+// depends on the seed and the settings, not on the thread count.
+//
+// Heights are simulated as if the map were 256 tiles across, so the same
+// settings give the same look at every map size.
+
+struct ErosionSettings {
+    // Hydraulic
+    float dropletsPerTile = 0.25f; // Droplets per map tile over all batches
+    int batches = 4;              // Rounds over the map, each on a shifted block grid
+    int maxLifetime = 30;         // Steps before a droplet evaporates
+    float inertia = 0.05f;        // How much a droplet keeps its direction, 0..1
+    float sedimentCapacity = 4.0f;    // Sediment carried per unit of water, speed and descent
+    float minSedimentCapacity = 0.01f; // Floor on the descent, so flats still carry some
+    float erodeSpeed = 0.3f;      // Share of the free capacity picked up per step
+    float depositSpeed = 0.3f;    // Share of the excess sediment dropped per step
+    float evaporateSpeed = 0.01f; // Share of the water lost per step
+    float gravity = 4.0f;
+    int brushRadius = 3;          // Tiles a droplet erodes around it, 1..8
+
+    // Thermal
+    int thermalIterations = 8;
+    float talus = 0.02f;          // Steepest stable height difference per tile (of a 256 map)
+    float thermalRate = 0.05f;    // Share of the excess slope moved per pass, stable up to 1/16
+};
+
+class ErosionSimulator {
+public:
+    // seed keys the droplet start positions and the block grid shifts
+    ErosionSimulator(World& world, unsigned int seed = 0);
+
+    // Threads for the blocks and stencil passes; 0 = all hardware threads
+    void setThreadCount(int threadCount);
+    int getThreadCount() const;
+    void setSeed(unsigned int seed);
+
+    // While *cancel is set, remaining blocks and passes are skipped and the
+    // heights are left part-eroded. nullptr (default) disables the check.
+    void setCancelFlag(const std::atomic<bool>* cancel);
+
+    // Hydraulic then thermal erosion
+    void erode(const ErosionSettings& settings = ErosionSettings());
+
+    // Runs the droplets; returns how many ran
+    size_t erodeHydraulic(const ErosionSettings& settings = ErosionSettings());
+
+    void erodeThermal(const ErosionSettings& settings = ErosionSettings());
+
+    // Bytes of scratch kept between runs
+    size_t getMemoryUsage() const;
+
+private:
+    // Cells a droplet may sit in: its block plus the halo, inside the map
+    struct Bounds {
+        int x0, y0, x1, y1; // [x0, x1) x [y0, y1)
+    };
+
+    // Tiles eroded around a droplet's cell, weights summing to 1
+    struct Brush {
+        int count = 0;
+        int dx[289];
+        int dy[289];
+        int offset[289]; // dy * width + dx
+        float weight[289];
+    };
+
+    World& m_world;
+    unsigned int m_seed;
+    std::unique_ptr<ThreadPool> m_pool;
+    const std::atomic<bool>* m_cancel = nullptr;
+
+    Plane<float> m_buffer; // thermal pass output
+
+    bool cancelled() const;
+    void runDroplet(const ErosionSettings& settings, const Brush& brush, const Bounds& bounds,
+        float x, float y, float scale);
+};
@@ -0,0 +1,360 @@
+#include "FlowAccumulation.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+struct Band {
+    int begin; // first cell
+    int end;   // one past the last cell
+    int ordered;   // cells placed in topological order
+    int* exits;    // cells whose receiver lies in another band
+    int exitCount;
+};
+
+// One band-edge crossing: flow from exit cell into entry cell
+struct Crossing {
+    int entry;
+    int exit;
+    float amount;
+
+    bool operator<(const Crossing& other) const {
+        // Group by entry cell; the exit index breaks ties so sums are reproducible
+        return entry != other.entry ? entry < other.entry : exit < other.exit;
+    }
+};
+
+// Receiver of a cell, -1 for sinks
+inline int receiverOf(const int* flowDirection, const int* offsets, int cell) {
+    int dir = flowDirection[cell];
+    return dir < 0 ? -1 : cell + offsets[dir];
+}
+
+// Cells [begin, end) in upstream-first order (Kahn's algorithm, sources
+// first); returns how many were placed. Cells on a cycle are left out.
+int orderBand(const int* flowDirection, const int* offsets, int* pending, int* order, int begin, int end) {
+    for (int c = begin; c < end; ++c) pending[c] = 0;
+    for (int c = begin; c < end; ++c) {
+        int r = receiverOf(flowDirection, offsets, c);
+        if (r >= begin && r < end) ++pending[r];
+    }
+
+    int* queue = order + begin;
+    int head = 0;
+    int tail = 0;
+    for (int c = begin; c < end; ++c) {
+        if (pending[c] == 0) queue[tail++] = c;
+    }
+    while (head < tail) {
+        int c = queue[head++];
+        int r = receiverOf(flowDirection, offsets, c);
+        if (r >= begin && r < end && --pending[r] == 0) queue[tail++] = r;
+    }
+    return tail;
+}
+
+// Pass 1 on one band: rainfall plus everything upstream inside the band,
+// exitOf for every cell and the band's exit cells in ascending order
+void localPass(const int* flowDirection, const int* offsets, const float* rainfall, float* accumulation,
+    int* pending, int* order, int* exitOf, int begin, int end, int width, Band& band) {
+    for (int c = begin; c < end; ++c) accumulation[c] = rainfall[c];
+
+    const int* queue = order + begin;
+    const int ordered = orderBand(flowDirection, offsets, pending, order, begin, end);
+    for (int i = 0; i < ordered; ++i) {
+        int c = queue[i];
+        int r = receiverOf(flowDirection, offsets, c);
+        if (r >= begin && r < end) accumulation[r] += accumulation[c];
+    }
+    band.ordered = ordered;
+
+    // Downstream first: where does each cell's water leave the band? A band
+    // passed on its own has negative receivers for the row above it, so
+    // sinks are told apart by their direction.
+    for (int c = begin; c < end; ++c) exitOf[c] = -1;
+    for (int i = ordered - 1; i >= 0; --i) {
+        int c = queue[i];
+        if (flowDirection[c] < 0) continue;
+        int r = c + offsets[flowDirection[c]];
+        exitOf[c] = (r >= begin && r < end) ? exitOf[r] : c;
+    }
+
+    // Only the first and last row of a band can drain into another band
+    band.exitCount = 0;
+    auto collectRow = [&](int rowStart) {
+        for (int c = rowStart; c < rowStart + width; ++c) {
+            if (exitOf[c] == c) band.exits[band.exitCount++] = c;
+        }
+    };
+    collectRow(begin);
+    if (end - width > begin) collectRow(end - width);
+}
+
+// Pass 2 on the exit graph: exit i drains into exit next[i] (-1: a sink).
+// Calls emit(i, amount) for every exit, upstream first, with all the water
+// it passes on. total holds each exit's own water and is consumed.
+template <typename Emit>
+void propagateExits(int exitCount, const int* next, float* total, int* donors, int* queue, const Emit& emit) {
+    std::fill(donors, donors + exitCount, 0);
+    for (int i = 0; i < exitCount; ++i) {
+        if (next[i] >= 0) ++donors[next[i]];
+    }
+
+    int tail = 0;
+    for (int i = 0; i < exitCount; ++i) {
+        if (donors[i] == 0) queue[tail++] = i;
+    }
+    for (int head = 0; head < tail; ++head) {
+        int i = queue[head];
+        emit(i, total[i]);
+
+        int n = next[i];
+        if (n >= 0) {
+            total[n] += total[i];
+            if (--donors[n] == 0) queue[tail++] = n;
+        }
+    }
+}
+
+// Pass 3 on one band: inflow holds the water entering at each cell (0
+// elsewhere) and is pushed downstream in upstream-first order
+void pushInflow(const int* flowDirection, const int* offsets, const int* order, int ordered,
+    float* inflow, float* accumulation, int begin, int end) {
+    const int* queue = order + begin;
+    for (int i = 0; i < ordered; ++i) {
+        int c = queue[i];
+        float in = inflow[c];
+        if (in == 0.0f) continue;
+
+        accumulation[c] += in;
+        int r = receiverOf(flowDirection, offsets, c);
+        if (r >= begin && r < end) inflow[r] += in;
+    }
+}
+
+} // namespace
+
+void accumulateFlow(const int* flowDirection, const int dx[8], const int dy[8], const float* rainfall,
+    float* accumulation, int width, int height, ThreadPool* pool, int bandRows) {
+    MonotonicArena scratch;
+    accumulateFlow(flowDirection, dx, dy, rainfall, accumulation, width, height, pool, scratch, bandRows);
+}
+
+void accumulateFlow(const int* flowDirection, const int dx[8], const int dy[8], const float* rainfall,
+    float* accumulation, int width, int height, ThreadPool* pool, MonotonicArena& scratch, int bandRows) {
+    const int cells = width * height;
+    if (cells == 0) return;
+    bandRows = std::max(1, bandRows);
+    ArenaScope scope(scratch);
+
+    // Receiver cell per cell, -1 for sinks
+    int offsets[8];
+    for (int dir = 0; dir < 8; ++dir) {
+        offsets[dir] = dy[dir] * width + dx[dir];
+    }
+
+    auto receiver = [&](int cell) {
+        return receiverOf(flowDirection, offsets, cell);
+    };
+
+    // Only the first and last row of a band can drain into another band
+    const int bandCount = (height + bandRows - 1) / bandRows;
+    Band* bands = scratch.allocate<Band>(bandCount);
+    int* exitStorage = scratch.allocate<int>((size_t)bandCount * 2 * width);
+    for (int b = 0; b < bandCount; ++b) {
+        bands[b].begin = b * bandRows * width;
+        bands[b].end = std::min(height, (b + 1) * bandRows) * width;
+        bands[b].ordered = 0;
+        bands[b].exits = exitStorage + (size_t)b * 2 * width;
+        bands[b].exitCount = 0;
+    }
+
+    int* order = scratch.allocate<int>(cells);   // per band: cells in upstream-first order
+    int* pending = scratch.allocate<int>(cells); // in-band donors not yet processed
+    int* exitOf = scratch.allocate<int>(cells);  // band-edge cell this cell drains out through, or -1
+
+    auto forEachBand = [&](auto&& fn) {
+        if (pool) {
+            pool->parallelFor(bandCount, [&](int b) { fn(bands[b]); });
+        }
+        else {
+            for (int b = 0; b < bandCount; ++b) fn(bands[b]);
+        }
+    };
+
+    // ----------- PASS 1: local accumulation per band -----------
+
+    forEachBand([&](Band& band) {
+        localPass(flowDirection, offsets, rainfall, accumulation, pending, order, exitOf,
+            band.begin, band.end, width, band);
+    });
+
+    if (bandCount == 1) return;
+
+    // ----------- PASS 2: resolve flow between bands -----------
+
+    // Exit graph: exit x drains into entry receiver(x), whose water leaves
+    // its band through exitOf[receiver(x)]. The graph is acyclic like the
+    // flow graph itself and has only O(width * bands) nodes.
+    int exitCount = 0;
+    for (int b = 0; b < bandCount; ++b) exitCount += bands[b].exitCount;
+
+    int* exits = scratch.allocate<int>(exitCount);
+    int* exitsEnd = exits;
+    for (int b = 0; b < bandCount; ++b) {
+        exitsEnd = std::copy(bands[b].exits, bands[b].exits + bands[b].exitCount, exitsEnd);
+    }
+
+    auto exitIndex = [&](int cell) {
+        const int* it = std::lower_bound(exits, exitsEnd, cell);
+        return (it != exitsEnd && *it == cell) ? (int)(it - exits) : -1;
+    };
+
+    int* next = scratch.allocate<int>(exitCount);
+    float* total = scratch.allocate<float>(exitCount);
+    for (int i = 0; i < exitCount; ++i) {
+        int downstream = exitOf[receiver(exits[i])];
+        next[i] = downstream < 0 ? -1 : exitIndex(downstream);
+        total[i] = accumulation[exits[i]];
+    }
+
+    int* donors = scratch.allocate<int>(exitCount);
+    int* queue = scratch.allocate<int>(exitCount);
+    Crossing* crossings = scratch.allocate<Crossing>(exitCount);
+    int crossingCount = 0;
+    propagateExits(exitCount, next, total, donors, queue, [&](int i, float amount) {
+        crossings[crossingCount++] = { receiver(exits[i]), exits[i], amount };
+    });
+    Crossing* crossingsEnd = crossings + crossingCount;
+    std::sort(crossings, crossingsEnd);
+
+    // ----------- PASS 3: push inflow downstream inside each band -----------
+
+    float* carry = scratch.allocate<float>(cells);
+
+    forEachBand([&](Band& band) {
+        const Crossing* first = std::lower_bound(crossings, crossingsEnd, band.begin,
+            [](const Crossing& c, int cell) { return c.entry < cell; });
+        if (first == crossingsEnd || first->entry >= band.end) return;
+
+        float* inflow = carry;
+        std::memset(inflow + band.begin, 0, (size_t)(band.end - band.begin) * sizeof(float));
+        for (const Crossing* it = first; it != crossingsEnd && it->entry < band.end; ++it) {
+            inflow[it->entry] += it->amount;
+        }
+        pushInflow(flowDirection, offsets, order, band.ordered, inflow, accumulation, band.begin, band.end);
+    });
+}
+
+// ----------- BAND PASSES -----------
+
+FlowBandEdges accumulateFlowBand(const int* flowDirection, const int dx[8], const int dy[8], const float* rainfall,
+    float* accumulation, int width, int rows) {
+    FlowBandEdges edges;
+    edges.width = width;
+    edges.rows = rows;
+    const int cells = width * rows;
+    if (cells == 0) return edges;
+
+    int offsets[8];
+    for (int dir = 0; dir < 8; ++dir) {
+        offsets[dir] = dy[dir] * width + dx[dir];
+    }
+
+    std::vector<int> order(cells);
+    std::vector<int> pending(cells);
+    std::vector<int> exitOf(cells);
+    std::vector<int> exits((size_t)2 * width);
+    Band band{ 0, cells, 0, exits.data(), 0 };
+    localPass(flowDirection, offsets, rainfall, accumulation, pending.data(), order.data(), exitOf.data(),
+        0, cells, width, band);
+
+    exits.resize(band.exitCount);
+    edges.exits = exits;
+    edges.exitReceivers.resize(band.exitCount);
+    edges.exitAmounts.resize(band.exitCount);
+    for (int i = 0; i < band.exitCount; ++i) {
+        edges.exitReceivers[i] = receiverOf(flowDirection, offsets, exits[i]);
+        edges.exitAmounts[i] = accumulation[exits[i]];
+    }
+
+    edges.edgeExitOf.assign(exitOf.begin(), exitOf.begin() + width);
+    edges.edgeExitOf.insert(edges.edgeExitOf.end(), exitOf.end() - width, exitOf.end());
+    return edges;
+}
+
+std::vector<FlowCrossing> resolveFlowCrossings(const std::vector<FlowBandEdges>& bands) {
+    std::vector<FlowCrossing> crossings;
+    if (bands.size() < 2) return crossings;
+
+    // Map index of every band's first cell, and of every exit
+    std::vector<int64_t> begins(bands.size() + 1, 0);
+    for (size_t b = 0; b < bands.size(); ++b) {
+        begins[b + 1] = begins[b] + (int64_t)bands[b].width * bands[b].rows;
+    }
+
+    std::vector<int64_t> exits;
+    std::vector<int64_t> receivers;
+    std::vector<float> total;
+    for (size_t b = 0; b < bands.size(); ++b) {
+        for (size_t i = 0; i < bands[b].exits.size(); ++i) {
+            exits.push_back(begins[b] + bands[b].exits[i]);
+            receivers.push_back(begins[b] + bands[b].exitReceivers[i]);
+            total.push_back(bands[b].exitAmounts[i]);
+        }
+    }
+    const int exitCount = (int)exits.size();
+
+    // exitOf of a cell in the first or last row of its band, as a map index
+    auto exitOf = [&](int64_t cell) -> int64_t {
+        const size_t b = std::upper_bound(begins.begin(), begins.end(), cell) - begins.begin() - 1;
+        const FlowBandEdges& band = bands[b];
+        const int local = (int)(cell - begins[b]);
+        const int column = local % band.width;
+        const int exit = local < band.width ? band.edgeExitOf[column] : band.edgeExitOf[band.width + column];
+        return exit < 0 ? -1 : begins[b] + exit;
+    };
+
+    std::vector<int> next(exitCount);
+    for (int i = 0; i < exitCount; ++i) {
+        const int64_t downstream = exitOf(receivers[i]);
+        auto it = std::lower_bound(exits.begin(), exits.end(), downstream);
+        next[i] = (downstream >= 0 && it != exits.end() && *it == downstream) ? (int)(it - exits.begin()) : -1;
+    }
+
+    std::vector<int> donors(exitCount);
+    std::vector<int> queue(exitCount);
+    crossings.reserve(exitCount);
+    propagateExits(exitCount, next.data(), total.data(), donors.data(), queue.data(), [&](int i, float amount) {
+        crossings.push_back({ receivers[i], exits[i], amount });
+    });
+    std::sort(crossings.begin(), crossings.end(), [](const FlowCrossing& a, const FlowCrossing& b) {
+        return a.entry != b.entry ? a.entry < b.entry : a.exit < b.exit;
+    });
+    return crossings;
+}
+
+void addFlowInflow(const int* flowDirection, const int dx[8], const int dy[8], float* accumulation,
+    int width, int rows, int64_t begin, const FlowCrossing* crossings, size_t crossingCount) {
+    const int cells = width * rows;
+    const FlowCrossing* end = crossings + crossingCount;
+    const FlowCrossing* first = std::lower_bound(crossings, end, begin,
+        [](const FlowCrossing& c, int64_t cell) { return c.entry < cell; });
+    if (first == end || first->entry >= begin + cells) return;
+
+    int offsets[8];
+    for (int dir = 0; dir < 8; ++dir) {
+        offsets[dir] = dy[dir] * width + dx[dir];
+    }
+
+    std::vector<int> order(cells);
+    std::vector<int> pending(cells);
+    const int ordered = orderBand(flowDirection, offsets, pending.data(), order.data(), 0, cells);
+
+    std::vector<float> inflow(cells, 0.0f);
+    for (const FlowCrossing* it = first; it != end && it->entry < begin + cells; ++it) {
+        inflow[(size_t)(it->entry - begin)] += it->amount;
+    }
+    pushInflow(flowDirection, offsets, order.data(), ordered, inflow.data(), accumulation, 0, cells);
+}
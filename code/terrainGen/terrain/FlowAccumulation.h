@@ -0,0 +1,105 @@
+#pragma once
+
+#include "util/Arena.h"
+#include "util/ThreadPool.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Drainage accumulation over a D8 flow graph in O(N).
+//
+// flowDirection[i] is -1 (sink) or a direction index into dx/dy. Every cell
+// receives rainfall[i] plus everything that drains through it.
+//
+// The map is cut into fixed row bands. Each band runs a topological pass on
+// its own cells in parallel; flow crossing band edges is then resolved on the
+// small graph of band-edge cells, and a second parallel pass pushes that
+// inflow downstream inside each band. Band height does not depend on the
+// thread count, so the result is identical for any number of threads.
+const int FLOW_BAND_ROWS = 256;
+
+void accumulateFlow(
+    const int* flowDirection,
+    const int dx[8],
+    const int dy[8],
+    const float* rainfall,
+    float* accumulation,
+    int width,
+    int height,
+    ThreadPool* pool,
+    int bandRows = FLOW_BAND_ROWS
+);
+
+// Same, taking all temporaries from scratch (released before returning)
+void accumulateFlow(
+    const int* flowDirection,
+    const int dx[8],
+    const int dy[8],
+    const float* rainfall,
+    float* accumulation,
+    int width,
+    int height,
+    ThreadPool* pool,
+    MonotonicArena& scratch,
+    int bandRows = FLOW_BAND_ROWS
+);
+
+// ----------- BAND PASSES -----------
+//
+// The three passes of accumulateFlow as separate steps, so the bands of one
+// map can be processed by different processes (see shard/ShardedGenerator.h).
+// Run on bands of FLOW_BAND_ROWS full map rows (the last one may be
+// shorter), they reproduce accumulateFlow bit for bit:
+//
+//     pass 1  accumulateFlowBand on every band          (anywhere)
+//     pass 2  resolveFlowCrossings on all their edges   (one place)
+//     pass 3  addFlowInflow on every band               (anywhere)
+//
+// flowDirection, rainfall and accumulation point at the band's first cell.
+// Cells are band-local, map indices are int64_t.
+
+// What pass 2 needs to know about one band after its local pass
+struct FlowBandEdges {
+    int width = 0;
+    int rows = 0;
+    std::vector<int> exits;         // cells whose receiver lies outside the band, ascending
+    std::vector<int> exitReceivers; // their receivers (negative: row above the band)
+    std::vector<float> exitAmounts; // their local accumulation
+    std::vector<int> edgeExitOf;    // first row then last row: exit each cell drains through, or -1
+};
+
+// Water carried across a band edge into entry
+struct FlowCrossing {
+    int64_t entry; // map index
+    int64_t exit;  // map index
+    float amount;
+};
+
+// Pass 1: local accumulation of one band of rows map rows
+FlowBandEdges accumulateFlowBand(
+    const int* flowDirection,
+    const int dx[8],
+    const int dy[8],
+    const float* rainfall,
+    float* accumulation,
+    int width,
+    int rows
+);
+
+// Pass 2: the flow between bands, given every band of the map top to
+// bottom. Crossings come back sorted by entry.
+std::vector<FlowCrossing> resolveFlowCrossings(const std::vector<FlowBandEdges>& bands);
+
+// Pass 3: adds the inflow of the crossings entering the band whose first
+// cell has map index begin; crossings outside it are ignored
+void addFlowInflow(
+    const int* flowDirection,
+    const int dx[8],
+    const int dy[8],
+    float* accumulation,
+    int width,
+    int rows,
+    int64_t begin,
+    const FlowCrossing* crossings,
+    size_t crossingCount
+);
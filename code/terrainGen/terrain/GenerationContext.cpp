@@ -0,0 +1,11 @@
+#include "GenerationContext.h"
+
+#include <cassert>
+
+void GenerationContext::prepare(int width, int height) {
+    if (width == m_width && height == m_height) return;
+    assert(m_arena.getUsed() == 0 && "GenerationContext::prepare() inside a scope");
+    m_width = width;
+    m_height = height;
+    m_arena.release();
+}
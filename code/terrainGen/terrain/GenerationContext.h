@@ -0,0 +1,47 @@
+#pragma once
+
+#include "util/Arena.h"
+#include <cstddef>
+
+// Scratch memory reused from one generation to the next.
+//
+// Stages open a Scope for their temporaries and take per-tile scratch
+// planes and growable buffers from the arena; everything is handed back
+// when the scope ends. After the first generation at a map size the arena
+// holds the largest stage's scratch, so regenerating at that size does no
+// heap allocation at all:
+//
+//     GenerationContext::Scope scope(context.arena());
+//     uint8_t* visited = context.scratchPlane<uint8_t>();
+//     ArenaVector<int> queue(context.arena());
+class GenerationContext {
+public:
+    using Scope = ArenaScope;
+
+    GenerationContext() = default;
+
+    // Sets the map size for scratchPlane(). Changing it frees the arena so
+    // it is sized for the new map instead of the largest one seen; no
+    // scope may be open.
+    void prepare(int width, int height);
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    size_t getTileCount() const { return (size_t)m_width * m_height; }
+
+    // One uninitialised T per tile, released with the enclosing scope
+    template <typename T>
+    T* scratchPlane() {
+        return m_arena.allocate<T>(getTileCount());
+    }
+
+    MonotonicArena& arena() { return m_arena; }
+
+    // Bytes reserved for scratch
+    size_t getMemoryUsage() const { return m_arena.getCapacity(); }
+
+private:
+    int m_width = 0;
+    int m_height = 0;
+    MonotonicArena m_arena;
+};
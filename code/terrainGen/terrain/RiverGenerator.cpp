@@ -1,123 +1,381 @@
 #include "RiverGenerator.h"
+#include "FlowAccumulation.h"
+#include "util/Profiler.h"
+#include "util/Random.h"
+#include "world/Stencil.h"
 #include <cmath>
 #include <algorithm>
-#include <random>
-#include <ctime>
+
+namespace {
+
+// Priority-flood pops the lowest cell first
+struct LowestFirst {
+    bool operator()(const FlowCell& a, const FlowCell& b) const {
+        return b < a;
+    }
+};
+
+} // namespace
 
 // 8-directional neighbors (N, NE, E, SE, S, SW, W, NW)
 const int RiverGenerator::DX[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
 const int RiverGenerator::DY[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
 
-RiverGenerator::RiverGenerator(World& world)
+RiverGenerator::RiverGenerator(World& world, unsigned int seed)
     : m_world(world),
+    m_seed(seed),
     m_flowDirection(world.getWidth()* world.getHeight(), -1),
-    m_accumulation(world.getWidth()* world.getHeight(), 0.0f)
+    m_accumulation(world.getWidth()* world.getHeight(), 0.0f),
+    m_pool(new ThreadPool()),
+    m_ownContext(new GenerationContext()),
+    m_context(m_ownContext.get())
 {
 }
 
+void RiverGenerator::setThreadCount(int threadCount) {
+    if (threadCount <= 0) threadCount = ThreadPool::hardwareThreads();
+    if (threadCount == m_pool->getThreadCount()) return;
+    m_pool.reset(new ThreadPool(threadCount));
+}
+
+void RiverGenerator::setSeed(unsigned int seed) {
+    m_seed = seed;
+}
+
+void RiverGenerator::setContext(GenerationContext* context) {
+    m_context = context ? context : m_ownContext.get();
+}
+
+GenerationContext& RiverGenerator::scratch() {
+    m_context->prepare(m_world.getWidth(), m_world.getHeight());
+    return *m_context;
+}
+
+void RiverGenerator::setCancelFlag(const std::atomic<bool>* cancel) {
+    m_cancel = cancel;
+}
+
 void RiverGenerator::generateRivers(int numSources, float riverThreshold, float moistureInfluence) {
     int width = m_world.getWidth();
     int height = m_world.getHeight();
 
-    // Step 1: Calculate flow directions for all tiles
-    calculateFlowDirections();
+    // Step 1: Calculate flow directions for all tiles, draining every pit
+    fillDepressions();
 
     // Step 2: Spawn water sources (prefer high elevation + high moisture)
-    std::vector<std::pair<int, int>> sources;
-    std::mt19937 rng(static_cast<unsigned>(std::time(nullptr)));
-
-    // Collect valid source candidates (land tiles above sea level)
-    std::vector<std::pair<int, int>> candidates;
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            const Tile& tile = m_world.at(x, y);
-
+    const float* heights = m_world.heightPlane().data();
+    const float* moistures = m_world.moisturePlane().data();
+    const Biome* biomes = m_world.biomePlane().data();
+
+    // Every candidate tile draws a random key from its own coordinate; the
+    // numSources smallest keys win. The choice does not depend on the order
+    // tiles are visited in, so bands can collect candidates in parallel.
+    // Keys are packed as (random << 32 | tile) to break ties by tile.
+    GenerationContext& context = scratch();
+    GenerationContext::Scope scope(context.arena());
+
+    const CounterRng rng(m_seed, RandomStream::RiverSources);
+    const int keep = std::max(numSources, 0);
+    const int bands = (height + BAND_ROWS - 1) / BAND_ROWS;
+    uint64_t* picks = context.arena().allocate<uint64_t>((size_t)bands * keep);
+    int* pickCounts = context.arena().allocate<int>(bands);
+
+    forEachRowBand([&](int begin, int end) {
+        // Max-heap of the band's keep smallest keys
+        const int band = begin / (BAND_ROWS * width);
+        uint64_t* best = picks + (size_t)band * keep;
+        int count = 0;
+
+        for (int idx = begin; idx < end; ++idx) {
             // Must be land and not too low
-            if (tile.height > 0.47f && tile.biome != Biome::Ocean && tile.biome != Biome::Beach) {
+            if (heights[idx] > 0.47f && biomes[idx] != Biome::Ocean && biomes[idx] != Biome::Beach) {
                 // Weight by height and moisture
-                float weight = tile.height * (1.0f - moistureInfluence) +
-                    tile.moisture * moistureInfluence;
+                float weight = heights[idx] * (1.0f - moistureInfluence) +
+                    moistures[idx] * moistureInfluence;
 
                 // Higher elevation and wetter areas are better sources
                 if (weight > 0.5f) {
-                    candidates.push_back({ x, y });
+                    uint64_t pick = uint64_t(rng.bits(idx % width, idx / width)) << 32 | uint32_t(idx);
+                    if (count < keep) {
+                        best[count++] = pick;
+                        std::push_heap(best, best + count);
+                    }
+                    else if (keep > 0 && pick < best[0]) {
+                        std::pop_heap(best, best + count);
+                        best[count - 1] = pick;
+                        std::push_heap(best, best + count);
+                    }
                 }
             }
         }
+        pickCounts[band] = count;
+    });
+
+    // Only the bands' best picks can make the final cut
+    uint64_t* merged = context.arena().allocate<uint64_t>((size_t)bands * keep);
+    int pickCount = 0;
+    for (int band = 0; band < bands; ++band) {
+        const uint64_t* best = picks + (size_t)band * keep;
+        pickCount = (int)(std::copy(best, best + pickCounts[band], merged + pickCount) - merged);
     }
-
-    // Randomly select sources from candidates
-    std::shuffle(candidates.begin(), candidates.end(), rng);
-    int actualSources = std::min(numSources, (int)candidates.size());
-
-    for (int i = 0; i < actualSources; ++i) {
-        sources.push_back(candidates[i]);
-    }
+    std::sort(merged, merged + pickCount);
+    pickCount = std::min(pickCount, keep);
 
     // Step 3: Simulate water flow from each source
-    for (const auto& source : sources) {
-        // More water from wetter/higher areas
-        float waterAmount = 0.02f + m_world.at(source.first, source.second).moisture * 0.03f;
-        simulateFlow(source.first, source.second, waterAmount);
+    {
+        TG_PROFILE_SCOPE("simulate_flow", pickCount);
+        for (int i = 0; i < pickCount; ++i) {
+            int idx = int(uint32_t(merged[i]));
+
+            // More water from wetter/higher areas
+            float waterAmount = 0.02f + moistures[idx] * 0.03f;
+            simulateFlow(idx % width, idx / width, waterAmount);
+        }
     }
 
     // Step 4: Convert accumulation to river strength
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            int idx = y * width + x;
-            Tile& tile = m_world.at(x, y);
+    applyRiverStrength(riverThreshold);
+}
+
+void RiverGenerator::generateCatchmentRivers(float riverThreshold, float moistureInfluence) {
+    fillDepressions();
+    accumulateFlow(moistureInfluence);
+    applyRiverStrength(riverThreshold);
+}
+
+void RiverGenerator::accumulateFlow(float moistureInfluence) {
+    int width = m_world.getWidth();
+    int height = m_world.getHeight();
+    TG_PROFILE_SCOPE("accumulate_flow", (double)width * height);
+    const float* moistures = m_world.moisturePlane().data();
+
+    GenerationContext& context = scratch();
+    GenerationContext::Scope scope(context.arena());
+
+    // Rainfall per tile, normalised so the map total is 1.0
+    float* rainfall = context.scratchPlane<float>();
+    const double tileCount = (double)width * height;
+    forEachRowBand([&](int begin, int end) {
+        for (int idx = begin; idx < end; ++idx) {
+            rainfall[idx] = RiverGenerator::rainfall(moistures[idx], moistureInfluence, tileCount);
+        }
+    });
+
+    ::accumulateFlow(m_flowDirection.data(), DX, DY, rainfall, m_accumulation.data(),
+        width, height, m_pool.get(), context.arena());
+}
 
+float RiverGenerator::rainfall(float moisture, float moistureInfluence, double tileCount) {
+    const float perTile = 1.0f / (float)tileCount;
+    return perTile * (1.0f - moistureInfluence + moisture * moistureInfluence);
+}
+
+float RiverGenerator::riverStrength(float accumulation, float riverThreshold) {
+    if (accumulation <= riverThreshold) return 0.0f;
+
+    // Normalize river strength (stronger rivers have more accumulation)
+    return std::min(1.0f, accumulation / (riverThreshold * 5.0f));
+}
+
+void RiverGenerator::applyRiverStrength(float riverThreshold) {
+    const Biome* biomes = m_world.biomePlane().data();
+    float* rivers = m_world.riverPlane().data();
+
+    forEachRowBand([&](int begin, int end) {
+        for (int idx = begin; idx < end; ++idx) {
             // Only create rivers on land
-            if (tile.biome != Biome::Ocean && tile.biome != Biome::Beach) {
+            if (biomes[idx] != Biome::Ocean && biomes[idx] != Biome::Beach) {
                 if (m_accumulation[idx] > riverThreshold) {
-                    // Normalize river strength (stronger rivers have more accumulation)
-                    tile.riverStrength = std::min(1.0f, m_accumulation[idx] / (riverThreshold * 5.0f));
+                    rivers[idx] = riverStrength(m_accumulation[idx], riverThreshold);
                 }
             }
         }
-    }
+    });
 }
 
 void RiverGenerator::calculateFlowDirections() {
     int width = m_world.getWidth();
     int height = m_world.getHeight();
+    TG_PROFILE_SCOPE("flow_directions", (double)width * height);
+    const float* heights = m_world.heightPlane().data();
+    const Biome* biomes = m_world.biomePlane().data();
+
+    forEachStencil(width, height, m_pool.get(), [&](const auto& cell) {
+        // Ocean tiles are sinks
+        if (biomes[cell.idx] == Biome::Ocean) {
+            m_flowDirection[cell.idx] = -1;
+            return;
+        }
+
+        // Find steepest downhill neighbor
+        m_flowDirection[cell.idx] = findSteepestNeighbor(cell, heights);
+    });
+}
+
+void RiverGenerator::fillDepressions() {
+    int width = m_world.getWidth();
+    int height = m_world.getHeight();
+    TG_PROFILE_SCOPE("fill_depressions", (double)width * height);
+    const float* heights = m_world.heightPlane().data();
+    const Biome* biomes = m_world.biomePlane().data();
+    const size_t cells = (size_t)width * height;
+
+    m_filledHeight.assign(heights, heights + cells);
+    m_basinId.assign(cells, -1);
+    m_basins.clear();
+
+    GenerationContext& context = scratch();
+    GenerationContext::Scope scope(context.arena());
+
+    // Tiles whose direction is set by the flood (ocean, basins and flats)
+    uint8_t* routed = context.scratchPlane<uint8_t>();
+    uint8_t* closed = context.scratchPlane<uint8_t>();
+
+    // Seeds: the coast and the map edge, where water can leave
+    uint8_t* seed = context.scratchPlane<uint8_t>();
+    forEachStencil(width, height, m_pool.get(), [&](const auto& cell) {
+        const int idx = cell.idx;
+
+        if (biomes[idx] != Biome::Ocean) {
+            bool edge = false;
+            for (int dir = 0; dir < 8; dir += 2) edge = edge || !cell.has(dir);
+            seed[idx] = edge;
+            closed[idx] = edge;
+            routed[idx] = 0;
+            return;
+        }
 
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            int idx = y * width + x;
-            const Tile& tile = m_world.at(x, y);
+        // Ocean tiles are sinks; only those touching land start the flood
+        closed[idx] = 1;
+        routed[idx] = 1;
+        m_flowDirection[idx] = -1;
 
-            // Ocean tiles are sinks
-            if (tile.biome == Biome::Ocean) {
-                m_flowDirection[idx] = -1;
+        bool coast = false;
+        for (int dir = 0; dir < 8; ++dir) {
+            if (cell.has(dir) && biomes[cell.neighbour(dir)] != Biome::Ocean) {
+                coast = true;
+                break;
+            }
+        }
+        seed[idx] = coast;
+    });
+
+    // Min-heap of the flood front
+    ArenaVector<FlowCell> open(context.arena(), 4096);
+    for (int idx = 0; idx < (int)cells; ++idx) {
+        if (seed[idx]) {
+            open.push_back({ idx % width, idx / width, heights[idx], 0.0f });
+            std::push_heap(open.begin(), open.end(), LowestFirst());
+        }
+    }
+
+    // FIFO of tiles at their parent's water level; every tile enters it at most once
+    int* pit = context.scratchPlane<int>();
+    size_t pitHead = 0;
+    size_t pitTail = 0;
+
+    // Cells inside depressions bypass the heap, so flat and filled areas
+    // cost O(1) each; only tiles above the water level pay O(log N).
+    size_t processed = 0;
+    while (pitHead < pitTail || !open.empty()) {
+        if ((++processed & 0xFFFF) == 0 && m_cancel && m_cancel->load(std::memory_order_relaxed)) return;
+
+        int x, y;
+        if (pitHead < pitTail) {
+            int idx = pit[pitHead++];
+            x = idx % width;
+            y = idx / width;
+        }
+        else {
+            std::pop_heap(open.begin(), open.end(), LowestFirst());
+            x = open.back().x;
+            y = open.back().y;
+            open.pop_back();
+        }
+        const int idx = y * width + x;
+        const float level = m_filledHeight[idx];
+        int spillBasin = m_basinId[idx];
+
+        for (int dir = 0; dir < 8; ++dir) {
+            int nx = x + DX[dir];
+            int ny = y + DY[dir];
+            if (!m_world.inBounds(nx, ny)) continue;
+
+            int nidx = ny * width + nx;
+            if (closed[nidx]) continue;
+            closed[nidx] = 1;
+
+            if (heights[nidx] > level) {
+                open.push_back({ nx, ny, heights[nidx], 0.0f });
+                std::push_heap(open.begin(), open.end(), LowestFirst());
                 continue;
             }
 
-            // Find steepest downhill neighbor
-            m_flowDirection[idx] = findSteepestNeighbor(x, y);
+            // At or below the water level: flood it and drain back towards
+            // the tile we came from, which leads out through the spill point
+            if (heights[nidx] < level && spillBasin < 0) {
+                spillBasin = (int)m_basins.size();
+                m_basins.push_back({ x, y, level, 0, 0.0f });
+            }
+            if (spillBasin >= 0) {
+                Basin& basin = m_basins[spillBasin];
+                basin.cellCount++;
+                basin.volume += level - heights[nidx];
+            }
+
+            m_filledHeight[nidx] = level;
+            m_basinId[nidx] = spillBasin;
+            m_flowDirection[nidx] = (dir + 4) % 8;
+            routed[nidx] = 1;
+            pit[pitTail++] = nidx;
         }
     }
+
+    // Everything else flows down the filled surface, which always has a
+    // strictly lower neighbour or leaves the map
+    const float* filled = m_filledHeight.data();
+    forEachStencil(width, height, m_pool.get(), [&](const auto& cell) {
+        if (!routed[cell.idx]) {
+            m_flowDirection[cell.idx] = findSteepestNeighbor(cell, filled);
+        }
+    });
 }
 
-int RiverGenerator::findSteepestNeighbor(int x, int y) const {
-    int width = m_world.getWidth();
-    int height = m_world.getHeight();
+const std::vector<int>& RiverGenerator::getFlowDirections() const {
+    return m_flowDirection;
+}
 
-    const Tile& current = m_world.at(x, y);
-    float currentHeight = current.height;
+const std::vector<float>& RiverGenerator::getAccumulation() const {
+    return m_accumulation;
+}
+
+const std::vector<float>& RiverGenerator::getFilledHeights() const {
+    return m_filledHeight;
+}
+
+const std::vector<int>& RiverGenerator::getBasinIds() const {
+    return m_basinId;
+}
+
+const std::vector<Basin>& RiverGenerator::getBasins() const {
+    return m_basins;
+}
+
+template <typename Cell>
+int RiverGenerator::findSteepestNeighbor(const Cell& cell, const float* heights) const {
+    const Biome* biomes = m_world.biomePlane().data();
+
+    float currentHeight = heights[cell.idx];
 
     int steepestDir = -1;
     float steepestSlope = 0.0f;
 
     // Check all 8 neighbors
     for (int dir = 0; dir < 8; ++dir) {
-        int nx = x + DX[dir];
-        int ny = y + DY[dir];
-
-        if (!m_world.inBounds(nx, ny)) continue;
+        if (!cell.has(dir)) continue;
 
-        const Tile& neighbor = m_world.at(nx, ny);
-        float slope = currentHeight - neighbor.height;
+        int nidx = cell.neighbour(dir);
+        float slope = currentHeight - heights[nidx];
 
         // Account for diagonal distance
         if (dir % 2 == 1) { // Diagonal
@@ -125,7 +383,7 @@ int RiverGenerator::findSteepestNeighbor(int x, int y) const {
         }
 
         // Water flows to steepest downhill neighbor (or ocean)
-        if (slope > steepestSlope || neighbor.biome == Biome::Ocean) {
+        if (slope > steepestSlope || biomes[nidx] == Biome::Ocean) {
             steepestSlope = slope;
             steepestDir = dir;
         }
@@ -136,6 +394,7 @@ int RiverGenerator::findSteepestNeighbor(int x, int y) const {
 
 void RiverGenerator::simulateFlow(int startX, int startY, float waterAmount) {
     int width = m_world.getWidth();
+    const Biome* biomes = m_world.biomePlane().data();
     int x = startX;
     int y = startY;
 
@@ -147,13 +406,12 @@ void RiverGenerator::simulateFlow(int startX, int startY, float waterAmount) {
         if (!m_world.inBounds(x, y)) break;
 
         int idx = y * width + x;
-        const Tile& tile = m_world.at(x, y);
 
         // Add water to this cell
         m_accumulation[idx] += waterAmount;
 
         // If we hit ocean, stop
-        if (tile.biome == Biome::Ocean) {
+        if (biomes[idx] == Biome::Ocean) {
             break;
         }
 
@@ -172,38 +430,34 @@ void RiverGenerator::simulateFlow(int startX, int startY, float waterAmount) {
 }
 
 void RiverGenerator::generateLakes(float lakeThreshold) {
-    int width = m_world.getWidth();
-    int height = m_world.getHeight();
+    TG_PROFILE_SCOPE("generate_lakes", (double)m_world.getWidth() * m_world.getHeight());
+    if (m_basinId.empty()) {
+        fillDepressions();
+    }
 
-    // Lakes form in local minima with enough water accumulation
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
-            int idx = y * width + x;
-            Tile& tile = m_world.at(x, y);
+    const size_t cells = m_basinId.size();
+    const Biome* biomes = m_world.biomePlane().data();
+    bool* lakes = m_world.lakePlane().data();
 
-            // Must be land, not already ocean/beach
-            if (tile.biome == Biome::Ocean || tile.biome == Biome::Beach) {
-                continue;
-            }
+    GenerationContext& context = scratch();
+    GenerationContext::Scope scope(context.arena());
 
-            // Check if this is a local minimum with water
-            if (m_flowDirection[idx] == -1 && m_accumulation[idx] > lakeThreshold) {
-                tile.isLake = true;
-
-                // Optionally flood nearby low areas
-                for (int dir = 0; dir < 8; ++dir) {
-                    int nx = x + DX[dir];
-                    int ny = y + DY[dir];
-
-                    if (m_world.inBounds(nx, ny)) {
-                        Tile& neighbor = m_world.at(nx, ny);
-                        if (neighbor.height <= tile.height + 0.02f &&
-                            neighbor.biome != Biome::Ocean) {
-                            neighbor.isLake = true;
-                        }
-                    }
-                }
-            }
+    // Everything entering a basin passes its wettest tile on the way out
+    float* inflow = context.arena().allocate<float>(m_basins.size());
+    std::fill(inflow, inflow + m_basins.size(), 0.0f);
+    for (size_t idx = 0; idx < cells; ++idx) {
+        int basin = m_basinId[idx];
+        if (basin >= 0) inflow[basin] = std::max(inflow[basin], m_accumulation[idx]);
+    }
+
+    // Lakes fill the whole basin up to its spill height
+    for (size_t idx = 0; idx < cells; ++idx) {
+        int basin = m_basinId[idx];
+        if (basin < 0 || inflow[basin] <= lakeThreshold) continue;
+
+        // Must be land, not already ocean/beach
+        if (biomes[idx] != Biome::Ocean && biomes[idx] != Biome::Beach) {
+            lakes[idx] = true;
         }
     }
-}
\ No newline at end of file
+}
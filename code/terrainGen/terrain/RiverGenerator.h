@@ -1,5 +1,9 @@
 #pragma once
-#include "world\World.h"
+#include "GenerationContext.h"
+#include "world/World.h"
+#include "util/ThreadPool.h"
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <queue>
 
@@ -14,9 +18,18 @@ struct FlowCell {
     }
 };
 
+// A depression filled up to its spill height by fillDepressions
+struct Basin {
+    int spillX, spillY; // Rim tile the basin overflows through
+    float spillHeight;  // Water surface height
+    int cellCount;      // Tiles at or below the water surface
+    float volume;       // Sum of water depth over the basin
+};
+
 class RiverGenerator {
 public:
-    RiverGenerator(World& world);
+    // seed keys the random choice of river sources
+    RiverGenerator(World& world, unsigned int seed = 0);
 
     // Generate rivers using precipitation and flow accumulation
     void generateRivers(
@@ -25,11 +38,71 @@ public:
         float moistureInfluence = 0.5f // How much moisture affects water sources
     );
 
-    // Generate lakes in low-lying areas
+    // Generate rivers from true catchment area: every tile drains into its
+    // steepest neighbour and accumulates everything upstream of it
+    void generateCatchmentRivers(
+        float riverThreshold = 0.002f,  // Share of the map's rainfall needed to form a river
+        float moistureInfluence = 0.5f  // How much moisture scales rainfall
+    );
+
+    // Full-map drainage in one O(N) pass over the flow directions.
+    // Each tile receives rainfall scaled by moisture, normalised so the whole
+    // map receives 1.0; the result replaces the accumulation map.
+    void accumulateFlow(float moistureInfluence = 0.5f);
+
+    // Convert accumulation above the threshold to river strength on land
+    void applyRiverStrength(float riverThreshold);
+
+    // Rain accumulateFlow puts on one tile of a map of tileCount tiles (the
+    // map total is 1.0); shared with sharded generation
+    static float rainfall(float moisture, float moistureInfluence, double tileCount);
+
+    // River strength of a land tile, 0 at or below the threshold
+    static float riverStrength(float accumulation, float riverThreshold);
+
+    // Turn every filled basin that receives enough water into a lake.
+    // Fills depressions first if that has not been done yet.
     void generateLakes(float lakeThreshold = 0.05f);
 
+    // Priority-flood: raise every depression to its spill height, record the
+    // basins and route flow across them and across flats to the spill point.
+    // Replaces the flow directions; no land tile is left as a sink.
+    void fillDepressions();
+
+    // Calculate flow directions for all tiles
+    void calculateFlowDirections();
+
+    // Flow direction per tile (see m_flowDirection)
+    const std::vector<int>& getFlowDirections() const;
+
+    // Water accumulation per tile
+    const std::vector<float>& getAccumulation() const;
+
+    // Height per tile after fillDepressions (empty before)
+    const std::vector<float>& getFilledHeights() const;
+
+    // Basin index per tile after fillDepressions, -1 outside basins
+    const std::vector<int>& getBasinIds() const;
+    const std::vector<Basin>& getBasins() const;
+
+    // Threads for the parallel passes; 0 = all hardware threads
+    void setThreadCount(int threadCount);
+
+    // Reseeds the river source choice for the next generateRivers()
+    void setSeed(unsigned int seed);
+
+    // Scratch memory for the passes. Sharing one context between the stages
+    // of a pipeline keeps regeneration free of heap allocation; nullptr
+    // (default) uses a context owned by this generator.
+    void setContext(GenerationContext* context);
+
+    // While *cancel is set, fillDepressions stops early with partial output.
+    // nullptr (default) disables the check.
+    void setCancelFlag(const std::atomic<bool>* cancel);
+
 private:
     World& m_world;
+    unsigned int m_seed;
 
     // Flow direction map: which neighbor does water flow to?
     std::vector<int> m_flowDirection; // -1 = ocean/sink, 0-7 = direction index
@@ -37,11 +110,28 @@ private:
     // Water accumulation per tile
     std::vector<float> m_accumulation;
 
-    // Calculate flow directions for all tiles
-    void calculateFlowDirections();
+    // Depression filling results
+    std::vector<float> m_filledHeight;
+    std::vector<int> m_basinId;
+    std::vector<Basin> m_basins;
 
-    // Find the steepest downhill neighbor
-    int findSteepestNeighbor(int x, int y) const;
+    std::unique_ptr<ThreadPool> m_pool;
+    std::unique_ptr<GenerationContext> m_ownContext;
+    GenerationContext* m_context;
+    const std::atomic<bool>* m_cancel = nullptr;
+
+    static const int BAND_ROWS = 64;
+
+    // Scratch context, prepared for the world size
+    GenerationContext& scratch();
+
+    // Runs fn(firstTile, endTile) over bands of BAND_ROWS whole rows on the pool
+    template <typename Fn>
+    void forEachRowBand(const Fn& fn);
+
+    // Find the steepest downhill neighbor of a stencil cell on the given height field
+    template <typename Cell>
+    int findSteepestNeighbor(const Cell& cell, const float* heights) const;
 
     // Simulate water flow from sources
     void simulateFlow(int startX, int startY, float waterAmount);
@@ -49,4 +139,18 @@ private:
     // Get flow direction offsets
     static const int DX[8];
     static const int DY[8];
-};
\ No newline at end of file
+};
+
+template <typename Fn>
+void RiverGenerator::forEachRowBand(const Fn& fn) {
+    const int rows = BAND_ROWS;
+    const int width = m_world.getWidth();
+    const int height = m_world.getHeight();
+    const int bands = (height + rows - 1) / rows;
+
+    m_pool->parallelFor(bands, [&](int band) {
+        int begin = band * rows * width;
+        int end = (band + 1) * rows < height ? (band + 1) * rows * width : height * width;
+        fn(begin, end);
+    });
+}
@@ -0,0 +1,289 @@
+#include "TerrainGenerator.h"
+#include "util/Profiler.h"
+#include "util/Random.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+unsigned int deriveSeed(unsigned int worldSeed, unsigned int layer) {
+    return CounterRng(worldSeed, RandomStream::NoiseSeeds).bits(layer);
+}
+
+// Generation always classifies with the default rules
+const BiomeClassifier& defaultClassifier() {
+    static const BiomeClassifier classifier;
+    return classifier;
+}
+
+} // namespace
+
+TerrainGenerator::TerrainGenerator(unsigned int heightSeed, unsigned int moistureSeed, unsigned int temperatureSeed)
+    : m_pool(new ThreadPool())
+{
+    const unsigned int seeds[(int)noise::NoiseLayer::Count] = { heightSeed, moistureSeed, temperatureSeed };
+    for (int layer = 0; layer < (int)noise::NoiseLayer::Count; ++layer) {
+        m_perlin[layer].setSeed(seeds[layer]);
+        m_simplex[layer].setSeed(seeds[layer]);
+        m_value[layer].setSeed(seeds[layer]);
+    }
+}
+
+TerrainGenerator::TerrainGenerator(unsigned int worldSeed)
+    : TerrainGenerator(deriveSeed(worldSeed, 0), deriveSeed(worldSeed, 1), deriveSeed(worldSeed, 2))
+{
+}
+
+void TerrainGenerator::setSeed(unsigned int worldSeed) {
+    for (int layer = 0; layer < (int)noise::NoiseLayer::Count; ++layer) {
+        const unsigned int seed = deriveSeed(worldSeed, layer);
+        m_perlin[layer].setSeed(seed);
+        m_simplex[layer].setSeed(seed);
+        m_value[layer].setSeed(seed);
+    }
+}
+
+void TerrainGenerator::setThreadCount(int threadCount) {
+    if (threadCount <= 0) threadCount = ThreadPool::hardwareThreads();
+    if (threadCount == m_pool->getThreadCount()) return;
+    m_pool.reset(new ThreadPool(threadCount));
+}
+
+int TerrainGenerator::getThreadCount() const {
+    return m_pool->getThreadCount();
+}
+
+void TerrainGenerator::setRecipe(const TerrainRecipe& recipe) {
+    m_recipe = recipe;
+}
+
+const TerrainRecipe& TerrainGenerator::getRecipe() const {
+    return m_recipe;
+}
+
+void TerrainGenerator::setNoiseBackend(noise::NoiseBackend backend) {
+    m_backend = backend;
+}
+
+noise::NoiseBackend TerrainGenerator::getNoiseBackend() const {
+    return m_backend;
+}
+
+void TerrainGenerator::setTileSize(int tileSize) {
+    m_tileSize = std::max(8, std::min(tileSize, MAX_TILE_SIZE));
+}
+
+int TerrainGenerator::getTileSize() const {
+    return m_tileSize;
+}
+
+void TerrainGenerator::setCancelFlag(const std::atomic<bool>* cancel) {
+    m_cancel = cancel;
+}
+
+void TerrainGenerator::generate(World& world) {
+    generateRegion(world, 0, 0, world.getWidth(), world.getHeight());
+}
+
+void TerrainGenerator::generateRegion(World& out, int originX, int originY, int worldWidth, int worldHeight) {
+    const int width = out.getWidth();
+    const int height = out.getHeight();
+    TG_PROFILE_SCOPE("terrain_noise", (double)width * height);
+    const int tilesX = (width + m_tileSize - 1) / m_tileSize;
+    const int tilesY = (height + m_tileSize - 1) / m_tileSize;
+
+    m_pool->parallelFor(tilesX * tilesY, [&](int tile) {
+        if (cancelled()) return;
+
+        int tileX = (tile % tilesX) * m_tileSize;
+        int tileY = (tile / tilesX) * m_tileSize;
+        int tileW = std::min(m_tileSize, width - tileX);
+        int tileH = std::min(m_tileSize, height - tileY);
+        generateTile(out, tileX, tileY, tileW, tileH, originX, originY, worldWidth, worldHeight);
+    });
+}
+
+void TerrainGenerator::generateLevel(World& out, int level, int worldWidth, int worldHeight, const World* coarser) {
+    const int width = out.getWidth();
+    const int height = out.getHeight();
+    TG_PROFILE_SCOPE("terrain_noise", (double)width * height);
+    const int tilesX = (width + m_tileSize - 1) / m_tileSize;
+    const int tilesY = (height + m_tileSize - 1) / m_tileSize;
+    const int stride = 1 << level;
+
+    m_pool->parallelFor(tilesX * tilesY, [&](int tile) {
+        if (cancelled()) return;
+
+        const int tileX = (tile % tilesX) * m_tileSize;
+        const int tileY = (tile / tilesX) * m_tileSize;
+        const int endX = std::min(tileX + m_tileSize, width);
+        const int endY = std::min(tileY + m_tileSize, height);
+
+        for (int y = tileY; y < endY; ++y) {
+            if (!coarser || (y & 1)) {
+                generateSpan(out, tileX, y, 1, endX - tileX, tileX * stride, stride, y * stride, worldWidth, worldHeight);
+                continue;
+            }
+
+            // Even rows: even columns are the coarser level's tiles
+            const size_t from = (size_t)(y / 2) * coarser->getWidth();
+            const size_t to = (size_t)y * width;
+            for (int x = tileX + (tileX & 1); x < endX; x += 2) {
+                out.heightPlane()[to + x] = coarser->heightPlane()[from + x / 2];
+                out.moisturePlane()[to + x] = coarser->moisturePlane()[from + x / 2];
+                out.temperaturePlane()[to + x] = coarser->temperaturePlane()[from + x / 2];
+                out.biomePlane()[to + x] = coarser->biomePlane()[from + x / 2];
+            }
+
+            const int firstOdd = tileX | 1;
+            if (firstOdd < endX) {
+                generateSpan(out, firstOdd, y, 2, (endX - firstOdd + 1) / 2,
+                    firstOdd * stride, 2 * stride, y * stride, worldWidth, worldHeight);
+            }
+        }
+    });
+}
+
+void TerrainGenerator::generateProgressive(WorldPyramid& pyramid, const std::function<void(int level)>& onLevel) {
+    for (int level = pyramid.getLevelCount() - 1; level >= 0; --level) {
+        const World* coarser = level + 1 < pyramid.getLevelCount() ? &pyramid.level(level + 1) : nullptr;
+        generateLevel(pyramid.level(level), level, pyramid.getWidth(), pyramid.getHeight(), coarser);
+        if (cancelled()) return;
+        if (onLevel) onLevel(level);
+    }
+}
+
+bool TerrainGenerator::cancelled() const {
+    return m_cancel && m_cancel->load(std::memory_order_relaxed);
+}
+
+ChunkGenerator TerrainGenerator::chunkGenerator(int worldWidth, int worldHeight) {
+    return [this, worldWidth, worldHeight](World& chunk, int originX, int originY) {
+        generateRegion(chunk, originX, originY, worldWidth, worldHeight);
+    };
+}
+
+void TerrainGenerator::generateTile(World& out, int tileX, int tileY, int tileW, int tileH,
+    int originX, int originY, int worldWidth, int worldHeight) const {
+    for (int y = tileY; y < tileY + tileH; ++y) {
+        generateSpan(out, tileX, y, 1, tileW, originX + tileX, 1, originY + y, worldWidth, worldHeight);
+    }
+}
+
+void TerrainGenerator::generateSpan(World& out, int outX, int outY, int outStride, int count,
+    int worldX, int worldStride, int worldY, int worldWidth, int worldHeight) const {
+    switch (m_backend) {
+    case noise::NoiseBackend::Perlin:
+        generateSpan(m_perlin, out, outX, outY, outStride, count, worldX, worldStride, worldY, worldWidth, worldHeight);
+        break;
+    case noise::NoiseBackend::OpenSimplex2:
+        generateSpan(m_simplex, out, outX, outY, outStride, count, worldX, worldStride, worldY, worldWidth, worldHeight);
+        break;
+    case noise::NoiseBackend::Value:
+        generateSpan(m_value, out, outX, outY, outStride, count, worldX, worldStride, worldY, worldWidth, worldHeight);
+        break;
+    }
+}
+
+template <typename Backend>
+void TerrainGenerator::generateSpan(const Backend* generators, World& out, int outX, int outY, int outStride, int count,
+    int worldX, int worldStride, int worldY, int worldWidth, int worldHeight) const {
+    const Backend* layers[(int)noise::NoiseLayer::Count] = { &generators[0], &generators[1], &generators[2] };
+    const noise::RowContext<Backend> row{ layers, worldX, worldStride, worldY, worldWidth, worldHeight, count, 1.0f };
+
+    float heights[MAX_TILE_SIZE];
+    float moistures[MAX_TILE_SIZE];
+    float temperatures[MAX_TILE_SIZE];
+    Biome biomes[MAX_TILE_SIZE];
+
+    m_recipe.evaluateRow(row, heights, moistures, temperatures);
+    defaultClassifier().classify(heights, moistures, temperatures, biomes, count);
+
+    float* heightRow = out.heightPlane().row(outY) + outX;
+    float* moistureRow = out.moisturePlane().row(outY) + outX;
+    float* temperatureRow = out.temperaturePlane().row(outY) + outX;
+    Biome* biomeRow = out.biomePlane().row(outY) + outX;
+
+    for (int i = 0; i < count; ++i) {
+        const int o = i * outStride;
+        heightRow[o] = heights[i];
+        moistureRow[o] = moistures[i];
+        temperatureRow[o] = temperatures[i];
+        biomeRow[o] = biomes[i];
+    }
+}
+
+// ---------------- BIOME DECISION ----------------
+
+void TerrainGenerator::classifyBiomes(World& world, const BiomeRules& rules) {
+    if (std::memcmp(&rules, &m_classifierRules, sizeof(BiomeRules)) != 0) {
+        m_classifier.setRules(BiomeRuleSet::fromRules(rules));
+        m_classifierRules = rules;
+    }
+    classifyBiomes(world, m_classifier);
+}
+
+void TerrainGenerator::classifyBiomes(World& world, const BiomeClassifier& classifier) {
+    const int rows = 64;
+    const int width = world.getWidth();
+    const int height = world.getHeight();
+    TG_PROFILE_SCOPE("classify_biomes", (double)width * height);
+
+    m_pool->parallelFor((height + rows - 1) / rows, [&](int band) {
+        const size_t begin = (size_t)band * rows * width;
+        const size_t end = (size_t)std::min(height, (band + 1) * rows) * width;
+        const float* heights = world.heightPlane().data();
+        const float* moistures = world.moisturePlane().data();
+        const float* temperatures = world.temperaturePlane().data();
+        Biome* biomes = world.biomePlane().data();
+
+        classifier.classify(heights + begin, moistures + begin, temperatures + begin, biomes + begin, end - begin);
+    });
+}
+
+Biome TerrainGenerator::determineBiome(float height, float moisture, float temperature) {
+    return determineBiome(height, moisture, temperature, BiomeRules());
+}
+
+Biome TerrainGenerator::determineBiome(float height, float moisture, float temperature, const BiomeRules& rules) {
+    if (height < rules.oceanLevel)
+        return Biome::Ocean;
+
+    if (height < rules.beachLevel)
+        return Biome::Beach;
+
+    if (height > rules.mountainLevel) {
+        // Snow caps on very tall mountains in cold areas
+        if (height > rules.snowLevel && temperature < rules.snowTemperature)
+            return Biome::Tundra;
+        return Biome::Mountain;
+    }
+
+    // Cold regions (polar/high latitude); cold deserts still look tundra-ish
+    if (temperature < rules.polarTemperature)
+        return Biome::Tundra;
+
+    // Temperate cold
+    if (temperature < rules.coolTemperature) {
+        if (moisture > rules.borealForestMoisture)
+            return Biome::Forest; // Boreal/Taiga forest
+        return Biome::Plains;
+    }
+
+    // Temperate
+    if (temperature < rules.temperateTemperature) {
+        if (moisture > rules.temperateForestMoisture)
+            return Biome::Forest; // Temperate forest
+        return Biome::Plains; // Grasslands and dry plains
+    }
+
+    // Hot regions
+    if (moisture < rules.desertMoisture)
+        return Biome::Desert; // Hot desert
+
+    if (moisture < rules.tropicalForestMoisture)
+        return Biome::Plains; // Savanna/dry grassland
+
+    return Biome::Forest; // Tropical/subtropical forest
+}
@@ -1 +1,123 @@
 #pragma once
+
+#include "BiomeClassifier.h"
+#include "BiomeRules.h"
+#include "TerrainRecipe.h"
+#include "noise/NoiseBackend.h"
+#include "noise/OpenSimplex2.h"
+#include "noise/PerlinNoise.h"
+#include "noise/ValueNoise.h"
+#include "util/ThreadPool.h"
+#include "world/ChunkedWorld.h"
+#include "world/World.h"
+#include "world/WorldPyramid.h"
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Fills height, moisture, temperature and biome for every tile.
+// The map is cut into square tiles that are spread over a thread pool;
+// every tile only reads the noise generators, so the output is identical
+// for any thread count or tile size.
+class TerrainGenerator {
+public:
+    TerrainGenerator(unsigned int heightSeed, unsigned int moistureSeed, unsigned int temperatureSeed);
+
+    // Derives the three noise seeds from a single world seed
+    explicit TerrainGenerator(unsigned int worldSeed);
+
+    // Reseeds from a world seed without reallocating anything
+    void setSeed(unsigned int worldSeed);
+
+    // Worker threads (including the caller); 0 = all hardware threads
+    void setThreadCount(int threadCount);
+    int getThreadCount() const;
+
+    // How height, moisture and temperature are made from the noise;
+    // TerrainRecipe::continent() unless set
+    void setRecipe(const TerrainRecipe& recipe);
+    const TerrainRecipe& getRecipe() const;
+
+    // Noise every layer is sampled with; Perlin unless set. Value noise
+    // trades quality for speed (e.g. for previews), OpenSimplex2 the other
+    // way round. Every backend is seeded, so switching is free.
+    void setNoiseBackend(noise::NoiseBackend backend);
+    noise::NoiseBackend getNoiseBackend() const;
+
+    // Edge length of the square tiles handed to each task
+    void setTileSize(int tileSize);
+    int getTileSize() const;
+
+    // While *cancel is set, remaining tiles are skipped and generate returns
+    // early with partial output. nullptr (default) disables the check.
+    void setCancelFlag(const std::atomic<bool>* cancel);
+
+    // Generate the whole world
+    void generate(World& world);
+
+    // Generate a window of a larger world: out.at(0, 0) is tile
+    // (originX, originY) of a worldWidth x worldHeight map
+    void generateRegion(World& out, int originX, int originY, int worldWidth, int worldHeight);
+
+    // Generate one pyramid level of a worldWidth x worldHeight map: out.at(x, y)
+    // is tile (x << level, y << level). If coarser holds level + 1, its tiles
+    // are copied instead of computed, so only 3 in 4 tiles cost noise.
+    void generateLevel(World& out, int level, int worldWidth, int worldHeight, const World* coarser = nullptr);
+
+    // Coarse to fine: fills the coarsest level first, then refines level by
+    // level down to level 0, which ends up identical to generate(). Each
+    // noise sample is computed once. onLevel(level) runs as soon as a level
+    // is complete, e.g. to show a preview.
+    void generateProgressive(WorldPyramid& pyramid, const std::function<void(int level)>& onLevel = nullptr);
+
+    // Chunk source for a ChunkedWorld. worldWidth/worldHeight only set the
+    // noise scale and island mask; chunks outside them are still generated.
+    // The generator must outlive the returned function.
+    ChunkGenerator chunkGenerator(int worldWidth, int worldHeight);
+
+    // Re-derive every biome from height, moisture and temperature, so the
+    // rules can change without regenerating the noise. The lookup table
+    // for the rules is kept and only rebuilt when a threshold changes.
+    void classifyBiomes(World& world, const BiomeRules& rules);
+
+    // Same with an already compiled (e.g. loaded) rule set
+    void classifyBiomes(World& world, const BiomeClassifier& classifier);
+
+    // Biome rules (reference implementation; generation and classifyBiomes
+    // use the equivalent BiomeClassifier table)
+    static Biome determineBiome(float height, float moisture, float temperature);
+    static Biome determineBiome(float height, float moisture, float temperature, const BiomeRules& rules);
+
+    // Largest supported tile edge (bounds the per-task row buffers)
+    static constexpr int MAX_TILE_SIZE = noise::MAX_ROW;
+
+private:
+    // One generator per noise::NoiseLayer and backend
+    PerlinNoise m_perlin[(int)noise::NoiseLayer::Count];
+    OpenSimplex2Noise m_simplex[(int)noise::NoiseLayer::Count];
+    ValueNoise m_value[(int)noise::NoiseLayer::Count];
+    noise::NoiseBackend m_backend = noise::NoiseBackend::Perlin;
+    TerrainRecipe m_recipe;
+
+    std::unique_ptr<ThreadPool> m_pool;
+    int m_tileSize = 64;
+    const std::atomic<bool>* m_cancel = nullptr;
+
+    BiomeRules m_classifierRules; // rules m_classifier was compiled from
+    BiomeClassifier m_classifier;
+
+    bool cancelled() const;
+
+    void generateTile(World& out, int tileX, int tileY, int tileW, int tileH,
+        int originX, int originY, int worldWidth, int worldHeight) const;
+
+    // Tiles i in [0, count) of row outY: out (outX + i * outStride, outY)
+    // is world tile (worldX + i * worldStride, worldY); count <= MAX_TILE_SIZE
+    void generateSpan(World& out, int outX, int outY, int outStride, int count,
+        int worldX, int worldStride, int worldY, int worldWidth, int worldHeight) const;
+
+    // generateSpan on one backend's generators
+    template <typename Backend>
+    void generateSpan(const Backend* generators, World& out, int outX, int outY, int outStride, int count,
+        int worldX, int worldStride, int worldY, int worldWidth, int worldHeight) const;
+};
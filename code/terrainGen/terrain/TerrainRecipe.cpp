@@ -0,0 +1,70 @@
+#include "TerrainRecipe.h"
+
+#include <algorithm>
+
+namespace {
+
+using namespace noise;
+
+// Moisture rises near water; shared by the built-in recipes
+auto moistureGraph() {
+    auto base = remap(scale(3.5f, fbm(NoiseLayer::Moisture, 4, 2.1f, 0.5f)), -1.0f, 1.0f, 0.0f, 1.0f);
+    auto nearWater = apply(base, height(), [](float moisture, float h) {
+        return h < 0.45f ? std::min(1.0f, moisture + 0.3f) : moisture;
+    });
+    return clamp(nearWater, 0.0f, 1.0f);
+}
+
+// Regional variation, cooler with elevation (no latitude gradient)
+auto temperatureGraph() {
+    auto base = remap(scale(2.8f, fbm(NoiseLayer::Temperature, 4, 2.0f, 0.5f)), -1.0f, 1.0f, 0.0f, 1.0f);
+    auto elevationCooling = smoothstep(0.5f, 0.85f, height()) * 0.35f;
+    return clamp(base * 0.85f + 0.15f - elevationCooling, 0.0f, 1.0f);
+}
+
+} // namespace
+
+TerrainRecipe::TerrainRecipe()
+    : TerrainRecipe(continent())
+{
+}
+
+TerrainRecipe TerrainRecipe::continent() {
+    // Landmass shape, hills and valleys, fine detail
+    auto continents = scale(2.2f, fbm(NoiseLayer::Height, 3, 2.0f, 0.5f));
+    auto mediumDetail = scale(5.0f, fbm(NoiseLayer::Height, 4, 2.0f, 0.5f));
+    auto fineDetail = scale(12.0f, fbm(NoiseLayer::Height, 3, 2.0f, 0.4f));
+    auto blended = continents * 0.55f + mediumDetail * 0.3f + fineDetail * 0.15f;
+
+    // A single continent with natural coastlines
+    auto island = blended * (0.3f + 0.7f * radialMask(0.25f, 0.48f));
+    auto heightGraph = clamp(remap(island, -1.0f, 1.0f, 0.0f, 1.0f), 0.0f, 1.0f);
+
+    static const TerrainRecipe recipe = compile(heightGraph, moistureGraph(), temperatureGraph());
+    return recipe;
+}
+
+TerrainRecipe TerrainRecipe::archipelago() {
+    // Island-sized features, only a gentle falloff towards the map edge,
+    // and everything lowered so most of the map is shallow sea
+    auto islands = scale(6.0f, fbm(NoiseLayer::Height, 4, 2.0f, 0.5f));
+    auto detail = scale(14.0f, fbm(NoiseLayer::Height, 3, 2.0f, 0.45f));
+    auto blended = islands * 0.75f + detail * 0.25f;
+
+    auto sea = blended * (0.6f + 0.4f * radialMask(0.3f, 0.6f)) - 0.14f;
+    auto heightGraph = clamp(remap(sea, -0.8f, 0.8f, 0.0f, 1.0f), 0.0f, 1.0f);
+
+    static const TerrainRecipe recipe = compile(heightGraph, moistureGraph(), temperatureGraph());
+    return recipe;
+}
+
+bool TerrainRecipe::byName(const std::string& name, TerrainRecipe& out) {
+    if (name == "continent") out = continent();
+    else if (name == "archipelago") out = archipelago();
+    else return false;
+    return true;
+}
+
+std::vector<std::string> TerrainRecipe::names() {
+    return { "continent", "archipelago" };
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "noise/NoiseGraph.h"
+#include "noise/OpenSimplex2.h"
+#include "noise/ValueNoise.h"
+#include <memory>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+// How a map's height, moisture and temperature come out of the noise: three
+// noise graphs (see noise/NoiseGraph.h) compiled into one row kernel.
+//
+//     using namespace noise;
+//     auto height = clamp(remap(scale(4.0f, fbm(NoiseLayer::Height, 5, 2.0f, 0.5f)),
+//         -1.0f, 1.0f, 0.0f, 1.0f), 0.0f, 1.0f);
+//     TerrainRecipe recipe = TerrainRecipe::compile(height, moisture, temperature);
+//     generator.setRecipe(recipe);
+//
+// compile() instantiates the kernel for the graphs' exact types and for
+// every noise backend, so a new recipe runs as fast as a hand-written loop
+// whichever backend the generator uses. Recipes are cheap to copy and
+// safe to share between threads.
+class TerrainRecipe {
+public:
+    // The built-in continent recipe
+    TerrainRecipe();
+
+    template <typename H, typename M, typename T>
+    static TerrainRecipe compile(const H& height, const M& moisture, const T& temperature);
+
+    // Fills one row of count <= noise::MAX_ROW tiles
+    template <typename Backend>
+    void evaluateRow(const noise::RowContext<Backend>& row, float* heights, float* moistures, float* temperatures) const {
+        std::get<Kernel<Backend>>(m_kernels)(m_graphs.get(), row, heights, moistures, temperatures);
+    }
+
+    // Built-in recipes:
+    //   continent    one island continent (the default)
+    //   archipelago  many smaller islands over shallow seas
+    static TerrainRecipe continent();
+    static TerrainRecipe archipelago();
+
+    // Built-in recipe by name; false if there is none
+    static bool byName(const std::string& name, TerrainRecipe& out);
+    static std::vector<std::string> names();
+
+private:
+    template <typename Backend>
+    using Kernel = void (*)(const void* graphs, const noise::RowContext<Backend>& row,
+        float* heights, float* moistures, float* temperatures);
+
+    using Kernels = std::tuple<Kernel<PerlinNoise>, Kernel<OpenSimplex2Noise>, Kernel<ValueNoise>>;
+
+    template <typename H, typename M, typename T>
+    struct Graphs {
+        H height;
+        M moisture;
+        T temperature;
+    };
+
+    template <typename G, typename Backend>
+    static void runKernel(const void* graphs, const noise::RowContext<Backend>& row,
+        float* heights, float* moistures, float* temperatures) {
+        const G& g = *static_cast<const G*>(graphs);
+        noise::evaluateRow(g.height, g.moisture, g.temperature, row, heights, moistures, temperatures);
+    }
+
+    TerrainRecipe(std::shared_ptr<const void> graphs, Kernels kernels)
+        : m_graphs(std::move(graphs)), m_kernels(kernels) {}
+
+    std::shared_ptr<const void> m_graphs;
+    Kernels m_kernels;
+};
+
+template <typename H, typename M, typename T>
+TerrainRecipe TerrainRecipe::compile(const H& height, const M& moisture, const T& temperature) {
+    using G = Graphs<H, M, T>;
+    return TerrainRecipe(std::make_shared<const G>(G{ height, moisture, temperature }),
+        Kernels(&runKernel<G, PerlinNoise>, &runKernel<G, OpenSimplex2Noise>, &runKernel<G, ValueNoise>));
+}
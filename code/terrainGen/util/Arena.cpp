@@ -0,0 +1,74 @@
+#include "Arena.h"
+
+#include <new>
+
+namespace {
+
+size_t alignUp(size_t bytes) {
+    return (bytes + MonotonicArena::ALIGNMENT - 1) & ~(MonotonicArena::ALIGNMENT - 1);
+}
+
+void* allocateAligned(size_t bytes) {
+    return ::operator new(bytes, std::align_val_t(MonotonicArena::ALIGNMENT));
+}
+
+void freeAligned(void* memory) {
+    ::operator delete(memory, std::align_val_t(MonotonicArena::ALIGNMENT));
+}
+
+} // namespace
+
+MonotonicArena::MonotonicArena(size_t capacity) {
+    if (capacity > 0) {
+        m_capacity = alignUp(capacity);
+        m_block = static_cast<char*>(allocateAligned(m_capacity));
+    }
+}
+
+MonotonicArena::~MonotonicArena() {
+    release();
+}
+
+void* MonotonicArena::allocateBytes(size_t bytes) {
+    bytes = alignUp(bytes > 0 ? bytes : 1);
+
+    // Offsets advance the same way whether or not the block has room, so
+    // the peak is exactly the block size that fits this round next time
+    const size_t offset = m_used;
+    m_used += bytes;
+    if (m_used > m_peak) m_peak = m_used;
+
+    if (m_used <= m_capacity) return m_block + offset;
+
+    void* memory = allocateAligned(bytes);
+    m_overflow.push_back({ memory, offset });
+    return memory;
+}
+
+void MonotonicArena::rewind(size_t mark) {
+    assert(mark <= m_used);
+    while (!m_overflow.empty() && m_overflow.back().offset >= mark) {
+        freeAligned(m_overflow.back().memory);
+        m_overflow.pop_back();
+    }
+    m_used = mark;
+
+    // Empty again after outgrowing the block: grow it to fit everything
+    if (m_used == 0 && m_peak > m_capacity) {
+        if (m_block) freeAligned(m_block);
+        m_block = static_cast<char*>(allocateAligned(m_peak));
+        m_capacity = m_peak;
+    }
+}
+
+void MonotonicArena::release() {
+    for (const Overflow& overflow : m_overflow) {
+        freeAligned(overflow.memory);
+    }
+    m_overflow.clear();
+    if (m_block) freeAligned(m_block);
+    m_block = nullptr;
+    m_capacity = 0;
+    m_used = 0;
+    m_peak = 0;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Bump allocator for per-generation scratch memory.
+//
+// Allocations are carved from one block and released together: rewind(mark)
+// drops everything allocated after mark(), reset() drops everything. When a
+// round of work needs more than the block holds, the excess comes from the
+// heap and the block is regrown to the high-water mark once the arena is
+// empty again, so repeating the same work never touches the heap.
+//
+// Not thread-safe: allocate on the calling thread before a parallel pass,
+// then let the jobs write into the memory.
+class MonotonicArena {
+public:
+    static const size_t ALIGNMENT = 64;
+
+    explicit MonotonicArena(size_t capacity = 0);
+    ~MonotonicArena();
+
+    MonotonicArena(const MonotonicArena&) = delete;
+    MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+    // Uninitialised, ALIGNMENT-aligned memory; valid until rewound past
+    void* allocateBytes(size_t bytes);
+
+    template <typename T>
+    T* allocate(size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "MonotonicArena only holds plain values");
+        return static_cast<T*>(allocateBytes(count * sizeof(T)));
+    }
+
+    size_t mark() const { return m_used; }
+    void rewind(size_t mark);
+    void reset() { rewind(0); }
+
+    // Frees the block as well; the next round starts from an empty arena
+    void release();
+
+    size_t getCapacity() const { return m_capacity; }
+    size_t getUsed() const { return m_used; }
+    size_t getPeak() const { return m_peak; }
+
+private:
+    struct Overflow {
+        void* memory;
+        size_t offset; // m_used before the allocation
+    };
+
+    char* m_block = nullptr;
+    size_t m_capacity = 0;
+    size_t m_used = 0;
+    size_t m_peak = 0;
+    std::vector<Overflow> m_overflow;
+};
+
+// Rewinds an arena to where it was when the scope was entered
+class ArenaScope {
+public:
+    explicit ArenaScope(MonotonicArena& arena) : m_arena(arena), m_mark(arena.mark()) {}
+    ~ArenaScope() { m_arena.rewind(m_mark); }
+
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+
+private:
+    MonotonicArena& m_arena;
+    size_t m_mark;
+};
+
+// Growable array of plain values in an arena. Growing leaves the old
+// storage behind until the arena is rewound, so reserve() what you can.
+template <typename T>
+class ArenaVector {
+    static_assert(std::is_trivially_copyable<T>::value, "ArenaVector only holds plain values");
+
+public:
+    explicit ArenaVector(MonotonicArena& arena, size_t capacity = 0) : m_arena(&arena) {
+        reserve(capacity);
+    }
+
+    void reserve(size_t capacity) {
+        if (capacity <= m_capacity) return;
+        T* data = m_arena->allocate<T>(capacity);
+        if (m_size > 0) std::memcpy(data, m_data, m_size * sizeof(T));
+        m_data = data;
+        m_capacity = capacity;
+    }
+
+    void push_back(const T& value) {
+        if (m_size == m_capacity) reserve(m_capacity < 16 ? 16 : m_capacity * 2);
+        m_data[m_size++] = value;
+    }
+
+    void pop_back() {
+        assert(m_size > 0);
+        --m_size;
+    }
+
+    void clear() { m_size = 0; }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    T* data() { return m_data; }
+    const T* data() const { return m_data; }
+    T* begin() { return m_data; }
+    T* end() { return m_data + m_size; }
+    const T* begin() const { return m_data; }
+    const T* end() const { return m_data + m_size; }
+
+    T& operator[](size_t i) { return m_data[i]; }
+    const T& operator[](size_t i) const { return m_data[i]; }
+    T& back() { return m_data[m_size - 1]; }
+    const T& back() const { return m_data[m_size - 1]; }
+
+private:
+    MonotonicArena* m_arena;
+    T* m_data = nullptr;
+    size_t m_size = 0;
+    size_t m_capacity = 0;
+};
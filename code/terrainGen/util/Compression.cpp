@@ -0,0 +1,156 @@
+#include "Compression.h"
+
+#include <cstring>
+
+namespace {
+
+const int HASH_BITS = 14;
+const size_t MIN_MATCH = 4;
+const size_t MAX_OFFSET = 65535;
+const size_t TAIL_LITERALS = 5; // never start a match this close to the end
+
+uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t hashSequence(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Lengths >= 15 continue in 255-valued bytes
+void putLength(std::vector<uint8_t>& out, size_t length) {
+    while (length >= 255) {
+        out.push_back(255);
+        length -= 255;
+    }
+    out.push_back((uint8_t)length);
+}
+
+bool getLength(const uint8_t*& ip, const uint8_t* end, size_t& length) {
+    uint8_t b;
+    do {
+        if (ip >= end) return false;
+        b = *ip++;
+        length += b;
+    } while (b == 255);
+    return true;
+}
+
+void putSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalCount,
+    size_t offset, size_t matchLength) {
+    const size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+    uint8_t token = (uint8_t)((literalCount < 15 ? literalCount : 15) << 4);
+    token |= (uint8_t)(matchCode < 15 ? matchCode : 15);
+    out.push_back(token);
+
+    if (literalCount >= 15) putLength(out, literalCount - 15);
+    out.insert(out.end(), literals, literals + literalCount);
+
+    if (matchLength == 0) return;
+    out.push_back((uint8_t)offset);
+    out.push_back((uint8_t)(offset >> 8));
+    if (matchCode >= 15) putLength(out, matchCode - 15);
+}
+
+} // namespace
+
+void lzCompress(const uint8_t* src, size_t size, std::vector<uint8_t>& out) {
+    // Positions + 1 of the last occurrence of each hashed 4-byte sequence
+    static thread_local uint32_t table[1 << HASH_BITS];
+    std::memset(table, 0, sizeof(table));
+
+    size_t anchor = 0;
+    size_t i = 0;
+    const size_t limit = size > TAIL_LITERALS + MIN_MATCH ? size - TAIL_LITERALS : 0;
+
+    while (i < limit) {
+        const uint32_t sequence = read32(src + i);
+        const uint32_t h = hashSequence(sequence);
+        const size_t candidate = table[h];
+        table[h] = (uint32_t)(i + 1);
+
+        if (candidate == 0 || i - (candidate - 1) > MAX_OFFSET || read32(src + candidate - 1) != sequence) {
+            ++i;
+            continue;
+        }
+
+        const size_t match = candidate - 1;
+        size_t length = MIN_MATCH;
+        while (i + length < size && src[match + length] == src[i + length]) ++length;
+
+        putSequence(out, src + anchor, i - anchor, i - match, length);
+        i += length;
+        anchor = i;
+    }
+
+    putSequence(out, src + anchor, size - anchor, 0, 0);
+}
+
+bool lzDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize) {
+    const uint8_t* ip = src;
+    const uint8_t* const iend = src + srcSize;
+    uint8_t* op = dst;
+    uint8_t* const oend = dst + dstSize;
+
+    while (ip < iend) {
+        const uint8_t token = *ip++;
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !getLength(ip, iend, literals)) return false;
+        if ((size_t)(iend - ip) < literals || (size_t)(oend - op) < literals) return false;
+        std::memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+
+        if (ip == iend) break; // last record
+
+        if (iend - ip < 2) return false;
+        const size_t offset = ip[0] | ((size_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - dst)) return false;
+
+        size_t length = token & 15;
+        if (length == 15 && !getLength(ip, iend, length)) return false;
+        length += MIN_MATCH;
+        if ((size_t)(oend - op) < length) return false;
+
+        // An overlapping match repeats the last `offset` bytes; copying whole
+        // periods keeps every memcpy disjoint and doubles the step each time
+        size_t distance = offset;
+        while (length > 0) {
+            const size_t n = length < distance ? length : distance;
+            std::memcpy(op, op - distance, n);
+            op += n;
+            length -= n;
+            distance += n;
+        }
+    }
+
+    return op == oend;
+}
+
+void shuffleDelta32(const uint8_t* src, size_t count, uint8_t* dst) {
+    uint32_t previous = 0;
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t value = read32(src + i * 4);
+        const uint32_t delta = value ^ previous;
+        previous = value;
+        for (int b = 0; b < 4; ++b) {
+            dst[b * count + i] = (uint8_t)(delta >> (8 * b));
+        }
+    }
+}
+
+void unshuffleDelta32(const uint8_t* src, size_t count, uint8_t* dst) {
+    uint32_t previous = 0;
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t delta = 0;
+        for (int b = 0; b < 4; ++b) {
+            delta |= (uint32_t)src[b * count + i] << (8 * b);
+        }
+        previous ^= delta;
+        std::memcpy(dst + i * 4, &previous, 4);
+    }
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Small LZ77 block codec for the world archive: byte-oriented like LZ4,
+// no entropy stage, so decompression runs at memory speed. No external
+// dependency.
+//
+// A block is a sequence of [token][literal length+][literals][offset:16]
+// [match length+] records; the last record has literals only.
+
+// Appends the compressed form of src[0, size) to out
+void lzCompress(const uint8_t* src, size_t size, std::vector<uint8_t>& out);
+
+// Decompresses a block into exactly dstSize bytes. Returns false on
+// malformed input; never reads or writes out of bounds.
+bool lzDecompress(const uint8_t* src, size_t srcSize, uint8_t* dst, size_t dstSize);
+
+// Reversible pre-filter for planes of 4-byte values (floats, ints):
+// XOR each value with its predecessor, then group byte 0 of every value,
+// then byte 1, ... Smooth fields turn into long runs of equal bytes.
+void shuffleDelta32(const uint8_t* src, size_t count, uint8_t* dst);
+void unshuffleDelta32(const uint8_t* src, size_t count, uint8_t* dst);
@@ -0,0 +1,233 @@
+#include "Deflate.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const uint64_t WINDOW = 32768;
+const uint64_t WINDOW_MASK = WINDOW - 1;
+const int HASH_BITS = 15;
+const int MIN_MATCH = 3;
+const int MAX_MATCH = 258;
+const size_t STEP = 256 * 1024; // input compressed at a time
+
+// Positions inside longer matches are not hashed, as in zlib's faster
+// levels: runs of map colour would otherwise hash every byte
+const int MAX_INSERT_LENGTH = 16;
+
+int floorLog2(uint32_t value) {
+    int log = 0;
+    while (value >>= 1) ++log;
+    return log;
+}
+
+uint32_t reverseBits(uint32_t value, int count) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < count; ++i) {
+        reversed = reversed << 1 | (value & 1);
+        value >>= 1;
+    }
+    return reversed;
+}
+
+// The fixed Huffman codes of RFC 1951 3.2.6, bit-reversed for LSB-first
+// output, and the length symbols with their extra bits
+struct FixedCodes {
+    uint16_t code[288];
+    uint8_t bits[288];
+    uint16_t lengthSymbol[MAX_MATCH + 1];
+    uint8_t lengthExtraBits[MAX_MATCH + 1];
+    uint8_t lengthExtra[MAX_MATCH + 1];
+
+    FixedCodes() {
+        for (int s = 0; s < 288; ++s) {
+            uint32_t value;
+            int count;
+            if (s < 144) { value = 0x30 + s; count = 8; }
+            else if (s < 256) { value = 0x190 + (s - 144); count = 9; }
+            else if (s < 280) { value = s - 256; count = 7; }
+            else { value = 0xC0 + (s - 280); count = 8; }
+            code[s] = (uint16_t)reverseBits(value, count);
+            bits[s] = (uint8_t)count;
+        }
+
+        for (int length = MIN_MATCH; length <= MAX_MATCH; ++length) {
+            const uint32_t x = (uint32_t)(length - MIN_MATCH);
+            if (length == MAX_MATCH) {
+                lengthSymbol[length] = 285;
+                lengthExtraBits[length] = 0;
+                lengthExtra[length] = 0;
+            }
+            else if (x < 8) {
+                lengthSymbol[length] = (uint16_t)(257 + x);
+                lengthExtraBits[length] = 0;
+                lengthExtra[length] = 0;
+            }
+            else {
+                const int log = floorLog2(x);
+                lengthSymbol[length] = (uint16_t)(257 + 4 * (log - 1) + ((x >> (log - 2)) & 3));
+                lengthExtraBits[length] = (uint8_t)(log - 2);
+                lengthExtra[length] = (uint8_t)(x & ((1u << (log - 2)) - 1));
+            }
+        }
+    }
+};
+
+const FixedCodes& fixedCodes() {
+    static const FixedCodes codes;
+    return codes;
+}
+
+// Length of the common prefix of a and b, at most maxLength
+int matchLength(const uint8_t* a, const uint8_t* b, int maxLength) {
+    int length = 0;
+    while (length + 8 <= maxLength) {
+        uint64_t x, y;
+        std::memcpy(&x, a + length, 8);
+        std::memcpy(&y, b + length, 8);
+        if (x != y) break;
+        length += 8;
+    }
+    while (length < maxLength && a[length] == b[length]) ++length;
+    return length;
+}
+
+uint32_t hash3(const uint8_t* p) {
+    const uint32_t sequence = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16;
+    return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+} // namespace
+
+DeflateEncoder::DeflateEncoder(int chainLength)
+    : m_chainLength(std::max(1, chainLength)),
+    m_head((size_t)1 << HASH_BITS, 0),
+    m_prev(WINDOW, 0)
+{
+}
+
+void DeflateEncoder::write(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    if (!m_started) {
+        putBits(1, 1, out); // BFINAL: the whole stream is one block
+        putBits(1, 2, out); // BTYPE = fixed Huffman codes
+        m_started = true;
+    }
+
+    m_buffer.insert(m_buffer.end(), data, data + size);
+
+    // Keep MAX_MATCH bytes of lookahead so no match is cut short by a step
+    const uint64_t end = m_base + m_buffer.size();
+    if (end - m_pos >= STEP + MAX_MATCH) {
+        compress(end - MAX_MATCH, out);
+        slide();
+    }
+}
+
+void DeflateEncoder::finish(std::vector<uint8_t>& out) {
+    write(nullptr, 0, out);
+    compress(m_base + m_buffer.size(), out);
+    putSymbol(256, out); // end of block
+    if (m_bitCount > 0) putBits(0, 8 - m_bitCount, out);
+
+    m_buffer.clear();
+    m_base = 0;
+    m_pos = 0;
+    std::fill(m_head.begin(), m_head.end(), 0);
+    std::fill(m_prev.begin(), m_prev.end(), 0);
+    m_started = false;
+}
+
+void DeflateEncoder::compress(uint64_t end, std::vector<uint8_t>& out) {
+    const uint64_t size = m_base + m_buffer.size();
+
+    while (m_pos < end) {
+        const uint8_t* current = &m_buffer[m_pos - m_base];
+        const uint64_t available = size - m_pos;
+        int bestLength = 0;
+        uint64_t bestDistance = 0;
+
+        if (available >= (uint64_t)MIN_MATCH) {
+            const int maxLength = (int)std::min<uint64_t>(available, MAX_MATCH);
+            uint64_t candidate = m_head[hash3(current)];
+            for (int chain = 0; candidate != 0 && chain < m_chainLength; ++chain) {
+                const uint64_t at = candidate - 1;
+                if (at < m_base || m_pos - at > WINDOW) break;
+
+                const uint8_t* match = &m_buffer[at - m_base];
+                if (match[bestLength] == current[bestLength]) {
+                    const int length = matchLength(match, current, maxLength);
+                    if (length > bestLength) {
+                        bestLength = length;
+                        bestDistance = m_pos - at;
+                        if (length == maxLength) break;
+                    }
+                }
+
+                const uint64_t older = m_prev[at & WINDOW_MASK];
+                if (older >= candidate) break;
+                candidate = older;
+            }
+            insert(m_pos);
+        }
+
+        if (bestLength >= MIN_MATCH) {
+            putMatch(bestLength, (int)bestDistance, out);
+            if (bestLength <= MAX_INSERT_LENGTH) {
+                for (int i = 1; i < bestLength; ++i) {
+                    if (size - (m_pos + i) >= (uint64_t)MIN_MATCH) insert(m_pos + i);
+                }
+            }
+            m_pos += bestLength;
+        }
+        else {
+            putSymbol(*current, out);
+            ++m_pos;
+        }
+    }
+}
+
+void DeflateEncoder::slide() {
+    const uint64_t keep = m_pos > WINDOW ? m_pos - WINDOW : 0;
+    if (keep <= m_base) return;
+    m_buffer.erase(m_buffer.begin(), m_buffer.begin() + (ptrdiff_t)(keep - m_base));
+    m_base = keep;
+}
+
+void DeflateEncoder::insert(uint64_t pos) {
+    const uint32_t hash = hash3(&m_buffer[pos - m_base]);
+    m_prev[pos & WINDOW_MASK] = m_head[hash];
+    m_head[hash] = pos + 1;
+}
+
+void DeflateEncoder::putBits(uint32_t value, int count, std::vector<uint8_t>& out) {
+    m_bits |= (uint64_t)value << m_bitCount;
+    m_bitCount += count;
+    while (m_bitCount >= 8) {
+        out.push_back((uint8_t)m_bits);
+        m_bits >>= 8;
+        m_bitCount -= 8;
+    }
+}
+
+void DeflateEncoder::putSymbol(int symbol, std::vector<uint8_t>& out) {
+    const FixedCodes& codes = fixedCodes();
+    putBits(codes.code[symbol], codes.bits[symbol], out);
+}
+
+void DeflateEncoder::putMatch(int length, int distance, std::vector<uint8_t>& out) {
+    const FixedCodes& codes = fixedCodes();
+    putSymbol(codes.lengthSymbol[length], out);
+    if (codes.lengthExtraBits[length] > 0) putBits(codes.lengthExtra[length], codes.lengthExtraBits[length], out);
+
+    // Distance codes are all 5 bits long
+    const uint32_t x = (uint32_t)(distance - 1);
+    if (x < 4) {
+        putBits(reverseBits(x, 5), 5, out);
+        return;
+    }
+    const int log = floorLog2(x);
+    const uint32_t symbol = 2 * log + ((x >> (log - 1)) & 1);
+    putBits(reverseBits(symbol, 5), 5, out);
+    putBits(x & ((1u << (log - 1)) - 1), log - 1, out);
+}
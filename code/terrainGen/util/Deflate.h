@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Streaming deflate (RFC 1951) encoder for PNG output, built the way
+// stb_image_write compresses: greedy LZ77 over the 32 KB window with hash
+// chains, all in one block of fixed Huffman codes. No external dependency.
+//
+// Input is buffered and compressed in large steps, so it may be fed a row
+// at a time; memory stays at the window plus one step of input.
+
+class DeflateEncoder {
+public:
+    // chainLength: earlier positions tried per match search; longer chains
+    // compress better and run slower
+    explicit DeflateEncoder(int chainLength = 16);
+
+    // Compresses data; finished output bytes are appended to out
+    void write(const uint8_t* data, size_t size, std::vector<uint8_t>& out);
+
+    // Compresses the rest, ends the stream and pads it to a whole byte.
+    // The encoder can then start a new stream.
+    void finish(std::vector<uint8_t>& out);
+
+private:
+    int m_chainLength;
+
+    // Window history followed by input not yet compressed; m_buffer[0] is
+    // stream position m_base
+    std::vector<uint8_t> m_buffer;
+    uint64_t m_base = 0;
+    uint64_t m_pos = 0;   // next stream position to compress
+
+    // Stream position + 1 of the latest occurrence of each 3-byte hash, and
+    // for each window slot the previous position + 1 with the same hash
+    std::vector<uint64_t> m_head;
+    std::vector<uint64_t> m_prev;
+
+    uint64_t m_bits = 0;
+    int m_bitCount = 0;
+    bool m_started = false;
+
+    // Compresses up to stream position end (matches may run past it)
+    void compress(uint64_t end, std::vector<uint8_t>& out);
+
+    // Drops history older than the window
+    void slide();
+
+    void insert(uint64_t pos);
+    void putBits(uint32_t value, int count, std::vector<uint8_t>& out);
+    void putSymbol(int symbol, std::vector<uint8_t>& out);
+    void putMatch(int length, int distance, std::vector<uint8_t>& out);
+};
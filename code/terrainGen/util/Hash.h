@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+const uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+
+// FNV-1a over raw bytes; chain calls by passing the previous result as seed
+inline uint64_t fnv1a(const void* data, size_t size, uint64_t seed = FNV_OFFSET_BASIS) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Folds one plain value (no padding) into a running hash
+template <typename T>
+uint64_t hashValue(uint64_t hash, const T& value) {
+    static_assert(std::is_trivially_copyable<T>::value, "hashValue only hashes plain values");
+    return fnv1a(&value, sizeof(T), hash);
+}
@@ -0,0 +1,219 @@
+#include "ImageWriter.h"
+#include "Deflate.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+struct CrcTable {
+    uint32_t entries[256];
+
+    CrcTable() {
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[n] = c;
+        }
+    }
+};
+
+uint32_t updateCrc(uint32_t crc, const uint8_t* data, size_t size) {
+    static const CrcTable table;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+void putBE32(std::vector<uint8_t>& out, uint32_t v) {
+    out.push_back((uint8_t)(v >> 24));
+    out.push_back((uint8_t)(v >> 16));
+    out.push_back((uint8_t)(v >> 8));
+    out.push_back((uint8_t)v);
+}
+
+// Writes PNG chunks and a deflated zlib stream spread over IDAT chunks
+class PngStream {
+public:
+    explicit PngStream(std::FILE* file) : m_file(file) {}
+
+    void chunk(const char type[4], const uint8_t* data, size_t size) {
+        std::vector<uint8_t> header;
+        putBE32(header, (uint32_t)size);
+        header.insert(header.end(), type, type + 4);
+        std::fwrite(header.data(), 1, header.size(), m_file);
+        if (size > 0) std::fwrite(data, 1, size, m_file);
+
+        uint32_t crc = updateCrc(0xFFFFFFFFu, (const uint8_t*)type, 4);
+        crc = updateCrc(crc, data, size) ^ 0xFFFFFFFFu;
+        std::vector<uint8_t> trailer;
+        putBE32(trailer, crc);
+        std::fwrite(trailer.data(), 1, trailer.size(), m_file);
+    }
+
+    void beginImageData() {
+        m_block.clear();
+        m_block.push_back(0x78); // zlib header: deflate, 32K window
+        m_block.push_back(0x01);
+    }
+
+    // Raw scanline bytes, filter byte included
+    void imageData(const uint8_t* data, size_t size) {
+        for (size_t i = 0; i < size; ++i) {
+            m_adlerA = (m_adlerA + data[i]) % 65521;
+            m_adlerB = (m_adlerB + m_adlerA) % 65521;
+        }
+
+        m_deflate.write(data, size, m_block);
+        if (m_block.size() >= CHUNK_SIZE) {
+            chunk("IDAT", m_block.data(), m_block.size());
+            m_block.clear();
+        }
+    }
+
+    void endImageData() {
+        m_deflate.finish(m_block);
+        putBE32(m_block, (m_adlerB << 16) | m_adlerA);
+        chunk("IDAT", m_block.data(), m_block.size());
+        m_block.clear();
+    }
+
+    bool ok() const { return std::ferror(m_file) == 0; }
+
+private:
+    static const size_t CHUNK_SIZE = 65536;
+
+    std::FILE* m_file;
+    DeflateEncoder m_deflate;
+    std::vector<uint8_t> m_block;
+    uint32_t m_adlerA = 1;
+    uint32_t m_adlerB = 0;
+};
+
+int paeth(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+    if (pa <= pb && pa <= pc) return a;
+    return pb <= pc ? b : c;
+}
+
+// Filters a scanline with each PNG filter type and keeps the one with the
+// smallest sum of absolute (signed) bytes, the usual heuristic for which
+// compresses best. above is the previous scanline (zeros for the first).
+// out receives the filter byte and rowBytes filtered bytes.
+void filterRow(const uint8_t* row, const uint8_t* above, size_t rowBytes, size_t bytesPerPixel,
+    std::vector<uint8_t>& candidate, std::vector<uint8_t>& out) {
+    uint64_t bestCost = UINT64_MAX;
+    for (int type = 0; type < 5; ++type) {
+        uint8_t* filtered = candidate.data() + 1;
+        candidate[0] = (uint8_t)type;
+        switch (type) {
+        case 0:
+            std::memcpy(filtered, row, rowBytes);
+            break;
+        case 1:
+            for (size_t i = 0; i < rowBytes; ++i) {
+                filtered[i] = (uint8_t)(row[i] - (i >= bytesPerPixel ? row[i - bytesPerPixel] : 0));
+            }
+            break;
+        case 2:
+            for (size_t i = 0; i < rowBytes; ++i) filtered[i] = (uint8_t)(row[i] - above[i]);
+            break;
+        case 3:
+            for (size_t i = 0; i < rowBytes; ++i) {
+                const int a = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+                filtered[i] = (uint8_t)(row[i] - ((a + above[i]) >> 1));
+            }
+            break;
+        default:
+            for (size_t i = 0; i < rowBytes; ++i) {
+                const bool left = i >= bytesPerPixel;
+                const int a = left ? row[i - bytesPerPixel] : 0;
+                const int c = left ? above[i - bytesPerPixel] : 0;
+                filtered[i] = (uint8_t)(row[i] - paeth(a, above[i], c));
+            }
+            break;
+        }
+
+        uint64_t cost = 0;
+        for (size_t i = 0; i < rowBytes; ++i) cost += (uint64_t)std::abs((int)(int8_t)filtered[i]);
+        if (cost < bestCost) {
+            bestCost = cost;
+            out.swap(candidate);
+        }
+    }
+}
+
+bool writePngImpl(const std::string& path, int width, int height, int channels, int bitDepth,
+    const uint8_t* rows, size_t rowBytes) {
+    static const int COLOR_TYPES[] = { 0, 0, 4, 2, 6 }; // by channel count
+
+    if (width <= 0 || height <= 0 || channels < 1 || channels > 4) return false;
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    static const uint8_t SIGNATURE[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    std::fwrite(SIGNATURE, 1, sizeof(SIGNATURE), file);
+
+    PngStream png(file);
+
+    std::vector<uint8_t> ihdr;
+    putBE32(ihdr, (uint32_t)width);
+    putBE32(ihdr, (uint32_t)height);
+    ihdr.push_back((uint8_t)bitDepth);
+    ihdr.push_back((uint8_t)COLOR_TYPES[channels]);
+    ihdr.push_back(0); // deflate
+    ihdr.push_back(0); // adaptive filtering
+    ihdr.push_back(0); // no interlace
+    png.chunk("IHDR", ihdr.data(), ihdr.size());
+
+    png.beginImageData();
+    const size_t bytesPerPixel = (size_t)channels * bitDepth / 8;
+    const std::vector<uint8_t> zeros(rowBytes, 0);
+    std::vector<uint8_t> candidate(rowBytes + 1);
+    std::vector<uint8_t> filtered(rowBytes + 1);
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* row = rows + (size_t)y * rowBytes;
+        filterRow(row, y > 0 ? row - rowBytes : zeros.data(), rowBytes, bytesPerPixel, candidate, filtered);
+        png.imageData(filtered.data(), filtered.size());
+    }
+    png.endImageData();
+    png.chunk("IEND", nullptr, 0);
+
+    bool ok = png.ok();
+    return std::fclose(file) == 0 && ok;
+}
+
+} // namespace
+
+bool writePng(const std::string& path, int width, int height, int channels, const uint8_t* pixels) {
+    return writePngImpl(path, width, height, channels, 8, pixels, (size_t)width * channels);
+}
+
+bool writePng16(const std::string& path, int width, int height, const uint16_t* pixels) {
+    // PNG samples are big-endian
+    std::vector<uint8_t> bytes((size_t)width * height * 2);
+    for (size_t i = 0, n = (size_t)width * height; i < n; ++i) {
+        bytes[i * 2 + 0] = (uint8_t)(pixels[i] >> 8);
+        bytes[i * 2 + 1] = (uint8_t)pixels[i];
+    }
+    return writePngImpl(path, width, height, 1, 16, bytes.data(), (size_t)width * 2);
+}
+
+bool writeRawFloats(const std::string& path, const float* values, size_t count) {
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    size_t written = std::fwrite(values, sizeof(float), count, file);
+    return std::fclose(file) == 0 && written == count;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// Minimal image output for the headless tools.
+// PNGs are filtered per row (the cheapest of the five PNG filters) and
+// deflated with DeflateEncoder, as stb_image_write does; no external
+// dependency.
+
+// 8-bit PNG; channels = 1 (gray), 3 (RGB) or 4 (RGBA). Rows are tightly packed.
+bool writePng(const std::string& path, int width, int height, int channels, const uint8_t* pixels);
+
+// 16-bit grayscale PNG (e.g. height maps)
+bool writePng16(const std::string& path, int width, int height, const uint16_t* pixels);
+
+// Headerless little-endian float32 dump, row-major
+bool writeRawFloats(const std::string& path, const float* values, size_t count);
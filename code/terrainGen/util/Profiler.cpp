@@ -0,0 +1,269 @@
+#include "Profiler.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+std::atomic<bool> Profiler::s_enabled{ false };
+std::atomic<uint64_t> Profiler::s_allocations{ 0 };
+std::atomic<int64_t> Profiler::s_liveBytes{ 0 };
+std::atomic<int64_t> Profiler::s_peakBytes{ 0 };
+thread_local bool Profiler::t_bookkeeping = false;
+
+// Marks the profiler's own allocations, which must neither count towards a
+// stage nor leave the live byte count off once freed. Everything allocated
+// inside a guard is freed inside one too.
+class BookkeepingGuard {
+public:
+    BookkeepingGuard() : m_outer(Profiler::t_bookkeeping) { Profiler::t_bookkeeping = true; }
+    ~BookkeepingGuard() { Profiler::t_bookkeeping = m_outer; }
+
+private:
+    bool m_outer;
+};
+
+namespace {
+
+// Past this many events only the stage totals keep counting, so a viewer
+// left profiling for hours does not grow without bound
+const size_t MAX_EVENTS = 1 << 20;
+
+struct Event {
+    int stage;
+    int thread;
+    double startUs;
+    double durationUs;
+    double tiles;
+    bool job; // one pool participant's share of a job inside the stage
+};
+
+struct State {
+    std::mutex mutex;
+    std::vector<ProfileStage> stages;
+    std::vector<Event> events;
+    size_t dropped = 0;
+    uint32_t generation = 0; // bumped by reset, so open scopes do not record into new stages
+    const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+};
+
+State& state() {
+    static State s;
+    return s;
+}
+
+// Innermost open scope on this thread
+thread_local int t_stage = -1;
+
+// Small per-thread number for the trace
+std::atomic<int> g_nextThread{ 0 };
+thread_local int t_thread = -1;
+
+int threadId() {
+    if (t_thread < 0) t_thread = g_nextThread.fetch_add(1);
+    return t_thread;
+}
+
+// Caller holds the mutex
+int findOrAddStage(State& s, const char* name) {
+    for (size_t i = 0; i < s.stages.size(); ++i) {
+        if (s.stages[i].name == name) return (int)i;
+    }
+    ProfileStage stage;
+    stage.name = name;
+    s.stages.push_back(stage);
+    return (int)s.stages.size() - 1;
+}
+
+// Caller holds the mutex
+void addEvent(State& s, const Event& event) {
+    if (s.events.size() < MAX_EVENTS) s.events.push_back(event);
+    else ++s.dropped;
+}
+
+void writeEscaped(std::FILE* file, const std::string& text) {
+    for (char c : text) {
+        if (c == '"' || c == '\\') std::fputc('\\', file);
+        if ((unsigned char)c >= 0x20) std::fputc(c, file);
+    }
+}
+
+} // namespace
+
+// ---------------- SCOPES ----------------
+
+void Profiler::Scope::begin(const char* name, double tiles) {
+    State& s = state();
+    {
+        BookkeepingGuard guard;
+        std::lock_guard<std::mutex> lock(s.mutex);
+        m_stage = findOrAddStage(s, name);
+        m_generation = s.generation;
+    }
+    m_parent = t_stage;
+    t_stage = m_stage;
+    m_tiles = tiles;
+
+    // The high-water mark restarts at the current heap size for this scope
+    // and is merged back into the enclosing one at the end
+    m_startAllocations = getHeapAllocations();
+    m_startBytes = getHeapBytes();
+    m_outerPeak = s_peakBytes.exchange(m_startBytes, std::memory_order_relaxed);
+    m_startUs = nowUs();
+}
+
+void Profiler::Scope::end() {
+    const double endUs = nowUs();
+    const uint64_t allocations = getHeapAllocations() - m_startAllocations;
+    const int64_t peak = s_peakBytes.load(std::memory_order_relaxed);
+    const int64_t growth = std::max<int64_t>(0, peak - m_startBytes);
+
+    int64_t merged = peak;
+    while (m_outerPeak > merged && !s_peakBytes.compare_exchange_weak(merged, m_outerPeak, std::memory_order_relaxed)) {}
+    t_stage = m_parent;
+
+    State& s = state();
+    BookkeepingGuard guard;
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (m_generation != s.generation || m_stage >= (int)s.stages.size()) return;
+
+    const double ms = (endUs - m_startUs) / 1000.0;
+    ProfileStage& stage = s.stages[m_stage];
+    stage.calls++;
+    stage.totalMs += ms;
+    stage.lastMs = ms;
+    stage.maxMs = std::max(stage.maxMs, ms);
+    stage.tiles += m_tiles;
+    stage.allocations += allocations;
+    stage.peakBytes = std::max(stage.peakBytes, growth);
+    addEvent(s, Event{ m_stage, threadId(), m_startUs, endUs - m_startUs, m_tiles, false });
+}
+
+// ---------------- RECORDING ----------------
+
+void Profiler::setEnabled(bool enabled) {
+    s_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+void Profiler::reset() {
+    State& s = state();
+    BookkeepingGuard guard;
+    std::lock_guard<std::mutex> lock(s.mutex);
+    s.stages.clear();
+    s.events.clear();
+    s.events.shrink_to_fit();
+    s.dropped = 0;
+    s.generation++;
+}
+
+std::vector<ProfileStage> Profiler::getStages() {
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.stages;
+}
+
+size_t Profiler::getEventCount() {
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.events.size();
+}
+
+size_t Profiler::getDroppedEventCount() {
+    State& s = state();
+    std::lock_guard<std::mutex> lock(s.mutex);
+    return s.dropped;
+}
+
+size_t Profiler::getPeakResidentBytes() {
+#ifdef _WIN32
+    return 0;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+#endif
+}
+
+int Profiler::currentStage() {
+    return t_stage;
+}
+
+double Profiler::nowUs() {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - state().epoch).count();
+}
+
+void Profiler::recordJobSlice(int stage, int slot, double startUs, double endUs) {
+    State& s = state();
+    BookkeepingGuard guard;
+    std::lock_guard<std::mutex> lock(s.mutex);
+    if (stage >= (int)s.stages.size()) return;
+
+    std::vector<double>& busy = s.stages[stage].threadBusyMs;
+    if ((int)busy.size() <= slot) busy.resize(slot + 1, 0.0);
+    busy[slot] += (endUs - startUs) / 1000.0;
+    addEvent(s, Event{ stage, threadId(), startUs, endUs - startUs, 0.0, true });
+}
+
+// ---------------- EXPORT ----------------
+
+bool Profiler::writeJson(const std::string& path) {
+    const std::vector<ProfileStage> stages = getStages();
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    std::fprintf(file, "{\n  \"peak_rss_bytes\": %zu,\n  \"heap_allocations\": %llu,\n  \"stages\": [\n",
+        getPeakResidentBytes(), (unsigned long long)getHeapAllocations());
+    for (size_t i = 0; i < stages.size(); ++i) {
+        const ProfileStage& stage = stages[i];
+        std::fprintf(file, "    { \"name\": \"");
+        writeEscaped(file, stage.name);
+        std::fprintf(file,
+            "\", \"calls\": %d, \"total_ms\": %.6f, \"mean_ms\": %.6f, \"max_ms\": %.6f, \"last_ms\": %.6f, "
+            "\"tiles\": %.0f, \"tiles_per_second\": %.1f, \"allocations\": %llu, \"peak_bytes\": %lld, \"thread_busy_ms\": [",
+            stage.calls, stage.totalMs, stage.calls > 0 ? stage.totalMs / stage.calls : 0.0, stage.maxMs, stage.lastMs,
+            stage.tiles, stage.tilesPerSecond(), (unsigned long long)stage.allocations, (long long)stage.peakBytes);
+        for (size_t t = 0; t < stage.threadBusyMs.size(); ++t) {
+            std::fprintf(file, "%s%.6f", t > 0 ? ", " : "", stage.threadBusyMs[t]);
+        }
+        std::fprintf(file, "] }%s\n", i + 1 < stages.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+    return std::fclose(file) == 0;
+}
+
+bool Profiler::writeChromeTrace(const std::string& path) {
+    std::vector<ProfileStage> stages;
+    std::vector<Event> events;
+    {
+        State& s = state();
+        std::lock_guard<std::mutex> lock(s.mutex);
+        stages = s.stages;
+        events = s.events;
+    }
+
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) return false;
+
+    // Complete ("X") events; stages and pool jobs in separate categories
+    std::fprintf(file, "{\n  \"displayTimeUnit\": \"ms\",\n  \"traceEvents\": [\n");
+    for (size_t i = 0; i < events.size(); ++i) {
+        const Event& e = events[i];
+        std::fprintf(file, "    { \"name\": \"");
+        writeEscaped(file, stages[e.stage].name);
+        std::fprintf(file, "\", \"cat\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f",
+            e.job ? "job" : "stage", e.thread, e.startUs, e.durationUs);
+        if (!e.job) std::fprintf(file, ", \"args\": { \"tiles\": %.0f }", e.tiles);
+        std::fprintf(file, " }%s\n", i + 1 < events.size() ? "," : "");
+    }
+    std::fprintf(file, "  ]\n}\n");
+    return std::fclose(file) == 0;
+}
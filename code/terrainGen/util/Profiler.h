@@ -0,0 +1,138 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scoped stage profiler.
+//
+//   TG_PROFILE_SCOPE("flow_directions", (double)width * height);
+//
+// times the rest of the enclosing block and adds it to the named stage:
+// wall time, tiles per second, heap allocations, heap high-water and the
+// busy time of every thread that ran a ThreadPool job inside the scope.
+// Every scope and pool job also becomes an event for a Chrome trace
+// (chrome://tracing or ui.perfetto.dev).
+//
+// Recording is off until Profiler::setEnabled(true); a scope then costs one
+// relaxed atomic load. Scopes and pool hooks are only compiled in when
+// configured with -DTERRAINGEN_PROFILE=ON; by default they, and the tiles
+// expression, compile out entirely.
+//
+// Heap figures need the executable to report its allocations through
+// onAllocate / onFree; link util/ProfilerHeap.cpp for that (CMake does with
+// -DTERRAINGEN_PROFILE_HEAP=ON). Without it they read 0. The heap is
+// process-wide, so scopes running at the same time on different threads
+// see each other's allocations.
+
+#ifdef TG_PROFILE
+#define TG_PROFILE_JOIN2(a, b) a##b
+#define TG_PROFILE_JOIN(a, b) TG_PROFILE_JOIN2(a, b)
+#define TG_PROFILE_SCOPE(name, tiles) Profiler::Scope TG_PROFILE_JOIN(tgProfileScope, __LINE__)(name, tiles)
+#else
+#define TG_PROFILE_SCOPE(name, tiles) ((void)0)
+#endif
+
+// Totals of one named stage since the last reset
+struct ProfileStage {
+    std::string name;
+    int calls = 0;
+    double totalMs = 0.0;
+    double lastMs = 0.0;
+    double maxMs = 0.0;
+    double tiles = 0.0;           // summed over calls
+    uint64_t allocations = 0;     // heap allocations, summed over calls
+    int64_t peakBytes = 0;        // most heap growth within one call
+    std::vector<double> threadBusyMs; // per pool slot (0 = calling thread), summed over calls
+
+    double tilesPerSecond() const { return totalMs > 0.0 ? tiles / (totalMs / 1000.0) : 0.0; }
+};
+
+class Profiler {
+public:
+    // Times one scope; use TG_PROFILE_SCOPE rather than naming one directly.
+    // Scopes with the same name text add up to one stage.
+    class Scope {
+    public:
+        Scope(const char* name, double tiles) {
+            if (isEnabled()) begin(name, tiles);
+        }
+        ~Scope() {
+            if (m_stage >= 0) end();
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        int m_stage = -1;
+        int m_parent = -1;
+        double m_tiles = 0.0;
+        double m_startUs = 0.0;
+        uint64_t m_startAllocations = 0;
+        int64_t m_startBytes = 0;
+        int64_t m_outerPeak = 0;
+        uint32_t m_generation = 0;
+
+        void begin(const char* name, double tiles);
+        void end();
+    };
+
+    static constexpr bool isCompiledIn() {
+#ifdef TG_PROFILE
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static bool isEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void setEnabled(bool enabled);
+
+    // Drops all stages and events
+    static void reset();
+
+    static std::vector<ProfileStage> getStages();
+    static size_t getEventCount();
+    static size_t getDroppedEventCount(); // beyond the event cap; stages still count them
+
+    // Stage totals, and the trace of every event, as JSON
+    static bool writeJson(const std::string& path);
+    static bool writeChromeTrace(const std::string& path);
+
+    // Heap accounting, fed by the executable's operator new / delete. The
+    // profiler's own bookkeeping is left out.
+    static void onAllocate(size_t bytes) {
+        if (t_bookkeeping) return;
+        s_allocations.fetch_add(1, std::memory_order_relaxed);
+        int64_t live = s_liveBytes.fetch_add((int64_t)bytes, std::memory_order_relaxed) + (int64_t)bytes;
+        int64_t peak = s_peakBytes.load(std::memory_order_relaxed);
+        while (live > peak && !s_peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+    }
+    static void onFree(size_t bytes) {
+        if (t_bookkeeping) return;
+        s_liveBytes.fetch_sub((int64_t)bytes, std::memory_order_relaxed);
+    }
+    static uint64_t getHeapAllocations() { return s_allocations.load(std::memory_order_relaxed); }
+    static int64_t getHeapBytes() { return s_liveBytes.load(std::memory_order_relaxed); }
+
+    // Largest resident set of the process so far, 0 where unsupported
+    static size_t getPeakResidentBytes();
+
+    // ThreadPool hooks: the stage open on the calling thread (-1 if none),
+    // and one participant's share of a job
+    static int currentStage();
+    static double nowUs();
+    static void recordJobSlice(int stage, int slot, double startUs, double endUs);
+
+private:
+    static std::atomic<bool> s_enabled;
+    static std::atomic<uint64_t> s_allocations;
+    static std::atomic<int64_t> s_liveBytes;
+    static std::atomic<int64_t> s_peakBytes;
+    static thread_local bool t_bookkeeping;
+
+    friend class BookkeepingGuard;
+};
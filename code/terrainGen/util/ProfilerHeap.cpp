@@ -0,0 +1,71 @@
+// Global operator new / delete that report every heap block to the
+// Profiler, for its allocation counts and heap high-water marks.
+//
+// Link into an executable (the viewer and the CLI do when profiling is
+// compiled in); never into the library, which must not replace the
+// allocator of whoever uses it. Each block carries its size in a header
+// just before the pointer handed out.
+
+#include "Profiler.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Keeps the pointer handed out aligned for any fundamental type
+const size_t HEADER = alignof(std::max_align_t) > 2 * sizeof(size_t) ? alignof(std::max_align_t) : 2 * sizeof(size_t);
+
+struct Header {
+    void* raw;   // what malloc returned
+    size_t size; // bytes requested
+};
+
+void* allocate(size_t size, size_t align) {
+    if (align < HEADER) align = HEADER;
+    void* raw = std::malloc(size + align + sizeof(Header));
+    if (!raw) throw std::bad_alloc();
+
+    uintptr_t block = ((uintptr_t)raw + sizeof(Header) + align - 1) & ~(uintptr_t)(align - 1);
+    Header* header = reinterpret_cast<Header*>(block) - 1;
+    header->raw = raw;
+    header->size = size;
+    Profiler::onAllocate(size);
+    return reinterpret_cast<void*>(block);
+}
+
+void release(void* memory) noexcept {
+    if (!memory) return;
+    Header* header = static_cast<Header*>(memory) - 1;
+    Profiler::onFree(header->size);
+    std::free(header->raw);
+}
+
+} // namespace
+
+void* operator new(size_t size) {
+    return allocate(size, HEADER);
+}
+
+void* operator new[](size_t size) {
+    return allocate(size, HEADER);
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    return allocate(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return allocate(size, (size_t)alignment);
+}
+
+void operator delete(void* memory) noexcept { release(memory); }
+void operator delete[](void* memory) noexcept { release(memory); }
+void operator delete(void* memory, size_t) noexcept { release(memory); }
+void operator delete[](void* memory, size_t) noexcept { release(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { release(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { release(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { release(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { release(memory); }
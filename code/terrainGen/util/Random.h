@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+
+// Stateless, counter-based random numbers (Philox4x32-10).
+//
+// A CounterRng holds nothing but a key made from the world seed and a stage
+// stream. Every value is a pure function of (key, counter), so a stage can
+// draw numbers for any tile in any order on any thread and still build the
+// same world:
+//
+//     CounterRng rng(seed, RandomStream::RiverSources);
+//     float r = rng.uniform(x, y); // always the same r for this tile
+//
+// Each stage uses its own stream so no two stages ever share numbers.
+
+enum class RandomStream : uint32_t {
+    NoiseSeeds = 1,   // counter: noise layer
+    NoisePermutation, // counter: permutation slot
+    RiverSources,     // counter: tile x, y
+    Settlements,      // counter: candidate, axis
+    Roads,            // counter: ant, step, iteration
+    Erosion,          // counter: droplet, batch, axis
+};
+
+class CounterRng {
+public:
+    CounterRng(uint32_t seed, RandomStream stream)
+        : m_key{ seed, static_cast<uint32_t>(stream) } {}
+
+    // Four independent 32-bit values for one 128-bit counter
+    void block(uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3, uint32_t out[4]) const {
+        uint32_t key0 = m_key[0];
+        uint32_t key1 = m_key[1];
+        out[0] = c0;
+        out[1] = c1;
+        out[2] = c2;
+        out[3] = c3;
+        for (int round = 0; round < 10; ++round) {
+            uint64_t p0 = uint64_t(0xD2511F53u) * out[0];
+            uint64_t p1 = uint64_t(0xCD9E8D57u) * out[2];
+            uint32_t x1 = out[1];
+            uint32_t x3 = out[3];
+            out[0] = uint32_t(p1 >> 32) ^ x1 ^ key0;
+            out[1] = uint32_t(p1);
+            out[2] = uint32_t(p0 >> 32) ^ x3 ^ key1;
+            out[3] = uint32_t(p0);
+            key0 += 0x9E3779B9u;
+            key1 += 0xBB67AE85u;
+        }
+    }
+
+    // 32 random bits for counter (x, y); n picks further values for the same (x, y)
+    uint32_t bits(uint32_t x, uint32_t y = 0, uint32_t n = 0) const {
+        uint32_t out[4];
+        block(x, y, n, 0, out);
+        return out[0];
+    }
+
+    // Uniform float in [0, 1)
+    float uniform(uint32_t x, uint32_t y = 0, uint32_t n = 0) const {
+        return (bits(x, y, n) >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // Uniform integer in [0, bound); bias is below bound / 2^32
+    uint32_t below(uint32_t bound, uint32_t x, uint32_t y = 0, uint32_t n = 0) const {
+        return uint32_t((uint64_t(bits(x, y, n)) * bound) >> 32);
+    }
+
+private:
+    uint32_t m_key[2];
+};
@@ -0,0 +1,181 @@
+#include "ThreadPool.h"
+#include "Profiler.h"
+
+#include <algorithm>
+
+namespace {
+
+// Set on pool workers (and on a caller while it runs a job) so nested
+// parallelFor calls fall back to a serial loop instead of deadlocking.
+thread_local bool t_insideJob = false;
+
+uint64_t pack(uint32_t begin, uint32_t end) {
+    return ((uint64_t)begin << 32) | end;
+}
+
+uint32_t rangeBegin(uint64_t r) {
+    return (uint32_t)(r >> 32);
+}
+
+uint32_t rangeEnd(uint64_t r) {
+    return (uint32_t)r;
+}
+
+} // namespace
+
+ThreadPool::ThreadPool(int threadCount)
+    : m_threadCount(threadCount > 0 ? threadCount : hardwareThreads()),
+    m_slots(new Slot[m_threadCount])
+{
+    // Slot 0 belongs to whichever thread calls parallelFor
+    for (int i = 1; i < m_threadCount; ++i) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread& t : m_workers) {
+        t.join();
+    }
+}
+
+int ThreadPool::getThreadCount() const {
+    return m_threadCount;
+}
+
+int ThreadPool::hardwareThreads() {
+    return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+void ThreadPool::run(int count, const Job& job) {
+    if (count <= 0) return;
+
+    if (m_threadCount == 1 || count == 1 || t_insideJob) {
+        for (int i = 0; i < count; ++i) {
+            job.invoke(job.fn, i);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(m_runMutex);
+
+    // Even initial split; stealing evens out whatever imbalance is left
+    for (int s = 0; s < m_threadCount; ++s) {
+        uint32_t begin = (uint32_t)((int64_t)count * s / m_threadCount);
+        uint32_t end = (uint32_t)((int64_t)count * (s + 1) / m_threadCount);
+        m_slots[s].range.store(pack(begin, end), std::memory_order_relaxed);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_active = m_threadCount - 1;
+        ++m_jobId;
+#ifdef TG_PROFILE
+        m_profileStage = Profiler::isEnabled() ? Profiler::currentStage() : -1;
+#endif
+    }
+    m_wake.notify_all();
+
+    t_insideJob = true;
+    runShare(0, job);
+    t_insideJob = false;
+
+    // The job lives on this stack frame: wait until every worker let go of it
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_active == 0; });
+    m_job = nullptr;
+}
+
+void ThreadPool::workerLoop(int slot) {
+    t_insideJob = true;
+    uint64_t seenJob = 0;
+
+    for (;;) {
+        const Job* job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stop || m_jobId != seenJob; });
+            if (m_stop) return;
+            seenJob = m_jobId;
+            job = m_job;
+        }
+
+        runShare(slot, *job);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_active == 0) {
+            m_done.notify_one();
+        }
+    }
+}
+
+// One participant's part of a job, timed for the profiler when the job was
+// submitted inside a profiled scope
+void ThreadPool::runShare(int slot, const Job& job) {
+#ifdef TG_PROFILE
+    const int stage = m_profileStage;
+    if (stage >= 0) {
+        const double start = Profiler::nowUs();
+        work(slot, job);
+        Profiler::recordJobSlice(stage, slot, start, Profiler::nowUs());
+        return;
+    }
+#endif
+    work(slot, job);
+}
+
+void ThreadPool::work(int slot, const Job& job) {
+    for (;;) {
+        int index;
+        while (popOwn(slot, index)) {
+            job.invoke(job.fn, index);
+        }
+        if (!steal(slot)) return;
+    }
+}
+
+bool ThreadPool::popOwn(int slot, int& index) {
+    std::atomic<uint64_t>& range = m_slots[slot].range;
+    uint64_t r = range.load(std::memory_order_acquire);
+
+    for (;;) {
+        uint32_t begin = rangeBegin(r);
+        uint32_t end = rangeEnd(r);
+        if (begin >= end) return false;
+
+        if (range.compare_exchange_weak(r, pack(begin + 1, end), std::memory_order_acq_rel)) {
+            index = (int)begin;
+            return true;
+        }
+    }
+}
+
+bool ThreadPool::steal(int slot) {
+    for (int k = 1; k < m_threadCount; ++k) {
+        int victim = (slot + k) % m_threadCount;
+        std::atomic<uint64_t>& range = m_slots[victim].range;
+        uint64_t r = range.load(std::memory_order_acquire);
+
+        for (;;) {
+            uint32_t begin = rangeBegin(r);
+            uint32_t end = rangeEnd(r);
+            if (begin >= end) break;
+
+            // Take the upper half (all of it when only one index is left)
+            uint32_t mid = begin + (end - begin) / 2;
+            if (range.compare_exchange_weak(r, pack(begin, mid), std::memory_order_acq_rel)) {
+                // Our own slot is empty, so nobody else is writing it
+                m_slots[slot].range.store(pack(mid, end), std::memory_order_release);
+                return true;
+            }
+        }
+    }
+    return false;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads running parallelFor jobs.
+// Each participant (workers + the calling thread) starts with a contiguous
+// slice of the index range and, once it runs dry, steals half of another
+// participant's remaining slice. Submitting a job does not allocate.
+class ThreadPool {
+public:
+    // threadCount includes the calling thread; 0 = hardware concurrency
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int getThreadCount() const;
+
+    // Calls fn(i) for every i in [0, count) and returns when all are done.
+    // Nested calls from inside a job run serially on the calling thread.
+    template <typename Fn>
+    void parallelFor(int count, const Fn& fn) {
+        Job job;
+        job.fn = &fn;
+        job.invoke = [](const void* f, int i) { (*static_cast<const Fn*>(f))(i); };
+        run(count, job);
+    }
+
+    static int hardwareThreads();
+
+private:
+    struct Job {
+        const void* fn;
+        void (*invoke)(const void*, int);
+    };
+
+    // Remaining [begin, end) of one participant, packed into one word
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> range{ 0 };
+    };
+
+    void run(int count, const Job& job);
+    void workerLoop(int slot);
+    void runShare(int slot, const Job& job);
+    void work(int slot, const Job& job);
+    bool popOwn(int slot, int& index);
+    bool steal(int slot);
+
+    int m_threadCount;
+    std::vector<std::thread> m_workers;
+    std::unique_ptr<Slot[]> m_slots;
+
+    std::mutex m_runMutex;  // one job at a time
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    const Job* m_job = nullptr;
+    uint64_t m_jobId = 0;
+    int m_active = 0;
+    bool m_stop = false;
+#ifdef TG_PROFILE
+    int m_profileStage = -1; // Profiler stage open on the submitting thread, -1 = not profiling
+#endif
+};
@@ -0,0 +1,130 @@
+#include "ChunkedWorld.h"
+
+ChunkedWorld::ChunkedWorld(int chunkSize, size_t memoryBudget, ChunkGenerator generator)
+    : m_chunkSize(chunkSize), m_memoryBudget(memoryBudget), m_generator(std::move(generator))
+{
+}
+
+int ChunkedWorld::getChunkSize() const {
+    return m_chunkSize;
+}
+
+uint64_t ChunkedWorld::key(int chunkX, int chunkY) {
+    return ((uint64_t)(uint32_t)chunkX << 32) | (uint32_t)chunkY;
+}
+
+int ChunkedWorld::floorDiv(int a) const {
+    return (a >= 0) ? a / m_chunkSize : -((-a + m_chunkSize - 1) / m_chunkSize);
+}
+
+std::shared_ptr<CompactWorld> ChunkedWorld::getChunk(int chunkX, int chunkY) {
+    const uint64_t k = key(chunkX, chunkY);
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_chunks.find(k);
+        if (it != m_chunks.end()) {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lruPos);
+            return it->second.chunk;
+        }
+    }
+
+    // Generate outside the lock so other chunks stay available meanwhile.
+    // Two threads may race on the same chunk; both produce the same data
+    // and the first one to finish wins.
+    std::unique_ptr<World> scratch;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_scratch.empty()) {
+            scratch = std::move(m_scratch.back());
+            m_scratch.pop_back();
+        }
+    }
+    if (scratch) {
+        scratch->clear(); // generators only write some planes
+    }
+    else {
+        scratch.reset(new World(m_chunkSize, m_chunkSize));
+    }
+
+    m_generator(*scratch, chunkX * m_chunkSize, chunkY * m_chunkSize);
+    auto chunk = std::make_shared<CompactWorld>(m_chunkSize, m_chunkSize);
+    chunk->encode(*scratch);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_scratch.push_back(std::move(scratch));
+    auto it = m_chunks.find(k);
+    if (it != m_chunks.end()) {
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lruPos);
+        return it->second.chunk;
+    }
+
+    m_lru.push_front(k);
+    m_chunks[k] = Entry{ chunk, m_lru.begin() };
+    m_memoryUsage += chunk->getMemoryUsage();
+    ++m_generated;
+
+    evictToBudget();
+    return chunk;
+}
+
+std::shared_ptr<CompactWorld> ChunkedWorld::chunkAt(int x, int y) {
+    return getChunk(floorDiv(x), floorDiv(y));
+}
+
+Tile ChunkedWorld::getTile(int x, int y) {
+    int chunkX = floorDiv(x);
+    int chunkY = floorDiv(y);
+    std::shared_ptr<const CompactWorld> chunk = getChunk(chunkX, chunkY);
+    return chunk->at(x - chunkX * m_chunkSize, y - chunkY * m_chunkSize);
+}
+
+void ChunkedWorld::setMemoryBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_memoryBudget = bytes;
+    evictToBudget();
+}
+
+size_t ChunkedWorld::getMemoryBudget() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_memoryBudget;
+}
+
+size_t ChunkedWorld::getMemoryUsage() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_memoryUsage;
+}
+
+size_t ChunkedWorld::getResidentChunks() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_chunks.size();
+}
+
+uint64_t ChunkedWorld::getGeneratedChunks() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_generated;
+}
+
+uint64_t ChunkedWorld::getEvictedChunks() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_evicted;
+}
+
+void ChunkedWorld::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_chunks.clear();
+    m_lru.clear();
+    m_scratch.clear();
+    m_memoryUsage = 0;
+}
+
+void ChunkedWorld::evictToBudget() {
+    // Always keep the most recent chunk, even if it alone exceeds the budget
+    while (m_memoryUsage > m_memoryBudget && m_lru.size() > 1) {
+        auto it = m_chunks.find(m_lru.back());
+        m_memoryUsage -= it->second.chunk->getMemoryUsage();
+        m_chunks.erase(it);
+        m_lru.pop_back();
+        ++m_evicted;
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "CompactWorld.h"
+#include "World.h"
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// Fills a chunk whose tile (0, 0) is world tile (originX, originY)
+using ChunkGenerator = std::function<void(World& chunk, int originX, int originY)>;
+
+// Unbounded world made of fixed-size square chunks.
+// A chunk is generated the first time it is touched and kept in an LRU
+// cache; once the cache exceeds its memory budget the least recently used
+// chunks are dropped and regenerated when needed again. Generation must
+// therefore be deterministic per chunk, and edits to a chunk only last
+// while it stays cached.
+//
+// Cached chunks are CompactWorlds, so a budget holds about 4x the tiles it
+// would as float Worlds. The generator still fills a float World, which is
+// packed right after; those scratch chunks (one per thread generating at
+// the same time) are reused and not counted against the budget.
+class ChunkedWorld {
+public:
+    ChunkedWorld(int chunkSize, size_t memoryBudget, ChunkGenerator generator);
+
+    int getChunkSize() const;
+
+    // Chunk by chunk coordinate. The returned pointer keeps the chunk alive
+    // even if the cache evicts it meanwhile.
+    std::shared_ptr<CompactWorld> getChunk(int chunkX, int chunkY);
+
+    // Chunk containing a tile (any coordinate, negative included)
+    std::shared_ptr<CompactWorld> chunkAt(int x, int y);
+
+    // Copy of a single tile, quantized as CompactWorld stores it
+    Tile getTile(int x, int y);
+
+    // Cache budget in bytes; shrinking it evicts immediately
+    void setMemoryBudget(size_t bytes);
+    size_t getMemoryBudget() const;
+
+    // Cache statistics; memory counts the cached chunks
+    size_t getMemoryUsage() const;
+    size_t getResidentChunks() const;
+    uint64_t getGeneratedChunks() const;
+    uint64_t getEvictedChunks() const;
+
+    // Drop every cached chunk
+    void clear();
+
+private:
+    struct Entry {
+        std::shared_ptr<CompactWorld> chunk;
+        std::list<uint64_t>::iterator lruPos;
+    };
+
+    int m_chunkSize;
+    size_t m_memoryBudget;
+    ChunkGenerator m_generator;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<uint64_t, Entry> m_chunks;
+    std::list<uint64_t> m_lru; // front = most recently used
+    size_t m_memoryUsage = 0;
+    uint64_t m_generated = 0;
+    uint64_t m_evicted = 0;
+    std::vector<std::unique_ptr<World>> m_scratch; // float chunks not in use by a generator
+
+    static uint64_t key(int chunkX, int chunkY);
+    int floorDiv(int a) const;
+
+    // Call with m_mutex held
+    void evictToBudget();
+};
@@ -0,0 +1,235 @@
+#include "CompactWorld.h"
+#include "CompactWorldSimd.h"
+
+#include <algorithm>
+#include <cassert>
+
+namespace {
+
+const int BAND_ROWS = 64;
+
+using Unit16 = compact::UnitRef<uint16_t>;
+using Unit8 = compact::UnitRef<uint8_t>;
+
+uint8_t packFlags(Biome biome, bool lake, bool road) {
+    return (uint8_t)(((uint8_t)biome & CompactWorld::BIOME_MASK) |
+        (lake ? CompactWorld::LAKE_BIT : 0) | (road ? CompactWorld::ROAD_BIT : 0));
+}
+
+// Bulk conversions over plain pointers. The clamp keeps the compiler from
+// vectorizing quantization, so that goes through the SIMD kernels; the
+// other loops vectorize as written.
+void encodeUnits(const float* in, uint16_t* out, size_t count, SimdLevel level) {
+    size_t done = 0;
+    if (level == SimdLevel::AVX2) done = CompactSimd::quantize16Avx2(in, out, count);
+    else if (level == SimdLevel::SSE41) done = CompactSimd::quantize16Sse41(in, out, count);
+    for (size_t i = done; i < count; ++i) out[i] = Unit16::encode(in[i]);
+}
+
+void encodeUnits(const float* in, uint8_t* out, size_t count, SimdLevel level) {
+    size_t done = 0;
+    if (level == SimdLevel::AVX2) done = CompactSimd::quantize8Avx2(in, out, count);
+    else if (level == SimdLevel::SSE41) done = CompactSimd::quantize8Sse41(in, out, count);
+    for (size_t i = done; i < count; ++i) out[i] = Unit8::encode(in[i]);
+}
+
+template <typename T>
+void decodeUnits(const T* in, float* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) out[i] = compact::UnitRef<T>::decode(in[i]);
+}
+
+void packFlags(const Biome* biomes, const bool* lakes, const bool* roads, uint8_t* out, size_t count) {
+    for (size_t i = 0; i < count; ++i) out[i] = packFlags(biomes[i], lakes[i], roads[i]);
+}
+
+void unpackFlags(const uint8_t* flags, Biome* biomes, bool* lakes, bool* roads, size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        biomes[i] = (Biome)(flags[i] & CompactWorld::BIOME_MASK);
+        lakes[i] = (flags[i] & CompactWorld::LAKE_BIT) != 0;
+        roads[i] = (flags[i] & CompactWorld::ROAD_BIT) != 0;
+    }
+}
+
+} // namespace
+
+// ---------------- SETTLEMENTS ----------------
+
+int SettlementMap::get(uint32_t tile) const {
+    auto it = std::lower_bound(m_entries.begin(), m_entries.end(), Entry(tile, INT32_MIN));
+    return it != m_entries.end() && it->first == tile ? it->second : -1;
+}
+
+void SettlementMap::set(uint32_t tile, int id) {
+    auto it = std::lower_bound(m_entries.begin(), m_entries.end(), Entry(tile, INT32_MIN));
+    const bool found = it != m_entries.end() && it->first == tile;
+    if (id < 0) {
+        if (found) m_entries.erase(it);
+    }
+    else if (found) {
+        it->second = id;
+    }
+    else {
+        m_entries.insert(it, Entry(tile, id));
+    }
+}
+
+// ---------------- PROXIES ----------------
+
+namespace compact {
+
+BiomeRef::operator Biome() const {
+    return (Biome)(flags & CompactWorld::BIOME_MASK);
+}
+
+BiomeRef& BiomeRef::operator=(Biome biome) {
+    flags = (uint8_t)((flags & ~CompactWorld::BIOME_MASK) | ((uint8_t)biome & CompactWorld::BIOME_MASK));
+    return *this;
+}
+
+} // namespace compact
+
+CompactTileRef& CompactTileRef::operator=(const Tile& t) {
+    height = t.height;
+    moisture = t.moisture;
+    temperature = t.temperature;
+    biome = t.biome;
+    riverStrength = t.riverStrength;
+    isLake = t.isLake;
+    hasRoad = t.hasRoad;
+    settlementId = t.settlementId;
+    return *this;
+}
+
+// ---------------- WORLD ----------------
+
+CompactWorld::CompactWorld(int width, int height)
+    : m_width(width), m_height(height),
+    m_heightPlane(width, height, Unit16::encode(Tile{}.height)),
+    m_moisturePlane(width, height, Unit8::encode(Tile{}.moisture)),
+    m_temperaturePlane(width, height, Unit8::encode(Tile{}.temperature)),
+    m_riverPlane(width, height, Unit8::encode(Tile{}.riverStrength)),
+    m_flagsPlane(width, height, packFlags(Tile{}.biome, Tile{}.isLake, Tile{}.hasRoad))
+{
+}
+
+bool CompactWorld::inBounds(int x, int y) const {
+    return x >= 0 && x < m_width && y >= 0 && y < m_height;
+}
+
+CompactTileRef CompactWorld::at(int x, int y) {
+    assert(inBounds(x, y) && "CompactWorld::at() out of bounds");
+    const size_t i = (size_t)y * m_width + x;
+    uint8_t& flags = m_flagsPlane[i];
+    return CompactTileRef{
+        { m_heightPlane[i] }, { m_moisturePlane[i] }, { m_temperaturePlane[i] }, { flags },
+        { m_riverPlane[i] }, { flags, LAKE_BIT }, { flags, ROAD_BIT }, { m_settlements, (uint32_t)i }
+    };
+}
+
+Tile CompactWorld::at(int x, int y) const {
+    assert(inBounds(x, y) && "CompactWorld::at() out of bounds");
+    const size_t i = (size_t)y * m_width + x;
+    const uint8_t flags = m_flagsPlane[i];
+    return Tile{
+        Unit16::decode(m_heightPlane[i]), Unit8::decode(m_moisturePlane[i]), Unit8::decode(m_temperaturePlane[i]),
+        (Biome)(flags & BIOME_MASK), Unit8::decode(m_riverPlane[i]),
+        (flags & LAKE_BIT) != 0, (flags & ROAD_BIT) != 0, m_settlements.get((uint32_t)i)
+    };
+}
+
+template <typename Fn>
+void CompactWorld::forEachRowBand(ThreadPool* pool, const Fn& fn) const {
+    const int bands = (m_height + BAND_ROWS - 1) / BAND_ROWS;
+    auto run = [&](int band) {
+        const size_t begin = (size_t)band * BAND_ROWS * m_width;
+        const size_t end = (size_t)std::min(m_height, (band + 1) * BAND_ROWS) * m_width;
+        fn(band, begin, end);
+    };
+    if (pool) {
+        pool->parallelFor(bands, run);
+    }
+    else {
+        for (int band = 0; band < bands; ++band) run(band);
+    }
+}
+
+void CompactWorld::encode(const World& world, ThreadPool* pool) {
+    encode(world, pool, PerlinNoise::bestSimdLevel());
+}
+
+void CompactWorld::encode(const World& world, ThreadPool* pool, SimdLevel level) {
+    level = std::min(level, PerlinNoise::bestSimdLevel());
+    assert(world.getWidth() == m_width && world.getHeight() == m_height);
+
+    const float* heights = world.heightPlane().data();
+    const float* moistures = world.moisturePlane().data();
+    const float* temperatures = world.temperaturePlane().data();
+    const float* rivers = world.riverPlane().data();
+    const Biome* biomes = world.biomePlane().data();
+    const bool* lakes = world.lakePlane().data();
+    const bool* roads = world.roadPlane().data();
+    const int* settlementIds = world.settlementPlane().data();
+
+    // Settlements found per band, concatenated in band order (= tile order)
+    const int bands = (m_height + BAND_ROWS - 1) / BAND_ROWS;
+    std::vector<std::vector<SettlementMap::Entry>> found(bands);
+
+    forEachRowBand(pool, [&](int band, size_t begin, size_t end) {
+        const size_t n = end - begin;
+        encodeUnits(heights + begin, m_heightPlane.data() + begin, n, level);
+        encodeUnits(moistures + begin, m_moisturePlane.data() + begin, n, level);
+        encodeUnits(temperatures + begin, m_temperaturePlane.data() + begin, n, level);
+        encodeUnits(rivers + begin, m_riverPlane.data() + begin, n, level);
+        packFlags(biomes + begin, lakes + begin, roads + begin, m_flagsPlane.data() + begin, n);
+        for (size_t i = begin; i < end; ++i) {
+            if (settlementIds[i] >= 0) found[band].push_back({ (uint32_t)i, settlementIds[i] });
+        }
+    });
+
+    std::vector<SettlementMap::Entry> entries;
+    for (const auto& band : found) entries.insert(entries.end(), band.begin(), band.end());
+    m_settlements.assign(std::move(entries));
+}
+
+void CompactWorld::decode(World& world, ThreadPool* pool) const {
+    assert(world.getWidth() == m_width && world.getHeight() == m_height);
+
+    float* heights = world.heightPlane().data();
+    float* moistures = world.moisturePlane().data();
+    float* temperatures = world.temperaturePlane().data();
+    float* rivers = world.riverPlane().data();
+    Biome* biomes = world.biomePlane().data();
+    bool* lakes = world.lakePlane().data();
+    bool* roads = world.roadPlane().data();
+
+    forEachRowBand(pool, [&](int, size_t begin, size_t end) {
+        const size_t n = end - begin;
+        decodeUnits(m_heightPlane.data() + begin, heights + begin, n);
+        decodeUnits(m_moisturePlane.data() + begin, moistures + begin, n);
+        decodeUnits(m_temperaturePlane.data() + begin, temperatures + begin, n);
+        decodeUnits(m_riverPlane.data() + begin, rivers + begin, n);
+        unpackFlags(m_flagsPlane.data() + begin, biomes + begin, lakes + begin, roads + begin, n);
+    });
+
+    Plane<int>& settlementIds = world.settlementPlane();
+    settlementIds.fill(-1);
+    for (const SettlementMap::Entry& entry : m_settlements.entries()) {
+        settlementIds[entry.first] = entry.second;
+    }
+}
+
+void CompactWorld::clear() {
+    const Tile empty{};
+    m_heightPlane.fill(Unit16::encode(empty.height));
+    m_moisturePlane.fill(Unit8::encode(empty.moisture));
+    m_temperaturePlane.fill(Unit8::encode(empty.temperature));
+    m_riverPlane.fill(Unit8::encode(empty.riverStrength));
+    m_flagsPlane.fill(packFlags(empty.biome, empty.isLake, empty.hasRoad));
+    m_settlements.clear();
+}
+
+size_t CompactWorld::getMemoryUsage() const {
+    return m_heightPlane.getMemoryUsage() + m_moisturePlane.getMemoryUsage() +
+        m_temperaturePlane.getMemoryUsage() + m_riverPlane.getMemoryUsage() +
+        m_flagsPlane.getMemoryUsage() + m_settlements.getMemoryUsage();
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "Plane.h"
+#include "Tile.h"
+#include "World.h"
+#include "noise/PerlinNoise.h"
+#include "util/ThreadPool.h"
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Quantized storage for a finished world: 6 bytes per tile instead of 23.
+//
+//   height                   16-bit fixed point over 0..1 (error <= 7.7e-6)
+//   moisture, temperature,
+//   river strength            8-bit fixed point over 0..1 (error <= 0.002)
+//   biome, lake, road         one byte: biome in bits 0-3, lake bit 4, road bit 5
+//   settlements               sparse (tile, id) list; almost no tile has one
+//
+// Values outside 0..1 are clamped. Generation keeps working on the float
+// planes of a World; pack the result with encode() and unpack it with
+// decode(). at(x, y) returns a proxy whose fields read and write like a
+// TileRef's, converting on the fly, so per-tile code works on either.
+//
+// ChunkedWorld caches its chunks in this form, so browsing a large world
+// (e.g. from a WorldArchive) fits about 4x the tiles in the same budget,
+// and finished maps leave GenerationWorker in it for display. Generation
+// itself still works on float planes.
+
+// Tile -> settlement id for the few tiles that have one, sorted by tile
+class SettlementMap {
+public:
+    using Entry = std::pair<uint32_t, int>; // tile index, settlement id
+
+    // -1 if the tile has no settlement
+    int get(uint32_t tile) const;
+
+    // id < 0 removes the tile's settlement
+    void set(uint32_t tile, int id);
+
+    void clear() { m_entries.clear(); }
+    size_t size() const { return m_entries.size(); }
+    const std::vector<Entry>& entries() const { return m_entries; }
+
+    // Replaces everything; entries must be sorted by tile and unique
+    void assign(std::vector<Entry> entries) { m_entries = std::move(entries); }
+
+    size_t getMemoryUsage() const { return m_entries.capacity() * sizeof(Entry); }
+
+private:
+    std::vector<Entry> m_entries;
+};
+
+namespace compact {
+
+// Fixed-point field over 0..1 that reads and writes as a float
+template <typename T>
+struct UnitRef {
+    T& value;
+
+    static constexpr float SCALE = (float)std::numeric_limits<T>::max();
+
+    static T encode(float v) {
+        v = v > 0.0f ? v : 0.0f; // NaN -> 0
+        v = v < 1.0f ? v : 1.0f;
+        return (T)(v * SCALE + 0.5f);
+    }
+    static float decode(T v) { return v * (1.0f / SCALE); }
+
+    operator float() const { return decode(value); }
+    UnitRef& operator=(float v) { value = encode(v); return *this; }
+    UnitRef& operator=(const UnitRef& other) { return *this = (float)other; }
+    UnitRef& operator+=(float v) { return *this = (float)*this + v; }
+    UnitRef& operator-=(float v) { return *this = (float)*this - v; }
+};
+
+// Biome in the low bits of a flags byte
+struct BiomeRef {
+    uint8_t& flags;
+
+    operator Biome() const;
+    BiomeRef& operator=(Biome biome);
+    BiomeRef& operator=(const BiomeRef& other) { return *this = (Biome)other; }
+};
+
+// One flag bit of a flags byte
+struct FlagRef {
+    uint8_t& flags;
+    uint8_t bit;
+
+    operator bool() const { return (flags & bit) != 0; }
+    FlagRef& operator=(bool set) {
+        flags = set ? (uint8_t)(flags | bit) : (uint8_t)(flags & ~bit);
+        return *this;
+    }
+    FlagRef& operator=(const FlagRef& other) { return *this = (bool)other; }
+};
+
+// Settlement id of one tile in a SettlementMap
+struct SettlementRef {
+    SettlementMap& map;
+    uint32_t tile;
+
+    operator int() const { return map.get(tile); }
+    SettlementRef& operator=(int id) { map.set(tile, id); return *this; }
+    SettlementRef& operator=(const SettlementRef& other) { return *this = (int)other; }
+};
+
+} // namespace compact
+
+// Reference to one tile of a CompactWorld; fields read and write like the
+// members of a TileRef
+struct CompactTileRef {
+    compact::UnitRef<uint16_t> height;
+    compact::UnitRef<uint8_t> moisture;
+    compact::UnitRef<uint8_t> temperature;
+    compact::BiomeRef biome;
+    compact::UnitRef<uint8_t> riverStrength;
+    compact::FlagRef isLake;
+    compact::FlagRef hasRoad;
+    compact::SettlementRef settlementId;
+
+    operator Tile() const {
+        return Tile{ height, moisture, temperature, biome, riverStrength, isLake, hasRoad, settlementId };
+    }
+
+    CompactTileRef& operator=(const Tile& t);
+    CompactTileRef& operator=(const CompactTileRef& other) { return *this = Tile(other); }
+};
+
+class CompactWorld {
+public:
+    static const uint8_t BIOME_MASK = 0x0F;
+    static const uint8_t LAKE_BIT = 0x10;
+    static const uint8_t ROAD_BIT = 0x20;
+
+    CompactWorld(int width = 0, int height = 0);
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    bool inBounds(int x, int y) const;
+
+    CompactTileRef at(int x, int y);
+    Tile at(int x, int y) const;
+
+    // Packs every field of a world of the same size; pool may be null.
+    // Every SIMD level produces the same bytes.
+    void encode(const World& world, ThreadPool* pool = nullptr);
+    void encode(const World& world, ThreadPool* pool, SimdLevel level);
+
+    // Unpacks into a world of the same size; pool may be null
+    void decode(World& world, ThreadPool* pool = nullptr) const;
+
+    // Quantized planes for bulk kernels (index = y * width + x)
+    Plane<uint16_t>& heightPlane() { return m_heightPlane; }
+    Plane<uint8_t>& moisturePlane() { return m_moisturePlane; }
+    Plane<uint8_t>& temperaturePlane() { return m_temperaturePlane; }
+    Plane<uint8_t>& riverPlane() { return m_riverPlane; }
+    Plane<uint8_t>& flagsPlane() { return m_flagsPlane; }
+    SettlementMap& settlements() { return m_settlements; }
+
+    const Plane<uint16_t>& heightPlane() const { return m_heightPlane; }
+    const Plane<uint8_t>& moisturePlane() const { return m_moisturePlane; }
+    const Plane<uint8_t>& temperaturePlane() const { return m_temperaturePlane; }
+    const Plane<uint8_t>& riverPlane() const { return m_riverPlane; }
+    const Plane<uint8_t>& flagsPlane() const { return m_flagsPlane; }
+    const SettlementMap& settlements() const { return m_settlements; }
+
+    void clear();
+
+    // Bytes held by all planes and the settlement list
+    size_t getMemoryUsage() const;
+
+private:
+    int m_width;
+    int m_height;
+
+    Plane<uint16_t> m_heightPlane;
+    Plane<uint8_t> m_moisturePlane;
+    Plane<uint8_t> m_temperaturePlane;
+    Plane<uint8_t> m_riverPlane;
+    Plane<uint8_t> m_flagsPlane; // biome | lake | road
+    SettlementMap m_settlements;
+
+    // Runs fn(begin, end) over bands of whole rows, on the pool if given
+    template <typename Fn>
+    void forEachRowBand(ThreadPool* pool, const Fn& fn) const;
+};
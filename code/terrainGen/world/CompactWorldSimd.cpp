@@ -0,0 +1,89 @@
+#include "CompactWorldSimd.h"
+#include "noise/PerlinNoiseSimd.h"
+
+#ifdef TG_NOISE_X86
+
+#include <immintrin.h>
+
+// max(v, 0) then min(v, 1) in this operand order sends NaN to 0, like the
+// scalar clamp; no FMA, so the results match it exactly.
+
+namespace {
+
+TG_TARGET_SSE41 inline __m128i quantize4(const float* in, __m128 scale) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(in), zero), one);
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half));
+}
+
+TG_TARGET_AVX2 inline __m256i quantize8(const float* in, __m256 scale) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 half = _mm256_set1_ps(0.5f);
+    __m256 v = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in), zero), one);
+    return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, scale), half));
+}
+
+} // namespace
+
+namespace CompactSimd {
+
+TG_TARGET_SSE41 size_t quantize16Sse41(const float* in, uint16_t* out, size_t count) {
+    const __m128 scale = _mm_set1_ps(65535.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i packed = _mm_packus_epi32(quantize4(in + i, scale), quantize4(in + i + 4, scale));
+        _mm_storeu_si128((__m128i*)(out + i), packed);
+    }
+    return i;
+}
+
+TG_TARGET_AVX2 size_t quantize16Avx2(const float* in, uint16_t* out, size_t count) {
+    const __m256 scale = _mm256_set1_ps(65535.0f);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        // packus works per 128-bit lane; the permute puts the halves back in order
+        __m256i packed = _mm256_packus_epi32(quantize8(in + i, scale), quantize8(in + i + 8, scale));
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+    return i;
+}
+
+TG_TARGET_SSE41 size_t quantize8Sse41(const float* in, uint8_t* out, size_t count) {
+    const __m128 scale = _mm_set1_ps(255.0f);
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m128i low = _mm_packus_epi32(quantize4(in + i, scale), quantize4(in + i + 4, scale));
+        __m128i high = _mm_packus_epi32(quantize4(in + i + 8, scale), quantize4(in + i + 12, scale));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packus_epi16(low, high));
+    }
+    return i;
+}
+
+TG_TARGET_AVX2 size_t quantize8Avx2(const float* in, uint8_t* out, size_t count) {
+    const __m256 scale = _mm256_set1_ps(255.0f);
+    const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+    size_t i = 0;
+    for (; i + 32 <= count; i += 32) {
+        __m256i low = _mm256_packus_epi32(quantize8(in + i, scale), quantize8(in + i + 8, scale));
+        __m256i high = _mm256_packus_epi32(quantize8(in + i + 16, scale), quantize8(in + i + 24, scale));
+        __m256i packed = _mm256_packus_epi16(low, high);
+        _mm256_storeu_si256((__m256i*)(out + i), _mm256_permutevar8x32_epi32(packed, order));
+    }
+    return i;
+}
+
+} // namespace CompactSimd
+
+#else
+
+namespace CompactSimd {
+    size_t quantize16Sse41(const float*, uint16_t*, size_t) { return 0; }
+    size_t quantize16Avx2(const float*, uint16_t*, size_t) { return 0; }
+    size_t quantize8Sse41(const float*, uint8_t*, size_t) { return 0; }
+    size_t quantize8Avx2(const float*, uint8_t*, size_t) { return 0; }
+}
+
+#endif
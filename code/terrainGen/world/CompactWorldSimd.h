@@ -0,0 +1,18 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// SIMD kernels behind CompactWorld::encode.
+// Each kernel processes whole vectors only and returns how many values it
+// wrote; the caller finishes the tail with the scalar path.
+
+namespace CompactSimd {
+    // out[i] = (int)(clamp(in[i], 0, 1) * 65535 + 0.5), NaN -> 0
+    size_t quantize16Sse41(const float* in, uint16_t* out, size_t count);
+    size_t quantize16Avx2(const float* in, uint16_t* out, size_t count);
+
+    // out[i] = (int)(clamp(in[i], 0, 1) * 255 + 0.5), NaN -> 0
+    size_t quantize8Sse41(const float* in, uint8_t* out, size_t count);
+    size_t quantize8Avx2(const float* in, uint8_t* out, size_t count);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+// One contiguous, cache-line aligned 2D array of a single tile field.
+// Rows are packed (stride == width) so a plane can be handed straight to
+// bulk or SIMD kernels as a flat array.
+template <typename T>
+class Plane {
+    static_assert(std::is_trivially_copyable<T>::value, "Plane only holds plain values");
+
+public:
+    static const size_t ALIGNMENT = 64;
+
+    Plane() = default;
+
+    Plane(int width, int height, T value = T())
+        : m_width(width), m_height(height), m_data(allocate(size()))
+    {
+        fill(value);
+    }
+
+    Plane(const Plane& other)
+        : m_width(other.m_width), m_height(other.m_height), m_data(allocate(other.size()))
+    {
+        if (size() > 0) std::memcpy(m_data.get(), other.m_data.get(), size() * sizeof(T));
+    }
+
+    Plane& operator=(const Plane& other) {
+        if (this != &other) {
+            Plane copy(other);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    Plane(Plane&&) = default;
+    Plane& operator=(Plane&&) = default;
+
+    int getWidth() const { return m_width; }
+    int getHeight() const { return m_height; }
+    size_t size() const { return (size_t)m_width * m_height; }
+
+    T* data() { return m_data.get(); }
+    const T* data() const { return m_data.get(); }
+
+    T* row(int y) { return m_data.get() + (size_t)y * m_width; }
+    const T* row(int y) const { return m_data.get() + (size_t)y * m_width; }
+
+    T& operator[](size_t i) { return m_data[i]; }
+    const T& operator[](size_t i) const { return m_data[i]; }
+
+    T& at(int x, int y) {
+        assert(x >= 0 && x < m_width && y >= 0 && y < m_height && "Plane::at() out of bounds");
+        return m_data[(size_t)y * m_width + x];
+    }
+
+    const T& at(int x, int y) const {
+        assert(x >= 0 && x < m_width && y >= 0 && y < m_height && "Plane::at() out of bounds");
+        return m_data[(size_t)y * m_width + x];
+    }
+
+    void fill(T value) {
+        T* p = m_data.get();
+        for (size_t i = 0, n = size(); i < n; ++i) {
+            p[i] = value;
+        }
+    }
+
+    size_t getMemoryUsage() const { return size() * sizeof(T); }
+
+private:
+    struct AlignedDelete {
+        void operator()(T* p) const {
+            ::operator delete(p, std::align_val_t(ALIGNMENT));
+        }
+    };
+
+    static T* allocate(size_t count) {
+        if (count == 0) return nullptr;
+        return static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(ALIGNMENT)));
+    }
+
+    int m_width = 0;
+    int m_height = 0;
+    std::unique_ptr<T[], AlignedDelete> m_data;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "util/ThreadPool.h"
+
+#include <algorithm>
+
+// 8-neighbour stencil passes over width x height planes.
+//
+// forEachStencil calls kernel(cell) for every tile. The map is processed in
+// square blocks so the three rows a block touches stay in cache, and blocks
+// run in parallel on the pool. Interior tiles get a StencilCell<false>: all
+// eight neighbours exist, has() is a compile-time true and no bounds checks
+// are emitted. Only the one-tile ring around the map takes the checked
+// StencilCell<true> path, so kernels are written once as a generic lambda:
+//
+//     forEachStencil(width, height, pool, [&](const auto& cell) {
+//         for (int dir = 0; dir < 8; ++dir) {
+//             if (!cell.has(dir)) continue;
+//             float h = heights[cell.neighbour(dir)];
+//             ...
+//         }
+//     });
+//
+// Neighbours are numbered N, NE, E, SE, S, SW, W, NW like the flow directions.
+
+namespace stencil {
+
+const int DX[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+const int DY[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+
+// Index offset of each neighbour in a plane of the given width
+struct Offsets {
+    int value[8];
+
+    explicit Offsets(int width) {
+        for (int dir = 0; dir < 8; ++dir) {
+            value[dir] = DY[dir] * width + DX[dir];
+        }
+    }
+};
+
+} // namespace stencil
+
+template <bool Border>
+struct StencilCell {
+    int x, y;
+    int idx; // y * width + x
+    int width, height;
+    const int* offsets;
+
+    bool has(int dir) const {
+        if (!Border) return true;
+        int nx = x + stencil::DX[dir];
+        int ny = y + stencil::DY[dir];
+        return nx >= 0 && ny >= 0 && nx < width && ny < height;
+    }
+
+    // Plane index of a neighbour; only valid if has(dir)
+    int neighbour(int dir) const {
+        return idx + offsets[dir];
+    }
+};
+
+// Runs kernel over every tile of a width x height plane; pool may be null.
+// Kernels must only write to the tile they are called for.
+template <typename Kernel>
+void forEachStencil(int width, int height, ThreadPool* pool, const Kernel& kernel, int blockSize = 64) {
+    if (width <= 0 || height <= 0) return;
+
+    const stencil::Offsets offsets(width);
+    const int blocksX = (width + blockSize - 1) / blockSize;
+    const int blocksY = (height + blockSize - 1) / blockSize;
+
+    auto runBlock = [&](int block) {
+        const int x0 = (block % blocksX) * blockSize;
+        const int y0 = (block / blocksX) * blockSize;
+        const int x1 = std::min(width, x0 + blockSize);
+        const int y1 = std::min(height, y0 + blockSize);
+
+        StencilCell<true> border{ 0, 0, 0, width, height, offsets.value };
+        auto checked = [&](int x, int y) {
+            border.x = x;
+            border.y = y;
+            border.idx = y * width + x;
+            kernel(static_cast<const StencilCell<true>&>(border));
+        };
+
+        // Interior columns of this block, clear of the left and right edge
+        const int ix0 = std::max(x0, 1);
+        const int ix1 = std::min(x1, width - 1);
+
+        for (int y = y0; y < y1; ++y) {
+            if (y == 0 || y == height - 1) {
+                for (int x = x0; x < x1; ++x) checked(x, y);
+                continue;
+            }
+
+            if (x0 == 0) checked(0, y);
+
+            StencilCell<false> cell{ ix0, y, y * width + ix0, width, height, offsets.value };
+            for (; cell.x < ix1; ++cell.x, ++cell.idx) {
+                kernel(static_cast<const StencilCell<false>&>(cell));
+            }
+
+            if (x1 == width && width > 1) checked(width - 1, y);
+        }
+    };
+
+    const int blocks = blocksX * blocksY;
+    if (pool) {
+        pool->parallelFor(blocks, runBlock);
+    }
+    else {
+        for (int block = 0; block < blocks; ++block) runBlock(block);
+    }
+}
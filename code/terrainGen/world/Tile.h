@@ -1,6 +1,8 @@
 #pragma once
 
-enum class Biome {
+#include <cstdint>
+
+enum class Biome : uint8_t {
     Ocean,
     Beach,
     Plains,
@@ -28,3 +30,65 @@ struct Tile {
     bool hasRoad = false;
     int settlementId = -1;
 };
+
+// Reference to one tile of a World, which stores each field in its own
+// plane. Fields read and write like the members of a Tile&.
+struct TileRef {
+    float& height;
+    float& moisture;
+    float& temperature;
+    Biome& biome;
+    float& riverStrength;
+    bool& isLake;
+    bool& hasRoad;
+    int& settlementId;
+
+    operator Tile() const {
+        return Tile{ height, moisture, temperature, biome, riverStrength, isLake, hasRoad, settlementId };
+    }
+
+    TileRef& operator=(const Tile& t) {
+        height = t.height;
+        moisture = t.moisture;
+        temperature = t.temperature;
+        biome = t.biome;
+        riverStrength = t.riverStrength;
+        isLake = t.isLake;
+        hasRoad = t.hasRoad;
+        settlementId = t.settlementId;
+        return *this;
+    }
+
+    TileRef& operator=(const TileRef& other) {
+        return *this = Tile(other);
+    }
+};
+
+// Read-only counterpart of TileRef
+struct ConstTileRef {
+    const float& height;
+    const float& moisture;
+    const float& temperature;
+    const Biome& biome;
+    const float& riverStrength;
+    const bool& isLake;
+    const bool& hasRoad;
+    const int& settlementId;
+
+    ConstTileRef(const TileRef& t)
+        : height(t.height), moisture(t.moisture), temperature(t.temperature), biome(t.biome),
+        riverStrength(t.riverStrength), isLake(t.isLake), hasRoad(t.hasRoad), settlementId(t.settlementId)
+    {
+    }
+
+    ConstTileRef(const float& height, const float& moisture, const float& temperature, const Biome& biome,
+        const float& riverStrength, const bool& isLake, const bool& hasRoad, const int& settlementId)
+        : height(height), moisture(moisture), temperature(temperature), biome(biome),
+        riverStrength(riverStrength), isLake(isLake), hasRoad(hasRoad), settlementId(settlementId)
+    {
+    }
+
+    operator Tile() const {
+        return Tile{ height, moisture, temperature, biome, riverStrength, isLake, hasRoad, settlementId };
+    }
+};
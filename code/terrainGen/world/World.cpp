@@ -1,11 +1,20 @@
-#include "world.h"
-#include "tile.h"
+#include "World.h"
+#include "Tile.h"
 
 #include <cassert>
 #include <algorithm>
+#include <cstring>
 
 World::World(int width, int height)
-    : m_width(width), m_height(height), m_tiles(width* height)
+    : m_width(width), m_height(height),
+    m_heightPlane(width, height, Tile{}.height),
+    m_moisturePlane(width, height, Tile{}.moisture),
+    m_temperaturePlane(width, height, Tile{}.temperature),
+    m_biomePlane(width, height, Tile{}.biome),
+    m_riverPlane(width, height, Tile{}.riverStrength),
+    m_lakePlane(width, height, Tile{}.isLake),
+    m_roadPlane(width, height, Tile{}.hasRoad),
+    m_settlementPlane(width, height, Tile{}.settlementId)
 {
 }
 
@@ -25,16 +34,56 @@ int World::index(int x, int y) const {
     return y * m_width + x;
 }
 
-Tile& World::at(int x, int y) {
+TileRef World::at(int x, int y) {
     assert(inBounds(x, y) && "World::at() out of bounds");
-    return m_tiles[index(x, y)];
+    int i = index(x, y);
+    return TileRef{
+        m_heightPlane[i], m_moisturePlane[i], m_temperaturePlane[i], m_biomePlane[i],
+        m_riverPlane[i], m_lakePlane[i], m_roadPlane[i], m_settlementPlane[i]
+    };
 }
 
-const Tile& World::at(int x, int y) const {
+ConstTileRef World::at(int x, int y) const {
     assert(inBounds(x, y) && "World::at() out of bounds");
-    return m_tiles[index(x, y)];
+    int i = index(x, y);
+    return ConstTileRef(
+        m_heightPlane[i], m_moisturePlane[i], m_temperaturePlane[i], m_biomePlane[i],
+        m_riverPlane[i], m_lakePlane[i], m_roadPlane[i], m_settlementPlane[i]
+    );
 }
 
 void World::clear() {
-    std::fill(m_tiles.begin(), m_tiles.end(), Tile{});
+    const Tile empty{};
+    m_heightPlane.fill(empty.height);
+    m_moisturePlane.fill(empty.moisture);
+    m_temperaturePlane.fill(empty.temperature);
+    m_biomePlane.fill(empty.biome);
+    m_riverPlane.fill(empty.riverStrength);
+    m_lakePlane.fill(empty.isLake);
+    m_roadPlane.fill(empty.hasRoad);
+    m_settlementPlane.fill(empty.settlementId);
+}
+
+void World::copyRegion(const World& source, int sourceX, int sourceY, int x, int y, int width, int height) {
+    auto copy = [&](auto& to, const auto& from) {
+        const size_t rowBytes = (size_t)width * sizeof(to[0]);
+        for (int row = 0; row < height; ++row) {
+            std::memcpy(to.row(y + row) + x, from.row(sourceY + row) + sourceX, rowBytes);
+        }
+    };
+    copy(m_heightPlane, source.m_heightPlane);
+    copy(m_moisturePlane, source.m_moisturePlane);
+    copy(m_temperaturePlane, source.m_temperaturePlane);
+    copy(m_biomePlane, source.m_biomePlane);
+    copy(m_riverPlane, source.m_riverPlane);
+    copy(m_lakePlane, source.m_lakePlane);
+    copy(m_roadPlane, source.m_roadPlane);
+    copy(m_settlementPlane, source.m_settlementPlane);
+}
+
+size_t World::getMemoryUsage() const {
+    return m_heightPlane.getMemoryUsage() + m_moisturePlane.getMemoryUsage() +
+        m_temperaturePlane.getMemoryUsage() + m_biomePlane.getMemoryUsage() +
+        m_riverPlane.getMemoryUsage() + m_lakePlane.getMemoryUsage() +
+        m_roadPlane.getMemoryUsage() + m_settlementPlane.getMemoryUsage();
 }
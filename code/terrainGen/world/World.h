@@ -1,8 +1,12 @@
 #pragma once
 
 #include <vector>
-#include "tile.h"
+#include "Tile.h"
+#include "Plane.h"
 
+// Tiles are stored as a structure of arrays: every Tile field lives in its
+// own contiguous plane. at(x, y) returns a TileRef proxy for per-tile code;
+// bulk passes should walk the planes directly.
 class World {
 public:
     World(int width, int height);
@@ -12,21 +16,60 @@ public:
     int getHeight() const;
 
     // Tile access (safe)
-    Tile& at(int x, int y);
-    const Tile& at(int x, int y) const;
+    TileRef at(int x, int y);
+    ConstTileRef at(int x, int y) const;
 
     // Bounds check
     bool inBounds(int x, int y) const;
 
+    // Field planes for bulk kernels (index = y * width + x)
+    Plane<float>& heightPlane() { return m_heightPlane; }
+    Plane<float>& moisturePlane() { return m_moisturePlane; }
+    Plane<float>& temperaturePlane() { return m_temperaturePlane; }
+    Plane<Biome>& biomePlane() { return m_biomePlane; }
+    Plane<float>& riverPlane() { return m_riverPlane; }
+    Plane<bool>& lakePlane() { return m_lakePlane; }
+    Plane<bool>& roadPlane() { return m_roadPlane; }
+    Plane<int>& settlementPlane() { return m_settlementPlane; }
+
+    const Plane<float>& heightPlane() const { return m_heightPlane; }
+    const Plane<float>& moisturePlane() const { return m_moisturePlane; }
+    const Plane<float>& temperaturePlane() const { return m_temperaturePlane; }
+    const Plane<Biome>& biomePlane() const { return m_biomePlane; }
+    const Plane<float>& riverPlane() const { return m_riverPlane; }
+    const Plane<bool>& lakePlane() const { return m_lakePlane; }
+    const Plane<bool>& roadPlane() const { return m_roadPlane; }
+    const Plane<int>& settlementPlane() const { return m_settlementPlane; }
+
     // Utilities
     void clear();
 
+    // Copies the width x height tiles at (sourceX, sourceY) of source, every
+    // plane, to (x, y); both areas must lie inside their worlds
+    void copyRegion(const World& source, int sourceX, int sourceY, int x, int y, int width, int height);
+
+    // Bytes held by all planes
+    size_t getMemoryUsage() const;
+
 private:
     int m_width;
     int m_height;
 
-    std::vector<Tile> m_tiles;
+    // Core terrain
+    Plane<float> m_heightPlane;
+    Plane<float> m_moisturePlane;
+    Plane<float> m_temperaturePlane;
+
+    // Derived data
+    Plane<Biome> m_biomePlane;
+
+    // Hydrology
+    Plane<float> m_riverPlane;
+    Plane<bool> m_lakePlane;
+
+    // Infrastructure
+    Plane<bool> m_roadPlane;
+    Plane<int> m_settlementPlane;
 
     int index(int x, int y) const;
 };
-#pragma once
@@ -0,0 +1,338 @@
+#include "WorldArchive.h"
+
+#include "util/Compression.h"
+#include "util/Hash.h"
+#include "util/ThreadPool.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+
+namespace {
+
+const char MAGIC[8] = { 'T', 'G', 'W', 'O', 'R', 'L', 'D', '\0' };
+const uint32_t PLANE_COUNT = 8;
+const size_t HEADER_SIZE = 32;
+const size_t INDEX_ENTRY_SIZE = 20;
+
+void putLE32(std::vector<uint8_t>& out, uint32_t v) {
+    for (int i = 0; i < 4; ++i) out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+void putLE64(std::vector<uint8_t>& out, uint64_t v) {
+    for (int i = 0; i < 8; ++i) out.push_back((uint8_t)(v >> (8 * i)));
+}
+
+uint32_t getLE32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint64_t getLE64(const uint8_t* p) {
+    return (uint64_t)getLE32(p) | ((uint64_t)getLE32(p + 4) << 32);
+}
+
+// FNV-1a over 8-byte words: same idea as fnv1a, eight times fewer steps,
+// so verifying a chunk costs little next to decompressing it
+uint64_t chunkChecksum(const uint8_t* data, size_t size) {
+    uint64_t hash = FNV_OFFSET_BASIS;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash = (hash ^ word) * 1099511628211ull;
+    }
+    return fnv1a(data + i, size - i, hash);
+}
+
+// Calls fn on every plane in file order
+template <typename W, typename Fn>
+void forEachPlane(W& world, const Fn& fn) {
+    fn(world.heightPlane());
+    fn(world.moisturePlane());
+    fn(world.temperaturePlane());
+    fn(world.biomePlane());
+    fn(world.riverPlane());
+    fn(world.lakePlane());
+    fn(world.roadPlane());
+    fn(world.settlementPlane());
+}
+
+// Appends the w x h region at (x0, y0) of every plane to blob
+void encodeChunk(const World& world, int x0, int y0, int w, int h, std::vector<uint8_t>& blob) {
+    std::vector<uint8_t> raw;
+    std::vector<uint8_t> filtered;
+    blob.clear();
+
+    forEachPlane(world, [&](const auto& plane) {
+        using T = typename std::decay<decltype(plane[0])>::type;
+        const size_t count = (size_t)w * h;
+        const size_t rowBytes = (size_t)w * sizeof(T);
+
+        raw.resize(count * sizeof(T));
+        for (int y = 0; y < h; ++y) {
+            std::memcpy(raw.data() + y * rowBytes, plane.row(y0 + y) + x0, rowBytes);
+        }
+
+        const uint8_t* input = raw.data();
+        if (sizeof(T) == 4) {
+            filtered.resize(raw.size());
+            shuffleDelta32(raw.data(), count, filtered.data());
+            input = filtered.data();
+        }
+
+        // Size prefix, patched once the block is done
+        const size_t sizePos = blob.size();
+        putLE32(blob, 0);
+        lzCompress(input, raw.size(), blob);
+        const uint32_t size = (uint32_t)(blob.size() - sizePos - 4);
+        for (int i = 0; i < 4; ++i) blob[sizePos + i] = (uint8_t)(size >> (8 * i));
+    });
+}
+
+// Writes header, index and chunks; encode(chunkX, chunkY, blob) produces one chunk
+bool writeArchive(const std::string& path, int width, int height, int chunkSize, int threadCount,
+    const std::function<void(int, int, std::vector<uint8_t>&)>& encode) {
+    if (width <= 0 || height <= 0 || chunkSize <= 0) return false;
+
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    const int chunksX = (width + chunkSize - 1) / chunkSize;
+    const int chunksY = (height + chunkSize - 1) / chunkSize;
+
+    std::vector<uint8_t> header;
+    header.insert(header.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    putLE32(header, WorldArchive::VERSION);
+    putLE32(header, PLANE_COUNT);
+    putLE32(header, (uint32_t)width);
+    putLE32(header, (uint32_t)height);
+    putLE32(header, (uint32_t)chunkSize);
+    putLE32(header, 0); // flags, reserved
+
+    // Index placeholder; the real one is written once all sizes are known
+    std::vector<uint8_t> index((size_t)chunksX * chunksY * INDEX_ENTRY_SIZE, 0);
+    std::fwrite(header.data(), 1, header.size(), file);
+    std::fwrite(index.data(), 1, index.size(), file);
+    index.clear();
+
+    ThreadPool pool(threadCount);
+    std::vector<std::vector<uint8_t>> blobs(chunksX);
+    uint64_t offset = HEADER_SIZE + (uint64_t)chunksX * chunksY * INDEX_ENTRY_SIZE;
+
+    for (int chunkY = 0; chunkY < chunksY; ++chunkY) {
+        pool.parallelFor(chunksX, [&](int chunkX) { encode(chunkX, chunkY, blobs[chunkX]); });
+
+        for (const std::vector<uint8_t>& blob : blobs) {
+            putLE64(index, offset);
+            putLE64(index, chunkChecksum(blob.data(), blob.size()));
+            putLE32(index, (uint32_t)blob.size());
+            std::fwrite(blob.data(), 1, blob.size(), file);
+            offset += blob.size();
+        }
+    }
+
+    // The index sits right after the header, well within fseek's range
+    std::fseek(file, (long)HEADER_SIZE, SEEK_SET);
+    std::fwrite(index.data(), 1, index.size(), file);
+
+    bool ok = std::ferror(file) == 0;
+    return std::fclose(file) == 0 && ok;
+}
+
+} // namespace
+
+bool saveWorldArchive(const std::string& path, int width, int height, int chunkSize,
+    const ChunkGenerator& source, int threadCount) {
+    return writeArchive(path, width, height, chunkSize, threadCount,
+        [&](int chunkX, int chunkY, std::vector<uint8_t>& blob) {
+            World chunk(chunkSize, chunkSize);
+            source(chunk, chunkX * chunkSize, chunkY * chunkSize);
+            encodeChunk(chunk, 0, 0,
+                std::min(chunkSize, width - chunkX * chunkSize),
+                std::min(chunkSize, height - chunkY * chunkSize), blob);
+        });
+}
+
+bool saveWorldArchive(const std::string& path, const World& world, int chunkSize, int threadCount) {
+    const int width = world.getWidth();
+    const int height = world.getHeight();
+    return writeArchive(path, width, height, chunkSize, threadCount,
+        [&](int chunkX, int chunkY, std::vector<uint8_t>& blob) {
+            int x0 = chunkX * chunkSize;
+            int y0 = chunkY * chunkSize;
+            encodeChunk(world, x0, y0, std::min(chunkSize, width - x0), std::min(chunkSize, height - y0), blob);
+        });
+}
+
+// ----------- READING -----------
+
+bool WorldArchive::open(const std::string& path) {
+    close();
+    if (!m_file.open(path)) return false;
+
+    const uint8_t* data = m_file.data();
+    const size_t size = m_file.size();
+    if (size < HEADER_SIZE || std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0 ||
+        getLE32(data + 8) != VERSION || getLE32(data + 12) != PLANE_COUNT) {
+        close();
+        return false;
+    }
+
+    m_width = (int)getLE32(data + 16);
+    m_height = (int)getLE32(data + 20);
+    m_chunkSize = (int)getLE32(data + 24);
+    if (m_width <= 0 || m_height <= 0 || m_chunkSize <= 0) {
+        close();
+        return false;
+    }
+    m_chunksX = (m_width + m_chunkSize - 1) / m_chunkSize;
+    m_chunksY = (m_height + m_chunkSize - 1) / m_chunkSize;
+
+    const size_t chunks = (size_t)m_chunksX * m_chunksY;
+    if ((size - HEADER_SIZE) / INDEX_ENTRY_SIZE < chunks) {
+        close();
+        return false;
+    }
+
+    m_index.resize(chunks);
+    const uint8_t* entry = data + HEADER_SIZE;
+    for (IndexEntry& e : m_index) {
+        e.offset = getLE64(entry);
+        e.checksum = getLE64(entry + 8);
+        e.size = getLE32(entry + 16);
+        entry += INDEX_ENTRY_SIZE;
+
+        if (e.offset > size || e.size > size - e.offset) {
+            close();
+            return false;
+        }
+    }
+    return true;
+}
+
+void WorldArchive::close() {
+    m_file.close();
+    m_index.clear();
+    m_width = m_height = m_chunkSize = 0;
+    m_chunksX = m_chunksY = 0;
+}
+
+bool WorldArchive::isOpen() const {
+    return m_file.isOpen();
+}
+
+int WorldArchive::getWidth() const {
+    return m_width;
+}
+
+int WorldArchive::getHeight() const {
+    return m_height;
+}
+
+int WorldArchive::getChunkSize() const {
+    return m_chunkSize;
+}
+
+int WorldArchive::getChunksX() const {
+    return m_chunksX;
+}
+
+int WorldArchive::getChunksY() const {
+    return m_chunksY;
+}
+
+size_t WorldArchive::getFileSize() const {
+    return m_file.size();
+}
+
+bool WorldArchive::readChunk(int chunkX, int chunkY, World& out, int outX, int outY) const {
+    if (chunkX < 0 || chunkY < 0 || chunkX >= m_chunksX || chunkY >= m_chunksY) return false;
+
+    const IndexEntry& entry = m_index[(size_t)chunkY * m_chunksX + chunkX];
+    const uint8_t* ip = m_file.data() + entry.offset;
+    const uint8_t* const end = ip + entry.size;
+    if (chunkChecksum(ip, entry.size) != entry.checksum) return false;
+
+    const int w = std::min(m_chunkSize, m_width - chunkX * m_chunkSize);
+    const int h = std::min(m_chunkSize, m_height - chunkY * m_chunkSize);
+
+    // Part of the chunk that lands inside out
+    const int x0 = std::max(0, -outX);
+    const int y0 = std::max(0, -outY);
+    const int x1 = std::min(w, out.getWidth() - outX);
+    const int y1 = std::min(h, out.getHeight() - outY);
+
+    thread_local std::vector<uint8_t> raw;
+    thread_local std::vector<uint8_t> filtered;
+    bool ok = true;
+
+    forEachPlane(out, [&](auto& plane) {
+        using T = typename std::decay<decltype(plane[0])>::type;
+        if (!ok) return;
+
+        const size_t count = (size_t)w * h;
+        if (end - ip < 4) {
+            ok = false;
+            return;
+        }
+        const uint32_t size = getLE32(ip);
+        ip += 4;
+        if ((size_t)(end - ip) < size) {
+            ok = false;
+            return;
+        }
+
+        raw.resize(count * sizeof(T));
+        if (sizeof(T) == 4) {
+            filtered.resize(raw.size());
+            ok = lzDecompress(ip, size, filtered.data(), filtered.size());
+            if (ok) unshuffleDelta32(filtered.data(), count, raw.data());
+        }
+        else {
+            ok = lzDecompress(ip, size, raw.data(), raw.size());
+        }
+        ip += size;
+        if (!ok || x1 <= x0) return;
+
+        const size_t rowBytes = (size_t)(x1 - x0) * sizeof(T);
+        for (int y = y0; y < y1; ++y) {
+            std::memcpy(plane.row(outY + y) + outX + x0, raw.data() + ((size_t)y * w + x0) * sizeof(T), rowBytes);
+        }
+    });
+
+    return ok;
+}
+
+bool WorldArchive::readWorld(World& out, int threadCount) const {
+    if (!isOpen() || out.getWidth() < m_width || out.getHeight() < m_height) return false;
+
+    ThreadPool pool(threadCount);
+    std::vector<uint8_t> ok(m_index.size(), 0);
+    pool.parallelFor((int)m_index.size(), [&](int chunk) {
+        int chunkX = chunk % m_chunksX;
+        int chunkY = chunk / m_chunksX;
+        ok[chunk] = readChunk(chunkX, chunkY, out, chunkX * m_chunkSize, chunkY * m_chunkSize);
+    });
+    return std::find(ok.begin(), ok.end(), 0) == ok.end();
+}
+
+ChunkGenerator WorldArchive::chunkSource() const {
+    return [this](World& chunk, int originX, int originY) {
+        const int right = originX + chunk.getWidth();
+        const int bottom = originY + chunk.getHeight();
+        if (!isOpen() || right <= 0 || bottom <= 0) return;
+
+        // Archive chunks overlapping the requested area
+        const int cx0 = std::max(0, originX) / m_chunkSize;
+        const int cy0 = std::max(0, originY) / m_chunkSize;
+        const int cx1 = std::min(m_chunksX, (right + m_chunkSize - 1) / m_chunkSize);
+        const int cy1 = std::min(m_chunksY, (bottom + m_chunkSize - 1) / m_chunkSize);
+
+        for (int chunkY = cy0; chunkY < cy1; ++chunkY) {
+            for (int chunkX = cx0; chunkX < cx1; ++chunkX) {
+                readChunk(chunkX, chunkY, chunk, chunkX * m_chunkSize - originX, chunkY * m_chunkSize - originY);
+            }
+        }
+    };
+}
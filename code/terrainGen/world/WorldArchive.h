@@ -0,0 +1,79 @@
+#pragma once
+
+#include "ChunkedWorld.h"
+#include "World.h"
+#include "util/MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Versioned binary world file.
+//
+//   header  magic "TGWORLD\0", version, plane count, width, height, chunk size
+//   index   one entry per chunk, row-major: file offset, checksum, byte size
+//   chunks  every plane of the chunk as [uint32 size][compressed bytes], in
+//           World order: height, moisture, temperature, biome, river, lake,
+//           road, settlement
+//
+// Each plane is compressed on its own (4-byte planes are delta-shuffled
+// first, see Compression.h). All integers are little-endian. Edge chunks
+// only store the tiles inside the world.
+
+// Writes a width x height world chunk by chunk. source fills a
+// chunkSize x chunkSize World for a chunk origin, like a ChunkedWorld
+// generator. Only one row of chunks is in memory at a time, so worlds far
+// larger than RAM can be written straight from a TerrainGenerator.
+bool saveWorldArchive(const std::string& path, int width, int height, int chunkSize,
+    const ChunkGenerator& source, int threadCount = 0);
+
+// Writes an in-memory world
+bool saveWorldArchive(const std::string& path, const World& world, int chunkSize = 256, int threadCount = 0);
+
+// Random-access reader. The file is memory-mapped: open() only validates
+// the header and index, and every read decompresses just the chunks it
+// touches. Reads are const and may run concurrently.
+class WorldArchive {
+public:
+    static const uint32_t VERSION = 1;
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const;
+
+    int getWidth() const;
+    int getHeight() const;
+    int getChunkSize() const;
+    int getChunksX() const;
+    int getChunksY() const;
+    size_t getFileSize() const;
+
+    // Decompresses one chunk into out, with its tile (0, 0) at (outX, outY).
+    // Tiles falling outside out are skipped. Returns false if the chunk does
+    // not exist or fails its checksum.
+    bool readChunk(int chunkX, int chunkY, World& out, int outX = 0, int outY = 0) const;
+
+    // Fills out, which must be at least getWidth() x getHeight()
+    bool readWorld(World& out, int threadCount = 0) const;
+
+    // Chunk source for a ChunkedWorld of any chunk size, which caches them
+    // as CompactWorlds: decompresses only the archive chunks a requested
+    // chunk overlaps. Tiles outside the
+    // archive, or in a corrupt chunk, keep their defaults. The archive must
+    // outlive the returned function.
+    ChunkGenerator chunkSource() const;
+
+private:
+    struct IndexEntry {
+        uint64_t offset;
+        uint64_t checksum; // of the chunk bytes
+        uint32_t size;
+    };
+
+    MappedFile m_file;
+    int m_width = 0;
+    int m_height = 0;
+    int m_chunkSize = 0;
+    int m_chunksX = 0;
+    int m_chunksY = 0;
+    std::vector<IndexEntry> m_index;
+};
@@ -0,0 +1,106 @@
+#include "WorldPyramid.h"
+
+#include <algorithm>
+#include <cassert>
+
+WorldPyramid::WorldPyramid(int width, int height, int levelCount)
+    : m_width(width), m_height(height)
+{
+    levelCount = std::max(1, levelCount);
+    for (int level = 0; level < levelCount; ++level) {
+        m_levels.emplace_back(new World(levelExtent(width, level), levelExtent(height, level)));
+    }
+}
+
+int WorldPyramid::getWidth() const {
+    return m_width;
+}
+
+int WorldPyramid::getHeight() const {
+    return m_height;
+}
+
+int WorldPyramid::getLevelCount() const {
+    return (int)m_levels.size();
+}
+
+World& WorldPyramid::level(int index) {
+    assert(index >= 0 && index < getLevelCount() && "WorldPyramid::level() out of range");
+    return *m_levels[index];
+}
+
+const World& WorldPyramid::level(int index) const {
+    assert(index >= 0 && index < getLevelCount() && "WorldPyramid::level() out of range");
+    return *m_levels[index];
+}
+
+int WorldPyramid::levelExtent(int size, int level) {
+    return (size + (1 << level) - 1) >> level;
+}
+
+int WorldPyramid::levelsFor(int width, int height, int maxLevels, int minExtent) {
+    int levels = 1;
+    while (levels < maxLevels &&
+        levelExtent(width, levels) >= minExtent && levelExtent(height, levels) >= minExtent) {
+        ++levels;
+    }
+    return levels;
+}
+
+void WorldPyramid::downsample(ThreadPool* pool) {
+    for (int index = 1; index < getLevelCount(); ++index) {
+        const World& fine = *m_levels[index - 1];
+        World& coarse = *m_levels[index];
+        const int fineWidth = fine.getWidth();
+        const int fineHeight = fine.getHeight();
+        const int width = coarse.getWidth();
+
+        auto row = [&](int y) {
+            const int fy = y * 2;
+            const int fy1 = std::min(fy + 1, fineHeight - 1);
+            const size_t top = (size_t)fy * fineWidth;
+            const size_t bottom = (size_t)fy1 * fineWidth;
+            const size_t out = (size_t)y * width;
+
+            for (int x = 0; x < width; ++x) {
+                const size_t f = top + x * 2;
+                const size_t c = out + x;
+                const int dx = std::min(x * 2 + 1, fineWidth - 1) - x * 2;
+                const size_t block[4] = { f, f + dx, bottom + x * 2, bottom + x * 2 + dx };
+
+                coarse.heightPlane()[c] = fine.heightPlane()[f];
+                coarse.moisturePlane()[c] = fine.moisturePlane()[f];
+                coarse.temperaturePlane()[c] = fine.temperaturePlane()[f];
+                coarse.biomePlane()[c] = fine.biomePlane()[f];
+                coarse.settlementPlane()[c] = fine.settlementPlane()[f];
+
+                float river = 0.0f;
+                bool lake = false;
+                bool road = false;
+                for (size_t i : block) {
+                    river = std::max(river, fine.riverPlane()[i]);
+                    lake = lake || fine.lakePlane()[i];
+                    road = road || fine.roadPlane()[i];
+                }
+                coarse.riverPlane()[c] = river;
+                coarse.lakePlane()[c] = lake;
+                coarse.roadPlane()[c] = road;
+            }
+        };
+
+        if (pool) {
+            pool->parallelFor(coarse.getHeight(), row);
+        }
+        else {
+            for (int y = 0; y < coarse.getHeight(); ++y) row(y);
+        }
+    }
+}
+
+size_t WorldPyramid::getMemoryUsage() const {
+    size_t bytes = 0;
+    for (const std::unique_ptr<World>& level : m_levels) {
+        bytes += level->getMemoryUsage();
+    }
+    return bytes;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include "World.h"
+#include "util/ThreadPool.h"
+#include <memory>
+#include <vector>
+
+// Resolution levels of one map. Level 0 is the full map; tile (x, y) of
+// level k is tile (x << k, y << k) of level 0, so level k is
+// ceil(width / 2^k) x ceil(height / 2^k) tiles.
+//
+// Levels are point samples rather than averages: a coarse level holds
+// exactly the values the full map has at those tiles, and every tile of
+// level k + 1 reappears in level k. Progressive generation relies on that
+// to compute each sample once (TerrainGenerator::generateProgressive).
+// Each level is an ordinary World and can be read, rendered or processed
+// on its own.
+class WorldPyramid {
+public:
+    WorldPyramid(int width, int height, int levelCount);
+
+    int getWidth() const;
+    int getHeight() const;
+    int getLevelCount() const;
+
+    World& level(int index);
+    const World& level(int index) const;
+
+    // Tiles along one axis of a level
+    static int levelExtent(int size, int level);
+
+    // Most levels (at most maxLevels) whose coarsest is at least minExtent
+    // tiles along both axes
+    static int levelsFor(int width, int height, int maxLevels, int minExtent = 1);
+
+    // Refreshes the coarser levels from level 0 after it was changed.
+    // Height, moisture, temperature, biome and settlements are point
+    // sampled; rivers keep their strongest tile and lakes and roads any
+    // tile of the 2x2 block, so thin features survive at every level.
+    void downsample(ThreadPool* pool = nullptr);
+
+    // Bytes held by all levels
+    size_t getMemoryUsage() const;
+
+private:
+    int m_width;
+    int m_height;
+    std::vector<std::unique_ptr<World>> m_levels;
+};